@@ -0,0 +1,134 @@
+#!/usr/bin/env bash
+#Load profiling and time-to-first-playable-frame runs of a packaged Linux build.
+#
+#  OryxLoadProfile.sh profile <BuildDir> [Map...]
+#      One run with -OryxLoadProfile per map (NewMap and GravityGunMap by default). The open orders are merged, first
+#      run first, into Build/Linux/FileOpenOrder/GameOpenOrder.log where BuildCookRun picks them up for the next
+#      package. The preload lists are printed to merge into Config/DefaultGame.ini.
+#  OryxLoadProfile.sh time <BuildDir> [Map] [Runs]
+#      Median time-to-first-playable-frame over Runs (5) runs.
+#  OryxLoadProfile.sh compare <BeforeDir> <AfterDir> [Map] [Runs]
+#      Times both builds, interleaved so drift in the machine hits both the same.
+#
+#BuildDir is the staged Linux build (the folder holding Oryx.sh). Map defaults to /Game/Maps/NewMap.
+#Runs are cold when the page cache can be dropped (root, or passwordless sudo), warm otherwise.
+#Extra game arguments go in ORYX_ARGS. Preload lists can be switched off for a run with ORYX_ARGS=-dpcvars=Oryx.Preload=0
+set -euo pipefail
+
+ProjectDir="$(cd "$(dirname "${BASH_SOURCE[0]}")/../.." && pwd)"
+OutDir="${ORYX_PROFILE_DIR:-$ProjectDir/Saved/Profiling/OryxLoad}"
+Timeout="${ORYX_TIMEOUT:-300}"
+
+usage()
+{
+	sed -n '2,15p' "${BASH_SOURCE[0]}" | sed 's/^#//'
+	exit 2
+}
+
+drop_caches()
+{
+	sync
+	if [ "$(id -u)" -eq 0 ]; then
+		echo 3 > /proc/sys/vm/drop_caches
+	elif sudo -n true 2>/dev/null; then
+		echo 3 | sudo -n tee /proc/sys/vm/drop_caches > /dev/null
+	else
+		[ -n "${WarnedWarm:-}" ] || echo "warning: can't drop the page cache, runs are warm" >&2
+		WarnedWarm=1
+	fi
+}
+
+#run_game <BuildDir> <RunDir> <Map> <args...>
+run_game()
+{
+	local BuildDir="$1" RunDir="$2" Map="$3"
+	shift 3
+	[ -x "$BuildDir/Oryx.sh" ] || { echo "no Oryx.sh in $BuildDir" >&2; exit 1; }
+
+	mkdir -p "$RunDir"
+	drop_caches
+	timeout "$Timeout" "$BuildDir/Oryx.sh" "$Map" -unattended -nosound -windowed -ResX=1280 -ResY=720 \
+		-OryxLoadProfileExit -OryxLoadProfileDir="$RunDir" "$@" ${ORYX_ARGS:-} > "$RunDir/Game.log" 2>&1 \
+		|| echo "warning: run in $RunDir exited with $?" >&2
+}
+
+#time_build <BuildDir> <Map> <Run> <Label>, appends one time to <Label>.txt
+time_build()
+{
+	local RunDir="$OutDir/$4/Run$3"
+	rm -rf "$RunDir"
+	run_game "$1" "$RunDir" "$2" -OryxFirstFrame
+	if [ -f "$RunDir/FirstFrame.csv" ]; then
+		tail -n 1 "$RunDir/FirstFrame.csv" | cut -d, -f2 >> "$OutDir/$4.txt"
+		echo "$4 run $3: $(tail -n 1 "$OutDir/$4.txt") s"
+	else
+		echo "$4 run $3: no playable frame, see $RunDir/Game.log" >&2
+	fi
+}
+
+median()
+{
+	[ -s "$1" ] || { echo "n/a"; return; }
+	sort -g "$1" | awk '{ v[NR] = $1 } END { if (NR % 2) print v[(NR + 1) / 2]; else printf "%.4f\n", (v[NR / 2] + v[NR / 2 + 1]) / 2 }'
+}
+
+Mode="${1:-}"
+case "$Mode" in
+profile)
+	[ $# -ge 2 ] || usage
+	BuildDir="$2"
+	shift 2
+	Maps=("$@")
+	[ ${#Maps[@]} -gt 0 ] || Maps=(/Game/Maps/NewMap /Game/Maps/GravityGunMap)
+
+	OrderFiles=()
+	PreloadLines=()
+	for Map in "${Maps[@]}"; do
+		RunDir="$OutDir/Profile/$(basename "$Map")"
+		rm -rf "$RunDir"
+		run_game "$BuildDir" "$RunDir" "$Map" -OryxLoadProfile
+		[ -f "$RunDir/GameOpenOrder.log" ] || { echo "no profile written, see $RunDir/Game.log" >&2; exit 1; }
+		echo "$Map: $RunDir/Packages.csv ($(($(wc -l < "$RunDir/Packages.csv") - 1)) packages)"
+		OrderFiles+=("$RunDir/GameOpenOrder.log")
+		while IFS= read -r Line; do PreloadLines+=("$Line"); done < <(grep '^+MapPreloads=' "$RunDir/Preload.ini" || true)
+	done
+
+	#A file keeps the place of its first open, later runs only add what earlier ones didn't load
+	mkdir -p "$ProjectDir/Build/Linux/FileOpenOrder"
+	awk '{ sub(/ [0-9]+$/, "") } !Seen[$0]++ { print $0 " " ++Order }' "${OrderFiles[@]}" \
+		> "$ProjectDir/Build/Linux/FileOpenOrder/GameOpenOrder.log"
+	echo "File open order: Build/Linux/FileOpenOrder/GameOpenOrder.log, used by the next BuildCookRun"
+	echo "Preload lists, merge into Config/DefaultGame.ini:"
+	echo "[/Script/Oryx.OryxPreloadSubsystem]"
+	printf '%s\n' "${PreloadLines[@]}" | awk -F'"' '!Seen[$2]++'
+	;;
+time)
+	[ $# -ge 2 ] || usage
+	Map="${3:-/Game/Maps/NewMap}"
+	Runs="${4:-5}"
+	rm -f "$OutDir/Time.txt"
+	mkdir -p "$OutDir"
+	for Run in $(seq 1 "$Runs"); do time_build "$2" "$Map" "$Run" Time; done
+	echo "Median time to first playable frame of $Map: $(median "$OutDir/Time.txt") s"
+	;;
+compare)
+	[ $# -ge 3 ] || usage
+	Map="${4:-/Game/Maps/NewMap}"
+	Runs="${5:-5}"
+	rm -f "$OutDir/Before.txt" "$OutDir/After.txt"
+	mkdir -p "$OutDir"
+	for Run in $(seq 1 "$Runs"); do
+		time_build "$2" "$Map" "$Run" Before
+		time_build "$3" "$Map" "$Run" After
+	done
+	Before="$(median "$OutDir/Before.txt")"
+	After="$(median "$OutDir/After.txt")"
+	echo "Median time to first playable frame of $Map over $Runs runs"
+	echo "  before: $Before s"
+	echo "  after:  $After s"
+	awk -v B="$Before" -v A="$After" 'BEGIN { if (B + 0 > 0 && A + 0 > 0) printf "  change: %+.3f s (%+.1f%%)\n", A - B, (A - B) * 100 / B }'
+	;;
+*)
+	usage
+	;;
+esac
@@ -0,0 +1,115 @@
+#!/usr/bin/env bash
+#Gravity gun replication test over localhost with emulated latency, on a packaged Linux build.
+#
+#  OryxNetLatencyTest.sh record <BuildDir> [Name]
+#      Starts a listen server and one client on this machine without emulation and records the client's inputs
+#      (Saved/InputRecordings/<Name>, GravityGunNet by default). Grab, spin and fire a prop, then quit the client.
+#  OryxNetLatencyTest.sh run <BuildDir> [Name] [Profile...]
+#      Replays the recording on a fresh client once per profile (LAN, Average and Bad by default) and prints whether
+#      the client's state matched the recording and the server's held prop bytes/s.
+#
+#Profiles set NetEmulation.PktLag/PktLagVariance/PktLoss on both ends through -ExecCmds:
+#  None 0/0/0, LAN 10/2/0, Average 60/10/1, Bad 150/40/3
+#BuildDir is the staged Linux build (the folder holding Oryx.sh). Extra game arguments go in ORYX_ARGS.
+set -euo pipefail
+
+ProjectDir="$(cd "$(dirname "${BASH_SOURCE[0]}")/../.." && pwd)"
+OutDir="${ORYX_PROFILE_DIR:-$ProjectDir/Saved/Profiling/OryxNet}"
+Timeout="${ORYX_TIMEOUT:-300}"
+Map="${ORYX_MAP:-/Game/Maps/GravityGunMap}"
+Port="${ORYX_PORT:-17777}"
+
+usage()
+{
+	sed -n '2,14p' "${BASH_SOURCE[0]}" | sed 's/^#//'
+	exit 2
+}
+
+#emulation <Profile>, console commands for the profile
+emulation()
+{
+	local Lag Variance Loss
+	case "$1" in
+	None) Lag=0; Variance=0; Loss=0 ;;
+	LAN) Lag=10; Variance=2; Loss=0 ;;
+	Average) Lag=60; Variance=10; Loss=1 ;;
+	Bad) Lag=150; Variance=40; Loss=3 ;;
+	*) echo "unknown profile $1" >&2; exit 1 ;;
+	esac
+	echo "NetEmulation.PktLag $Lag,NetEmulation.PktLagVariance $Variance,NetEmulation.PktLoss $Loss"
+}
+
+#start_server <BuildDir> <RunDir> <Profile>, sets ServerPid
+start_server()
+{
+	mkdir -p "$2"
+	"$1/Oryx.sh" "$Map?listen" -port="$Port" -unattended -nosound -windowed -ResX=640 -ResY=360 \
+		-ExecCmds="$(emulation "$3"),Oryx.GravityGun.LogNetStats 1" ${ORYX_ARGS:-} > "$2/Server.log" 2>&1 &
+	ServerPid=$!
+	#Give the server time to load the map and listen before the client connects
+	sleep "${ORYX_SERVER_WAIT:-15}"
+}
+
+stop_server()
+{
+	kill "$ServerPid" 2>/dev/null || true
+	wait "$ServerPid" 2>/dev/null || true
+}
+
+#run_client <BuildDir> <RunDir> <Profile> <args...>, returns the client's exit code
+run_client()
+{
+	local BuildDir="$1" RunDir="$2" Profile="$3"
+	shift 3
+	timeout "$Timeout" "$BuildDir/Oryx.sh" "127.0.0.1:$Port" -unattended -nosound -windowed -ResX=1280 -ResY=720 \
+		-ExecCmds="$(emulation "$Profile")" "$@" ${ORYX_ARGS:-} > "$RunDir/Client.log" 2>&1
+}
+
+Mode="${1:-}"
+[ $# -ge 2 ] || usage
+BuildDir="$2"
+Name="${3:-GravityGunNet}"
+[ -x "$BuildDir/Oryx.sh" ] || { echo "no Oryx.sh in $BuildDir" >&2; exit 1; }
+
+case "$Mode" in
+record)
+	RunDir="$OutDir/Record"
+	rm -rf "$RunDir"
+	start_server "$BuildDir" "$RunDir" None
+	trap stop_server EXIT
+	#Interactive, so no timeout
+	"$BuildDir/Oryx.sh" "127.0.0.1:$Port" -windowed -ResX=1280 -ResY=720 -OryxRecord="$Name" ${ORYX_ARGS:-} \
+		> "$RunDir/Client.log" 2>&1 || true
+	grep -h "Input recording saved" "$RunDir/Client.log" || { echo "nothing recorded, see $RunDir/Client.log" >&2; exit 1; }
+	;;
+run)
+	shift 3 || shift $#
+	Profiles=("$@")
+	[ ${#Profiles[@]} -gt 0 ] || Profiles=(LAN Average Bad)
+
+	Failed=0
+	for Profile in "${Profiles[@]}"; do
+		RunDir="$OutDir/$Profile"
+		rm -rf "$RunDir"
+		start_server "$BuildDir" "$RunDir" "$Profile"
+		Status=0
+		run_client "$BuildDir" "$RunDir" "$Profile" -OryxReplay="$Name" -OryxReplayExit || Status=$?
+		stop_server
+
+		#Server logs one line per second while props are held, the replay's figure is their average
+		BytesPerSecond="$(grep -ho 'GravityGun: [0-9.]* bytes/s per held prop' "$RunDir/Server.log" \
+			| awk '{ Sum += $2 } END { if (NR) printf "%.1f", Sum / NR; else print "n/a" }')"
+		case "$Status" in
+		0) Result="matched" ;;
+		1) Result="$(grep -ho 'diverged at frame [0-9]* of [0-9]*' "$RunDir/Client.log" | tail -n 1)"; Failed=1 ;;
+		124) Result="timed out"; Failed=1 ;;
+		*) Result="exited with $Status"; Failed=1 ;;
+		esac
+		echo "$Profile: $Result, $BytesPerSecond bytes/s per held prop ($RunDir)"
+	done
+	exit "$Failed"
+	;;
+*)
+	usage
+	;;
+esac
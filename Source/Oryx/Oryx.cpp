@@ -1,6 +1,17 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "Oryx.h"
+#include "OryxLoadProfiler.h"
 #include "Modules/ModuleManager.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, Oryx, "Oryx" );
+DEFINE_LOG_CATEGORY(LogOryx);
+
+class FOryxModule : public FDefaultGameModuleImpl
+{
+public:
+	//Game modules load before the engine browses to its first map, early enough to profile boot loads
+	virtual void StartupModule() override { FOryxLoadProfiler::StartFromCommandLine(); }
+	virtual void ShutdownModule() override { FOryxLoadProfiler::Shutdown(); }
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FOryxModule, Oryx, "Oryx" );
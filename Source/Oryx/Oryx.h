@@ -4,3 +4,14 @@
 
 #include "CoreMinimal.h"
 
+//Shared log category and stat group for all Oryx gameplay systems (use "stat Oryx" in game)
+DECLARE_LOG_CATEGORY_EXTERN(LogOryx, Log, All);
+DECLARE_STATS_GROUP(TEXT("Oryx"), STATGROUP_Oryx, STATCAT_Advanced);
+
+//Project collision channels, set up in DefaultEngine.ini [/Script/Engine.CollisionProfile]. Oryx queries run on these
+//instead of Visibility/PhysicsBody so the broadphase only hands back what the query is about
+#define ECC_OryxShip ECC_GameTraceChannel1 //Object type of ship hulls, profile OryxShip
+#define ECC_OryxProp ECC_GameTraceChannel2 //Object type of loose simulating props, profile OryxProp
+#define ECC_OryxPad ECC_GameTraceChannel3 //Object type of landing pads, profile OryxPad
+#define ECC_OryxWalkable ECC_GameTraceChannel4 //Trace, ground a player can stand on. Blocked by default
+#define ECC_OryxGrab ECC_GameTraceChannel5 //Trace, what a gravity gun can grab or is stopped by. Ignored by default
@@ -0,0 +1,225 @@
+#include "DebrisField.h"
+#include "Oryx.h"
+#include "SpaceshipPawn.h"
+#include "GravityGun.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Debris game thread"), STAT_OryxDebrisGameThread, STATGROUP_Oryx);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Debris promoted to physics"), STAT_OryxDebrisPromoted, STATGROUP_Oryx);
+
+static TAutoConsoleVariable<int32> CVarOryxDebrisPhysicsTier(
+	TEXT("Oryx.Debris.PhysicsTier"),
+	2,
+	TEXT("How much debris may become physics bodies: 2 up to MaxPromoted, 1 half of it, 0 none"));
+
+ADebrisField::ADebrisField()
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	Instances = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("Instances"));
+	Instances->SetMobility(EComponentMobility::Movable);
+	Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Instances->SetCanEverAffectNavigation(false);
+	RootComponent = Instances;
+
+	DebrisMesh = TSoftObjectPtr<UStaticMesh>(FSoftObjectPath(TEXT("/Game/RockEnv_Pack/Meshes/Rocks/SM_Rock_5.SM_Rock_5")));
+}
+
+void ADebrisField::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (DebrisMesh.IsNull()) return;
+
+	MeshHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(DebrisMesh.ToSoftObjectPath(),
+		FStreamableDelegate::CreateUObject(this, &ADebrisField::OnMeshLoaded));
+}
+
+void ADebrisField::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	//A step still running keeps its own reference to the state and just finishes into nothing
+	State.Reset();
+	StepTask = UE::Tasks::FTask();
+
+	if (MeshHandle.IsValid()) MeshHandle->CancelHandle();
+	MeshHandle.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ADebrisField::OnMeshLoaded()
+{
+	UStaticMesh* Mesh = DebrisMesh.Get();
+	if (!Mesh)
+	{
+		UE_LOG(LogOryx, Warning, TEXT("Debris field %s: mesh %s failed to load"), *GetName(), *DebrisMesh.ToString());
+		return;
+	}
+	Instances->SetStaticMesh(Mesh);
+
+	State = MakeShared<FStepState>();
+	State->Simulation.Settings.GravityConstant = GravityConstant;
+	State->Simulation.Settings.Theta = Theta;
+	State->Simulation.Init(Count, FVector3f(Extent), MinMass, MaxMass, Seed);
+	State->Simulation.WriteTransforms(State->Transforms, ScalePerCubeRootMass);
+	Instances->AddInstances(State->Transforms, false, false, false);
+
+	LaunchStep();
+}
+
+void ADebrisField::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!State.IsValid()) return;
+
+	PendingTime += DeltaTime;
+	if (!StepTask.IsCompleted()) return; //Keep drawing the last step, the next one catches up on PendingTime
+
+	SCOPE_CYCLE_COUNTER(STAT_OryxDebrisGameThread);
+
+	//Lower tiers only stop new promotions, bodies already out demote once left alone as usual
+	const int32 Tier = FMath::Clamp(CVarOryxDebrisPhysicsTier.GetValueOnGameThread(), 0, 2);
+	const int32 MaxBodies = MaxPromoted * Tier / 2;
+
+	//Promote before drawing, so the instance hides the same frame its body appears
+	for (const int32 Particle : State->Promote)
+	{
+		if (PromotedBodies.Num() >= MaxBodies) break;
+
+		Promote(Particle);
+		State->Transforms[Particle].SetScale3D(FVector::ZeroVector);
+	}
+
+	Instances->BatchUpdateInstancesTransforms(0, State->Transforms, false, true, true);
+
+	for (UStaticMeshComponent* Body : DemotingBodies)
+	{
+		Body->SetVisibility(false);
+		FreeBodies.Add(Body);
+	}
+	DemotingBodies.Reset();
+
+	LaunchStep();
+
+	INC_DWORD_STAT_BY(STAT_OryxDebrisPromoted, PromotedBodies.Num());
+}
+
+void ADebrisField::LaunchStep()
+{
+	GatherPromoters(State->Promoters);
+	SyncPromoted(State->Promoters);
+
+	//Long hitches are simulated as one slower step rather than a huge jump
+	State->DeltaTime = FMath::Min(PendingTime, 0.1f);
+	PendingTime = 0.f;
+
+	StepTask = UE::Tasks::Launch(UE_SOURCE_LOCATION,
+		[Step = State, Scale = ScalePerCubeRootMass]()
+		{
+			Step->Simulation.Step(Step->DeltaTime, Step->Promoters, Step->Promote);
+			Step->Simulation.WriteTransforms(Step->Transforms, Scale);
+		});
+}
+
+void ADebrisField::GatherPromoters(TArray<FDebrisPromoter>& OutPromoters) const
+{
+	OutPromoters.Reset();
+	const FTransform& ToWorld = Instances->GetComponentTransform();
+
+	for (TActorIterator<ASpaceshipPawn> It(GetWorld()); It; ++It)
+	{
+		FDebrisPromoter& Promoter = OutPromoters.AddDefaulted_GetRef();
+		Promoter.Start = Promoter.End = FVector3f(ToWorld.InverseTransformPosition(It->GetActorLocation()));
+		Promoter.Radius = ShipPromoteRadius + It->GetSimpleCollisionRadius();
+	}
+
+	for (TActorIterator<AGravityGun> It(GetWorld()); It; ++It)
+	{
+		FVector Start, End;
+		if (!It->GetGrabTrace(Start, End)) continue;
+
+		FDebrisPromoter& Promoter = OutPromoters.AddDefaulted_GetRef();
+		Promoter.Start = FVector3f(ToWorld.InverseTransformPosition(Start));
+		Promoter.End = FVector3f(ToWorld.InverseTransformPosition(End));
+		Promoter.Radius = GunPromoteRadius;
+	}
+}
+
+void ADebrisField::Promote(int32 Particle)
+{
+	FDebrisSimulation& Simulation = State->Simulation;
+	if (Simulation.IsPromoted(Particle)) return;
+
+	UStaticMeshComponent* Body = FreeBodies.Num() > 0 ? FreeBodies.Pop(EAllowShrinking::No) : nullptr;
+	if (!Body)
+	{
+		//Left unattached, a simulating body moves on its own
+		Body = NewObject<UStaticMeshComponent>(this);
+		Body->SetMobility(EComponentMobility::Movable);
+		Body->SetStaticMesh(Instances->GetStaticMesh());
+		Body->SetCollisionProfileName(TEXT("OryxProp"));
+		Body->SetEnableGravity(false);
+		Body->SetCanEverAffectNavigation(false);
+		Body->RegisterComponent();
+	}
+
+	const FTransform& ToWorld = Instances->GetComponentTransform();
+	const FTransform Local(FQuat(Simulation.GetRotation(Particle)), FVector(Simulation.GetPosition(Particle)), State->Transforms[Particle].GetScale3D());
+
+	Body->SetWorldTransform(Local * ToWorld, false, nullptr, ETeleportType::TeleportPhysics);
+	Body->SetVisibility(true);
+	Body->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+	Body->SetMassOverrideInKg(NAME_None, Simulation.GetMass(Particle) * KilogramsPerMass, true);
+	Body->SetSimulatePhysics(true);
+	Body->SetPhysicsLinearVelocity(ToWorld.TransformVector(FVector(Simulation.GetVelocity(Particle))));
+
+	Simulation.SetPromoted(Particle, true);
+	PromotedBodies.Add(Body);
+	PromotedParticles.Add(Particle);
+}
+
+void ADebrisField::SyncPromoted(const TArray<FDebrisPromoter>& Promoters)
+{
+	if (PromotedBodies.Num() == 0) return;
+
+	FDebrisSimulation& Simulation = State->Simulation;
+	const FTransform& ToWorld = Instances->GetComponentTransform();
+
+	TArray<const UPrimitiveComponent*, TInlineAllocator<4>> HeldComponents;
+	for (TActorIterator<AGravityGun> It(GetWorld()); It; ++It)
+	{
+		if (const UPrimitiveComponent* Held = It->GetHeldComponent()) HeldComponents.Add(Held);
+	}
+
+	for (int32 Index = PromotedBodies.Num() - 1; Index >= 0; --Index)
+	{
+		UStaticMeshComponent* Body = PromotedBodies[Index];
+		const int32 Particle = PromotedParticles[Index];
+
+		//Physics owns the particle while promoted, the rest of the field still feels its pull from here
+		const FVector3f Position(ToWorld.InverseTransformPosition(Body->GetComponentLocation()));
+		Simulation.SetState(Particle, Position, FVector3f(ToWorld.InverseTransformVector(Body->GetPhysicsLinearVelocity())));
+		Simulation.SetRotation(Particle, FQuat4f(ToWorld.InverseTransformRotation(Body->GetComponentQuat())));
+
+		const bool bNear = Promoters.ContainsByPredicate([this, &Position](const FDebrisPromoter& Promoter)
+			{
+				return Promoter.DistanceSquaredTo(Position) <= FMath::Square(Promoter.Radius * DemoteScale);
+			});
+		if (bNear || HeldComponents.Contains(Body)) continue;
+
+		Simulation.SetPromoted(Particle, false);
+		Body->SetSimulatePhysics(false);
+		Body->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		DemotingBodies.Add(Body);
+
+		PromotedBodies.RemoveAtSwap(Index);
+		PromotedParticles.RemoveAtSwap(Index);
+	}
+}
@@ -0,0 +1,400 @@
+#include "DebrisSimulation.h"
+#include "Oryx.h"
+#include "Async/ParallelFor.h"
+#include "Algo/Sort.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Debris tree build"), STAT_OryxDebrisBuild, STATGROUP_Oryx);
+DECLARE_CYCLE_STAT(TEXT("Debris forces"), STAT_OryxDebrisForces, STATGROUP_Oryx);
+DECLARE_CYCLE_STAT(TEXT("Debris integrate"), STAT_OryxDebrisIntegrate, STATGROUP_Oryx);
+
+static FAutoConsoleCommand GOryxDebrisBenchCommand(
+	TEXT("Oryx.Debris.Bench"),
+	TEXT("Oryx.Debris.Bench [Steps] - time Barnes-Hut debris steps at 10k, 50k and 100k particles"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumSteps = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 10;
+
+		for (const int32 Count : { 10000, 50000, 100000 })
+		{
+			//Same density at every size, so only the particle count changes
+			FDebrisSimulation Simulation;
+			Simulation.Init(Count, FVector3f(20000.f * FMath::Pow(Count / 10000.f, 1.f / 3.f)), 1.f, 10.f, 1234);
+
+			TArray<int32> Promote;
+			double BuildMs = 0.0, ForceMs = 0.0, IntegrateMs = 0.0;
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 Step = 0; Step < NumSteps; ++Step)
+			{
+				Simulation.Step(1.f / 60.f, {}, Promote);
+				BuildMs += Simulation.LastBuildMs;
+				ForceMs += Simulation.LastForceMs;
+				IntegrateMs += Simulation.LastIntegrateMs;
+			}
+			const double TotalMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+			UE_LOG(LogOryx, Display, TEXT("Debris bench: %6d particles, %.2f ms/step (tree %.2f, forces %.2f, integrate %.2f)"),
+				Count, TotalMs / NumSteps, BuildMs / NumSteps, ForceMs / NumSteps, IntegrateMs / NumSteps);
+		}
+	}));
+
+namespace OryxDebris
+{
+	//Spreads the low 10 bits of Value out to every third bit
+	static uint32 Part1By2(uint32 Value)
+	{
+		Value &= 0x000003ff;
+		Value = (Value ^ (Value << 16)) & 0xff0000ff;
+		Value = (Value ^ (Value << 8)) & 0x0300f00f;
+		Value = (Value ^ (Value << 4)) & 0x030c30c3;
+		Value = (Value ^ (Value << 2)) & 0x09249249;
+		return Value;
+	}
+
+	static constexpr int32 MaxLevel = 10; //10 bits per axis
+}
+
+void FDebrisSimulation::Init(int32 Count, const FVector3f& InExtent, float MinMass, float MaxMass, int32 Seed)
+{
+	Extent = InExtent;
+	FRandomStream Random(Seed);
+
+	for (TArray<float>* Array : { &PosX, &PosY, &PosZ, &VelX, &VelY, &VelZ, &AccX, &AccY, &AccZ, &Mass, &SpinAngle, &SpinRate })
+		Array->SetNumZeroed(Count);
+	SpinAxis.SetNumUninitialized(Count);
+	bPromoted.Init(false, Count);
+
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		PosX[Index] = Random.FRandRange(-Extent.X, Extent.X);
+		PosY[Index] = Random.FRandRange(-Extent.Y, Extent.Y);
+		PosZ[Index] = Random.FRandRange(-Extent.Z, Extent.Z);
+
+		const FVector3f Drift = FVector3f(Random.VRand()) * Random.FRandRange(0.f, 50.f);
+		VelX[Index] = Drift.X;
+		VelY[Index] = Drift.Y;
+		VelZ[Index] = Drift.Z;
+
+		Mass[Index] = Random.FRandRange(MinMass, MaxMass);
+		SpinAxis[Index] = FVector3f(Random.VRand());
+		SpinAngle[Index] = Random.FRandRange(0.f, UE_TWO_PI);
+		SpinRate[Index] = Random.FRandRange(-1.f, 1.f);
+	}
+}
+
+void FDebrisSimulation::SetState(int32 Index, const FVector3f& Position, const FVector3f& Velocity)
+{
+	PosX[Index] = Position.X;
+	PosY[Index] = Position.Y;
+	PosZ[Index] = Position.Z;
+	VelX[Index] = Velocity.X;
+	VelY[Index] = Velocity.Y;
+	VelZ[Index] = Velocity.Z;
+}
+
+void FDebrisSimulation::SetRotation(int32 Index, const FQuat4f& Rotation)
+{
+	Rotation.ToAxisAndAngle(SpinAxis[Index], SpinAngle[Index]);
+}
+
+#pragma region Tree
+void FDebrisSimulation::BuildTree()
+{
+	SCOPE_CYCLE_COUNTER(STAT_OryxDebrisBuild);
+
+	const int32 Count = Num();
+	Nodes.Reset();
+	Leaves.Reset();
+	if (Count == 0) return;
+
+	FVector3f Min(TNumericLimits<float>::Max());
+	FVector3f Max(TNumericLimits<float>::Lowest());
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		Min = Min.ComponentMin(FVector3f(PosX[Index], PosY[Index], PosZ[Index]));
+		Max = Max.ComponentMax(FVector3f(PosX[Index], PosY[Index], PosZ[Index]));
+	}
+	TreeMin = Min;
+	TreeSize = FMath::Max((Max - Min).GetMax() * 1.001f, 1.f);
+
+	//Morton order puts every octree cell's particles in one contiguous run
+	SortedKeys.SetNumUninitialized(Count);
+	const float Quantize = 1024.f / TreeSize; //Each bit splits a cell exactly in half
+	ParallelFor(Count, [this, Quantize](int32 Index)
+		{
+			const uint32 X = FMath::Min(static_cast<uint32>((PosX[Index] - TreeMin.X) * Quantize), 1023u);
+			const uint32 Y = FMath::Min(static_cast<uint32>((PosY[Index] - TreeMin.Y) * Quantize), 1023u);
+			const uint32 Z = FMath::Min(static_cast<uint32>((PosZ[Index] - TreeMin.Z) * Quantize), 1023u);
+			const uint32 Code = OryxDebris::Part1By2(X) | (OryxDebris::Part1By2(Y) << 1) | (OryxDebris::Part1By2(Z) << 2);
+			SortedKeys[Index] = (static_cast<uint64>(Code) << 32) | static_cast<uint32>(Index);
+		});
+	Algo::Sort(SortedKeys);
+
+	Order.SetNumUninitialized(Count);
+	for (int32 Index = 0; Index < Count; ++Index)
+		Order[Index] = static_cast<int32>(SortedKeys[Index] & 0xffffffff);
+
+	FDebrisTreeNode& Root = Nodes.AddDefaulted_GetRef();
+	Root.HalfSize = TreeSize * 0.5f;
+	Root.Center = TreeMin + FVector3f(Root.HalfSize);
+	BuildNode(0, 0, Count, 0);
+}
+
+void FDebrisSimulation::BuildNode(int32 NodeIndex, int32 Begin, int32 End, int32 Level)
+{
+	Nodes[NodeIndex].First = Begin;
+	Nodes[NodeIndex].Count = End - Begin;
+
+	if (End - Begin <= Settings.LeafSize || Level >= OryxDebris::MaxLevel)
+	{
+		FVector3f WeightedSum = FVector3f::ZeroVector;
+		float TotalMass = 0.f;
+		for (int32 Slot = Begin; Slot < End; ++Slot)
+		{
+			const int32 Index = Order[Slot];
+			WeightedSum += FVector3f(PosX[Index], PosY[Index], PosZ[Index]) * Mass[Index];
+			TotalMass += Mass[Index];
+		}
+
+		FDebrisTreeNode& Node = Nodes[NodeIndex];
+		Node.Mass = TotalMass;
+		Node.CenterOfMass = TotalMass > 0.f ? WeightedSum / TotalMass : Node.Center;
+		Leaves.Add(NodeIndex);
+		return;
+	}
+
+	//The three bits for this level pick the octant, z y x from high to low
+	const int32 Shift = 32 + 3 * (OryxDebris::MaxLevel - 1 - Level);
+	auto Octant = [this, Shift](int32 Slot) { return static_cast<int32>((SortedKeys[Slot] >> Shift) & 7); };
+
+	TArray<TPair<int32, int32>, TInlineAllocator<8>> Ranges; //Octant and first slot of each non-empty child
+	for (int32 Slot = Begin; Slot < End; ++Slot)
+	{
+		if (Slot == Begin || Octant(Slot) != Octant(Slot - 1)) Ranges.Emplace(Octant(Slot), Slot);
+	}
+
+	const int32 FirstChild = Nodes.Num();
+	const FVector3f ParentCenter = Nodes[NodeIndex].Center;
+	const float ChildHalfSize = Nodes[NodeIndex].HalfSize * 0.5f;
+	Nodes[NodeIndex].FirstChild = FirstChild;
+	Nodes[NodeIndex].NumChildren = Ranges.Num();
+	Nodes.AddDefaulted(Ranges.Num());
+
+	for (int32 Child = 0; Child < Ranges.Num(); ++Child)
+	{
+		const int32 Bits = Ranges[Child].Key;
+		Nodes[FirstChild + Child].HalfSize = ChildHalfSize;
+		Nodes[FirstChild + Child].Center = ParentCenter + FVector3f(
+			(Bits & 1) ? ChildHalfSize : -ChildHalfSize,
+			(Bits & 2) ? ChildHalfSize : -ChildHalfSize,
+			(Bits & 4) ? ChildHalfSize : -ChildHalfSize);
+
+		const int32 ChildEnd = Child + 1 < Ranges.Num() ? Ranges[Child + 1].Value : End;
+		BuildNode(FirstChild + Child, Ranges[Child].Value, ChildEnd, Level + 1);
+	}
+
+	FVector3f WeightedSum = FVector3f::ZeroVector;
+	float TotalMass = 0.f;
+	for (int32 Child = FirstChild; Child < FirstChild + Ranges.Num(); ++Child)
+	{
+		WeightedSum += Nodes[Child].CenterOfMass * Nodes[Child].Mass;
+		TotalMass += Nodes[Child].Mass;
+	}
+
+	FDebrisTreeNode& Node = Nodes[NodeIndex];
+	Node.Mass = TotalMass;
+	Node.CenterOfMass = TotalMass > 0.f ? WeightedSum / TotalMass : Node.Center;
+}
+#pragma endregion
+
+#pragma region Forces
+void FDebrisSimulation::GatherInteractions(int32 LeafIndex, TArray<float>& OutX, TArray<float>& OutY, TArray<float>& OutZ, TArray<float>& OutMass) const
+{
+	const FDebrisTreeNode& Leaf = Nodes[LeafIndex];
+	const FVector3f LeafMin = Leaf.Center - FVector3f(Leaf.HalfSize);
+	const FVector3f LeafMax = Leaf.Center + FVector3f(Leaf.HalfSize);
+	const float ThetaSq = FMath::Square(Settings.Theta);
+
+	auto AddPoint = [&](const FVector3f& Position, float PointMass)
+		{
+			OutX.Add(Position.X);
+			OutY.Add(Position.Y);
+			OutZ.Add(Position.Z);
+			OutMass.Add(PointMass);
+		};
+
+	//One list for the whole leaf: a cell is far enough if it's small seen from anywhere in the leaf
+	TArray<int32, TInlineAllocator<64>> Stack;
+	Stack.Add(0);
+	while (Stack.Num() > 0)
+	{
+		const int32 NodeIndex = Stack.Pop(EAllowShrinking::No);
+		const FDebrisTreeNode& Node = Nodes[NodeIndex];
+		if (Node.Mass <= 0.f) continue;
+
+		//The leaf itself and its ancestors hold the leaf's own particles, they are always opened
+		const bool bContainsLeaf = Node.First <= Leaf.First && Leaf.First < Node.First + Node.Count;
+		const FVector3f Closest = Node.CenterOfMass.BoundToBox(LeafMin, LeafMax);
+		const float DistanceSq = FVector3f::DistSquared(Closest, Node.CenterOfMass);
+		if (!bContainsLeaf && FMath::Square(2.f * Node.HalfSize) < ThetaSq * DistanceSq)
+		{
+			AddPoint(Node.CenterOfMass, Node.Mass);
+		}
+		else if (Node.IsLeaf())
+		{
+			for (int32 Slot = Node.First; Slot < Node.First + Node.Count; ++Slot)
+			{
+				const int32 Index = Order[Slot];
+				AddPoint(FVector3f(PosX[Index], PosY[Index], PosZ[Index]), Mass[Index]);
+			}
+		}
+		else
+		{
+			for (int32 Child = Node.FirstChild; Child < Node.FirstChild + Node.NumChildren; ++Child)
+				Stack.Add(Child);
+		}
+	}
+
+	//Pad to whole SIMD lanes with massless points
+	while (OutMass.Num() % 4 != 0)
+		AddPoint(FVector3f::ZeroVector, 0.f);
+}
+
+void FDebrisSimulation::ComputeLeafAccelerations(int32 LeafIndex)
+{
+	TArray<float> X, Y, Z, M;
+	GatherInteractions(LeafIndex, X, Y, Z, M);
+
+	const VectorRegister4Float SofteningSq = VectorSetFloat1(FMath::Square(Settings.Softening));
+	const int32 NumPoints = M.Num();
+
+	const FDebrisTreeNode& Leaf = Nodes[LeafIndex];
+	for (int32 Slot = Leaf.First; Slot < Leaf.First + Leaf.Count; ++Slot)
+	{
+		const int32 Index = Order[Slot];
+		const VectorRegister4Float Px = VectorSetFloat1(PosX[Index]);
+		const VectorRegister4Float Py = VectorSetFloat1(PosY[Index]);
+		const VectorRegister4Float Pz = VectorSetFloat1(PosZ[Index]);
+		VectorRegister4Float Ax = VectorZeroFloat();
+		VectorRegister4Float Ay = VectorZeroFloat();
+		VectorRegister4Float Az = VectorZeroFloat();
+
+		//Four sources per iteration, a particle against itself contributes nothing since its offset is zero
+		for (int32 Point = 0; Point < NumPoints; Point += 4)
+		{
+			const VectorRegister4Float Dx = VectorSubtract(VectorLoad(&X[Point]), Px);
+			const VectorRegister4Float Dy = VectorSubtract(VectorLoad(&Y[Point]), Py);
+			const VectorRegister4Float Dz = VectorSubtract(VectorLoad(&Z[Point]), Pz);
+
+			const VectorRegister4Float DistSq = VectorMultiplyAdd(Dx, Dx, VectorMultiplyAdd(Dy, Dy, VectorMultiplyAdd(Dz, Dz, SofteningSq)));
+			const VectorRegister4Float InvDist = VectorReciprocalSqrt(DistSq);
+			const VectorRegister4Float Strength = VectorMultiply(VectorLoad(&M[Point]), VectorMultiply(InvDist, VectorMultiply(InvDist, InvDist)));
+
+			Ax = VectorMultiplyAdd(Dx, Strength, Ax);
+			Ay = VectorMultiplyAdd(Dy, Strength, Ay);
+			Az = VectorMultiplyAdd(Dz, Strength, Az);
+		}
+
+		float Lanes[3][4];
+		VectorStore(Ax, Lanes[0]);
+		VectorStore(Ay, Lanes[1]);
+		VectorStore(Az, Lanes[2]);
+		AccX[Index] = Settings.GravityConstant * (Lanes[0][0] + Lanes[0][1] + Lanes[0][2] + Lanes[0][3]);
+		AccY[Index] = Settings.GravityConstant * (Lanes[1][0] + Lanes[1][1] + Lanes[1][2] + Lanes[1][3]);
+		AccZ[Index] = Settings.GravityConstant * (Lanes[2][0] + Lanes[2][1] + Lanes[2][2] + Lanes[2][3]);
+	}
+}
+#pragma endregion
+
+void FDebrisSimulation::Step(float DeltaTime, TConstArrayView<FDebrisPromoter> Promoters, TArray<int32>& OutPromote)
+{
+	OutPromote.Reset();
+	if (Num() == 0) return;
+
+	double StartTime = FPlatformTime::Seconds();
+	BuildTree();
+	LastBuildMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	StartTime = FPlatformTime::Seconds();
+	{
+		SCOPE_CYCLE_COUNTER(STAT_OryxDebrisForces);
+		ParallelFor(Leaves.Num(), [this](int32 Leaf) { ComputeLeafAccelerations(Leaves[Leaf]); });
+	}
+	LastForceMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	StartTime = FPlatformTime::Seconds();
+	{
+		SCOPE_CYCLE_COUNTER(STAT_OryxDebrisIntegrate);
+
+		const float DampingScale = FMath::Max(1.f - Settings.Damping * DeltaTime, 0.f);
+		const float Contain = Settings.ContainStrength * DeltaTime;
+		const float MaxSpeedSq = FMath::Square(Settings.MaxSpeed);
+
+		ParallelFor(Num(), [&](int32 Index)
+			{
+				if (bPromoted[Index]) return;
+
+				FVector3f Velocity(VelX[Index], VelY[Index], VelZ[Index]);
+				const FVector3f Position(PosX[Index], PosY[Index], PosZ[Index]);
+
+				Velocity += FVector3f(AccX[Index], AccY[Index], AccZ[Index]) * DeltaTime;
+				Velocity *= DampingScale;
+
+				//Stragglers are nudged back so the field keeps its shape
+				for (int32 Axis = 0; Axis < 3; ++Axis)
+				{
+					if (Position[Axis] > Extent[Axis]) Velocity[Axis] -= Contain;
+					else if (Position[Axis] < -Extent[Axis]) Velocity[Axis] += Contain;
+				}
+
+				if (Velocity.SizeSquared() > MaxSpeedSq) Velocity = Velocity.GetUnsafeNormal() * Settings.MaxSpeed;
+
+				SetState(Index, Position + Velocity * DeltaTime, Velocity);
+				SpinAngle[Index] = FMath::Fmod(SpinAngle[Index] + SpinRate[Index] * DeltaTime, UE_TWO_PI);
+			});
+	}
+	LastIntegrateMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	//Promotion uses the tree just built, positions are at most one step stale
+	for (const FDebrisPromoter& Promoter : Promoters)
+	{
+		const FVector3f BoxMin = Promoter.Start.ComponentMin(Promoter.End) - FVector3f(Promoter.Radius);
+		const FVector3f BoxMax = Promoter.Start.ComponentMax(Promoter.End) + FVector3f(Promoter.Radius);
+		const float RadiusSq = FMath::Square(Promoter.Radius);
+
+		TArray<int32, TInlineAllocator<64>> Stack;
+		Stack.Add(0);
+		while (Stack.Num() > 0)
+		{
+			const FDebrisTreeNode& Node = Nodes[Stack.Pop(EAllowShrinking::No)];
+			const FVector3f NodeMin = Node.Center - FVector3f(Node.HalfSize);
+			const FVector3f NodeMax = Node.Center + FVector3f(Node.HalfSize);
+			if (NodeMin.X > BoxMax.X || NodeMin.Y > BoxMax.Y || NodeMin.Z > BoxMax.Z ||
+				NodeMax.X < BoxMin.X || NodeMax.Y < BoxMin.Y || NodeMax.Z < BoxMin.Z) continue;
+
+			if (!Node.IsLeaf())
+			{
+				for (int32 Child = Node.FirstChild; Child < Node.FirstChild + Node.NumChildren; ++Child)
+					Stack.Add(Child);
+				continue;
+			}
+
+			for (int32 Slot = Node.First; Slot < Node.First + Node.Count; ++Slot)
+			{
+				const int32 Index = Order[Slot];
+				if (!bPromoted[Index] && Promoter.DistanceSquaredTo(GetPosition(Index)) <= RadiusSq)
+					OutPromote.AddUnique(Index);
+			}
+		}
+	}
+}
+
+void FDebrisSimulation::WriteTransforms(TArray<FTransform>& OutTransforms, float ScalePerCubeRootMass) const
+{
+	OutTransforms.SetNumUninitialized(Num());
+	ParallelFor(Num(), [&](int32 Index)
+		{
+			const float Scale = bPromoted[Index] ? 0.f : ScalePerCubeRootMass * FMath::Pow(Mass[Index], 1.f / 3.f);
+			OutTransforms[Index] = FTransform(FQuat(GetRotation(Index)), FVector(GetPosition(Index)), FVector(Scale));
+		});
+}
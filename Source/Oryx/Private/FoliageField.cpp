@@ -0,0 +1,572 @@
+#include "FoliageField.h"
+#include "Oryx.h"
+#include "Components/BoxComponent.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/World.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "WorldCollision.h"
+
+DECLARE_CYCLE_STAT(TEXT("Foliage field streaming"), STAT_OryxFoliageFieldStream, STATGROUP_Oryx);
+DECLARE_CYCLE_STAT(TEXT("Foliage field cell scatter"), STAT_OryxFoliageFieldScatter, STATGROUP_Oryx);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Foliage cells loaded"), STAT_OryxFoliageCellsLoaded, STATGROUP_Oryx);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Foliage cells in flight"), STAT_OryxFoliageCellsInFlight, STATGROUP_Oryx);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Foliage cells waiting"), STAT_OryxFoliageCellsWaiting, STATGROUP_Oryx);
+
+static TAutoConsoleVariable<float> CVarOryxFoliageBudgetMs(
+	TEXT("Oryx.Foliage.BudgetMs"),
+	0.5f,
+	TEXT("Game thread milliseconds each foliage field may spend adding scattered instances per frame, at least one mesh batch is always added"));
+
+static FAutoConsoleCommand GOryxFoliageBenchCommand(
+	TEXT("Oryx.Foliage.Bench"),
+	TEXT("Oryx.Foliage.Bench [Cells] - time scattering quarry grass and bushes over rolling ground, on one thread and on all workers"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumCells = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 64;
+
+		//Same numbers as the default layers: 20 grass meshes, then 4 bushes
+		FFoliageFieldParams Params;
+		Params.Seed = 7919;
+		Params.Bounds = FBox(FVector::ZeroVector, FVector(Params.CellSize * NumCells, Params.CellSize, 10000.f));
+		FFoliageLayerParams& Grass = Params.Layers.AddDefaulted_GetRef();
+		Grass.NumMeshes = 20;
+		Grass.InstancesPerCell = 1200;
+		Grass.MinNormalZ = FMath::Cos(FMath::DegreesToRadians(35.f));
+		Grass.AlignToSurface = 0.6f;
+		Grass.NoiseScale = 0.0008f;
+		FFoliageLayerParams& Bush = Params.Layers.AddDefaulted_GetRef();
+		Bush.FirstBucket = 20;
+		Bush.NumMeshes = 4;
+		Bush.InstancesPerCell = 12;
+		Bush.MinNormalZ = FMath::Cos(FMath::DegreesToRadians(25.f));
+		Params.NumBuckets = 24;
+
+		TArray<FFoliageCellData> Cells;
+		Cells.SetNum(NumCells);
+		const int32 N = Params.SamplesPerSide;
+		for (int32 Cell = 0; Cell < NumCells; ++Cell)
+		{
+			Cells[Cell].Surface.SetNum(N * N);
+			for (int32 Sample = 0; Sample < N * N; ++Sample)
+			{
+				const float X = (Cell + (Sample % N) / (N - 1.f)) * Params.CellSize;
+				FFoliageSurfaceSample& Surface = Cells[Cell].Surface[Sample];
+				Surface.Height = 5000.f + 300.f * FMath::Sin(X * 0.001f);
+				Surface.Normal = FVector3f(-0.3f * FMath::Cos(X * 0.001f), 0.f, 1.f).GetSafeNormal();
+				Surface.bHit = true;
+			}
+		}
+
+		auto CountInstances = [&Cells]()
+			{
+				int32 Count = 0;
+				for (const FFoliageCellData& Cell : Cells)
+				{
+					for (const TArray<FTransform>& Bucket : Cell.Instances) Count += Bucket.Num();
+				}
+				return Count;
+			};
+
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 Cell = 0; Cell < NumCells; ++Cell)
+			AFoliageField::ScatterCell(Params, FIntPoint(Cell, 0), Cells[Cell]);
+		const double SerialMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		const int32 NumInstances = CountInstances();
+
+		//Kept to check the workers place every instance of every bucket exactly where one thread did
+		TArray<TArray<TArray<FTransform>>> SerialInstances;
+		SerialInstances.Reserve(NumCells);
+		for (FFoliageCellData& Cell : Cells)
+			SerialInstances.Add(MoveTemp(Cell.Instances));
+
+		StartTime = FPlatformTime::Seconds();
+		ParallelFor(NumCells, [&](int32 Cell) { AFoliageField::ScatterCell(Params, FIntPoint(Cell, 0), Cells[Cell]); });
+		const double ParallelMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+		int32 NumMismatched = 0;
+		for (int32 Cell = 0; Cell < NumCells; ++Cell)
+		{
+			const TArray<TArray<FTransform>>& Serial = SerialInstances[Cell];
+			const TArray<TArray<FTransform>>& Parallel = Cells[Cell].Instances;
+			for (int32 Bucket = 0; Bucket < FMath::Max(Serial.Num(), Parallel.Num()); ++Bucket)
+			{
+				bool bSame = Serial.IsValidIndex(Bucket) && Parallel.IsValidIndex(Bucket) && Serial[Bucket].Num() == Parallel[Bucket].Num();
+				for (int32 Index = 0; bSame && Index < Serial[Bucket].Num(); ++Index)
+					bSame = Serial[Bucket][Index].Equals(Parallel[Bucket][Index], 0.0);
+				if (bSame) continue;
+
+				if (NumMismatched++ == 0)
+					UE_LOG(LogOryx, Warning, TEXT("Foliage bench: cell %d bucket %d differs between one thread and all workers"), Cell, Bucket);
+			}
+		}
+
+		UE_LOG(LogOryx, Display, TEXT("Foliage bench: %d cells, %d instances (%s), one thread %.3f ms/cell, all workers %.3f ms/cell"),
+			NumCells, NumInstances, NumMismatched == 0 ? TEXT("deterministic") : *FString::Printf(TEXT("%d buckets MISMATCH"), NumMismatched),
+			SerialMs / NumCells, ParallelMs / NumCells);
+	}));
+
+AFoliageField::AFoliageField()
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	FieldBounds = CreateDefaultSubobject<UBoxComponent>(TEXT("FieldBounds"));
+	FieldBounds->SetBoxExtent(FVector(50000.f, 50000.f, 10000.f));
+	FieldBounds->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	FieldBounds->SetMobility(EComponentMobility::Static);
+	RootComponent = FieldBounds;
+
+	//Quarry grass carpets the flats, cheap enough to skip shadows and collision
+	FFoliageFieldLayer& Grass = Layers.AddDefaulted_GetRef();
+	for (TCHAR Variant = TEXT('A'); Variant <= TEXT('T'); ++Variant)
+	{
+		Grass.Meshes.Emplace(FSoftObjectPath(FString::Printf(
+			TEXT("/Game/Scene_QuarrySlate/Assets/MS/3D_Plants/Qua_Lim_Grass_Thatching_Common_Set_01/SM_Qua_Lim_Grass_Thatching_Common_Set_01_%c.SM_Qua_Lim_Grass_Thatching_Common_Set_01_%c"),
+			Variant, Variant)));
+	}
+	Grass.InstancesPerCell = 1200;
+	Grass.MinScale = 0.8f;
+	Grass.MaxScale = 1.3f;
+	Grass.AlignToSurface = 0.6f;
+	Grass.SinkDepth = 3.f;
+	Grass.NoiseScale = 0.0008f;
+	Grass.CullDistance = 6000.f;
+
+	//Sparse bushes in large clumps, these block like the rest of the scenery
+	FFoliageFieldLayer& Bushes = Layers.AddDefaulted_GetRef();
+	for (TCHAR Variant = TEXT('A'); Variant <= TEXT('D'); ++Variant)
+	{
+		Bushes.Meshes.Emplace(FSoftObjectPath(FString::Printf(
+			TEXT("/Game/Scene_QuarrySlate/Assets/MS/3D_Plants/Tun_Nor_Bush_EuropeanSpindle_Set_01/SM_Tun_Nor_Bush_EuropeanSpindle_Set_01_%c.SM_Tun_Nor_Bush_EuropeanSpindle_Set_01_%c"),
+			Variant, Variant)));
+	}
+	Bushes.InstancesPerCell = 12;
+	Bushes.MinScale = 0.7f;
+	Bushes.MaxScale = 1.3f;
+	Bushes.MaxSlope = 25.f;
+	Bushes.AlignToSurface = 0.15f;
+	Bushes.SinkDepth = 10.f;
+	Bushes.NoiseScale = 0.0002f;
+	Bushes.CullDistance = 12000.f;
+	Bushes.bCollision = true;
+	Bushes.bCastShadow = true;
+}
+
+void AFoliageField::BeginPlay()
+{
+	Super::BeginPlay();
+
+	TArray<FSoftObjectPath> Paths;
+	for (const FFoliageFieldLayer& Layer : Layers)
+	{
+		for (const TSoftObjectPtr<UStaticMesh>& Mesh : Layer.Meshes)
+		{
+			if (!Mesh.IsNull()) Paths.AddUnique(Mesh.ToSoftObjectPath());
+		}
+	}
+	if (Paths.Num() == 0) return;
+
+	MeshesHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(Paths,
+		FStreamableDelegate::CreateUObject(this, &AFoliageField::OnMeshesLoaded));
+}
+
+void AFoliageField::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	//Workers only hold their cell's data and traces check the cell's serial, so both can be left to finish
+	for (TPair<FIntPoint, FCell>& Pair : Cells)
+	{
+		if (Pair.Value.Data) Pair.Value.Data->bCancelled = true;
+	}
+	Cells.Reset();
+	WantedCells.Reset();
+
+	if (MeshesHandle.IsValid()) MeshesHandle->CancelHandle();
+	MeshesHandle.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AFoliageField::OnMeshesLoaded()
+{
+	//Snapshot the settings for the workers, changing them in the editor mid-play needs a restart
+	Params = FFoliageFieldParams();
+	Params.Seed = Seed;
+	Params.CellSize = CellSize;
+	Params.SamplesPerSide = FMath::Clamp(SamplesPerSide, 2, 33);
+	Params.Bounds = FieldBounds->Bounds.GetBox();
+
+	BucketMeshes.Reset();
+	BucketLayers.Reset();
+	for (int32 LayerIndex = 0; LayerIndex < Layers.Num(); ++LayerIndex)
+	{
+		const FFoliageFieldLayer& Layer = Layers[LayerIndex];
+
+		FFoliageLayerParams& LayerParams = Params.Layers.AddDefaulted_GetRef();
+		LayerParams.FirstBucket = BucketMeshes.Num();
+		LayerParams.InstancesPerCell = Layer.InstancesPerCell;
+		LayerParams.MinScale = Layer.MinScale;
+		LayerParams.MaxScale = Layer.MaxScale;
+		LayerParams.MinNormalZ = FMath::Cos(FMath::DegreesToRadians(Layer.MaxSlope));
+		LayerParams.AlignToSurface = Layer.AlignToSurface;
+		LayerParams.SinkDepth = Layer.SinkDepth;
+		LayerParams.NoiseScale = Layer.NoiseScale;
+
+		for (const TSoftObjectPtr<UStaticMesh>& Mesh : Layer.Meshes)
+		{
+			if (UStaticMesh* Loaded = Mesh.Get())
+			{
+				BucketMeshes.Add(Loaded);
+				BucketLayers.Add(LayerIndex);
+			}
+		}
+		LayerParams.NumMeshes = BucketMeshes.Num() - LayerParams.FirstBucket;
+	}
+	Params.NumBuckets = BucketMeshes.Num();
+
+	bMeshesLoaded = Params.NumBuckets > 0;
+	if (!bMeshesLoaded)
+		UE_LOG(LogOryx, Warning, TEXT("Foliage field %s: no foliage meshes loaded"), *GetName());
+}
+
+void AFoliageField::ScatterCell(const FFoliageFieldParams& Params, const FIntPoint& Coord, FFoliageCellData& Data)
+{
+	SCOPE_CYCLE_COUNTER(STAT_OryxFoliageFieldScatter);
+
+	const int32 N = Params.SamplesPerSide;
+	Data.Instances.SetNum(Params.NumBuckets);
+	if (N < 2 || Data.Surface.Num() != N * N) return;
+
+	const FVector2D CellMin = FVector2D(Coord) * Params.CellSize;
+	const FVector2D FieldSize(Params.Bounds.GetSize());
+
+	for (int32 LayerIndex = 0; LayerIndex < Params.Layers.Num(); ++LayerIndex)
+	{
+		const FFoliageLayerParams& Layer = Params.Layers[LayerIndex];
+		if (Layer.NumMeshes == 0) continue;
+
+		FRandomStream Random(HashCombine(HashCombine(GetTypeHash(Params.Seed), GetTypeHash(Coord)), GetTypeHash(LayerIndex)));
+
+		for (int32 Index = 0; Index < Layer.InstancesPerCell; ++Index)
+		{
+			if ((Index & 255) == 0 && Data.bCancelled) return;
+
+			//Every draw happens before any rejection so one plant never shifts the ones after it
+			const float U = Random.FRand();
+			const float V = Random.FRand();
+			const float KeepRoll = Random.FRand();
+			const float ScaleRoll = Random.FRand();
+			const int32 MeshIndex = Random.RandHelper(Layer.NumMeshes);
+			const float Yaw = Random.FRandRange(0.f, UE_TWO_PI);
+
+			const FVector2D Location2D = CellMin + FVector2D(U, V) * Params.CellSize;
+			if (Location2D.X >= FieldSize.X || Location2D.Y >= FieldSize.Y) continue;
+
+			//Bilinear between the four samples around it, bare where any of them missed the ground
+			const float GridX = U * (N - 1);
+			const float GridY = V * (N - 1);
+			const int32 X0 = FMath::Min(FMath::FloorToInt32(GridX), N - 2);
+			const int32 Y0 = FMath::Min(FMath::FloorToInt32(GridY), N - 2);
+			const float FracX = GridX - X0;
+			const float FracY = GridY - Y0;
+
+			const FFoliageSurfaceSample& S00 = Data.Surface[Y0 * N + X0];
+			const FFoliageSurfaceSample& S10 = Data.Surface[Y0 * N + X0 + 1];
+			const FFoliageSurfaceSample& S01 = Data.Surface[(Y0 + 1) * N + X0];
+			const FFoliageSurfaceSample& S11 = Data.Surface[(Y0 + 1) * N + X0 + 1];
+			if (!S00.bHit || !S10.bHit || !S01.bHit || !S11.bHit) continue;
+
+			const FVector3f Normal = FMath::BiLerp(S00.Normal, S10.Normal, S01.Normal, S11.Normal, FracX, FracY).GetSafeNormal();
+			if (Normal.Z < Layer.MinNormalZ) continue;
+
+			//Low frequency noise gathers the plants into clumps with bare ground between them
+			if (Layer.NoiseScale > 0.f)
+			{
+				const float Density = FMath::Clamp(FMath::PerlinNoise2D(Location2D * Layer.NoiseScale) * 0.5f + 0.5f, 0.f, 1.f);
+				if (KeepRoll > Density) continue;
+			}
+
+			const float Height = FMath::BiLerp(S00.Height, S10.Height, S01.Height, S11.Height, FracX, FracY);
+			const float Scale = FMath::Lerp(Layer.MinScale, Layer.MaxScale, ScaleRoll);
+			const FVector Up = FMath::Lerp(FVector::UpVector, FVector(Normal), Layer.AlignToSurface).GetSafeNormal();
+			const FQuat Rotation = FQuat::FindBetweenNormals(FVector::UpVector, Up) * FQuat(FVector::UpVector, Yaw);
+			const FVector Location = FVector(Location2D.X, Location2D.Y, Height) - Up * (Layer.SinkDepth * Scale);
+
+			Data.Instances[Layer.FirstBucket + MeshIndex].Emplace(Rotation, Location, FVector(Scale));
+		}
+	}
+}
+
+void AFoliageField::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!bMeshesLoaded) return;
+
+	SCOPE_CYCLE_COUNTER(STAT_OryxFoliageFieldStream);
+
+	UpdateWantedCells();
+	LaunchCellTasks();
+	StartCells();
+	ApplyCells();
+}
+
+void AFoliageField::ApplyWorldOffset(const FVector& InOffset, bool bWorldShift)
+{
+	Super::ApplyWorldOffset(InOffset, bWorldShift);
+
+	//Applied instances move with their components, cell coordinates and scattered cells are relative to this
+	Params.Bounds = Params.Bounds.ShiftBy(InOffset);
+
+	//Traces in flight answer in the old space, those cells start over
+	TArray<FIntPoint> Tracing;
+	for (const TPair<FIntPoint, FCell>& Pair : Cells)
+	{
+		if (Pair.Value.PendingTraces > 0) Tracing.Add(Pair.Key);
+	}
+	for (const FIntPoint& Coord : Tracing)
+		UnloadCell(Coord);
+}
+
+void AFoliageField::UpdateWantedCells()
+{
+	const FVector Origin = Params.Bounds.Min;
+	const FIntPoint MaxCoord(
+		FMath::CeilToInt(Params.Bounds.GetSize().X / Params.CellSize) - 1,
+		FMath::CeilToInt(Params.Bounds.GetSize().Y / Params.CellSize) - 1);
+
+	//Cells to keep (a cell beyond the load distance so they don't flicker at the edge), with their distance to the
+	//nearest pawn. Cells within the load distance of the pawn or its predicted path are wanted. Flat, height is ignored.
+	const float KeepDistance = LoadDistance + Params.CellSize;
+	TMap<FIntPoint, double> Keep;
+	TSet<FIntPoint> Wanted;
+
+	auto GatherAround = [&](const FVector2D& Point, const FVector2D& PawnLocation)
+		{
+			const FIntPoint Low(
+				FMath::Max(FMath::FloorToInt((Point.X - KeepDistance - Origin.X) / Params.CellSize), 0),
+				FMath::Max(FMath::FloorToInt((Point.Y - KeepDistance - Origin.Y) / Params.CellSize), 0));
+			const FIntPoint High(
+				FMath::Min(FMath::FloorToInt((Point.X + KeepDistance - Origin.X) / Params.CellSize), MaxCoord.X),
+				FMath::Min(FMath::FloorToInt((Point.Y + KeepDistance - Origin.Y) / Params.CellSize), MaxCoord.Y));
+
+			for (int32 Y = Low.Y; Y <= High.Y; ++Y)
+			for (int32 X = Low.X; X <= High.X; ++X)
+			{
+				const FIntPoint Coord(X, Y);
+				const FVector2D CellMin = FVector2D(Origin) + FVector2D(Coord) * Params.CellSize;
+				const FBox2D CellBox(CellMin, CellMin + FVector2D(Params.CellSize));
+
+				const double DistanceSq = CellBox.ComputeSquaredDistanceToPoint(Point);
+				if (DistanceSq > FMath::Square(KeepDistance)) continue;
+				if (DistanceSq <= FMath::Square(LoadDistance)) Wanted.Add(Coord);
+
+				const double PawnDistance = FMath::Sqrt(CellBox.ComputeSquaredDistanceToPoint(PawnLocation));
+				double& Priority = Keep.FindOrAdd(Coord, PawnDistance);
+				Priority = FMath::Min(Priority, PawnDistance);
+			}
+		};
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APawn* Pawn = It->Get() ? It->Get()->GetPawn() : nullptr;
+		if (!Pawn) continue;
+
+		//Sample the path the pawn will cover over the next PrefetchSeconds, about one sample per cell
+		const FVector2D Location(Pawn->GetActorLocation());
+		const FVector2D Predicted = Location + FVector2D(Pawn->GetVelocity()) * PrefetchSeconds;
+		const int32 NumSteps = FMath::Clamp(FMath::CeilToInt(FVector2D::Distance(Location, Predicted) / Params.CellSize), 0, 8);
+		for (int32 Step = 0; Step <= NumSteps; ++Step)
+			GatherAround(NumSteps > 0 ? FMath::Lerp(Location, Predicted, static_cast<float>(Step) / NumSteps) : Location, Location);
+	}
+
+	TArray<FIntPoint> ToUnload;
+	for (const TPair<FIntPoint, FCell>& Pair : Cells)
+	{
+		if (!Keep.Contains(Pair.Key)) ToUnload.Add(Pair.Key);
+	}
+	for (const FIntPoint& Coord : ToUnload)
+		UnloadCell(Coord);
+
+	WantedCells.Reset();
+	for (const FIntPoint& Coord : Wanted)
+	{
+		if (!Cells.Contains(Coord)) WantedCells.Emplace(Coord, Keep[Coord]);
+	}
+	WantedCells.Sort([](const TPair<FIntPoint, double>& A, const TPair<FIntPoint, double>& B) { return A.Value < B.Value; });
+
+	INC_DWORD_STAT_BY(STAT_OryxFoliageCellsWaiting, WantedCells.Num());
+}
+
+void AFoliageField::LaunchCellTasks()
+{
+	for (TPair<FIntPoint, FCell>& Pair : Cells)
+	{
+		FCell& Cell = Pair.Value;
+		if (Cell.bLaunched || Cell.PendingTraces > 0) continue;
+
+		Cell.bLaunched = true;
+		Cell.Task = UE::Tasks::Launch(UE_SOURCE_LOCATION,
+			[Data = Cell.Data, FieldParams = Params, Coord = Pair.Key]()
+			{
+				ScatterCell(FieldParams, Coord, *Data);
+			});
+	}
+}
+
+void AFoliageField::StartCells()
+{
+	int32 NumInFlight = 0;
+	for (const TPair<FIntPoint, FCell>& Pair : Cells)
+	{
+		if (!Pair.Value.bLaunched || !Pair.Value.Task.IsCompleted()) ++NumInFlight;
+	}
+	INC_DWORD_STAT_BY(STAT_OryxFoliageCellsInFlight, NumInFlight);
+
+	const int32 N = Params.SamplesPerSide;
+	const float Spacing = Params.CellSize / (N - 1);
+	const FVector Origin = Params.Bounds.Min;
+
+	//Ground is what pawns can walk on, minus ships, props and pawns that happen to be there and this field's own bushes
+	const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(OryxFoliageSurface), false, this);
+	FCollisionResponseParams ResponseParams;
+	ResponseParams.CollisionResponse.SetResponse(ECC_OryxShip, ECR_Ignore);
+	ResponseParams.CollisionResponse.SetResponse(ECC_OryxProp, ECR_Ignore);
+	ResponseParams.CollisionResponse.SetResponse(ECC_Pawn, ECR_Ignore);
+	ResponseParams.CollisionResponse.SetResponse(ECC_PhysicsBody, ECR_Ignore);
+
+	for (int32 Index = 0; Index < WantedCells.Num() && NumInFlight < MaxCellsInFlight; ++Index, ++NumInFlight)
+	{
+		const FIntPoint Coord = WantedCells[Index].Key;
+
+		FCell& Cell = Cells.Add(Coord);
+		Cell.Priority = WantedCells[Index].Value;
+		Cell.Serial = NextSerial++;
+		Cell.Data = MakeShared<FFoliageCellData>();
+		Cell.Data->Surface.SetNum(N * N);
+		Cell.PendingTraces = N * N;
+
+		//Answered on the async trace threads, the results come back at the start of next frame
+		const FTraceDelegate Delegate = FTraceDelegate::CreateUObject(this, &AFoliageField::OnSurfaceTrace, Coord, Cell.Serial);
+		for (int32 Sample = 0; Sample < N * N; ++Sample)
+		{
+			const double X = Origin.X + Coord.X * Params.CellSize + (Sample % N) * Spacing;
+			const double Y = Origin.Y + Coord.Y * Params.CellSize + (Sample / N) * Spacing;
+			GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, FVector(X, Y, Params.Bounds.Max.Z), FVector(X, Y, Origin.Z),
+				ECC_OryxWalkable, QueryParams, ResponseParams, &Delegate, Sample);
+		}
+	}
+}
+
+void AFoliageField::OnSurfaceTrace(const FTraceHandle& Handle, FTraceDatum& Datum, FIntPoint Coord, uint32 Serial)
+{
+	FCell* Cell = Cells.Find(Coord);
+	if (!Cell || Cell->Serial != Serial || !Cell->Data.IsValid() || !Cell->Data->Surface.IsValidIndex(Datum.UserData)) return;
+
+	if (Datum.OutHits.Num() > 0 && Datum.OutHits[0].bBlockingHit)
+	{
+		FFoliageSurfaceSample& Sample = Cell->Data->Surface[Datum.UserData];
+		Sample.Height = static_cast<float>(Datum.OutHits[0].ImpactPoint.Z - Params.Bounds.Min.Z);
+		Sample.Normal = FVector3f(Datum.OutHits[0].ImpactNormal);
+		Sample.bHit = true;
+	}
+	--Cell->PendingTraces;
+}
+
+void AFoliageField::ApplyCells()
+{
+	TArray<FCell*> Ready;
+	for (TPair<FIntPoint, FCell>& Pair : Cells)
+	{
+		if (!Pair.Value.bApplied && Pair.Value.bLaunched && Pair.Value.Task.IsCompleted()) Ready.Add(&Pair.Value);
+	}
+	Ready.Sort([](const FCell& A, const FCell& B) { return A.Priority < B.Priority; });
+
+	//Instances go in one mesh batch at a time, that's where the render and physics state cost lands
+	const double Deadline = FPlatformTime::Seconds() + CVarOryxFoliageBudgetMs.GetValueOnGameThread() / 1000.0;
+	bool bAppliedAny = false;
+
+	for (FCell* Cell : Ready)
+	{
+		while (Cell->NextBucket < Params.NumBuckets)
+		{
+			if (bAppliedAny && FPlatformTime::Seconds() >= Deadline) break;
+
+			const int32 Bucket = Cell->NextBucket++;
+			TArray<FTransform>& Instances = Cell->Data->Instances[Bucket];
+			if (Instances.Num() == 0) continue;
+
+			for (FTransform& Instance : Instances)
+				Instance.AddToTranslation(Params.Bounds.Min);
+
+			UHierarchicalInstancedStaticMeshComponent* Component = AcquireComponent(Bucket);
+			Component->AddInstances(Instances, false, true, false);
+			Cell->Components.Add(Component);
+			bAppliedAny = true;
+		}
+
+		if (Cell->NextBucket < Params.NumBuckets) break;
+
+		Cell->bApplied = true;
+		Cell->Data.Reset(); //Instances live in the components now
+	}
+
+	INC_DWORD_STAT_BY(STAT_OryxFoliageCellsLoaded, Cells.Num());
+}
+
+void AFoliageField::UnloadCell(const FIntPoint& Coord)
+{
+	FCell Cell;
+	if (!Cells.RemoveAndCopyValue(Coord, Cell)) return;
+
+	if (Cell.Data) Cell.Data->bCancelled = true;
+
+	for (UHierarchicalInstancedStaticMeshComponent* Component : Cell.Components)
+	{
+		Component->ClearInstances();
+		FreeComponents.Add(Component);
+	}
+}
+
+UHierarchicalInstancedStaticMeshComponent* AFoliageField::AcquireComponent(int32 Bucket)
+{
+	//Static components can't change mesh once registered, so only reuse one that already has this bucket's mesh
+	UStaticMesh* Mesh = BucketMeshes[Bucket];
+	UHierarchicalInstancedStaticMeshComponent* Component = nullptr;
+	for (int32 Index = FreeComponents.Num() - 1; Index >= 0; --Index)
+	{
+		if (FreeComponents[Index]->GetStaticMesh() != Mesh) continue;
+
+		Component = FreeComponents[Index];
+		FreeComponents.RemoveAtSwap(Index, EAllowShrinking::No);
+		break;
+	}
+
+	if (!Component)
+	{
+		Component = NewObject<UHierarchicalInstancedStaticMeshComponent>(this);
+		Component->SetupAttachment(RootComponent);
+		Component->SetMobility(EComponentMobility::Static);
+		Component->SetCanEverAffectNavigation(false);
+		Component->SetStaticMesh(Mesh);
+		Component->RegisterComponent();
+	}
+
+	const FFoliageFieldLayer& Layer = Layers[BucketLayers[Bucket]];
+	Component->SetCastShadow(Layer.bCastShadow);
+	Component->SetCullDistances(FMath::RoundToInt(Layer.CullDistance * 0.8f), FMath::RoundToInt(Layer.CullDistance));
+	if (Layer.bCollision)
+	{
+		Component->SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+	}
+	else
+	{
+		Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	}
+	return Component;
+}
@@ -1,13 +1,85 @@
 #include "GravityGun.h"
+#include "Oryx.h"
+#include "OryxEventSubsystem.h"
 #include "Components/StaticMeshComponent.h"
 #include "PhysicsEngine/PhysicsHandleComponent.h"
 #include "Camera/CameraComponent.h"
+#include "GameFramework/Pawn.h"
 #include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Net/UnrealNetwork.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/PackageMapClient.h"
+#include "Serialization/BitWriter.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_FLOAT_COUNTER_STAT(TEXT("GravityGun Bytes/s per Held Prop"), STAT_GravityGunBytesPerHeldProp, STATGROUP_Oryx);
+
+static TAutoConsoleVariable<bool> CVarGravityGunLogNetStats(
+    TEXT("Oryx.GravityGun.LogNetStats"),
+    false,
+    TEXT("Log replicated bytes per second per held prop once a second (server only)."));
+
+static TAutoConsoleVariable<float> CVarGravityGunHoldRateScale(
+    TEXT("Oryx.GravityGun.HoldRateScale"),
+    1.f,
+    TEXT("Scales how often a held prop's target is sent and replicated, lower saves game thread and bandwidth."));
+
+//Server-wide held prop bandwidth, measured over one second windows
+static int64 GHeldStateBitsSent = 0;     //Held state bits sent to all connections, measured in PreReplication
+static float GHeldPropSeconds = 0.f;     //Sum of time each gun spent holding a prop
+static double GNetStatsWindowStart = 0.0;
+static float GHeldPropBytesPerSecond = 0.f;
+
+bool FGravityGunHeldState::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+    //Presence bit keeps the stream in sync even if the receiver can't resolve the component yet
+    uint8 bHasComponent = Component != nullptr;
+    Ar.SerializeBits(&bHasComponent, 1);
+
+    bOutSuccess = true;
+    if (bHasComponent)
+    {
+        UObject* Object = Component;
+        Ar << Object;
+        Component = Cast<UPrimitiveComponent>(Object);
+
+        TargetLocation.NetSerialize(Ar, Map, bOutSuccess);
+        TargetRotation.SerializeCompressedShort(Ar);
+    }
+    else if (Ar.IsLoading())
+    {
+        Component = nullptr;
+    }
+    return true;
+}
+
+void FGravityGunHeldState::SerializeForStats(FBitWriter& Writer, FNetworkGUID ComponentGUID) const
+{
+    //Same layout as NetSerialize, with the component written as the packed NetGUID the package map would send
+    uint8 bHasComponent = Component != nullptr;
+    Writer.SerializeBits(&bHasComponent, 1);
+    if (!bHasComponent) return;
+
+    Writer << ComponentGUID;
+
+    FVector_NetQuantize10 Location = TargetLocation;
+    FRotator Rotation = TargetRotation;
+    bool bSuccess = true;
+    Location.NetSerialize(Writer, nullptr, bSuccess);
+    Rotation.SerializeCompressedShort(Writer);
+}
 
 AGravityGun::AGravityGun()
 {
     PrimaryActorTick.bCanEverTick = true;
 
+    //Server authoritative, the gun rides along on the owner's camera attachment
+    bReplicates = true;
+    SetReplicatingMovement(false);
+    SetNetUpdateFrequency(IdleNetUpdateFrequency);
+
     //Gun Mesh
     GunMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("GunMesh"));
     RootComponent = GunMesh;
@@ -17,6 +89,42 @@ AGravityGun::AGravityGun()
     //PhysicsHandle allows for smooth object movement using physics
 }
 
+void AGravityGun::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+    Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+    //Owner predicts its own prop, so it never needs the server copy
+    DOREPLIFETIME_CONDITION(AGravityGun, HeldState, COND_SkipOwner);
+    DOREPLIFETIME_CONDITION(AGravityGun, FireState, COND_SkipOwner);
+}
+
+void AGravityGun::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+    Super::PreReplication(ChangedPropertyTracker);
+
+    //Measured here rather than in NetSerialize, whose archive isn't always a bit writer
+    UNetDriver* NetDriver = GetNetDriver();
+    if (!NetDriver || !NetDriver->GuidCache.IsValid()) return;
+
+    FBitWriter Writer(0, true);
+    HeldState.SerializeForStats(Writer, HeldState.Component ? NetDriver->GuidCache->GetNetGUID(HeldState.Component) : FNetworkGUID());
+
+    //Quantized state that didn't change isn't sent again
+    const TArray<uint8>& Bits = *Writer.GetBuffer();
+    if (Writer.GetNumBits() == LastHeldStateNumBits && Bits == LastHeldStateBits) return;
+    LastHeldStateBits = Bits;
+    LastHeldStateNumBits = Writer.GetNumBits();
+
+    //Every client but the owner receives it (COND_SkipOwner). Relevancy is ignored, so far away clients count too
+    const UNetConnection* OwnerConnection = GetNetConnection();
+    int32 Receivers = 0;
+    for (const UNetConnection* Connection : NetDriver->ClientConnections)
+    {
+        if (Connection && Connection != OwnerConnection) ++Receivers;
+    }
+    GHeldStateBitsSent += Writer.GetNumBits() * Receivers;
+}
+
 void AGravityGun::BeginPlay()
 {
     Super::BeginPlay();
@@ -30,10 +138,26 @@ void AGravityGun::Tick(float DeltaTime)
 {
     Super::Tick(DeltaTime);
 
+    TimeSinceFire += DeltaTime;
+    if (HasAuthority())
+    {
+        UpdateNetRate(DeltaTime);
+        UpdateNetStats(DeltaTime);
+    }
+
     if (!HeldComponent || !PhysicsHandle) return;
 
+    //Other players' props follow the replicated server target,
+    //the server gets remote owners' targets through ServerUpdateHoldTarget
+    if (!IsLocallyControlled())
+    {
+        if (!HasAuthority())
+            PhysicsHandle->SetTargetLocationAndRotation(HeldState.TargetLocation, HeldState.TargetRotation);
+        return;
+    }
+
     //Get player camera
-    UCameraComponent* CameraComp = GetOwner()->FindComponentByClass<UCameraComponent>();
+    UCameraComponent* CameraComp = GetOwnerCamera();
     if (!CameraComp) return;
 
     //Compute hold location in front of player
@@ -91,24 +215,74 @@ void AGravityGun::Tick(float DeltaTime)
     //Apply rotation and position to physics handle
     //PhysicsHandle moves the held object smoothly via physics
     PhysicsHandle->SetTargetLocationAndRotation(HoldLocation, HeldTargetRotation);
+
+    //Server publishes its own target, clients predict locally and stream theirs up
+    if (HasAuthority())
+    {
+        HeldState.TargetLocation = HoldLocation;
+        HeldState.TargetRotation = HeldTargetRotation;
+    }
+    else
+    {
+        TimeSinceHoldTargetSent += DeltaTime;
+        const float RateScale = FMath::Clamp(CVarGravityGunHoldRateScale.GetValueOnGameThread(), 0.1f, 1.f);
+        if (TimeSinceHoldTargetSent >= 1.f / (HoldTargetSendRate * RateScale))
+        {
+            TimeSinceHoldTargetSent = 0.f;
+            ServerUpdateHoldTarget(HoldLocation, HeldTargetRotation);
+        }
+    }
+}
+
+UCameraComponent* AGravityGun::GetOwnerCamera() const
+{
+    return GetOwner() ? GetOwner()->FindComponentByClass<UCameraComponent>() : nullptr;
+}
+
+bool AGravityGun::IsLocallyControlled() const
+{
+    const APawn* OwnerPawn = Cast<APawn>(GetOwner());
+    return OwnerPawn ? OwnerPawn->IsLocallyControlled() : HasAuthority();
 }
 
 // Grab / Release
-void AGravityGun::ToggleGrab() 
-{ 
-    if (!HeldComponent) Grab(); 
-    else Release(); 
+void AGravityGun::ToggleGrab()
+{
+    if (!HeldComponent) Grab();
+    else Release();
 }
 
 void AGravityGun::Grab()
 {
     if (!PhysicsHandle || HeldComponent) return;
 
-    UCameraComponent* CameraComp = GetOwner()->FindComponentByClass<UCameraComponent>();
-    if (!CameraComp) return;
+    UPrimitiveComponent* HitComp = TraceForGrabbable();
+    if (!HitComp) return;
 
-    FVector Start = CameraComp->GetComponentLocation();
-    FVector End = Start + CameraComp->GetForwardVector() * Range;
+    //Grab immediately, clients then ask the server to confirm
+    GrabComponent(HitComp);
+    UOryxEventSubsystem::Push(this, EOryxEventType::Grab, this, HitComp);
+
+    if (HasAuthority())
+        HeldState.Component = HitComp;
+    else
+        ServerGrab(HitComp);
+}
+
+bool AGravityGun::GetGrabTrace(FVector& OutStart, FVector& OutEnd) const
+{
+    UCameraComponent* CameraComp = GetOwnerCamera();
+    if (!CameraComp) return false;
+
+    OutStart = CameraComp->GetComponentLocation();
+    OutEnd = OutStart + CameraComp->GetForwardVector() * Range;
+    return true;
+}
+
+UPrimitiveComponent* AGravityGun::TraceForGrabbable() const
+{
+    FVector Start, End;
+    if (!GetGrabTrace(Start, End)) return nullptr;
 
     FHitResult Hit;
     FCollisionQueryParams Params;
@@ -116,37 +290,68 @@ void AGravityGun::Grab()
     Params.AddIgnoredActor(GetOwner());
 
     //Line trace to find object in front
-    if (GetWorld()->LineTraceSingleByChannel(Hit, Start, End, ECC_PhysicsBody, Params))
+    if (GetWorld()->LineTraceSingleByChannel(Hit, Start, End, ECC_OryxGrab, Params))
     {
         UPrimitiveComponent* HitComp = Hit.GetComponent();
         if (HitComp && HitComp->IsSimulatingPhysics())
-        {
-            HeldComponent = HitComp;
-            FVector ComponentCenter = HitComp->Bounds.Origin;
-
-            //grab the object at its center with physics handle
-            PhysicsHandle->GrabComponentAtLocationWithRotation(
-                HeldComponent,
-                NAME_None,
-                ComponentCenter,
-                HeldComponent->GetComponentRotation()
-            );
-
-            //reduce damping while holding for smooth movement
-            HeldTargetRotation = HeldComponent->GetComponentRotation();
-            HeldComponent->SetLinearDamping(1.f);
-            HeldComponent->SetAngularDamping(1.f);
-        }
+            return HitComp;
     }
+    return nullptr;
+}
+
+void AGravityGun::GrabComponent(UPrimitiveComponent* Component)
+{
+    HeldComponent = Component;
+    FVector ComponentCenter = Component->Bounds.Origin;
+
+    //grab the object at its center with physics handle
+    PhysicsHandle->GrabComponentAtLocationWithRotation(
+        HeldComponent,
+        NAME_None,
+        ComponentCenter,
+        HeldComponent->GetComponentRotation()
+    );
+
+    //reduce damping while holding for smooth movement
+    HeldTargetRotation = HeldComponent->GetComponentRotation();
+    HeldComponent->SetLinearDamping(1.f);
+    HeldComponent->SetAngularDamping(1.f);
 }
 
 void AGravityGun::Release()
 {
     if (PhysicsHandle && HeldComponent)
     {
-        PhysicsHandle->ReleaseComponent();
-        HeldComponent = nullptr;
+        UOryxEventSubsystem::Push(this, EOryxEventType::Release, this, HeldComponent);
+        ReleaseComponent();
+
+        if (HasAuthority())
+            HeldState.Component = nullptr;
+        else
+            ServerRelease();
+    }
+}
+
+void AGravityGun::ReleaseComponent()
+{
+    PhysicsHandle->ReleaseComponent();
+    HeldComponent = nullptr;
+}
+
+void AGravityGun::SetHeldComponent(UPrimitiveComponent* Component)
+{
+    if (!HasAuthority() || Component == HeldComponent) return;
+
+    if (HeldComponent) ReleaseComponent();
+    if (Component && Component->IsSimulatingPhysics()) GrabComponent(Component);
+
+    HeldState.Component = HeldComponent;
+    if (HeldComponent)
+    {
+        HeldState.TargetLocation = HeldComponent->Bounds.Origin;
+        HeldState.TargetRotation = HeldTargetRotation;
     }
+    ForceNetUpdate();
 }
 
 // Spin
@@ -158,7 +363,7 @@ void AGravityGun::SnapRotationToHorizontal()
 {
     if (!HeldComponent) return;
 
-    UCameraComponent* CameraComp = GetOwner()->FindComponentByClass<UCameraComponent>();
+    UCameraComponent* CameraComp = GetOwnerCamera();
     if (!CameraComp) return;
 
     FRotator CameraRot = CameraComp->GetComponentRotation();
@@ -170,7 +375,7 @@ void AGravityGun::SnapRotationToVertical()
 {
     if (!HeldComponent) return;
 
-    UCameraComponent* CameraComp = GetOwner()->FindComponentByClass<UCameraComponent>();
+    UCameraComponent* CameraComp = GetOwnerCamera();
     if (!CameraComp) return;
 
     FRotator CameraRot = CameraComp->GetComponentRotation();
@@ -182,7 +387,7 @@ void AGravityGun::SnapRotationForward()
 {
     if (!HeldComponent) return;
 
-    UCameraComponent* CameraComp = GetOwner()->FindComponentByClass<UCameraComponent>();
+    UCameraComponent* CameraComp = GetOwnerCamera();
     if (!CameraComp) return;
 
     FRotator CameraRot = CameraComp->GetComponentRotation();
@@ -194,9 +399,177 @@ void AGravityGun::SnapRotationForward()
 void AGravityGun::FireObject()
 {
     if (!HeldComponent) return;
+
+    UCameraComponent* CameraComp = GetOwnerCamera();
+    if (!CameraComp) return;
+
     UPrimitiveComponent* Prim = HeldComponent;
-    FVector Forward = GetOwner()->FindComponentByClass<UCameraComponent>()->GetForwardVector();
+    FVector Forward = CameraComp->GetForwardVector();
+
+    ReleaseComponent(); //Let go before applying physics impulse
+    LaunchComponent(Prim, Forward);
+    UOryxEventSubsystem::Push(this, EOryxEventType::Fire, this, Prim);
+
+    if (HasAuthority())
+        RecordFire(Prim, Forward);
+    else
+        ServerFire(Prim, Forward);
+}
+
+void AGravityGun::LaunchComponent(UPrimitiveComponent* Component, const FVector& Direction)
+{
+    Component->AddImpulse(Direction * FireForce, NAME_None, true); //Add impulse to simulate shooting
+}
+
+void AGravityGun::RecordFire(UPrimitiveComponent* Component, const FVector& Direction)
+{
+    HeldState.Component = nullptr;
+
+    FireState.Component = Component;
+    FireState.LaunchLocation = Component->GetComponentLocation();
+    FireState.Direction = Direction;
+    FireState.FireCount++;
+
+    TimeSinceFire = 0.f;
+    ForceNetUpdate();
+}
+
+#pragma region Server RPCs
+void AGravityGun::ServerGrab_Implementation(UPrimitiveComponent* Component)
+{
+    if (HeldComponent) ReleaseComponent();
+
+    if (!CanServerGrab(Component))
+    {
+        HeldState.Component = nullptr;
+        ClientRejectGrab();
+        return;
+    }
+
+    GrabComponent(Component);
+    HeldState.Component = Component;
+    HeldState.TargetLocation = Component->Bounds.Origin;
+    HeldState.TargetRotation = HeldTargetRotation;
+    ForceNetUpdate();
+}
+
+bool AGravityGun::CanServerGrab(const UPrimitiveComponent* Component) const
+{
+    if (!Component || !Component->IsSimulatingPhysics()) return false;
+
+    //Two players can press grab on the same prop at once, the first to reach the server keeps it
+    for (TActorIterator<AGravityGun> It(GetWorld()); It; ++It)
+    {
+        if (*It != this && It->GetHeldComponent() == Component) return false;
+    }
+
+    //The owner's view as last sent by its client (APlayerPawnController::ServerUpdateMovement)
+    UCameraComponent* CameraComp = GetOwnerCamera();
+    if (!CameraComp) return false;
+
+    //Client traced from its predicted view, allow some slack for latency
+    const float MaxDistance = Range + Component->Bounds.SphereRadius + MaxHoldTargetError;
+    return FVector::DistSquared(CameraComp->GetComponentLocation(), Component->Bounds.Origin) <= FMath::Square(MaxDistance);
+}
+
+void AGravityGun::ServerRelease_Implementation()
+{
+    if (HeldComponent)
+    {
+        //The client pushed its own event, the server's stream needs one too (cargo holds listen there)
+        UOryxEventSubsystem::Push(this, EOryxEventType::Release, this, HeldComponent);
+        ReleaseComponent();
+    }
+    HeldState.Component = nullptr;
+}
+
+void AGravityGun::ServerFire_Implementation(UPrimitiveComponent* Component, FVector_NetQuantizeNormal Direction)
+{
+    //Ignore shots for props the server never confirmed
+    if (!HeldComponent || HeldComponent != Component) return;
+
+    ReleaseComponent();
+    LaunchComponent(Component, Direction);
+    RecordFire(Component, Direction);
+    UOryxEventSubsystem::Push(this, EOryxEventType::Fire, this, Component);
+}
+
+void AGravityGun::ServerUpdateHoldTarget_Implementation(FVector_NetQuantize10 Location, FRotator Rotation)
+{
+    if (!HeldComponent) return;
+
+    //Keep client targets inside the hold sphere so props can't be dragged through the level
+    if (UCameraComponent* CameraComp = GetOwnerCamera())
+    {
+        const FVector Eye = CameraComp->GetComponentLocation();
+        Location = Eye + (Location - Eye).GetClampedToMaxSize(HoldDistance + MaxHoldTargetError);
+    }
+
+    PhysicsHandle->SetTargetLocationAndRotation(Location, Rotation);
+    HeldState.TargetLocation = Location;
+    HeldState.TargetRotation = Rotation;
+}
+
+void AGravityGun::ClientRejectGrab_Implementation()
+{
+    if (HeldComponent) ReleaseComponent();
+}
+#pragma endregion
+
+#pragma region Replication
+void AGravityGun::OnRep_HeldState()
+{
+    if (HeldState.Component == HeldComponent) return;
+
+    if (HeldComponent) ReleaseComponent();
+    if (HeldState.Component) GrabComponent(HeldState.Component);
+}
+
+void AGravityGun::OnRep_FireState()
+{
+    UPrimitiveComponent* Prim = FireState.Component;
+    if (!Prim) return;
+
+    if (HeldComponent == Prim) ReleaseComponent();
+
+    //Start from the server launch point so every machine flies the same arc
+    Prim->SetWorldLocation(FireState.LaunchLocation, false, nullptr, ETeleportType::TeleportPhysics);
+    LaunchComponent(Prim, FireState.Direction);
+    UOryxEventSubsystem::Push(this, EOryxEventType::Fire, this, Prim); //Every machine sees each shot once
+}
+
+void AGravityGun::UpdateNetRate(float DeltaTime)
+{
+    //Replicate fast only while a prop is held or still flying from a shot,
+    //the engine further scales priority by distance to each viewer
+    const bool bActive = HeldComponent || TimeSinceFire < FiredTrackTime;
+    const float RateScale = FMath::Clamp(CVarGravityGunHoldRateScale.GetValueOnGameThread(), 0.1f, 1.f);
+    const float DesiredFrequency = bActive ? FMath::Max(HeldNetUpdateFrequency * RateScale, IdleNetUpdateFrequency) : IdleNetUpdateFrequency;
+
+    if (!FMath::IsNearlyEqual(GetNetUpdateFrequency(), DesiredFrequency))
+        SetNetUpdateFrequency(DesiredFrequency);
+}
+
+void AGravityGun::UpdateNetStats(float DeltaTime)
+{
+    if (HeldComponent) GHeldPropSeconds += DeltaTime;
+
+    const double Now = FPlatformTime::Seconds();
+    if (Now - GNetStatsWindowStart >= 1.0)
+    {
+        GHeldPropBytesPerSecond = GHeldPropSeconds > 0.f ? (GHeldStateBitsSent / 8.f) / GHeldPropSeconds : 0.f;
+
+        if (CVarGravityGunLogNetStats.GetValueOnGameThread() && GHeldPropSeconds > 0.f)
+        {
+            UE_LOG(LogOryx, Log, TEXT("GravityGun: %.1f bytes/s per held prop (%lld bits over %.2f prop-seconds)"),
+                GHeldPropBytesPerSecond, GHeldStateBitsSent, GHeldPropSeconds);
+        }
+
+        GHeldStateBitsSent = 0;
+        GHeldPropSeconds = 0.f;
+        GNetStatsWindowStart = Now;
+    }
 
-    Release(); //Let go before applying physics impulse
-    Prim->AddImpulse(Forward * FireForce, NAME_None, true); //Add impulse to simulate shooting
+    SET_FLOAT_STAT(STAT_GravityGunBytesPerHeldProp, GHeldPropBytesPerSecond);
 }
+#pragma endregion
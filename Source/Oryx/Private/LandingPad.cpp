@@ -3,6 +3,8 @@
 
 #include "LandingPad.h"
 #include "SpaceshipPawn.h"
+#include "OryxTrafficControl.h"
+#include "OryxEventSubsystem.h"
 #include "Components/StaticMeshComponent.h"
 #include "Kismet/GameplayStatics.h"
 #include "GameFramework/PlayerController.h"
@@ -16,12 +18,13 @@ ALandingPad::ALandingPad()
 	//Mesh for the pad
 	PadMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("PadMesh"));
 	RootComponent = PadMesh;
+	PadMesh->SetCollisionProfileName(TEXT("OryxPad"));
 
 	//Trigger Sphere
 	LandingTrigger = CreateDefaultSubobject<USphereComponent>(TEXT("LandingTrigger"));
 	LandingTrigger->SetupAttachment(RootComponent);
 	LandingTrigger->SetSphereRadius(500.f);
-	LandingTrigger->SetCollisionProfileName(TEXT("Trigger"));
+	LandingTrigger->SetCollisionProfileName(TEXT("OryxPadTrigger")); //Overlaps ships and nothing else
 
 	//Bind overlap events
 	LandingTrigger->OnComponentBeginOverlap.AddDynamic(this, &ALandingPad::OnOverlapBegin);
@@ -31,7 +34,23 @@ ALandingPad::ALandingPad()
 // Called when the game starts or when spawned
 void ALandingPad::BeginPlay()
 {
-	Super::BeginPlay();	
+	Super::BeginPlay();
+
+	if (UOryxTrafficControl* Traffic = GetWorld()->GetSubsystem<UOryxTrafficControl>())
+		Traffic->RegisterPad(this);
+}
+
+void ALandingPad::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UOryxTrafficControl* Traffic = GetWorld()->GetSubsystem<UOryxTrafficControl>())
+		Traffic->UnregisterPad(this);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+FVector ALandingPad::GetApproachPoint() const
+{
+	return GetActorLocation() + FVector(0.f, 0.f, LandingTrigger->GetScaledSphereRadius() * 0.5f);
 }
 
 
@@ -40,34 +59,33 @@ void ALandingPad::Tick(float DeltaTime)
 {
     Super::Tick(DeltaTime);
 
-    // Only check if a ship is inside the trigger
-    if (OverlappingShip && bIsInsideTrigger)
-    {
-        const float ShipZ = OverlappingShip->GetActorLocation().Z;
-        const float PadZ = GetActorLocation().Z;
+    OverlappingShips.RemoveAll([](const ASpaceshipPawn* Ship) { return !IsValid(Ship); });
+    ShipsCanLand.RemoveAll([](const ASpaceshipPawn* Ship) { return !IsValid(Ship); });
+
+    const UOryxTrafficControl* Traffic = GetWorld()->GetSubsystem<UOryxTrafficControl>();
 
+    // Only check ships inside the trigger
+    for (ASpaceshipPawn* Ship : OverlappingShips)
+    {
         // Landing is allowed only if inside trigger AND above pad
-        bool bWasCanLand = bCanLand;
-        bCanLand = (ShipZ > PadZ);
+        const bool bWasCanLand = ShipsCanLand.Contains(Ship);
+        const bool bCanLand = Ship->GetActorLocation().Z > GetActorLocation().Z;
+        if (bWasCanLand == bCanLand) continue;
+
+        if (bCanLand)
+        {
+            ShipsCanLand.Add(Ship);
+            Ship->OverlappingLandingPad = this;
 
-        if (bWasCanLand != bCanLand)
+            const bool bAvailable = !Traffic || Traffic->IsPadAvailableFor(this, Ship);
+            UOryxEventSubsystem::Push(this, EOryxEventType::PadEntered, Ship, this, bAvailable ? 1 : 0);
+        }
+        else
         {
-            if (bCanLand)
-            {
-                if (GEngine)
-                {
-                    GEngine->AddOnScreenDebugMessage(-1, 2.f, FColor::Yellow, TEXT("Press E to enter landing mode"));
-                }
-                OverlappingShip->OverlappingLandingPad = this;
-            }
-            else
-            {
-                if (GEngine)
-                {
-                    GEngine->AddOnScreenDebugMessage(-1, 2.f, FColor::Red, TEXT("Too low to enter landing mode"));
-                }
-                OverlappingShip->OverlappingLandingPad = nullptr;
-            }
+            ShipsCanLand.Remove(Ship);
+            if (Ship->OverlappingLandingPad == this) Ship->OverlappingLandingPad = nullptr;
+
+            UOryxEventSubsystem::Push(this, EOryxEventType::PadExited, Ship, this);
         }
     }
 }
@@ -75,22 +93,19 @@ void ALandingPad::Tick(float DeltaTime)
 void ALandingPad::OnOverlapBegin(UPrimitiveComponent* OverlappedComp, AActor* OtherActor,
     UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
-    ASpaceshipPawn* Ship = Cast<ASpaceshipPawn>(OtherActor);
-    if (Ship)
+    if (ASpaceshipPawn* Ship = Cast<ASpaceshipPawn>(OtherActor))
     {
-        OverlappingShip = Ship;
-        bIsInsideTrigger = true; // Ship is now inside trigger
+        OverlappingShips.AddUnique(Ship); // Ship is now inside trigger
     }
 }
 
 void ALandingPad::OnOverlapEnd(UPrimitiveComponent* OverlappedComp, AActor* OtherActor,
     UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
-    if (OtherActor == OverlappingShip)
+    if (ASpaceshipPawn* Ship = Cast<ASpaceshipPawn>(OtherActor))
     {
-        OverlappingShip->OverlappingLandingPad = nullptr;
-        OverlappingShip = nullptr;
-        bCanLand = false;
-        bIsInsideTrigger = false;
+        if (Ship->OverlappingLandingPad == this) Ship->OverlappingLandingPad = nullptr;
+        OverlappingShips.Remove(Ship);
+        ShipsCanLand.Remove(Ship);
     }
-}
\ No newline at end of file
+}
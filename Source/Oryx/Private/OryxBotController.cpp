@@ -0,0 +1,96 @@
+#include "OryxBotController.h"
+#include "Oryx.h"
+#include "GameFramework/Pawn.h"
+#include "Misc/FileHelper.h"
+
+TSharedPtr<const FOryxBotScript> FOryxBotScript::LoadFromFile(const FString& Path)
+{
+	TArray<FString> Lines;
+	if (!FFileHelper::LoadFileToStringArray(Lines, *Path))
+	{
+		UE_LOG(LogOryx, Error, TEXT("Bot script '%s' could not be read"), *Path);
+		return nullptr;
+	}
+
+	TSharedPtr<FOryxBotScript> Script = MakeShared<FOryxBotScript>();
+	const UEnum* ActionEnum = StaticEnum<EOryxInputAction>();
+
+	for (int32 LineIndex = 0; LineIndex < Lines.Num(); ++LineIndex)
+	{
+		FString Line = Lines[LineIndex].TrimStartAndEnd();
+		if (Line.IsEmpty() || Line.StartsWith(TEXT("#"))) continue; //Blank lines and comments
+
+		TArray<FString> Tokens;
+		Line.ParseIntoArrayWS(Tokens);
+
+		const int64 ActionValue = Tokens.Num() >= 2 ? ActionEnum->GetValueByNameString(Tokens[1]) : INDEX_NONE;
+		if (ActionValue == INDEX_NONE)
+		{
+			UE_LOG(LogOryx, Warning, TEXT("%s:%d: expected '<seconds> <Action> [x [y [z]]]'"), *Path, LineIndex + 1);
+			continue;
+		}
+
+		FOryxBotCommand Command;
+		Command.Time = FCString::Atof(*Tokens[0]);
+		Command.Action = static_cast<EOryxInputAction>(ActionValue);
+
+		//Value type follows the number of components given, no components means a press
+		FVector Axis = FVector::ZeroVector;
+		const int32 NumComponents = FMath::Min(Tokens.Num() - 2, 3);
+		for (int32 Component = 0; Component < NumComponents; ++Component)
+			Axis[Component] = FCString::Atof(*Tokens[Component + 2]);
+
+		switch (NumComponents)
+		{
+		case 0: Command.Value = FInputActionValue(true); break;
+		case 1: Command.Value = FInputActionValue(EInputActionValueType::Axis1D, Axis); break;
+		case 2: Command.Value = FInputActionValue(EInputActionValueType::Axis2D, Axis); break;
+		default: Command.Value = FInputActionValue(EInputActionValueType::Axis3D, Axis); break;
+		}
+
+		Script->Commands.Add(Command);
+	}
+
+	Script->Commands.StableSort([](const FOryxBotCommand& A, const FOryxBotCommand& B) { return A.Time < B.Time; });
+	Script->Duration = Script->Commands.Num() > 0 ? Script->Commands.Last().Time + 1.f : 0.f;
+	return Script;
+}
+
+AOryxBotController::AOryxBotController()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	bWantsPlayerState = false; //Bots don't need a player state, keeps the server lean
+}
+
+void AOryxBotController::SetScript(TSharedPtr<const FOryxBotScript> InScript, float StartOffset)
+{
+	Script = InScript;
+
+	//Negative time delays the first command so many bots don't act on the same frame
+	ScriptTime = -StartOffset;
+	NextCommand = 0;
+}
+
+void AOryxBotController::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!Script.IsValid() || Script->Duration <= 0.f) return;
+
+	ScriptTime += DeltaTime;
+
+	//Fire every command that came due this frame
+	const TArray<FOryxBotCommand>& Commands = Script->Commands;
+	while (NextCommand < Commands.Num() && Commands[NextCommand].Time <= ScriptTime)
+	{
+		OryxInput::Dispatch(GetPawn(), Commands[NextCommand].Action, Commands[NextCommand].Value);
+		++NextCommand;
+	}
+
+	//Loop forever, load tests run until the server is stopped
+	if (ScriptTime >= Script->Duration)
+	{
+		ScriptTime -= Script->Duration;
+		NextCommand = 0;
+	}
+}
@@ -0,0 +1,155 @@
+#include "OryxBotSubsystem.h"
+#include "Oryx.h"
+#include "OryxBotController.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerStart.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/IConsoleManager.h"
+
+static FAutoConsoleCommandWithWorldAndArgs GOryxBotsSpawnCommand(
+	TEXT("Oryx.Bots.Spawn"),
+	TEXT("Oryx.Bots.Spawn <Count> [ScriptPath] [OnFoot] - spawn scripted load test bots"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UOryxBotSubsystem* Bots = World ? World->GetSubsystem<UOryxBotSubsystem>() : nullptr;
+		if (!Bots || Args.Num() < 1) return;
+
+		const bool bOnFoot = Args.Num() >= 3 && Args[2].Equals(TEXT("OnFoot"), ESearchCase::IgnoreCase);
+		Bots->SpawnBots(FCString::Atoi(*Args[0]), Args.Num() >= 2 ? Args[1] : FString(), bOnFoot);
+	}));
+
+static FAutoConsoleCommandWithWorld GOryxBotsClearCommand(
+	TEXT("Oryx.Bots.Clear"),
+	TEXT("Destroy every load test bot and its pawn"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UOryxBotSubsystem* Bots = World ? World->GetSubsystem<UOryxBotSubsystem>() : nullptr)
+			Bots->ClearBots();
+	}));
+
+bool UOryxBotSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UOryxBotSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	//Command line bots are only spawned by the server (or standalone), clients just join
+	int32 Count = 0;
+	if (InWorld.GetNetMode() == NM_Client || !FParse::Value(FCommandLine::Get(), TEXT("OryxBots="), Count)) return;
+
+	FString ScriptPath;
+	FParse::Value(FCommandLine::Get(), TEXT("OryxBotScript="), ScriptPath);
+
+	FString PawnType;
+	FParse::Value(FCommandLine::Get(), TEXT("OryxBotPawn="), PawnType);
+
+	SpawnBots(Count, ScriptPath, PawnType.Equals(TEXT("OnFoot"), ESearchCase::IgnoreCase));
+}
+
+void UOryxBotSubsystem::Deinitialize()
+{
+	Bots.Reset();
+	Super::Deinitialize();
+}
+
+void UOryxBotSubsystem::SpawnBots(int32 Count, const FString& ScriptPath, bool bOnFoot)
+{
+	UWorld* World = GetWorld();
+	if (!World || Count <= 0) return;
+
+	UClass* PawnClass = (bOnFoot ? OnFootPawnClass : ShipPawnClass).LoadSynchronous();
+	if (!PawnClass)
+	{
+		UE_LOG(LogOryx, Error, TEXT("Bots: no %s pawn class configured in [/Script/Oryx.OryxBotSubsystem]"), bOnFoot ? TEXT("on-foot") : TEXT("ship"));
+		return;
+	}
+
+	const FString RelativeScript = ScriptPath.IsEmpty() ? (bOnFoot ? DefaultOnFootScript : DefaultShipScript) : ScriptPath;
+	const FString FullScriptPath = FPaths::IsRelative(RelativeScript) ? FPaths::ProjectContentDir() / RelativeScript : RelativeScript;
+	TSharedPtr<const FOryxBotScript> Script = FOryxBotScript::LoadFromFile(FullScriptPath);
+	if (!Script.IsValid()) return;
+
+	//Lay bots out on a grid around the first player start, row by row
+	FVector Origin = FVector::ZeroVector;
+	if (AActor* PlayerStart = UGameplayStatics::GetActorOfClass(World, APlayerStart::StaticClass()))
+		Origin = PlayerStart->GetActorLocation();
+
+	const int32 GridWidth = FMath::Max(SpawnGridWidth, 1);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		const int32 Slot = NextSpawnSlot++;
+		const FVector Location = Origin + FVector((Slot % GridWidth) * SpawnSpacing, (Slot / GridWidth) * SpawnSpacing, 0.f);
+
+		APawn* Pawn = World->SpawnActor<APawn>(PawnClass, Location, FRotator::ZeroRotator, SpawnParams);
+		AOryxBotController* Bot = World->SpawnActor<AOryxBotController>(SpawnParams);
+		if (!Pawn || !Bot) continue;
+
+		Bot->Possess(Pawn);
+		Bot->SetScript(Script, FMath::FRandRange(0.f, 1.f)); //Stagger so bots don't all press on the same frame
+		Bots.Add(Bot);
+	}
+
+	UE_LOG(LogOryx, Log, TEXT("Bots: %d running '%s'"), Bots.Num(), *FullScriptPath);
+
+	//Fresh measurement window for the new bot count
+	ReportFrames = 0;
+	ReportFrameTime = ReportGameThreadTime = ReportMaxFrameTime = ReportTimer = 0.0;
+}
+
+void UOryxBotSubsystem::ClearBots()
+{
+	for (AOryxBotController* Bot : Bots)
+	{
+		if (!Bot) continue;
+		if (APawn* Pawn = Bot->GetPawn()) Pawn->Destroy();
+		Bot->Destroy();
+	}
+	Bots.Reset();
+	NextSpawnSlot = 0;
+}
+
+void UOryxBotSubsystem::Tick(float DeltaTime)
+{
+	if (Bots.Num() == 0) return;
+
+	const double FrameMs = DeltaTime * 1000.0;
+	ReportFrames++;
+	ReportFrameTime += FrameMs;
+	ReportGameThreadTime += FPlatformTime::ToMilliseconds(GGameThreadTime);
+	ReportMaxFrameTime = FMath::Max(ReportMaxFrameTime, FrameMs);
+	ReportTimer += DeltaTime;
+
+	if (ReportTimer < ReportInterval) return;
+
+	UE_LOG(LogOryx, Display, TEXT("Bots: %d bots, tick avg %.2f ms, max %.2f ms, game thread %.2f ms"),
+		Bots.Num(), ReportFrameTime / ReportFrames, ReportMaxFrameTime, ReportGameThreadTime / ReportFrames);
+
+	//Logging is compiled out of shipping servers, the file keeps the numbers there
+	const FString ReportPath = FPaths::ProfilingDir() / TEXT("OryxBots.csv");
+	if (!bReportHeaderWritten)
+	{
+		bReportHeaderWritten = FFileHelper::SaveStringToFile(TEXT("Seconds,Bots,TickAvgMs,TickMaxMs,GameThreadMs\n"), *ReportPath);
+	}
+	FFileHelper::SaveStringToFile(FString::Printf(TEXT("%.1f,%d,%.3f,%.3f,%.3f\n"), GetWorld()->GetTimeSeconds(), Bots.Num(),
+		ReportFrameTime / ReportFrames, ReportMaxFrameTime, ReportGameThreadTime / ReportFrames),
+		*ReportPath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+
+	ReportFrames = 0;
+	ReportFrameTime = ReportGameThreadTime = ReportMaxFrameTime = ReportTimer = 0.0;
+}
+
+TStatId UOryxBotSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UOryxBotSubsystem, STATGROUP_Tickables);
+}
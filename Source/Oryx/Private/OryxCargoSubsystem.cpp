@@ -0,0 +1,69 @@
+#include "OryxCargoSubsystem.h"
+#include "Oryx.h"
+#include "OryxEventSubsystem.h"
+#include "ShipCargoHoldComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/World.h"
+
+bool UOryxCargoSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UOryxCargoSubsystem::Deinitialize()
+{
+	if (UOryxEventSubsystem* Events = EventsHandle.IsValid() ? GetWorld()->GetSubsystem<UOryxEventSubsystem>() : nullptr)
+		Events->RemoveListener(EventsHandle);
+	EventsHandle.Reset();
+	Holds.Reset();
+
+	Super::Deinitialize();
+}
+
+void UOryxCargoSubsystem::RegisterHold(UShipCargoHoldComponent* Hold)
+{
+	Holds.AddUnique(Hold);
+	if (EventsHandle.IsValid()) return;
+
+	if (UOryxEventSubsystem* Events = GetWorld()->GetSubsystem<UOryxEventSubsystem>())
+		EventsHandle = Events->AddListener(FOnOryxEvents::FDelegate::CreateUObject(this, &UOryxCargoSubsystem::OnEvents));
+}
+
+void UOryxCargoSubsystem::UnregisterHold(UShipCargoHoldComponent* Hold)
+{
+	Holds.RemoveAllSwap([Hold](const TWeakObjectPtr<UShipCargoHoldComponent>& Registered) { return !Registered.IsValid() || Registered == Hold; });
+	if (Holds.Num() > 0 || !EventsHandle.IsValid()) return;
+
+	if (UOryxEventSubsystem* Events = GetWorld()->GetSubsystem<UOryxEventSubsystem>())
+		Events->RemoveListener(EventsHandle);
+	EventsHandle.Reset();
+}
+
+void UOryxCargoSubsystem::OnEvents(TConstArrayView<FOryxEvent> Events)
+{
+	for (const FOryxEvent& Event : Events)
+	{
+		if (Event.Type != EOryxEventType::Release && Event.Type != EOryxEventType::Fire) continue;
+
+		UStaticMeshComponent* Component = Cast<UStaticMeshComponent>(Event.Other.ResolveObjectPtr());
+		if (!Component) continue;
+
+		//Only the closest hold in range watches it, two ships parked side by side don't both try to stow it
+		UShipCargoHoldComponent* Closest = nullptr;
+		double ClosestSq = TNumericLimits<double>::Max();
+		for (const TWeakObjectPtr<UShipCargoHoldComponent>& Registered : Holds)
+		{
+			UShipCargoHoldComponent* Hold = Registered.Get();
+			if (!Hold) continue;
+
+			const double DistanceSq = FVector::DistSquared(Component->Bounds.Origin, Hold->GetComponentLocation());
+			if (DistanceSq <= FMath::Square(Hold->GetWatchRadius()) && DistanceSq < ClosestSq)
+			{
+				Closest = Hold;
+				ClosestSq = DistanceSq;
+			}
+		}
+
+		if (Closest) Closest->Watch(Component);
+	}
+}
@@ -0,0 +1,105 @@
+#include "Oryx.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+//Old general purpose queries against the Oryx channels that replaced them, run from the local player's view. Candidates
+//are what an overlap of the query's volume accepts through the filter, a stand in for the broadphase results the
+//narrow phase has to look at
+namespace OryxCollisionBench
+{
+	struct FCase
+	{
+		const TCHAR* Name;
+		TFunction<int32()> Candidates;
+		TFunction<bool()> Query;
+	};
+
+	static void Run(UWorld* World, int32 Iterations)
+	{
+		const APlayerController* Player = World ? World->GetFirstPlayerController() : nullptr;
+		if (!Player || Iterations <= 0)
+		{
+			UE_LOG(LogOryx, Warning, TEXT("Collision bench: needs a local player"));
+			return;
+		}
+
+		FVector Eye;
+		FRotator ViewRotation;
+		Player->GetPlayerViewPoint(Eye, ViewRotation);
+
+		//Roughly the extents of CheckGrounded, the gravity gun's trace and FindShip's default radius
+		const FVector GroundEnd = Eye - FVector(0.0, 0.0, 200.0);
+		const FVector GrabEnd = Eye + ViewRotation.Vector() * 500.0;
+		const float BoardRadius = 1000.f;
+
+		const FCollisionQueryParams Params(SCENE_QUERY_STAT(OryxCollisionBench), false, Player->GetPawn());
+		const FCollisionShape GroundShape = FCollisionShape::MakeCapsule(1.f, 100.f);
+		const FCollisionShape GrabShape = FCollisionShape::MakeCapsule(1.f, 250.f);
+		const FCollisionShape BoardShape = FCollisionShape::MakeSphere(BoardRadius);
+		const FQuat Down = FQuat::Identity;
+		const FQuat Along = FRotationMatrix::MakeFromZ(ViewRotation.Vector()).ToQuat();
+		const FVector GroundMid = (Eye + GroundEnd) * 0.5;
+		const FVector GrabMid = (Eye + GrabEnd) * 0.5;
+
+		auto CountByChannel = [World, &Params](const FVector& At, const FQuat& Rotation, ECollisionChannel Channel, const FCollisionShape& Shape)
+		{
+			TArray<FOverlapResult> Overlaps;
+			World->OverlapMultiByChannel(Overlaps, At, Rotation, Channel, Shape, Params);
+			return Overlaps.Num();
+		};
+		auto CountByObjects = [World, &Params](const FVector& At, const FCollisionObjectQueryParams& Objects, const FCollisionShape& Shape)
+		{
+			TArray<FOverlapResult> Overlaps;
+			World->OverlapMultiByObjectType(Overlaps, At, FQuat::Identity, Objects, Shape, Params);
+			return Overlaps.Num();
+		};
+
+		const FCollisionObjectQueryParams AllObjects(FCollisionObjectQueryParams::AllObjects);
+		const FCollisionObjectQueryParams ShipObjects(ECC_OryxShip);
+
+		const FCase Cases[] =
+		{
+			{ TEXT("ground Visibility"),
+				[&] { return CountByChannel(GroundMid, Down, ECC_Visibility, GroundShape); },
+				[&] { FHitResult Hit; return World->LineTraceSingleByChannel(Hit, Eye, GroundEnd, ECC_Visibility, Params); } },
+			{ TEXT("ground OryxWalkable"),
+				[&] { return CountByChannel(GroundMid, Down, ECC_OryxWalkable, GroundShape); },
+				[&] { FHitResult Hit; return World->LineTraceSingleByChannel(Hit, Eye, GroundEnd, ECC_OryxWalkable, Params); } },
+			{ TEXT("grab PhysicsBody"),
+				[&] { return CountByChannel(GrabMid, Along, ECC_PhysicsBody, GrabShape); },
+				[&] { FHitResult Hit; return World->LineTraceSingleByChannel(Hit, Eye, GrabEnd, ECC_PhysicsBody, Params); } },
+			{ TEXT("grab OryxGrab"),
+				[&] { return CountByChannel(GrabMid, Along, ECC_OryxGrab, GrabShape); },
+				[&] { FHitResult Hit; return World->LineTraceSingleByChannel(Hit, Eye, GrabEnd, ECC_OryxGrab, Params); } },
+			{ TEXT("board all objects"),
+				[&] { return CountByObjects(Eye, AllObjects, BoardShape); },
+				[&] { TArray<FOverlapResult> Overlaps; return World->OverlapMultiByObjectType(Overlaps, Eye, FQuat::Identity, AllObjects, BoardShape, Params); } },
+			{ TEXT("board OryxShip"),
+				[&] { return CountByObjects(Eye, ShipObjects, BoardShape); },
+				[&] { TArray<FOverlapResult> Overlaps; return World->OverlapMultiByObjectType(Overlaps, Eye, FQuat::Identity, ShipObjects, BoardShape, Params); } },
+		};
+
+		for (const FCase& Case : Cases)
+		{
+			const int32 Candidates = Case.Candidates();
+
+			int32 NumHits = 0;
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 Index = 0; Index < Iterations; ++Index)
+				NumHits += Case.Query() ? 1 : 0;
+			const double Elapsed = FPlatformTime::Seconds() - StartTime;
+
+			UE_LOG(LogOryx, Display, TEXT("Collision bench: %-20s %4d candidates, %.3f us/query, hit %s"),
+				Case.Name, Candidates, Elapsed * 1000000.0 / Iterations, NumHits > 0 ? TEXT("yes") : TEXT("no"));
+		}
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs GOryxCollisionBenchCommand(
+	TEXT("Oryx.Collision.Bench"),
+	TEXT("Oryx.Collision.Bench [Iterations] - compare candidates and query times of the ground, grab and board queries on general vs Oryx channels"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		OryxCollisionBench::Run(World, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10000);
+	}));
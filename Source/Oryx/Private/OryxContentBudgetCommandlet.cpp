@@ -0,0 +1,362 @@
+#include "OryxContentBudgetCommandlet.h"
+#include "Oryx.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#if WITH_EDITOR
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "AssetCompilingManager.h"
+#include "Engine/Blueprint.h"
+#include "Engine/BlueprintGeneratedClass.h"
+#include "Engine/SimpleConstructionScript.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/Texture.h"
+#include "Engine/World.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "NiagaraSystem.h"
+#include "NiagaraEmitter.h"
+#include "NiagaraEmitterHandle.h"
+#include "UObject/UObjectGlobals.h"
+#endif
+
+UOryxContentBudgetCommandlet::UOryxContentBudgetCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+#if WITH_EDITOR
+TArray<FString> UOryxContentBudgetCommandlet::CheckStaticMesh(UStaticMesh* Mesh, FJsonObject& Metrics) const
+{
+	TArray<FString> Violations;
+
+	const bool bNanite = Mesh->IsNaniteEnabled();
+	const int32 Triangles = Mesh->GetNumTriangles(0);
+	Metrics.SetBoolField(TEXT("nanite"), bNanite);
+	Metrics.SetNumberField(TEXT("triangles"), Triangles);
+
+	if (bNanite)
+	{
+		const int32 NaniteTriangles = Mesh->GetNumNaniteTriangles();
+		Metrics.SetNumberField(TEXT("naniteTriangles"), NaniteTriangles);
+		if (NaniteTriangles > MaxNaniteTriangles)
+			Violations.Add(FString::Printf(TEXT("%d Nanite triangles, budget %d"), NaniteTriangles, MaxNaniteTriangles));
+	}
+	else if (Triangles > MaxMeshTriangles)
+	{
+		Violations.Add(FString::Printf(TEXT("%d LOD0 triangles, budget %d"), Triangles, MaxMeshTriangles));
+	}
+
+	if (const UBodySetup* Body = Mesh->GetBodySetup())
+	{
+		const int32 Elements = Body->AggGeom.GetElementCount();
+		int32 ConvexVertices = 0;
+		for (const FKConvexElem& Convex : Body->AggGeom.ConvexElems)
+			ConvexVertices += Convex.VertexData.Num();
+		const bool bComplexAsSimple = Body->CollisionTraceFlag == CTF_UseComplexAsSimple;
+
+		Metrics.SetNumberField(TEXT("collisionElements"), Elements);
+		Metrics.SetNumberField(TEXT("convexVertices"), ConvexVertices);
+		Metrics.SetBoolField(TEXT("complexAsSimple"), bComplexAsSimple);
+
+		if (Elements > MaxCollisionElements)
+			Violations.Add(FString::Printf(TEXT("%d collision elements, budget %d"), Elements, MaxCollisionElements));
+		if (ConvexVertices > MaxConvexVertices)
+			Violations.Add(FString::Printf(TEXT("%d convex hull vertices, budget %d"), ConvexVertices, MaxConvexVertices));
+		if (bComplexAsSimple && !bAllowComplexAsSimple)
+			Violations.Add(TEXT("uses complex collision as simple"));
+	}
+
+	return Violations;
+}
+
+TArray<FString> UOryxContentBudgetCommandlet::CheckTexture(UTexture* Texture, FJsonObject& Metrics, float& OutMB) const
+{
+	TArray<FString> Violations;
+
+	const int32 Width = Texture->Source.GetSizeX();
+	const int32 Height = Texture->Source.GetSizeY();
+	OutMB = Texture->CalcTextureMemorySizeEnum(TMC_AllMips) / (1024.f * 1024.f);
+
+	Metrics.SetNumberField(TEXT("width"), Width);
+	Metrics.SetNumberField(TEXT("height"), Height);
+	Metrics.SetNumberField(TEXT("memoryMB"), OutMB);
+
+	if (FMath::Max(Width, Height) > MaxTextureSize)
+		Violations.Add(FString::Printf(TEXT("%dx%d, budget %d"), Width, Height, MaxTextureSize));
+	if (OutMB > MaxTextureMB)
+		Violations.Add(FString::Printf(TEXT("%.1f MB, budget %.1f MB"), OutMB, MaxTextureMB));
+
+	return Violations;
+}
+
+TArray<FString> UOryxContentBudgetCommandlet::CheckNiagaraSystem(UNiagaraSystem* System, FJsonObject& Metrics) const
+{
+	TArray<FString> Violations;
+	int32 NumEmitters = 0;
+	int32 NumGpuEmitters = 0;
+	int32 NumUncapped = 0;
+	int32 LargestCap = 0;
+
+	for (const FNiagaraEmitterHandle& Handle : System->GetEmitterHandles())
+	{
+		const FVersionedNiagaraEmitterData* Data = Handle.GetIsEnabled() ? Handle.GetEmitterData() : nullptr;
+		if (!Data) continue;
+
+		++NumEmitters;
+		if (Data->SimTarget == ENiagaraSimTarget::GPUComputeSim) ++NumGpuEmitters;
+
+		//The declared allocation is the only cap an emitter states up front, automatic ones grow to whatever spawns
+		if (Data->AllocationMode == EParticleAllocationMode::AutomaticEstimate)
+		{
+			++NumUncapped;
+			if (bRequireParticleCaps)
+				Violations.Add(FString::Printf(TEXT("emitter %s has no particle cap"), *Handle.GetName().ToString()));
+		}
+		else
+		{
+			LargestCap = FMath::Max(LargestCap, Data->PreAllocationCount);
+			if (Data->PreAllocationCount > MaxParticlesPerEmitter)
+				Violations.Add(FString::Printf(TEXT("emitter %s caps at %d particles, budget %d"), *Handle.GetName().ToString(), Data->PreAllocationCount, MaxParticlesPerEmitter));
+		}
+	}
+
+	Metrics.SetNumberField(TEXT("emitters"), NumEmitters);
+	Metrics.SetNumberField(TEXT("gpuEmitters"), NumGpuEmitters);
+	Metrics.SetNumberField(TEXT("uncappedEmitters"), NumUncapped);
+	Metrics.SetNumberField(TEXT("largestParticleCap"), LargestCap);
+
+	if (NumEmitters > MaxNiagaraEmitters)
+		Violations.Add(FString::Printf(TEXT("%d emitters, budget %d"), NumEmitters, MaxNiagaraEmitters));
+
+	return Violations;
+}
+
+TArray<FString> UOryxContentBudgetCommandlet::CheckBlueprint(UBlueprint* Blueprint, FJsonObject& Metrics) const
+{
+	TArray<FString> Violations;
+
+	const UBlueprintGeneratedClass* Class = Cast<UBlueprintGeneratedClass>(Blueprint->GeneratedClass);
+	const AActor* Defaults = Class ? Cast<AActor>(Class->GetDefaultObject()) : nullptr;
+	if (!Defaults) return Violations; //Only actor blueprints have components
+
+	//Native components live on the class default object, blueprint added ones only as construction script nodes
+	int32 NumComponents = Defaults->GetComponents().Num();
+	for (const UBlueprintGeneratedClass* It = Class; It; It = Cast<UBlueprintGeneratedClass>(It->GetSuperClass()))
+	{
+		if (It->SimpleConstructionScript) NumComponents += It->SimpleConstructionScript->GetAllNodes().Num();
+	}
+
+	Metrics.SetNumberField(TEXT("components"), NumComponents);
+	if (NumComponents > MaxBlueprintComponents)
+		Violations.Add(FString::Printf(TEXT("%d components, budget %d"), NumComponents, MaxBlueprintComponents));
+
+	return Violations;
+}
+
+void UOryxContentBudgetCommandlet::GatherDependencies(FName Package, TSet<FName>& InOutPackages) const
+{
+	IAssetRegistry& Registry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+
+	TArray<FName> Stack = { Package };
+	while (Stack.Num() > 0)
+	{
+		const FName Current = Stack.Pop(EAllowShrinking::No);
+		bool bAlreadyGathered = false;
+		InOutPackages.Add(Current, &bAlreadyGathered);
+		if (bAlreadyGathered) continue;
+
+		TArray<FName> Dependencies;
+		Registry.GetDependencies(Current, Dependencies, UE::AssetRegistry::EDependencyCategory::Package, UE::AssetRegistry::EDependencyQuery::Hard);
+		for (const FName Dependency : Dependencies)
+		{
+			//Engine content is Epic's budget, not ours
+			if (Dependency.ToString().StartsWith(TEXT("/Game/"))) Stack.Add(Dependency);
+		}
+	}
+}
+#endif
+
+int32 UOryxContentBudgetCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	FString RootsParam = TEXT("/Game/Maps,/Game/Blueprints");
+	FParse::Value(*Params, TEXT("Roots="), RootsParam);
+	FString ReportPath = FPaths::ProjectSavedDir() / TEXT("ContentBudget") / TEXT("Report.json");
+	FParse::Value(*Params, TEXT("Report="), ReportPath);
+
+	TArray<FString> Roots;
+	RootsParam.ParseIntoArray(Roots, TEXT(","));
+
+	IAssetRegistry& Registry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	Registry.SearchAllAssets(true);
+
+	FARFilter Filter;
+	for (const FString& Root : Roots)
+		Filter.PackagePaths.Add(FName(*Root));
+	Filter.bRecursivePaths = true;
+	Filter.ClassPaths = { UWorld::StaticClass()->GetClassPathName(), UBlueprint::StaticClass()->GetClassPathName() };
+	Filter.bRecursiveClasses = true;
+
+	TArray<FAssetData> Scanned;
+	Registry.GetAssets(Filter, Scanned);
+	UE_LOG(LogOryx, Display, TEXT("Content budget: %d maps and blueprints under %s"), Scanned.Num(), *RootsParam);
+
+	//Each referenced asset is measured once, however many maps use it
+	TMap<FSoftObjectPath, TSharedPtr<FJsonObject>> Measured;
+	TMap<FSoftObjectPath, float> TextureMB;
+	TArray<TSharedPtr<FJsonValue>> MapReports;
+	int32 NumViolations = 0;
+
+	auto Measure = [&](const FAssetData& Asset)
+		{
+			const FSoftObjectPath Path = Asset.GetSoftObjectPath();
+			if (Measured.Contains(Path)) return;
+
+			const TCHAR* Category = Asset.IsInstanceOf(UStaticMesh::StaticClass()) ? TEXT("StaticMesh") :
+				Asset.IsInstanceOf(UTexture::StaticClass()) ? TEXT("Texture") :
+				Asset.IsInstanceOf(UNiagaraSystem::StaticClass()) ? TEXT("NiagaraSystem") :
+				Asset.IsInstanceOf(UBlueprint::StaticClass()) ? TEXT("Blueprint") : nullptr;
+			if (!Category) return;
+
+			UObject* Object = Asset.GetAsset();
+			if (!Object)
+			{
+				UE_LOG(LogOryx, Warning, TEXT("Content budget: failed to load %s"), *Path.ToString());
+				return;
+			}
+
+			//Render and collision data are built asynchronously in the editor
+			FAssetCompilingManager::Get().FinishAllCompilation();
+
+			TSharedPtr<FJsonObject> Metrics = MakeShared<FJsonObject>();
+			TArray<FString> Violations;
+			if (UStaticMesh* Mesh = Cast<UStaticMesh>(Object))
+			{
+				Violations = CheckStaticMesh(Mesh, *Metrics);
+			}
+			else if (UTexture* Texture = Cast<UTexture>(Object))
+			{
+				float MB = 0.f;
+				Violations = CheckTexture(Texture, *Metrics, MB);
+				TextureMB.Add(Path, MB);
+			}
+			else if (UNiagaraSystem* System = Cast<UNiagaraSystem>(Object))
+			{
+				Violations = CheckNiagaraSystem(System, *Metrics);
+			}
+			else if (UBlueprint* Blueprint = Cast<UBlueprint>(Object))
+			{
+				Violations = CheckBlueprint(Blueprint, *Metrics);
+			}
+
+			for (const FString& Violation : Violations)
+				UE_LOG(LogOryx, Warning, TEXT("Content budget: %s %s"), *Path.ToString(), *Violation);
+			NumViolations += Violations.Num();
+
+			TSharedPtr<FJsonObject> Entry = MakeShared<FJsonObject>();
+			Entry->SetStringField(TEXT("path"), Path.ToString());
+			Entry->SetStringField(TEXT("category"), Category);
+			Entry->SetObjectField(TEXT("metrics"), Metrics);
+			TArray<TSharedPtr<FJsonValue>> ViolationValues;
+			for (const FString& Violation : Violations)
+				ViolationValues.Add(MakeShared<FJsonValueString>(Violation));
+			Entry->SetArrayField(TEXT("violations"), ViolationValues);
+			Measured.Add(Path, Entry);
+		};
+
+	for (const FAssetData& Root : Scanned)
+	{
+		TSet<FName> Packages;
+		GatherDependencies(Root.PackageName, Packages);
+
+		const bool bMap = Root.IsInstanceOf(UWorld::StaticClass());
+		if (bMap)
+		{
+			//World Partition actors are saved in their own packages, nothing in the map references them
+			const FString MapPath = Root.PackageName.ToString();
+			const FString ExternalActors = TEXT("/Game/__ExternalActors__") + MapPath.RightChop(FCString::Strlen(TEXT("/Game")));
+			TArray<FAssetData> ActorAssets;
+			Registry.GetAssetsByPath(FName(*ExternalActors), ActorAssets, true);
+			for (const FAssetData& Actor : ActorAssets)
+				GatherDependencies(Actor.PackageName, Packages);
+		}
+
+		float MapTextureMB = 0.f;
+		for (const FName Package : Packages)
+		{
+			TArray<FAssetData> Assets;
+			Registry.GetAssetsByPackageName(Package, Assets);
+			for (const FAssetData& Asset : Assets)
+			{
+				Measure(Asset);
+				if (const float* MB = TextureMB.Find(Asset.GetSoftObjectPath())) MapTextureMB += *MB;
+			}
+		}
+
+		//Measured assets are only kept as JSON, the objects can go
+		CollectGarbage(RF_NoFlags);
+
+		if (!bMap) continue;
+
+		TSharedPtr<FJsonObject> MapEntry = MakeShared<FJsonObject>();
+		MapEntry->SetStringField(TEXT("path"), Root.GetSoftObjectPath().ToString());
+		MapEntry->SetNumberField(TEXT("packages"), Packages.Num());
+		MapEntry->SetNumberField(TEXT("textureMB"), MapTextureMB);
+		TArray<TSharedPtr<FJsonValue>> ViolationValues;
+		if (MapTextureMB > MaxMapTextureMB)
+		{
+			const FString Violation = FString::Printf(TEXT("%.1f MB of textures, budget %.1f MB"), MapTextureMB, MaxMapTextureMB);
+			UE_LOG(LogOryx, Warning, TEXT("Content budget: %s %s"), *Root.PackageName.ToString(), *Violation);
+			ViolationValues.Add(MakeShared<FJsonValueString>(Violation));
+			++NumViolations;
+		}
+		MapEntry->SetArrayField(TEXT("violations"), ViolationValues);
+		MapReports.Add(MakeShared<FJsonValueObject>(MapEntry));
+	}
+
+	TSharedPtr<FJsonObject> Budgets = MakeShared<FJsonObject>();
+	Budgets->SetNumberField(TEXT("maxMeshTriangles"), MaxMeshTriangles);
+	Budgets->SetNumberField(TEXT("maxNaniteTriangles"), MaxNaniteTriangles);
+	Budgets->SetNumberField(TEXT("maxCollisionElements"), MaxCollisionElements);
+	Budgets->SetNumberField(TEXT("maxConvexVertices"), MaxConvexVertices);
+	Budgets->SetBoolField(TEXT("allowComplexAsSimple"), bAllowComplexAsSimple);
+	Budgets->SetNumberField(TEXT("maxTextureMB"), MaxTextureMB);
+	Budgets->SetNumberField(TEXT("maxTextureSize"), MaxTextureSize);
+	Budgets->SetNumberField(TEXT("maxNiagaraEmitters"), MaxNiagaraEmitters);
+	Budgets->SetNumberField(TEXT("maxParticlesPerEmitter"), MaxParticlesPerEmitter);
+	Budgets->SetBoolField(TEXT("requireParticleCaps"), bRequireParticleCaps);
+	Budgets->SetNumberField(TEXT("maxBlueprintComponents"), MaxBlueprintComponents);
+	Budgets->SetNumberField(TEXT("maxMapTextureMB"), MaxMapTextureMB);
+
+	TArray<TSharedPtr<FJsonValue>> AssetReports;
+	for (const TPair<FSoftObjectPath, TSharedPtr<FJsonObject>>& Pair : Measured)
+		AssetReports.Add(MakeShared<FJsonValueObject>(Pair.Value));
+
+	TSharedPtr<FJsonObject> Report = MakeShared<FJsonObject>();
+	Report->SetBoolField(TEXT("passed"), NumViolations == 0);
+	Report->SetNumberField(TEXT("violations"), NumViolations);
+	Report->SetObjectField(TEXT("budgets"), Budgets);
+	Report->SetArrayField(TEXT("maps"), MapReports);
+	Report->SetArrayField(TEXT("assets"), AssetReports);
+
+	FString Json;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+	if (!FJsonSerializer::Serialize(Report.ToSharedRef(), Writer) || !FFileHelper::SaveStringToFile(Json, *ReportPath))
+	{
+		UE_LOG(LogOryx, Error, TEXT("Content budget: failed to write %s"), *ReportPath);
+		return 2;
+	}
+
+	UE_LOG(LogOryx, Display, TEXT("Content budget: %d assets measured, %d violation(s), report %s"), Measured.Num(), NumViolations, *ReportPath);
+	return NumViolations == 0 ? 0 : 1;
+#else
+	UE_LOG(LogOryx, Error, TEXT("Content budget: needs editor data, run it with UnrealEditor-Cmd"));
+	return 2;
+#endif
+}
@@ -0,0 +1,227 @@
+#include "OryxEventSubsystem.h"
+#include "Oryx.h"
+#include "SpaceshipPawn.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Event dispatch"), STAT_OryxEventDispatch, STATGROUP_Oryx);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Events dispatched"), STAT_OryxEventsDispatched, STATGROUP_Oryx);
+
+static TAutoConsoleVariable<bool> CVarOryxEventsScreen(
+	TEXT("Oryx.Events.Screen"),
+	UE_BUILD_DEBUG || UE_BUILD_DEVELOPMENT, //Debug messages, test and shipping builds start without the listener
+	TEXT("Show landing and pad prompts for the local player's ship on screen"));
+
+static TAutoConsoleVariable<bool> CVarOryxEventsLog(
+	TEXT("Oryx.Events.Log"),
+	false,
+	TEXT("Log every gameplay event"));
+
+static FAutoConsoleCommandWithWorldAndArgs GOryxEventsBenchCommand(
+	TEXT("Oryx.Events.Bench"),
+	TEXT("Oryx.Events.Bench [Count] - push Count events from all workers and time push and dispatch"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UOryxEventSubsystem* Events = World ? World->GetSubsystem<UOryxEventSubsystem>() : nullptr)
+			Events->RunBenchmark(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000000);
+	}));
+
+bool UOryxEventSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UOryxEventSubsystem::Deinitialize()
+{
+	OnEvents.Clear();
+	NumListeners = 0;
+	Queue.Empty();
+	Super::Deinitialize();
+}
+
+TStatId UOryxEventSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UOryxEventSubsystem, STATGROUP_Tickables);
+}
+
+void UOryxEventSubsystem::Push(const UObject* WorldContext, EOryxEventType Type, const UObject* Subject, const UObject* Other, uint8 Value)
+{
+	const UWorld* World = WorldContext ? WorldContext->GetWorld() : nullptr;
+	UOryxEventSubsystem* Events = World ? World->GetSubsystem<UOryxEventSubsystem>() : nullptr;
+	if (!Events || !Events->HasListeners()) return;
+
+	FOryxEvent Event;
+	Event.Time = FPlatformTime::Seconds();
+	Event.Frame = static_cast<uint32>(GFrameCounter);
+	Event.Type = Type;
+	Event.Value = Value;
+	Event.Subject = FObjectKey(Subject);
+	Event.Other = FObjectKey(Other);
+	Events->Push(Event);
+}
+
+void UOryxEventSubsystem::Push(const FOryxEvent& Event)
+{
+	if (HasListeners()) Queue.Enqueue(Event);
+}
+
+FDelegateHandle UOryxEventSubsystem::AddListener(FOnOryxEvents::FDelegate&& Listener)
+{
+	check(IsInGameThread());
+	++NumListeners;
+	return OnEvents.Add(MoveTemp(Listener));
+}
+
+void UOryxEventSubsystem::RemoveListener(FDelegateHandle Handle)
+{
+	check(IsInGameThread());
+	if (OnEvents.Remove(Handle)) --NumListeners;
+}
+
+void UOryxEventSubsystem::Tick(float DeltaTime)
+{
+	SyncBuiltInListeners();
+	Flush();
+}
+
+void UOryxEventSubsystem::Flush()
+{
+	SCOPE_CYCLE_COUNTER(STAT_OryxEventDispatch);
+
+	FOryxEvent Event;
+	while (Queue.Dequeue(Event))
+		Batch.Add(Event);
+	if (Batch.Num() == 0) return;
+
+	//Listeners removed since these were pushed just miss them
+	OnEvents.Broadcast(Batch);
+	INC_DWORD_STAT_BY(STAT_OryxEventsDispatched, Batch.Num());
+	Batch.Reset();
+}
+
+void UOryxEventSubsystem::SyncBuiltInListeners()
+{
+	const bool bScreen = CVarOryxEventsScreen.GetValueOnGameThread();
+	if (bScreen != ScreenHandle.IsValid())
+	{
+		if (bScreen)
+		{
+			ScreenHandle = AddListener(FOnOryxEvents::FDelegate::CreateUObject(this, &UOryxEventSubsystem::ShowOnScreen));
+		}
+		else
+		{
+			RemoveListener(ScreenHandle);
+			ScreenHandle.Reset();
+		}
+	}
+
+	const bool bLog = CVarOryxEventsLog.GetValueOnGameThread();
+	if (bLog != LogHandle.IsValid())
+	{
+		if (bLog)
+		{
+			LogHandle = AddListener(FOnOryxEvents::FDelegate::CreateUObject(this, &UOryxEventSubsystem::LogEvents));
+		}
+		else
+		{
+			RemoveListener(LogHandle);
+			LogHandle.Reset();
+		}
+	}
+}
+
+void UOryxEventSubsystem::ShowOnScreen(TConstArrayView<FOryxEvent> Events) const
+{
+	if (!GEngine) return;
+
+	for (const FOryxEvent& Event : Events)
+	{
+		//Prompts are only for the local player, AI traffic can be in the hundreds
+		const ASpaceshipPawn* Ship = Cast<ASpaceshipPawn>(Event.Subject.ResolveObjectPtr());
+		if (!Ship || !Ship->IsLocallyControlled() || !Ship->IsPlayerControlled()) continue;
+
+		switch (Event.Type)
+		{
+		case EOryxEventType::LandingStage:
+			if (Event.Value == static_cast<uint8>(ELandingStage::Landed))
+				GEngine->AddOnScreenDebugMessage(-1, 3.f, FColor::Green, TEXT("Landing Complete"));
+			else if (Event.Value == static_cast<uint8>(ELandingStage::None))
+				GEngine->AddOnScreenDebugMessage(-1, 2.f, FColor::Cyan, TEXT("Takeoff initiated"));
+			break;
+		case EOryxEventType::PadEntered:
+			if (Event.Value)
+				GEngine->AddOnScreenDebugMessage(-1, 2.f, FColor::Yellow, TEXT("Press E to enter landing mode"));
+			else
+				GEngine->AddOnScreenDebugMessage(-1, 2.f, FColor::Red, TEXT("Landing pad reserved by another ship"));
+			break;
+		case EOryxEventType::PadExited:
+			GEngine->AddOnScreenDebugMessage(-1, 2.f, FColor::Red, TEXT("Too low to enter landing mode"));
+			break;
+		case EOryxEventType::PadDenied:
+			GEngine->AddOnScreenDebugMessage(-1, 2.f, FColor::Red, TEXT("Landing pad reserved by another ship"));
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+void UOryxEventSubsystem::LogEvents(TConstArrayView<FOryxEvent> Events) const
+{
+	static const TCHAR* TypeNames[] = { TEXT("LandingStage"), TEXT("PadEntered"), TEXT("PadExited"), TEXT("PadDenied"),
+		TEXT("Grab"), TEXT("Release"), TEXT("Fire"), TEXT("Board"), TEXT("Exit"), TEXT("Stow"), TEXT("Eject"), TEXT("Fracture") };
+
+	for (const FOryxEvent& Event : Events)
+	{
+		const uint8 TypeIndex = static_cast<uint8>(Event.Type);
+		UE_LOG(LogOryx, Log, TEXT("Event %u %s %s -> %s (%u)"), Event.Frame,
+			TypeIndex < UE_ARRAY_COUNT(TypeNames) ? TypeNames[TypeIndex] : TEXT("?"),
+			*GetNameSafe(Event.Subject.ResolveObjectPtr()), *GetNameSafe(Event.Other.ResolveObjectPtr()), Event.Value);
+	}
+}
+
+void UOryxEventSubsystem::RunBenchmark(int32 Count)
+{
+	if (Count <= 0) return;
+
+	//Built-in listeners would try to show or log a million events, they come back on the next Tick
+	Flush();
+	RemoveListener(ScreenHandle);
+	RemoveListener(LogHandle);
+	ScreenHandle.Reset();
+	LogHandle.Reset();
+
+	int32 NumReceived = 0;
+	int32 NumBatches = 0;
+	const FDelegateHandle Counter = AddListener(FOnOryxEvents::FDelegate::CreateLambda([&](TConstArrayView<FOryxEvent> Events)
+		{
+			NumReceived += Events.Num();
+			++NumBatches;
+		}));
+
+	const double PushStart = FPlatformTime::Seconds();
+	ParallelFor(Count, [this](int32 Index)
+		{
+			Push(this, EOryxEventType::Grab, nullptr, nullptr, static_cast<uint8>(Index));
+		});
+	const double PushSeconds = FPlatformTime::Seconds() - PushStart;
+
+	const double DispatchStart = FPlatformTime::Seconds();
+	Flush();
+	const double DispatchSeconds = FPlatformTime::Seconds() - DispatchStart;
+
+	RemoveListener(Counter);
+
+	//No listener, so these should be nearly free
+	const double IdleStart = FPlatformTime::Seconds();
+	ParallelFor(Count, [this](int32 Index)
+		{
+			Push(this, EOryxEventType::Grab, nullptr, nullptr, static_cast<uint8>(Index));
+		});
+	const double IdleSeconds = FPlatformTime::Seconds() - IdleStart;
+
+	UE_LOG(LogOryx, Log, TEXT("Events bench: %d events, push %.1f ns each (%.1f ns with no listener), dispatch %.1f ns each, %d received in %d batch(es)"),
+		Count, PushSeconds * 1e9 / Count, IdleSeconds * 1e9 / Count, DispatchSeconds * 1e9 / Count, NumReceived, NumBatches);
+}
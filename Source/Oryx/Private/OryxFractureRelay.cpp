@@ -0,0 +1,22 @@
+#include "OryxFractureRelay.h"
+#include "Oryx.h"
+#include "Engine/World.h"
+
+AOryxFractureRelay::AOryxFractureRelay()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	bReplicates = true;
+	bAlwaysRelevant = true;
+	SetReplicatingMovement(false);
+	SetNetUpdateFrequency(1.f); //Nothing to update, breaks go out as they happen
+}
+
+void AOryxFractureRelay::MulticastBreak_Implementation(const FOryxFractureBreak& Break)
+{
+	//The authority spawned its pieces when it decided
+	if (HasAuthority()) return;
+
+	if (UOryxFractureSubsystem* Fracture = GetWorld()->GetSubsystem<UOryxFractureSubsystem>())
+		Fracture->ApplyBreak(Break);
+}
@@ -0,0 +1,451 @@
+#include "OryxFractureSubsystem.h"
+#include "Oryx.h"
+#include "OryxEventSubsystem.h"
+#include "OryxFractureRelay.h"
+#include "OryxPropPool.h"
+#include "GravityGun.h"
+#include "Algo/AllOf.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StreamableManager.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Fracture bodies"), STAT_OryxFractureBodies, STATGROUP_Oryx);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Props fractured"), STAT_OryxPropsFractured, STATGROUP_Oryx);
+
+static TAutoConsoleVariable<int32> CVarOryxFracturePhysicsTier(
+	TEXT("Oryx.Fracture.PhysicsTier"),
+	2,
+	TEXT("How many fracture pieces may simulate: 2 up to MaxBodies, 1 half of it, 0 none and props stop breaking"));
+
+static FAutoConsoleCommandWithWorldAndArgs GOryxFractureSpawnCommand(
+	TEXT("Oryx.Fracture.Spawn"),
+	TEXT("Oryx.Fracture.Spawn [Count] - put Count props that have a fracture set in front of the local player"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UOryxFractureSubsystem* Fracture = World ? World->GetSubsystem<UOryxFractureSubsystem>() : nullptr)
+			Fracture->SpawnProps(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 8);
+	}));
+
+bool UOryxFractureSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UOryxFractureSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	//Clients break what the authority tells them to
+	const ENetMode NetMode = InWorld.GetNetMode();
+	if (NetMode != NM_Client)
+	{
+		if (UOryxEventSubsystem* Events = InWorld.GetSubsystem<UOryxEventSubsystem>())
+			EventsHandle = Events->AddListener(FOnOryxEvents::FDelegate::CreateUObject(this, &UOryxFractureSubsystem::OnEvents));
+	}
+	if (NetMode == NM_ListenServer || NetMode == NM_DedicatedServer)
+		Relay = InWorld.SpawnActor<AOryxFractureRelay>();
+
+	TArray<FSoftObjectPath> Paths;
+	for (const FOryxFractureSet& Set : Sets)
+	{
+		if (Set.Mesh.IsNull() || Set.Pieces.Num() == 0) continue;
+
+		Paths.Add(Set.Mesh.ToSoftObjectPath());
+		for (const TSoftObjectPtr<UStaticMesh>& Piece : Set.Pieces)
+			Paths.Add(Piece.ToSoftObjectPath());
+	}
+
+	if (Paths.Num() > 0)
+		SetsHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(Paths, FStreamableDelegate::CreateUObject(this, &UOryxFractureSubsystem::OnSetsLoaded));
+}
+
+void UOryxFractureSubsystem::Deinitialize()
+{
+	if (UOryxEventSubsystem* Events = EventsHandle.IsValid() ? GetWorld()->GetSubsystem<UOryxEventSubsystem>() : nullptr)
+		Events->RemoveListener(EventsHandle);
+	EventsHandle.Reset();
+
+	for (int32 Index = Watched.Num() - 1; Index >= 0; --Index)
+		StopWatching(Index);
+
+	if (SetsHandle.IsValid()) SetsHandle->CancelHandle();
+	SetsHandle.Reset();
+
+	Super::Deinitialize();
+}
+
+void UOryxFractureSubsystem::OnSetsLoaded()
+{
+	for (const FOryxFractureSet& Set : Sets)
+	{
+		UStaticMesh* Mesh = Set.Mesh.Get();
+		if (!Mesh) continue;
+
+		FOryxFracturePool Pool;
+		double TotalVolume = 0.0;
+		for (int32 Piece = 0; Piece < Set.Pieces.Num(); ++Piece)
+		{
+			UStaticMesh* Loaded = Set.Pieces[Piece].Get();
+			if (!Loaded) continue;
+
+			const FTransform PieceTransform = Set.PieceTransforms.IsValidIndex(Piece) ? Set.PieceTransforms[Piece] : FTransform::Identity;
+			const FVector Scale = PieceTransform.GetScale3D().GetAbs();
+			const double Volume = Loaded->GetBoundingBox().GetVolume() * Scale.X * Scale.Y * Scale.Z;
+			Pool.Pieces.Add(Loaded);
+			Pool.PieceTransforms.Add(PieceTransform);
+			Pool.MassShares.Add(static_cast<float>(Volume));
+			TotalVolume += Volume;
+		}
+
+		if (Pool.Pieces.Num() == 0)
+		{
+			UE_LOG(LogOryx, Warning, TEXT("Fracture: no pieces of %s loaded"), *Mesh->GetName());
+			continue;
+		}
+
+		for (float& Share : Pool.MassShares)
+			Share = TotalVolume > 0.0 ? static_cast<float>(Share / TotalVolume) : 1.f / Pool.Pieces.Num();
+		Pool.Folded.Init(nullptr, Pool.Pieces.Num());
+		Pool.NextFolded.Init(0, Pool.Pieces.Num());
+		Pools.Add(Mesh, MoveTemp(Pool));
+	}
+
+	if (Pools.Num() > 0 && !Rubble)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		Rubble = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+
+		USceneComponent* Root = NewObject<USceneComponent>(Rubble, TEXT("Root"));
+		Root->SetMobility(EComponentMobility::Movable);
+		Rubble->SetRootComponent(Root);
+		Root->RegisterComponent();
+	}
+
+	UE_LOG(LogOryx, Log, TEXT("Fracture: %d of %d sets ready"), Pools.Num(), Sets.Num());
+}
+
+void UOryxFractureSubsystem::OnEvents(TConstArrayView<FOryxEvent> Events)
+{
+	const double Until = GetWorld()->GetTimeSeconds() + WatchSeconds;
+
+	for (const FOryxEvent& Event : Events)
+	{
+		if (Event.Type != EOryxEventType::Fire) continue;
+
+		//Pieces that are fired again stay pieces, they belong to their break
+		UStaticMeshComponent* Prop = Cast<UStaticMeshComponent>(Event.Other.ResolveObjectPtr());
+		if (!Prop || !Prop->IsSimulatingPhysics() || IsRubble(Prop->GetOwner()) || !Pools.Contains(Prop->GetStaticMesh())) continue;
+
+		if (FWatchedProp* Existing = Watched.FindByPredicate([Prop](const FWatchedProp& Entry) { return Entry.Prop.Get() == Prop; }))
+		{
+			Existing->Until = Until;
+			continue;
+		}
+
+		FWatchedProp& Entry = Watched.AddDefaulted_GetRef();
+		Entry.Prop = Prop;
+		Entry.Until = Until;
+		Entry.Velocity = Prop->GetPhysicsLinearVelocity();
+		Entry.bNotifiedHits = Prop->BodyInstance.bNotifyRigidBodyCollision;
+
+		Prop->SetNotifyRigidBodyCollision(true);
+		Prop->OnComponentHit.AddUniqueDynamic(this, &UOryxFractureSubsystem::OnPropHit);
+	}
+}
+
+void UOryxFractureSubsystem::StopWatching(int32 Index)
+{
+	const FWatchedProp& Entry = Watched[Index];
+	if (UStaticMeshComponent* Prop = Entry.Prop.Get())
+	{
+		Prop->OnComponentHit.RemoveDynamic(this, &UOryxFractureSubsystem::OnPropHit);
+		Prop->SetNotifyRigidBodyCollision(Entry.bNotifiedHits);
+	}
+	Watched.RemoveAtSwap(Index);
+}
+
+void UOryxFractureSubsystem::OnPropHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
+{
+	const int32 Index = Watched.IndexOfByPredicate([HitComponent](const FWatchedProp& Entry) { return Entry.Prop.Get() == HitComponent; });
+	if (Index == INDEX_NONE) return;
+
+	//The body has already bounced by now, the velocity kept by the last tick is the one it hit with
+	const FVector Velocity = Watched[Index].Velocity;
+	if (Velocity.SizeSquared() < FMath::Square(FractureSpeed)) return;
+
+	PendingBreaks.Emplace(Watched[Index].Prop, Velocity);
+	StopWatching(Index);
+}
+
+int32 UOryxFractureSubsystem::GetBodyBudget() const
+{
+	const int32 Tier = FMath::Clamp(CVarOryxFracturePhysicsTier.GetValueOnGameThread(), 0, 2);
+	return MaxBodies * Tier / 2;
+}
+
+void UOryxFractureSubsystem::Tick(float DeltaTime)
+{
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	for (const TPair<TWeakObjectPtr<UStaticMeshComponent>, FVector>& Pending : PendingBreaks)
+	{
+		if (UStaticMeshComponent* Prop = Pending.Key.Get()) Fracture(Prop, Pending.Value);
+	}
+	PendingBreaks.Reset();
+
+	for (int32 Index = Watched.Num() - 1; Index >= 0; --Index)
+	{
+		UStaticMeshComponent* Prop = Watched[Index].Prop.Get();
+		if (!Prop || Now > Watched[Index].Until || !Prop->IsSimulatingPhysics())
+		{
+			StopWatching(Index);
+			continue;
+		}
+		Watched[Index].Velocity = Prop->GetPhysicsLinearVelocity();
+	}
+
+	//Folded last tick, their instances have been drawn since
+	for (TPair<UStaticMesh*, FOryxFracturePool>& Pair : Pools)
+	{
+		for (UStaticMeshComponent* Body : Pair.Value.Folding)
+		{
+			Body->SetVisibility(false);
+			Pair.Value.Free.Add(Body);
+		}
+		Pair.Value.Folding.Reset();
+	}
+
+	//A lowered tier takes effect at once
+	const int32 Budget = GetBodyBudget();
+	while (NumBodies > Budget && Breaks.Num() > 0)
+		Fold(0);
+
+	TArray<const UPrimitiveComponent*, TInlineAllocator<4>> HeldComponents;
+	for (TActorIterator<AGravityGun> It(GetWorld()); It; ++It)
+	{
+		if (const UPrimitiveComponent* Held = It->GetHeldComponent()) HeldComponents.Add(Held);
+	}
+
+	const float RestSpeedSquared = FMath::Square(RestSpeed);
+	for (int32 Index = Breaks.Num() - 1; Index >= 0; --Index)
+	{
+		FBreak& Break = Breaks[Index];
+		const bool bStill = Algo::AllOf(Break.Bodies, [&HeldComponents, RestSpeedSquared](const UStaticMeshComponent* Body)
+			{
+				return !HeldComponents.Contains(Body) &&
+					(!Body->RigidBodyIsAwake() || Body->GetPhysicsLinearVelocity().SizeSquared() <= RestSpeedSquared);
+			});
+
+		if (!bStill)
+			Break.StillSince = 0.0;
+		else if (Break.StillSince == 0.0)
+			Break.StillSince = Now;
+		else if (Now - Break.StillSince >= RestSeconds)
+			Fold(Index);
+	}
+
+	SET_DWORD_STAT(STAT_OryxFractureBodies, NumBodies);
+}
+
+bool UOryxFractureSubsystem::Fracture(UStaticMeshComponent* Prop, const FVector& Velocity)
+{
+	AActor* Owner = Prop ? Prop->GetOwner() : nullptr;
+	if (!Owner || !Owner->HasAuthority()) return false;
+
+	UStaticMesh* Mesh = Prop->GetStaticMesh();
+	const FOryxFracturePool* Pool = Pools.Find(Mesh);
+	if (!Pool || Pool->Pieces.Num() > FMath::Min(MaxBodiesPerSet, GetBodyBudget())) return false;
+
+	FOryxFractureBreak Break;
+	Break.Prop = Prop;
+	Break.Mesh = Mesh;
+	Break.Transform = Prop->GetComponentTransform();
+	Break.Velocity = Velocity;
+	Break.AngularVelocity = Prop->GetPhysicsAngularVelocityInRadians();
+	Break.Mass = Prop->GetMass();
+	Break.bGravity = Prop->IsGravityEnabled();
+
+	//Nobody sees the pieces of a dedicated server
+	if (GetWorld()->GetNetMode() != NM_DedicatedServer) SpawnPieces(Break);
+	if (Relay) Relay->MulticastBreak(Break);
+
+	INC_DWORD_STAT(STAT_OryxPropsFractured);
+	UOryxEventSubsystem::Push(this, EOryxEventType::Fracture, Owner, Prop, static_cast<uint8>(FMath::Min(Pool->Pieces.Num(), 255)));
+
+	UOryxPropPool::Retire(Prop);
+	return true;
+}
+
+void UOryxFractureSubsystem::ApplyBreak(const FOryxFractureBreak& Break)
+{
+	SpawnPieces(Break);
+
+	//Hidden until the retirement replicates
+	UStaticMeshComponent* Prop = Break.Prop;
+	AActor* Owner = Prop ? Prop->GetOwner() : nullptr;
+	if (!Owner) return;
+
+	if (Owner->GetRootComponent() == Prop)
+		Owner->SetActorHiddenInGame(true);
+	else
+		Prop->SetVisibility(false);
+
+	const FOryxFracturePool* Pool = Pools.Find(Break.Mesh);
+	UOryxEventSubsystem::Push(this, EOryxEventType::Fracture, Owner, Prop, static_cast<uint8>(FMath::Min(Pool ? Pool->Pieces.Num() : 0, 255)));
+}
+
+bool UOryxFractureSubsystem::SpawnPieces(const FOryxFractureBreak& Break)
+{
+	UStaticMesh* Mesh = Break.Mesh;
+	FOryxFracturePool* Pool = Pools.Find(Mesh);
+	const int32 Budget = GetBodyBudget();
+	if (!Pool || !Rubble || Pool->Pieces.Num() > FMath::Min(MaxBodiesPerSet, Budget)) return false;
+
+	const int32 NumPieces = Pool->Pieces.Num();
+
+	//Oldest breaks fold early, so the budget holds however much gets broken at once
+	while (NumBodies + NumPieces > Budget || Pool->NumActive + NumPieces > MaxBodiesPerSet)
+	{
+		const bool bSetFull = Pool->NumActive + NumPieces > MaxBodiesPerSet;
+		const int32 Oldest = bSetFull ? Breaks.IndexOfByPredicate([Mesh](const FBreak& Existing) { return Existing.Mesh == Mesh; }) : 0;
+		if (!Breaks.IsValidIndex(Oldest)) return false;
+		Fold(Oldest);
+	}
+
+	const FVector Center = Break.Transform.TransformPosition(Mesh->GetBounds().Origin);
+	const FVector AngularVelocity = Break.AngularVelocity;
+
+	FBreak& Added = Breaks.AddDefaulted_GetRef();
+	Added.Mesh = Mesh;
+
+	for (int32 Piece = 0; Piece < NumPieces; ++Piece)
+	{
+		//Pieces keep the collection's pivot, so the prop's transform puts each one where it was in the prop
+		UStaticMeshComponent* Body = AcquireBody(*Pool);
+		Body->SetStaticMesh(Pool->Pieces[Piece]);
+		Body->SetWorldTransform(Pool->PieceTransforms[Piece] * Break.Transform, false, nullptr, ETeleportType::TeleportPhysics);
+		Body->SetVisibility(true);
+		Body->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+		Body->SetEnableGravity(Break.bGravity);
+		Body->SetMassOverrideInKg(NAME_None, FMath::Max(Break.Mass * Pool->MassShares[Piece], 0.1f), true);
+		Body->SetSimulatePhysics(true);
+
+		//Moving as that part of the prop was, pushed outwards so the pieces come apart
+		const FVector Offset = Body->Bounds.Origin - Center;
+		Body->SetPhysicsLinearVelocity(Break.Velocity + FVector::CrossProduct(AngularVelocity, Offset) + Offset.GetSafeNormal() * SpreadSpeed);
+		Body->SetPhysicsAngularVelocityInRadians(AngularVelocity);
+
+		Added.Bodies.Add(Body);
+	}
+
+	Pool->NumActive += NumPieces;
+	NumBodies += NumPieces;
+	return true;
+}
+
+void UOryxFractureSubsystem::SpawnProps(int32 Count)
+{
+	UWorld* World = GetWorld();
+	UOryxPropPool* PropPool = World->GetSubsystem<UOryxPropPool>();
+	const APlayerController* Player = World->GetFirstPlayerController();
+	if (!PropPool || !Player || World->GetNetMode() == NM_Client || Pools.Num() == 0 || Count <= 0) return;
+
+	TArray<UStaticMesh*> Meshes;
+	Pools.GetKeys(Meshes);
+
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	Player->GetPlayerViewPoint(ViewLocation, ViewRotation);
+	const FVector Forward = ViewRotation.Vector();
+	const FVector Right = FRotationMatrix(ViewRotation).GetUnitAxis(EAxis::Y);
+
+	//A row across the view, far enough apart not to spawn inside each other
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		UStaticMesh* Mesh = Meshes[Index % Meshes.Num()];
+		const float Spacing = Mesh->GetBounds().SphereRadius * 2.5f;
+		const FVector Location = ViewLocation + Forward * 600.f + Right * ((Index - (Count - 1) * 0.5f) * Spacing);
+		PropPool->Acquire(Mesh, FTransform(Location));
+	}
+}
+
+UStaticMeshComponent* UOryxFractureSubsystem::AcquireBody(FOryxFracturePool& Pool)
+{
+	if (Pool.Free.Num() > 0) return Pool.Free.Pop(EAllowShrinking::No);
+
+	//Its instance is already added, at worst the piece is missing for a frame
+	if (Pool.Folding.Num() > 0) return Pool.Folding.Pop(EAllowShrinking::No);
+
+	//Left unattached, a simulating body moves on its own
+	UStaticMeshComponent* Body = NewObject<UStaticMeshComponent>(Rubble);
+	Body->SetMobility(EComponentMobility::Movable);
+	Body->SetCollisionProfileName(TEXT("OryxProp"));
+	Body->SetCanEverAffectNavigation(false);
+	Body->RegisterComponent();
+	return Body;
+}
+
+void UOryxFractureSubsystem::Fold(int32 Index)
+{
+	const FBreak& Break = Breaks[Index];
+	FOryxFracturePool& Pool = Pools.FindChecked(Break.Mesh);
+
+	for (int32 Piece = 0; Piece < Break.Bodies.Num(); ++Piece)
+	{
+		UStaticMeshComponent* Body = Break.Bodies[Piece];
+
+		//Folding early for the budget can catch a piece in a gravity gun
+		for (TActorIterator<AGravityGun> It(GetWorld()); It; ++It)
+		{
+			if (It->GetHeldComponent() == Body) It->SetHeldComponent(nullptr);
+		}
+
+		AddFolded(Pool, Piece, Body->GetComponentTransform());
+		Body->SetSimulatePhysics(false);
+		Body->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		Pool.Folding.Add(Body);
+	}
+
+	Pool.NumActive -= Break.Bodies.Num();
+	NumBodies -= Break.Bodies.Num();
+	Breaks.RemoveAt(Index);
+}
+
+void UOryxFractureSubsystem::AddFolded(FOryxFracturePool& Pool, int32 Piece, const FTransform& Transform)
+{
+	UInstancedStaticMeshComponent*& Instances = Pool.Folded[Piece];
+	if (!Instances)
+	{
+		Instances = NewObject<UInstancedStaticMeshComponent>(Rubble);
+		Instances->SetMobility(EComponentMobility::Movable);
+		Instances->SetStaticMesh(Pool.Pieces[Piece]);
+		Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		Instances->SetCanEverAffectNavigation(false);
+		Instances->SetupAttachment(Rubble->GetRootComponent());
+		Instances->RegisterComponent();
+	}
+
+	const int32 MaxInstances = FMath::Max(MaxFoldedPerPiece, 1);
+	if (Instances->GetInstanceCount() < MaxInstances)
+	{
+		Instances->AddInstance(Transform, true);
+	}
+	else
+	{
+		Instances->UpdateInstanceTransform(Pool.NextFolded[Piece], Transform, true, true);
+		Pool.NextFolded[Piece] = (Pool.NextFolded[Piece] + 1) % MaxInstances;
+	}
+}
+
+TStatId UOryxFractureSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UOryxFractureSubsystem, STATGROUP_Tickables);
+}
@@ -0,0 +1,186 @@
+#include "OryxFrameGovernor.h"
+#include "Oryx.h"
+#include "Engine/World.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "PBDRigidsSolver.h"
+#include "Misc/App.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Governor level"), STAT_OryxGovernorLevel, STATGROUP_Oryx);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Governor game thread (ms)"), STAT_OryxGovernorGameMs, STATGROUP_Oryx);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Governor physics (ms)"), STAT_OryxGovernorPhysicsMs, STATGROUP_Oryx);
+
+static TAutoConsoleVariable<bool> CVarOryxGovernorEnable(
+	TEXT("Oryx.Governor.Enable"),
+	true,
+	TEXT("Let the frame governor lower gameplay detail when frames run over budget, turning it off restores everything"));
+
+static TAutoConsoleVariable<float> CVarOryxGovernorSyntheticGameMs(
+	TEXT("Oryx.Governor.SyntheticGameMs"),
+	0.f,
+	TEXT("Busy-waits this long at the start of every world tick, to test the governor without real load"));
+
+static TAutoConsoleVariable<float> CVarOryxGovernorSyntheticPhysicsMs(
+	TEXT("Oryx.Governor.SyntheticPhysicsMs"),
+	0.f,
+	TEXT("Added to the physics time the governor measures, to test the governor without real load"));
+
+bool UOryxFrameGovernor::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UOryxFrameGovernor::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UOryxFrameGovernor, STATGROUP_Tickables);
+}
+
+void UOryxFrameGovernor::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	MaxLevel = 0;
+	DefaultValues.Reset();
+	for (const FOryxGovernorStep& Step : Steps)
+	{
+		IConsoleVariable* Variable = IConsoleManager::Get().FindConsoleVariable(*Step.CVar);
+		if (!Variable)
+		{
+			UE_LOG(LogOryx, Warning, TEXT("Governor: no console variable %s"), *Step.CVar);
+			continue;
+		}
+
+		MaxLevel = FMath::Max(MaxLevel, Step.Level);
+		if (!DefaultValues.Contains(Step.CVar)) DefaultValues.Add(Step.CVar, Variable->GetString());
+	}
+
+	TickStartHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &UOryxFrameGovernor::OnWorldTickStart);
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UOryxFrameGovernor::OnWorldPostActorTick);
+
+	//Timed inside the solver's own advance, so game thread work in the physics tick groups isn't counted. The
+	//callbacks run on the physics thread, they only touch the shared timing and never this object
+	Chaos::FPhysicsSolver* Solver = InWorld.GetPhysicsScene() ? InWorld.GetPhysicsScene()->GetSolver() : nullptr;
+	if (Solver)
+	{
+		PhysicsTiming = MakeShared<FOryxPhysicsTiming, ESPMode::ThreadSafe>();
+		TSharedRef<FOryxPhysicsTiming, ESPMode::ThreadSafe> Timing = PhysicsTiming.ToSharedRef();
+		SolverPreAdvanceHandle = Solver->AddPreAdvanceCallback(Chaos::FSolverPreAdvance::FDelegate::CreateLambda([Timing](Chaos::FReal Dt)
+		{
+			Timing->StepStartCycles.store(FPlatformTime::Cycles64(), std::memory_order_relaxed);
+		}));
+		SolverPostAdvanceHandle = Solver->AddPostAdvanceCallback(Chaos::FSolverPostAdvance::FDelegate::CreateLambda([Timing](Chaos::FReal Dt)
+		{
+			const uint64 Start = Timing->StepStartCycles.load(std::memory_order_relaxed);
+			if (Start != 0) Timing->AccumulatedCycles.fetch_add(FPlatformTime::Cycles64() - Start, std::memory_order_relaxed);
+		}));
+	}
+}
+
+void UOryxFrameGovernor::Deinitialize()
+{
+	FWorldDelegates::OnWorldTickStart.Remove(TickStartHandle);
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	FPhysScene* Scene = GetWorld() ? GetWorld()->GetPhysicsScene() : nullptr;
+	if (Chaos::FPhysicsSolver* Solver = Scene ? Scene->GetSolver() : nullptr)
+	{
+		Solver->RemovePreAdvanceCallback(SolverPreAdvanceHandle);
+		Solver->RemovePostAdvanceCallback(SolverPostAdvanceHandle);
+	}
+	PhysicsTiming.Reset();
+
+	//Console variables outlive the world, the next map starts at full detail
+	if (Level != 0) SetLevel(0, TEXT("world ended"));
+
+	Super::Deinitialize();
+}
+
+void UOryxFrameGovernor::OnWorldTickStart(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (InWorld != GetWorld()) return;
+	TickStartTime = FPlatformTime::Seconds();
+
+	const float SyntheticMs = CVarOryxGovernorSyntheticGameMs.GetValueOnGameThread();
+	if (SyntheticMs > 0.f)
+	{
+		const double SpinUntil = TickStartTime + SyntheticMs / 1000.0;
+		while (FPlatformTime::Seconds() < SpinUntil) {}
+	}
+}
+
+void UOryxFrameGovernor::OnWorldPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (InWorld != GetWorld() || TickStartTime <= 0.0) return;
+	GameMs = (FPlatformTime::Seconds() - TickStartTime) * 1000.0;
+}
+
+void UOryxFrameGovernor::Tick(float DeltaTime)
+{
+	if (MaxLevel == 0) return;
+
+	if (!CVarOryxGovernorEnable.GetValueOnGameThread())
+	{
+		if (Level != 0) SetLevel(0, TEXT("governor disabled"));
+		OverSeconds = UnderSeconds = 0.f;
+		return;
+	}
+
+	//Solver steps finished since last frame, substeps and fixed async steps add up
+	if (PhysicsTiming)
+		PhysicsMs = FPlatformTime::ToMilliseconds64(PhysicsTiming->AccumulatedCycles.exchange(0, std::memory_order_relaxed));
+
+	const float RealDelta = FMath::Max(FApp::GetDeltaTime(), UE_KINDA_SMALL_NUMBER);
+	const float Alpha = 1.f - FMath::Exp(-RealDelta / FMath::Max(SmoothingSeconds, UE_KINDA_SMALL_NUMBER));
+	SmoothedGameMs = FMath::Lerp(SmoothedGameMs, GameMs, Alpha);
+	SmoothedPhysicsMs = FMath::Lerp(SmoothedPhysicsMs, PhysicsMs + CVarOryxGovernorSyntheticPhysicsMs.GetValueOnGameThread(), Alpha);
+
+	SET_DWORD_STAT(STAT_OryxGovernorLevel, Level);
+	SET_FLOAT_STAT(STAT_OryxGovernorGameMs, SmoothedGameMs);
+	SET_FLOAT_STAT(STAT_OryxGovernorPhysicsMs, SmoothedPhysicsMs);
+
+	const bool bOver = SmoothedGameMs > TargetFrameMs * (1.f + DegradeMargin) || SmoothedPhysicsMs > PhysicsBudgetMs * (1.f + DegradeMargin);
+	const bool bUnder = SmoothedGameMs < TargetFrameMs * (1.f - RestoreMargin) && SmoothedPhysicsMs < PhysicsBudgetMs * (1.f - RestoreMargin);
+
+	//Between the two thresholds neither timer runs, that band is the hysteresis
+	OverSeconds = bOver ? OverSeconds + RealDelta : 0.f;
+	UnderSeconds = bUnder ? UnderSeconds + RealDelta : 0.f;
+
+	if (OverSeconds >= DegradeSeconds && Level < MaxLevel)
+	{
+		SetLevel(Level + 1, TEXT("over budget"));
+		OverSeconds = 0.f;
+	}
+	else if (UnderSeconds >= RestoreSeconds && Level > 0)
+	{
+		SetLevel(Level - 1, TEXT("under budget"));
+		UnderSeconds = 0.f;
+	}
+}
+
+void UOryxFrameGovernor::SetLevel(int32 NewLevel, const TCHAR* Reason)
+{
+	NewLevel = FMath::Clamp(NewLevel, 0, MaxLevel);
+	if (NewLevel == Level) return;
+
+	UE_LOG(LogOryx, Log, TEXT("Governor: level %d -> %d, %s (game %.2f / %.2f ms, physics %.2f / %.2f ms)"),
+		Level, NewLevel, Reason, SmoothedGameMs, TargetFrameMs, SmoothedPhysicsMs, PhysicsBudgetMs);
+	Level = NewLevel;
+
+	for (const TPair<FString, FString>& Default : DefaultValues)
+	{
+		//The highest step at or below the level wins, no step means the begin play value
+		const FOryxGovernorStep* Chosen = nullptr;
+		for (const FOryxGovernorStep& Step : Steps)
+		{
+			if (Step.CVar == Default.Key && Step.Level <= Level && (!Chosen || Step.Level >= Chosen->Level)) Chosen = &Step;
+		}
+
+		IConsoleVariable* Variable = IConsoleManager::Get().FindConsoleVariable(*Default.Key);
+		const FString Value = Chosen ? FString::SanitizeFloat(Chosen->Value) : Default.Value;
+		const FString Current = Variable->GetString();
+		if (Variable->GetFloat() == FCString::Atof(*Value)) continue;
+
+		//Set by code, so a value typed into the console still overrides the governor
+		Variable->Set(*Value, ECVF_SetByCode);
+		UE_LOG(LogOryx, Log, TEXT("Governor:   %s %s -> %s"), *Default.Key, *Current, *Variable->GetString());
+	}
+}
@@ -0,0 +1,33 @@
+#include "OryxInputAction.h"
+#include "SpaceshipPawn.h"
+#include "PlayerPawnController.h"
+#include "OryxInputRecorder.h"
+#include "Engine/World.h"
+
+void OryxInput::Dispatch(APawn* Pawn, EOryxInputAction Action, const FInputActionValue& Value)
+{
+	if (ASpaceshipPawn* Ship = Cast<ASpaceshipPawn>(Pawn))
+	{
+		Ship->DispatchInput(Action, Value);
+	}
+	else if (APlayerPawnController* OnFoot = Cast<APlayerPawnController>(Pawn))
+	{
+		OnFoot->DispatchInput(Action, Value);
+	}
+}
+
+void OryxInput::Record(const APawn* Source, EOryxInputAction Action, const FInputActionValue& Value)
+{
+	UWorld* World = Source ? Source->GetWorld() : nullptr;
+	if (UOryxInputRecorder* Recorder = World ? World->GetSubsystem<UOryxInputRecorder>() : nullptr)
+	{
+		Recorder->RecordInput(Source, Action, Value);
+	}
+}
+
+bool OryxInput::IsPlayingBack(const AActor* Source)
+{
+	UWorld* World = Source ? Source->GetWorld() : nullptr;
+	UOryxInputRecorder* Recorder = World ? World->GetSubsystem<UOryxInputRecorder>() : nullptr;
+	return Recorder && Recorder->IsPlaying();
+}
@@ -0,0 +1,400 @@
+#include "OryxInputRecorder.h"
+#include "Oryx.h"
+#include "SpaceshipPawn.h"
+#include "PlayerPawnController.h"
+#include "EngineUtils.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "HAL/IConsoleManager.h"
+
+static constexpr uint32 RecordingMagic = 0x4958524F; //"ORXI"
+static constexpr uint32 RecordingVersion = 1;
+
+//Value tag written before each payload, bools carry their state in the tag so presses have no payload
+enum class EOryxRecordedValue : uint8
+{
+	False,
+	True,
+	Axis1D,
+	Axis2D,
+	Axis3D
+};
+
+static FAutoConsoleCommandWithWorldAndArgs GOryxInputRecordCommand(
+	TEXT("Oryx.Input.Record"),
+	TEXT("Oryx.Input.Record <Name> - record the local player's inputs to Saved/InputRecordings"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UOryxInputRecorder* Recorder = World ? World->GetSubsystem<UOryxInputRecorder>() : nullptr)
+			Recorder->StartRecording(Args.Num() > 0 ? Args[0] : TEXT("Latest"));
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs GOryxInputPlayCommand(
+	TEXT("Oryx.Input.Play"),
+	TEXT("Oryx.Input.Play <Name> - replay a recording with fixed steps and compare state checksums"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UOryxInputRecorder* Recorder = World ? World->GetSubsystem<UOryxInputRecorder>() : nullptr)
+			Recorder->StartPlayback(Args.Num() > 0 ? Args[0] : TEXT("Latest"));
+	}));
+
+static FAutoConsoleCommandWithWorld GOryxInputStopCommand(
+	TEXT("Oryx.Input.Stop"),
+	TEXT("Stop recording (and save) or stop playback"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UOryxInputRecorder* Recorder = World ? World->GetSubsystem<UOryxInputRecorder>() : nullptr)
+			Recorder->Stop();
+	}));
+
+bool UOryxInputRecorder::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UOryxInputRecorder::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	//Starting from the command line keeps both runs aligned to the first frame of the map
+	FString Name;
+	if (FParse::Value(FCommandLine::Get(), TEXT("OryxReplay="), Name))
+	{
+		bExitWhenDone = FParse::Param(FCommandLine::Get(), TEXT("OryxReplayExit"));
+		StartPlayback(Name);
+	}
+	else if (FParse::Value(FCommandLine::Get(), TEXT("OryxRecord="), Name))
+	{
+		StartRecording(Name);
+	}
+}
+
+void UOryxInputRecorder::Deinitialize()
+{
+	Stop();
+	Super::Deinitialize();
+}
+
+FString UOryxInputRecorder::GetRecordingPath(const FString& Name)
+{
+	FString Path = FPaths::IsRelative(Name) ? FPaths::ProjectSavedDir() / TEXT("InputRecordings") / Name : Name;
+	if (FPaths::GetExtension(Path).IsEmpty()) Path += TEXT(".oryxinput");
+	return Path;
+}
+
+APawn* UOryxInputRecorder::GetPlayerPawn() const
+{
+	return UGameplayStatics::GetPlayerPawn(GetWorld(), 0);
+}
+
+void UOryxInputRecorder::StartRecording(const FString& Name)
+{
+	Stop();
+
+	Inputs.Reset();
+	Checksums.Reset();
+	CurrentFrame = 0;
+	ActiveName = Name;
+	bRecording = true;
+
+	//Recording runs fixed-step as well, otherwise frame numbers would not line up on playback
+	EnableFixedStep();
+	UE_LOG(LogOryx, Display, TEXT("Input recording started: %s"), *GetRecordingPath(Name));
+}
+
+void UOryxInputRecorder::StartPlayback(const FString& Name)
+{
+	Stop();
+
+	const FString Path = GetRecordingPath(Name);
+	if (!LoadRecording(Path))
+	{
+		UE_LOG(LogOryx, Error, TEXT("Input recording '%s' could not be loaded"), *Path);
+		return;
+	}
+
+	PlaybackChecksums.Reset();
+	PlaybackChecksums.Reserve(Checksums.Num());
+	CurrentFrame = 0;
+	NextInput = 0;
+	FirstDivergentFrame = INDEX_NONE;
+	ActiveName = Name;
+	bPlaying = true;
+
+	EnableFixedStep();
+	UE_LOG(LogOryx, Display, TEXT("Input playback started: %s (%d inputs, %d frames)"), *Path, Inputs.Num(), Checksums.Num());
+
+	//Frame 0 inputs arrived before the first recorded frame simulated
+	APawn* Pawn = GetPlayerPawn();
+	while (NextInput < Inputs.Num() && Inputs[NextInput].Frame == 0)
+	{
+		OryxInput::Dispatch(Pawn, Inputs[NextInput].Action, Inputs[NextInput].Value);
+		++NextInput;
+	}
+	BlockLiveInput();
+}
+
+void UOryxInputRecorder::Stop()
+{
+	if (bRecording)
+	{
+		bRecording = false;
+		const FString Path = GetRecordingPath(ActiveName);
+		if (SaveRecording(Path))
+			UE_LOG(LogOryx, Display, TEXT("Input recording saved: %s (%d inputs, %d frames)"), *Path, Inputs.Num(), Checksums.Num());
+		RestoreTimeStep();
+	}
+	else if (bPlaying)
+	{
+		FinishPlayback();
+	}
+}
+
+void UOryxInputRecorder::RecordInput(const APawn* Source, EOryxInputAction Action, const FInputActionValue& Value)
+{
+	if (!bRecording || !Source || Source != GetPlayerPawn()) return;
+
+	FOryxRecordedInput& Input = Inputs.AddDefaulted_GetRef();
+	Input.Frame = CurrentFrame;
+	Input.Action = Action;
+	Input.Value = Value;
+}
+
+void UOryxInputRecorder::Tick(float DeltaTime)
+{
+	if (bRecording)
+	{
+		Checksums.Add(ComputeStateChecksum());
+		++CurrentFrame;
+	}
+	else if (bPlaying)
+	{
+		const uint32 Checksum = ComputeStateChecksum();
+		PlaybackChecksums.Add(Checksum);
+
+		if (FirstDivergentFrame == INDEX_NONE && Checksums.IsValidIndex(CurrentFrame) && Checksums[CurrentFrame] != Checksum)
+		{
+			FirstDivergentFrame = CurrentFrame;
+			UE_LOG(LogOryx, Warning, TEXT("Input playback diverged at frame %u (recorded %08x, replayed %08x)"),
+				CurrentFrame, Checksums[CurrentFrame], Checksum);
+		}
+
+		++CurrentFrame;
+		if (CurrentFrame >= static_cast<uint32>(Checksums.Num()))
+		{
+			FinishPlayback();
+			return;
+		}
+
+		//Feed the inputs for the frame about to be simulated
+		APawn* Pawn = GetPlayerPawn();
+		while (NextInput < Inputs.Num() && Inputs[NextInput].Frame <= CurrentFrame)
+		{
+			OryxInput::Dispatch(Pawn, Inputs[NextInput].Action, Inputs[NextInput].Value);
+			++NextInput;
+		}
+
+		//Boarding or exiting during playback possesses a pawn whose bindings are still live
+		BlockLiveInput();
+	}
+}
+
+TStatId UOryxInputRecorder::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UOryxInputRecorder, STATGROUP_Tickables);
+}
+
+uint32 UOryxInputRecorder::ComputeStateChecksum() const
+{
+	//Quantize to 1mm / 0.01 deg so float noise below that doesn't count as divergence
+	TArray<int32, TInlineAllocator<64>> State;
+	auto AddVector = [&State](const FVector& V, double Scale)
+		{
+			State.Add(FMath::RoundToInt32(V.X * Scale));
+			State.Add(FMath::RoundToInt32(V.Y * Scale));
+			State.Add(FMath::RoundToInt32(V.Z * Scale));
+		};
+	auto AddPawn = [&](const APawn* Pawn)
+		{
+			AddVector(Pawn->GetActorLocation(), 10.0);
+			AddVector(Pawn->GetActorRotation().Euler(), 100.0);
+			AddVector(Pawn->GetVelocity(), 10.0);
+		};
+
+	for (TActorIterator<ASpaceshipPawn> It(GetWorld()); It; ++It)
+	{
+		AddPawn(*It);
+		State.Add(static_cast<int32>(It->GetLandingStage()));
+	}
+	for (TActorIterator<APlayerPawnController> It(GetWorld()); It; ++It)
+	{
+		AddPawn(*It);
+	}
+
+	return FCrc::MemCrc32(State.GetData(), State.Num() * sizeof(int32));
+}
+
+void UOryxInputRecorder::EnableFixedStep()
+{
+	bPrevUseFixedTimeStep = FApp::UseFixedTimeStep();
+	PrevFixedDeltaTime = FApp::GetFixedDeltaTime();
+
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(FixedDeltaTime);
+}
+
+void UOryxInputRecorder::RestoreTimeStep()
+{
+	FApp::SetUseFixedTimeStep(bPrevUseFixedTimeStep);
+	FApp::SetFixedDeltaTime(PrevFixedDeltaTime);
+}
+
+bool UOryxInputRecorder::SaveRecording(const FString& Path) const
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Ar(Bytes);
+
+	uint32 Magic = RecordingMagic;
+	uint32 Version = RecordingVersion;
+	float StepTime = FixedDeltaTime;
+	int32 NumInputs = Inputs.Num();
+	Ar << Magic << Version << StepTime << NumInputs;
+
+	//Frames are delta coded and packed, most inputs cost 2-3 bytes plus their axis payload
+	uint32 PrevFrame = 0;
+	for (const FOryxRecordedInput& Input : Inputs)
+	{
+		uint32 FrameDelta = Input.Frame - PrevFrame;
+		PrevFrame = Input.Frame;
+		Ar.SerializeIntPacked(FrameDelta);
+
+		uint8 Action = static_cast<uint8>(Input.Action);
+		Ar << Action;
+
+		EOryxRecordedValue Tag;
+		switch (Input.Value.GetValueType())
+		{
+		case EInputActionValueType::Boolean: Tag = Input.Value.Get<bool>() ? EOryxRecordedValue::True : EOryxRecordedValue::False; break;
+		case EInputActionValueType::Axis1D: Tag = EOryxRecordedValue::Axis1D; break;
+		case EInputActionValueType::Axis2D: Tag = EOryxRecordedValue::Axis2D; break;
+		default: Tag = EOryxRecordedValue::Axis3D; break;
+		}
+		Ar << Tag;
+
+		FVector3f Axis(Input.Value.Get<FVector>());
+		const int32 NumComponents = Tag == EOryxRecordedValue::Axis3D ? 3 : Tag == EOryxRecordedValue::Axis2D ? 2 : Tag == EOryxRecordedValue::Axis1D ? 1 : 0;
+		for (int32 Component = 0; Component < NumComponents; ++Component)
+			Ar << Axis[Component];
+	}
+
+	TArray<uint32> FrameChecksums = Checksums;
+	Ar << FrameChecksums;
+
+	return FFileHelper::SaveArrayToFile(Bytes, *Path);
+}
+
+bool UOryxInputRecorder::LoadRecording(const FString& Path)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Path)) return false;
+
+	FMemoryReader Ar(Bytes);
+
+	uint32 Magic = 0, Version = 0;
+	int32 NumInputs = 0;
+	Ar << Magic << Version;
+	if (Magic != RecordingMagic || Version != RecordingVersion) return false;
+
+	Ar << FixedDeltaTime << NumInputs;
+	if (NumInputs < 0 || Ar.IsError()) return false;
+
+	Inputs.Reset(NumInputs);
+	uint32 Frame = 0;
+	for (int32 Index = 0; Index < NumInputs && !Ar.IsError(); ++Index)
+	{
+		uint32 FrameDelta = 0;
+		Ar.SerializeIntPacked(FrameDelta);
+		Frame += FrameDelta;
+
+		uint8 Action = 0;
+		EOryxRecordedValue Tag = EOryxRecordedValue::False;
+		Ar << Action << Tag;
+
+		FVector3f Axis = FVector3f::ZeroVector;
+		const int32 NumComponents = Tag == EOryxRecordedValue::Axis3D ? 3 : Tag == EOryxRecordedValue::Axis2D ? 2 : Tag == EOryxRecordedValue::Axis1D ? 1 : 0;
+		for (int32 Component = 0; Component < NumComponents; ++Component)
+			Ar << Axis[Component];
+
+		FOryxRecordedInput& Input = Inputs.AddDefaulted_GetRef();
+		Input.Frame = Frame;
+		Input.Action = static_cast<EOryxInputAction>(Action);
+		switch (Tag)
+		{
+		case EOryxRecordedValue::False: Input.Value = FInputActionValue(false); break;
+		case EOryxRecordedValue::True: Input.Value = FInputActionValue(true); break;
+		case EOryxRecordedValue::Axis1D: Input.Value = FInputActionValue(EInputActionValueType::Axis1D, FVector(Axis)); break;
+		case EOryxRecordedValue::Axis2D: Input.Value = FInputActionValue(EInputActionValueType::Axis2D, FVector(Axis)); break;
+		default: Input.Value = FInputActionValue(EInputActionValueType::Axis3D, FVector(Axis)); break;
+		}
+	}
+
+	Ar << Checksums;
+	return !Ar.IsError();
+}
+
+void UOryxInputRecorder::BlockLiveInput()
+{
+	//Disabled pawns are skipped by the controller's input stack, recorded inputs still arrive through Dispatch
+	APawn* Pawn = GetPlayerPawn();
+	APlayerController* PlayerController = Pawn ? Cast<APlayerController>(Pawn->GetController()) : nullptr;
+	if (!PlayerController || !Pawn->InputEnabled()) return;
+
+	Pawn->DisableInput(PlayerController);
+	InputBlockedPawns.Add(Pawn);
+}
+
+void UOryxInputRecorder::RestoreLiveInput()
+{
+	for (const TWeakObjectPtr<APawn>& Pawn : InputBlockedPawns)
+	{
+		//A pawn left during playback has no controller anymore, nullptr just clears its flag
+		if (Pawn.IsValid()) Pawn->EnableInput(Cast<APlayerController>(Pawn->GetController()));
+	}
+	InputBlockedPawns.Reset();
+}
+
+void UOryxInputRecorder::FinishPlayback()
+{
+	if (!bPlaying) return;
+	bPlaying = false;
+	RestoreTimeStep();
+	RestoreLiveInput();
+
+	//Per-frame checksums of both runs, for diffing on the capture machine
+	FString Report = TEXT("Frame,Recorded,Replayed\n");
+	for (int32 Frame = 0; Frame < PlaybackChecksums.Num(); ++Frame)
+	{
+		const uint32 Recorded = Checksums.IsValidIndex(Frame) ? Checksums[Frame] : 0;
+		Report += FString::Printf(TEXT("%d,%08x,%08x\n"), Frame, Recorded, PlaybackChecksums[Frame]);
+	}
+	const FString ReportPath = FPaths::ChangeExtension(GetRecordingPath(ActiveName), TEXT("checksums.csv"));
+	FFileHelper::SaveStringToFile(Report, *ReportPath);
+
+	if (FirstDivergentFrame == INDEX_NONE)
+		UE_LOG(LogOryx, Display, TEXT("Input playback matched for %d frames (%s)"), PlaybackChecksums.Num(), *ReportPath);
+	else
+		UE_LOG(LogOryx, Warning, TEXT("Input playback diverged at frame %d of %d (%s)"), FirstDivergentFrame, PlaybackChecksums.Num(), *ReportPath);
+
+	if (bExitWhenDone)
+	{
+		//Non-zero exit code lets automation flag the divergence
+		FPlatformMisc::RequestExitWithStatus(false, FirstDivergentFrame == INDEX_NONE ? 0 : 1);
+	}
+}
@@ -0,0 +1,272 @@
+#include "OryxLoadProfiler.h"
+#include "Oryx.h"
+#include "OryxPreloadSubsystem.h"
+#include "CoreGlobals.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "UObject/Package.h"
+
+static TUniquePtr<FOryxLoadProfiler> GOryxLoadProfiler;
+
+static FAutoConsoleCommand GOryxLoadProfileDumpCommand(
+	TEXT("Oryx.LoadProfile.Dump"),
+	TEXT("Oryx.LoadProfile.Dump - write what -OryxLoadProfile has recorded so far"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		if (FOryxLoadProfiler* Profiler = FOryxLoadProfiler::Get())
+			Profiler->Dump();
+		else
+			UE_LOG(LogOryx, Warning, TEXT("Load profile: start the game with -OryxLoadProfile"));
+	}));
+
+void FOryxLoadProfiler::StartFromCommandLine()
+{
+	const TCHAR* CommandLine = FCommandLine::Get();
+
+	float SettleSeconds = 5.f;
+	const bool bRecord = FParse::Value(CommandLine, TEXT("OryxLoadProfile="), SettleSeconds) || FParse::Param(CommandLine, TEXT("OryxLoadProfile"));
+	if (!bRecord && !FParse::Param(CommandLine, TEXT("OryxFirstFrame"))) return;
+
+	GOryxLoadProfiler.Reset(new FOryxLoadProfiler(bRecord, SettleSeconds, FParse::Param(CommandLine, TEXT("OryxLoadProfileExit"))));
+}
+
+void FOryxLoadProfiler::Shutdown()
+{
+	//Runs that quit before the settle time still leave their profile behind
+	if (GOryxLoadProfiler && GOryxLoadProfiler->bRecord && !GOryxLoadProfiler->bDumped)
+		GOryxLoadProfiler->Dump();
+	GOryxLoadProfiler.Reset();
+}
+
+FOryxLoadProfiler* FOryxLoadProfiler::Get()
+{
+	return GOryxLoadProfiler.Get();
+}
+
+FOryxLoadProfiler::FOryxLoadProfiler(bool bInRecord, float InSettleSeconds, bool bInExit)
+	: bRecord(bInRecord)
+	, SettleSeconds(FMath::Max(InSettleSeconds, 0.f))
+	, bExit(bInExit)
+{
+	if (!FParse::Value(FCommandLine::Get(), TEXT("OryxLoadProfileDir="), OutputDir))
+		OutputDir = FPaths::ProfilingDir() / TEXT("OryxLoad");
+
+	if (bRecord)
+	{
+		GUObjectArray.AddUObjectCreateListener(this);
+		bListening = true;
+
+		PreLoadMapHandle = FCoreUObjectDelegates::PreLoadMap.AddRaw(this, &FOryxLoadProfiler::OnPreLoadMap);
+		PostLoadMapHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddRaw(this, &FOryxLoadProfiler::OnPostLoadMap);
+		SyncLoadHandle = FCoreUObjectDelegates::OnSyncLoadPackage.AddRaw(this, &FOryxLoadProfiler::OnSyncLoadPackage);
+		BeginFrameHandle = FCoreDelegates::OnBeginFrame.AddRaw(this, &FOryxLoadProfiler::OnBeginFrame);
+	}
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FOryxLoadProfiler::OnEndFrame);
+}
+
+FOryxLoadProfiler::~FOryxLoadProfiler()
+{
+	if (bListening) GUObjectArray.RemoveUObjectCreateListener(this);
+
+	FCoreUObjectDelegates::PreLoadMap.Remove(PreLoadMapHandle);
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapHandle);
+	FCoreUObjectDelegates::OnSyncLoadPackage.Remove(SyncLoadHandle);
+	FCoreDelegates::OnBeginFrame.Remove(BeginFrameHandle);
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+}
+
+void FOryxLoadProfiler::NotifyUObjectCreated(const UObjectBase* Object, int32 Index)
+{
+	//Called for every object from any loading thread, so packages are picked out by class and nothing else is done
+	if (Object->GetClass() != UPackage::StaticClass()) return;
+
+	FPackageRecord Record;
+	Record.Name = Object->GetFName();
+	Record.Time = FPlatformTime::Seconds();
+	Record.Window = CurrentWindow.load(std::memory_order_relaxed);
+	Record.Segment = CurrentSegment.load(std::memory_order_relaxed);
+
+	FScopeLock Lock(&RecordsLock);
+	Records.Add(Record);
+}
+
+void FOryxLoadProfiler::OnUObjectArrayShutdown()
+{
+	GUObjectArray.RemoveUObjectCreateListener(this);
+	bListening = false;
+}
+
+void FOryxLoadProfiler::OpenWindow(bool bMapLoad)
+{
+	FWindow& Window = Windows.AddDefaulted_GetRef();
+	Window.Start = FPlatformTime::Seconds();
+	Window.bMapLoad = bMapLoad;
+	CurrentWindow.store(Windows.Num() - 1);
+}
+
+void FOryxLoadProfiler::CloseWindow()
+{
+	const int32 Window = CurrentWindow.exchange(INDEX_NONE);
+	if (Windows.IsValidIndex(Window)) Windows[Window].End = FPlatformTime::Seconds();
+}
+
+void FOryxLoadProfiler::OnPreLoadMap(const FString& MapName)
+{
+	CloseWindow();
+	SegmentMaps.Add(UOryxPreloadSubsystem::GetMapPackageName(MapName));
+	CurrentSegment.store(SegmentMaps.Num() - 1);
+	OpenWindow(true);
+}
+
+void FOryxLoadProfiler::OnPostLoadMap(UWorld* World)
+{
+	CloseWindow();
+}
+
+void FOryxLoadProfiler::OnSyncLoadPackage(const FString& PackageName)
+{
+	//Nested loads and loads inside LoadMap belong to the stretch already open
+	if (IsInGameThread() && CurrentWindow.load() == INDEX_NONE) OpenWindow(false);
+}
+
+void FOryxLoadProfiler::OnBeginFrame()
+{
+	CloseWindow();
+}
+
+void FOryxLoadProfiler::OnEndFrame()
+{
+	if (FirstFrameTime == 0.0)
+	{
+		const UWorld* World = FindPlayableWorld();
+		if (!World) return;
+
+		FirstFrameTime = FPlatformTime::Seconds();
+		ReportFirstFrame(World, FirstFrameTime - GStartTime);
+		if (!bRecord && bExit) FPlatformMisc::RequestExit(false);
+		return;
+	}
+
+	if (bRecord && !bDumped && FPlatformTime::Seconds() - FirstFrameTime >= SettleSeconds)
+	{
+		Dump();
+		if (bExit) FPlatformMisc::RequestExit(false);
+	}
+}
+
+const UWorld* FOryxLoadProfiler::FindPlayableWorld() const
+{
+	if (!GEngine) return nullptr;
+
+	for (const FWorldContext& Context : GEngine->GetWorldContexts())
+	{
+		const UWorld* World = Context.World();
+		if (!World || (Context.WorldType != EWorldType::Game && Context.WorldType != EWorldType::PIE) || !World->HasBegunPlay()) continue;
+
+		const APlayerController* Player = World->GetFirstPlayerController();
+		if (Player && Player->GetPawn()) return World;
+	}
+	return nullptr;
+}
+
+void FOryxLoadProfiler::ReportFirstFrame(const UWorld* World, double Seconds) const
+{
+	const FString Map = UWorld::RemovePIEPrefix(World->GetOutermost()->GetName());
+	UE_LOG(LogOryx, Display, TEXT("Load profile: first playable frame of %s at %.3f s"), *Map, Seconds);
+
+	//Logging is compiled out of shipping builds, and repeated timing runs collect in one file
+	const FString Path = OutputDir / TEXT("FirstFrame.csv");
+	const bool bNewFile = !IFileManager::Get().FileExists(*Path);
+	const FString Line = FString::Printf(TEXT("%s%s,%.4f\n"), bNewFile ? TEXT("Map,Seconds\n") : TEXT(""), *Map, Seconds);
+	FFileHelper::SaveStringToFile(Line, *Path, FFileHelper::EEncodingOptions::ForceAnsi, &IFileManager::Get(), FILEWRITE_Append);
+}
+
+bool FOryxLoadProfiler::Dump()
+{
+	bDumped = true;
+	const double Now = FPlatformTime::Seconds();
+
+	TArray<FPackageRecord> Sorted;
+	{
+		FScopeLock Lock(&RecordsLock);
+		Sorted = Records;
+	}
+	Sorted.StableSort([](const FPackageRecord& A, const FPackageRecord& B) { return A.Time < B.Time; });
+
+	const TSet<FName> MapPackages(SegmentMaps);
+	TSet<FName> Seen;
+	TMap<FName, TArray<FName>> Preloads;
+	FString Csv = TEXT("Order,Package,Seconds,Blocking,SelfMs,Map\n");
+	FString OpenOrder;
+	int32 Order = 0;
+	int32 NumBlocking = 0;
+	double BlockingMs = 0.0;
+
+	for (int32 Index = 0; Index < Sorted.Num(); ++Index)
+	{
+		const FPackageRecord& Record = Sorted[Index];
+		const FString Name = Record.Name.ToString();
+
+		//Native script packages and transient ones aren't content, a package reloaded after GC keeps its first place
+		if (!Name.StartsWith(TEXT("/")) || Name.StartsWith(TEXT("/Script/")) || Name.StartsWith(TEXT("/Temp/")) ||
+			Name.StartsWith(TEXT("/Memory/")) || Seen.Contains(Record.Name)) continue;
+		Seen.Add(Record.Name);
+
+		const bool bBlocking = Windows.IsValidIndex(Record.Window);
+		double SelfMs = 0.0;
+		if (bBlocking)
+		{
+			const FWindow& Window = Windows[Record.Window];
+			double End = Window.End > 0.0 ? Window.End : Now;
+			if (Sorted.IsValidIndex(Index + 1) && Sorted[Index + 1].Window == Record.Window) End = FMath::Min(End, Sorted[Index + 1].Time);
+			SelfMs = FMath::Max(End - Record.Time, 0.0) * 1000.0;
+			BlockingMs += SelfMs;
+			++NumBlocking;
+		}
+
+		const bool bHasMap = SegmentMaps.IsValidIndex(Record.Segment);
+		Csv += FString::Printf(TEXT("%d,%s,%.4f,%d,%.3f,%s\n"), Order, *Name, Record.Time - GStartTime, bBlocking ? 1 : 0, SelfMs,
+			bHasMap ? *SegmentMaps[Record.Segment].ToString() : TEXT("boot"));
+
+		//Same format -fileopenlog writes, paths as the packaged game sees them
+		FString Filename;
+		const FString Extension = MapPackages.Contains(Record.Name) ? FPackageName::GetMapPackageExtension() : FPackageName::GetAssetPackageExtension();
+		if (FPackageName::TryConvertLongPackageNameToFilename(Name, Filename, Extension))
+			OpenOrder += FString::Printf(TEXT("\"%s\" %d\n"), *Filename, Order + 1);
+		++Order;
+
+		//World Partition streams external actors and objects in, the map itself is what's being loaded
+		if (bBlocking && bHasMap && Record.Name != SegmentMaps[Record.Segment] && !Name.Contains(TEXT("/__External")))
+			Preloads.FindOrAdd(SegmentMaps[Record.Segment]).AddUnique(Record.Name);
+	}
+
+	FString Ini = TEXT("[/Script/Oryx.OryxPreloadSubsystem]\n");
+	for (const TPair<FName, TArray<FName>>& Preload : Preloads)
+	{
+		TArray<FString> Quoted;
+		for (const FName Package : Preload.Value)
+			Quoted.Add(FString::Printf(TEXT("\"%s\""), *Package.ToString()));
+		Ini += FString::Printf(TEXT("+MapPreloads=(Map=\"%s\",Packages=(%s))\n"), *Preload.Key.ToString(), *FString::Join(Quoted, TEXT(",")));
+	}
+
+	const bool bWritten = FFileHelper::SaveStringToFile(Csv, *(OutputDir / TEXT("Packages.csv"))) &&
+		FFileHelper::SaveStringToFile(OpenOrder, *(OutputDir / TEXT("GameOpenOrder.log"))) &&
+		FFileHelper::SaveStringToFile(Ini, *(OutputDir / TEXT("Preload.ini")));
+
+	for (const FWindow& Window : Windows)
+	{
+		if (Window.bMapLoad && Window.End > 0.0)
+			UE_LOG(LogOryx, Display, TEXT("Load profile: map load at %.3f s took %.1f ms"), Window.Start - GStartTime, (Window.End - Window.Start) * 1000.0);
+	}
+	UE_LOG(LogOryx, Display, TEXT("Load profile: %d packages, %d blocking for %.1f ms over %d stretches, %s %s"),
+		Order, NumBlocking, BlockingMs, Windows.Num(), bWritten ? TEXT("written to") : TEXT("failed to write"), *OutputDir);
+	return bWritten;
+}
@@ -0,0 +1,185 @@
+#include "OryxPilotController.h"
+#include "OryxPilotScheduler.h"
+#include "SpaceshipPawn.h"
+#include "ShipArchetype.h"
+#include "ShipNavSubsystem.h"
+#include "OryxTrafficControl.h"
+#include "LandingPad.h"
+#include "Engine/World.h"
+
+AOryxPilotController::AOryxPilotController()
+{
+	PrimaryActorTick.bCanEverTick = false; //Driven by UOryxPilotScheduler
+	bWantsPlayerState = false;
+}
+
+void AOryxPilotController::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (UOryxPilotScheduler* Scheduler = GetWorld()->GetSubsystem<UOryxPilotScheduler>())
+		Scheduler->RegisterPilot(this);
+}
+
+void AOryxPilotController::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UOryxPilotScheduler* Scheduler = GetWorld()->GetSubsystem<UOryxPilotScheduler>())
+		Scheduler->UnregisterPilot(this);
+
+	if (UOryxTrafficControl* Traffic = GetWorld()->GetSubsystem<UOryxTrafficControl>())
+		Traffic->CancelRequest(Ship);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AOryxPilotController::ApplyWorldOffset(const FVector& InOffset, bool bWorldShift)
+{
+	Super::ApplyWorldOffset(InOffset, bWorldShift);
+
+	//Route points are world locations, they move with everything else on an origin rebase
+	for (FVector& Point : Route)
+		Point += InOffset;
+	for (FVector& Point : LegPath)
+		Point += InOffset;
+}
+
+void AOryxPilotController::OnPossess(APawn* InPawn)
+{
+	Super::OnPossess(InPawn);
+
+	Ship = Cast<ASpaceshipPawn>(InPawn);
+	bThrusting = bBraking = false;
+	AssignedPad = nullptr;
+	LandedTime = -1.0;
+	RequestLegPath();
+}
+
+void AOryxPilotController::SetRoute(const TArray<FVector>& InRoute)
+{
+	Route = InRoute;
+	RouteIndex = 0;
+	RequestLegPath();
+}
+
+void AOryxPilotController::RequestLegPath()
+{
+	LegPath.Reset();
+	LegPathIndex = 0;
+	if (!Ship || Route.Num() == 0) return;
+
+	//Fly straight at the route point until the path comes back
+	if (UShipNavSubsystem* Nav = GetWorld()->GetSubsystem<UShipNavSubsystem>())
+	{
+		Nav->RequestPath(Ship->GetActorLocation(), GetGoal(),
+			FOnShipNavPathFound::CreateUObject(this, &AOryxPilotController::OnLegPathFound, ++LegPathRequest));
+	}
+}
+
+void AOryxPilotController::OnPadAssigned(ALandingPad* Pad)
+{
+	AssignedPad = Pad;
+	RequestLegPath();
+}
+
+FVector AOryxPilotController::GetGoal() const
+{
+	return AssignedPad ? AssignedPad->GetApproachPoint() : Route[RouteIndex];
+}
+
+void AOryxPilotController::OnLegPathFound(EShipNavResult Result, const TArray<FVector>& Path, uint32 RequestId)
+{
+	if (RequestId != LegPathRequest || Result == EShipNavResult::Failed) return;
+
+	LegPath = Path;
+	LegPathIndex = 1; //Path[0] is where the ship was when it asked
+}
+
+void AOryxPilotController::SetPressed(EOryxInputAction Action, bool bPressed, bool& bCurrent)
+{
+	if (bPressed == bCurrent) return;
+
+	bCurrent = bPressed;
+	Ship->DispatchInput(Action, FInputActionValue(bPressed));
+}
+
+void AOryxPilotController::Think(int32 ThinkFrames)
+{
+	if (!Ship || Route.Num() == 0) return;
+
+	//The ship's own landing sequence flies it once started, take off again after a stop on the pad
+	const ELandingStage Stage = Ship->GetLandingStage();
+	if (Stage != ELandingStage::None)
+	{
+		SetPressed(EOryxInputAction::ForwardThrust, false, bThrusting);
+		SetPressed(EOryxInputAction::Brake, false, bBraking);
+
+		const double Now = GetWorld()->GetTimeSeconds();
+		if (Stage == ELandingStage::Landed)
+		{
+			if (LandedTime < 0.0) LandedTime = Now;
+			if (Now - LandedTime < LandedWaitTime) return;
+
+			//Takeoff hands the pad back to traffic control
+			Ship->DispatchInput(EOryxInputAction::AllThrusters, FInputActionValue(true));
+			Ship->DispatchInput(EOryxInputAction::AllThrusters, FInputActionValue(false));
+			AssignedPad = nullptr;
+			LandedTime = -1.0;
+			RequestLegPath();
+		}
+		return;
+	}
+
+	const FVector Location = Ship->GetActorLocation();
+	UOryxTrafficControl* Traffic = GetWorld()->GetSubsystem<UOryxTrafficControl>();
+
+	//Reservation timed out or the pad went away, carry on with the route
+	if (AssignedPad && (!IsValid(AssignedPad) || (Traffic && !Traffic->IsPadAvailableFor(AssignedPad, Ship))))
+	{
+		AssignedPad = nullptr;
+		RequestLegPath();
+	}
+
+	//Over the assigned pad: the reservation already holds it for us
+	if (AssignedPad && Ship->OverlappingLandingPad == AssignedPad)
+	{
+		Ship->DispatchInput(EOryxInputAction::Land, FInputActionValue(true));
+		return;
+	}
+
+	//Route point reached, carry on to the next one and queue for a pad at the end of each lap
+	if (!AssignedPad && FVector::Dist(Location, Route[RouteIndex]) < ArrivalRadius)
+	{
+		RouteIndex = (RouteIndex + 1) % Route.Num();
+		RequestLegPath();
+
+		if (bLandAfterEachLap && RouteIndex == 0 && Traffic)
+			Traffic->RequestLanding(Ship, FOnLandingPadAssigned::CreateUObject(this, &AOryxPilotController::OnPadAssigned));
+	}
+
+	while (LegPathIndex < LegPath.Num() - 1 && FVector::Dist(Location, LegPath[LegPathIndex]) < WaypointRadius)
+		++LegPathIndex;
+
+	const FVector Goal = GetGoal();
+	const FVector Target = LegPathIndex < LegPath.Num() - 1 ? LegPath[LegPathIndex] : Goal;
+
+	//Ease off approaching each route point or pad, and give way to other ships
+	const float DesiredSpeed = FMath::Min(CruiseSpeed, static_cast<float>(FVector::Dist(Location, Goal)));
+	const FVector Desired = Ship->SteerAroundTraffic((Target - Location).GetSafeNormal() * DesiredSpeed, ThinkFrames);
+	const FVector Heading = Desired.IsNearlyZero() ? (Target - Location).GetSafeNormal() : Desired.GetSafeNormal();
+
+	//Same mapping the mouse uses: an offset of 1 asks for MaxSteerAngle of yaw or pitch
+	const FVector Local = Ship->GetActorTransform().InverseTransformVectorNoScale(Heading);
+	const float YawError = FMath::RadiansToDegrees(FMath::Atan2(Local.Y, Local.X));
+	const float PitchError = FMath::RadiansToDegrees(FMath::Atan2(Local.Z, FVector2D(Local.X, Local.Y).Size()));
+	const float MaxSteerAngle = Ship->GetArchetype().MaxSteerAngle;
+	const FVector2D Steer(FMath::Clamp(YawError / MaxSteerAngle, -1.f, 1.f), FMath::Clamp(-PitchError / MaxSteerAngle, -1.f, 1.f));
+	Ship->DispatchInput(EOryxInputAction::Steer, FInputActionValue(Steer));
+
+	//Thrust only roughly nose-on, brake when well over speed
+	const FVector Velocity = Ship->GetVelocity();
+	const bool bFacing = FMath::Abs(YawError) < ThrustConeAngle && FMath::Abs(PitchError) < ThrustConeAngle;
+	const bool bOverSpeed = Velocity.Size() > DesiredSpeed * 1.2f + 100.f;
+
+	SetPressed(EOryxInputAction::Brake, bOverSpeed, bBraking);
+	SetPressed(EOryxInputAction::ForwardThrust, !bOverSpeed && bFacing && (Velocity | Heading) < DesiredSpeed, bThrusting);
+}
@@ -0,0 +1,174 @@
+#include "OryxPilotScheduler.h"
+#include "Oryx.h"
+#include "OryxPilotController.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerStart.h"
+#include "Kismet/GameplayStatics.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Pilot scheduler"), STAT_OryxPilotScheduler, STATGROUP_Oryx);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pilots thought"), STAT_OryxPilotsThought, STATGROUP_Oryx);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pilots deferred"), STAT_OryxPilotsDeferred, STATGROUP_Oryx);
+
+static TAutoConsoleVariable<float> CVarOryxPilotBudgetMs(
+	TEXT("Oryx.Pilots.BudgetMs"),
+	1.0f,
+	TEXT("Game thread milliseconds NPC pilots may spend thinking each frame, at least one pilot always thinks"));
+
+static FAutoConsoleCommandWithWorldAndArgs GOryxPilotsSpawnCommand(
+	TEXT("Oryx.Pilots.Spawn"),
+	TEXT("Oryx.Pilots.Spawn <Count> [PatrolRadius] - spawn NPC pilots patrolling around the player start"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UOryxPilotScheduler* Scheduler = World ? World->GetSubsystem<UOryxPilotScheduler>() : nullptr;
+		if (!Scheduler || Args.Num() < 1) return;
+
+		Scheduler->SpawnPilots(FCString::Atoi(*Args[0]), Args.Num() >= 2 ? FCString::Atof(*Args[1]) : 20000.f);
+	}));
+
+static FAutoConsoleCommandWithWorld GOryxPilotsClearCommand(
+	TEXT("Oryx.Pilots.Clear"),
+	TEXT("Destroy every spawned NPC pilot and its ship"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UOryxPilotScheduler* Scheduler = World ? World->GetSubsystem<UOryxPilotScheduler>() : nullptr)
+			Scheduler->ClearPilots();
+	}));
+
+bool UOryxPilotScheduler::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UOryxPilotScheduler::Deinitialize()
+{
+	Pilots.Reset();
+	SpawnedPilots.Reset();
+	Super::Deinitialize();
+}
+
+void UOryxPilotScheduler::RegisterPilot(AOryxPilotController* Pilot)
+{
+	FPilotEntry& Entry = Pilots.AddDefaulted_GetRef();
+	Entry.Pilot = Pilot;
+}
+
+void UOryxPilotScheduler::UnregisterPilot(AOryxPilotController* Pilot)
+{
+	Pilots.RemoveAllSwap([Pilot](const FPilotEntry& Entry) { return Entry.Pilot == Pilot; });
+}
+
+float UOryxPilotScheduler::GetThinkInterval(float Distance) const
+{
+	const float Alpha = FMath::Clamp((Distance - NearDistance) / FMath::Max(FarDistance - NearDistance, 1.f), 0.f, 1.f);
+	return FMath::Lerp(1.f, static_cast<float>(FMath::Max(FarThinkFrames, 1)), Alpha);
+}
+
+void UOryxPilotScheduler::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_OryxPilotScheduler);
+
+	Pilots.RemoveAllSwap([](const FPilotEntry& Entry) { return !Entry.Pilot.IsValid(); });
+	if (Pilots.Num() == 0) return;
+
+	//Pilots matter as much as they are close to someone who can see them
+	TArray<FVector, TInlineAllocator<4>> PlayerLocations;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const APawn* PlayerPawn = It->Get() ? It->Get()->GetPawn() : nullptr)
+			PlayerLocations.Add(PlayerPawn->GetActorLocation());
+	}
+
+	//How overdue each pilot is, 1 means exactly on its interval
+	TArray<TPair<float, int32>> Due;
+	TArray<float, TInlineAllocator<64>> Intervals;
+	Intervals.SetNumZeroed(Pilots.Num());
+	for (int32 Index = 0; Index < Pilots.Num(); ++Index)
+	{
+		const APawn* Pawn = Pilots[Index].Pilot->GetPawn();
+		if (!Pawn) continue;
+
+		double ClosestSq = FMath::Square(static_cast<double>(FarDistance));
+		for (const FVector& PlayerLocation : PlayerLocations)
+			ClosestSq = FMath::Min(ClosestSq, FVector::DistSquared(PlayerLocation, Pawn->GetActorLocation()));
+
+		Intervals[Index] = GetThinkInterval(FMath::Sqrt(ClosestSq));
+		const float Overdue = (GFrameCounter - Pilots[Index].LastThinkFrame) / Intervals[Index];
+		if (Overdue >= 1.f) Due.Emplace(Overdue, Index);
+	}
+
+	Due.Sort([](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key > B.Key; });
+
+	const double Deadline = FPlatformTime::Seconds() + CVarOryxPilotBudgetMs.GetValueOnGameThread() / 1000.0;
+	int32 NumThought = 0;
+	for (const TPair<float, int32>& Entry : Due)
+	{
+		if (NumThought > 0 && FPlatformTime::Seconds() >= Deadline) break;
+
+		Pilots[Entry.Value].Pilot->Think(FMath::CeilToInt(Intervals[Entry.Value]));
+		Pilots[Entry.Value].LastThinkFrame = GFrameCounter;
+		++NumThought;
+	}
+
+	SET_DWORD_STAT(STAT_OryxPilotsThought, NumThought);
+	SET_DWORD_STAT(STAT_OryxPilotsDeferred, Due.Num() - NumThought);
+}
+
+void UOryxPilotScheduler::SpawnPilots(int32 Count, float PatrolRadius)
+{
+	UWorld* World = GetWorld();
+	if (!World || Count <= 0 || World->GetNetMode() == NM_Client) return; //Pilots, like bots, fly on the server
+
+	UClass* ShipClass = PilotShipClass.LoadSynchronous();
+	if (!ShipClass)
+	{
+		UE_LOG(LogOryx, Error, TEXT("Pilots: no ship class configured in [/Script/Oryx.OryxPilotScheduler]"));
+		return;
+	}
+
+	FVector Origin = FVector::ZeroVector;
+	if (AActor* PlayerStart = UGameplayStatics::GetActorOfClass(World, APlayerStart::StaticClass()))
+		Origin = PlayerStart->GetActorLocation();
+
+	//Random points in the upper half of a sphere around the start
+	auto RandomPatrolPoint = [&]()
+		{
+			FVector Direction = FMath::VRand();
+			Direction.Z = FMath::Abs(Direction.Z);
+			return Origin + Direction * FMath::FRandRange(0.3f, 1.f) * PatrolRadius;
+		};
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		APawn* Ship = World->SpawnActor<APawn>(ShipClass, RandomPatrolPoint(), FRotator(0.f, FMath::FRandRange(0.f, 360.f), 0.f), SpawnParams);
+		AOryxPilotController* Pilot = World->SpawnActor<AOryxPilotController>(SpawnParams);
+		if (!Ship || !Pilot) continue;
+
+		Pilot->Possess(Ship);
+		Pilot->SetRoute({ RandomPatrolPoint(), RandomPatrolPoint(), RandomPatrolPoint(), RandomPatrolPoint() });
+		SpawnedPilots.Add(Pilot);
+	}
+
+	UE_LOG(LogOryx, Log, TEXT("Pilots: %d flying"), Pilots.Num());
+}
+
+void UOryxPilotScheduler::ClearPilots()
+{
+	for (AOryxPilotController* Pilot : SpawnedPilots)
+	{
+		if (!Pilot) continue;
+		if (APawn* Pawn = Pilot->GetPawn()) Pawn->Destroy();
+		Pilot->Destroy();
+	}
+	SpawnedPilots.Reset();
+}
+
+TStatId UOryxPilotScheduler::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UOryxPilotScheduler, STATGROUP_Tickables);
+}
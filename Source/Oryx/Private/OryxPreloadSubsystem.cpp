@@ -0,0 +1,120 @@
+#include "OryxPreloadSubsystem.h"
+#include "Oryx.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/PackageName.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectHash.h"
+
+static TAutoConsoleVariable<int32> CVarOryxPreload(
+	TEXT("Oryx.Preload"),
+	1,
+	TEXT("Request a map's preload list in one batch when it starts loading (0 = off)"));
+
+void UOryxPreloadSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	//Game instance subsystems are up before the first map is browsed to, so boot benefits too
+	PreLoadMapHandle = FCoreUObjectDelegates::PreLoadMap.AddUObject(this, &UOryxPreloadSubsystem::OnPreLoadMap);
+	PostLoadMapHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this, &UOryxPreloadSubsystem::OnPostLoadMap);
+}
+
+void UOryxPreloadSubsystem::Deinitialize()
+{
+	FCoreUObjectDelegates::PreLoadMap.Remove(PreLoadMapHandle);
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapHandle);
+	Held.Reset();
+
+	Super::Deinitialize();
+}
+
+FName UOryxPreloadSubsystem::GetMapPackageName(const FString& Map)
+{
+	FString Name = UWorld::RemovePIEPrefix(FPackageName::ObjectPathToPackageName(Map));
+	if (FPackageName::IsShortPackageName(Name))
+	{
+		FString LongName;
+		if (FPackageName::SearchForPackageOnDisk(Name + FPackageName::GetMapPackageExtension(), &LongName)) Name = LongName;
+	}
+	return FName(*Name);
+}
+
+bool UOryxPreloadSubsystem::PreloadMap(const FString& Map)
+{
+	const FName MapName = GetMapPackageName(Map);
+	if (MapName == PreloadingMap) return NumRequested > 0;
+
+	const FOryxMapPreload* Preload = MapPreloads.FindByPredicate([MapName](const FOryxMapPreload& Entry) { return Entry.Map == MapName; });
+	if (!Preload || CVarOryxPreload.GetValueOnGameThread() == 0) return false;
+
+	//A previous map's batch still in flight finishes on its own, its packages are simply not held
+	Held.Reset();
+	++CurrentBatch;
+	PreloadingMap = MapName;
+	NumRequested = 0;
+	NumPending = 0;
+	PreloadStartTime = FPlatformTime::Seconds();
+
+	for (const FName Package : Preload->Packages)
+	{
+		if (UPackage* Loaded = FindPackage(nullptr, *Package.ToString()); Loaded && Loaded->IsFullyLoaded())
+		{
+			Hold(Loaded);
+			continue;
+		}
+
+		++NumRequested;
+		++NumPending;
+		LoadPackageAsync(Package.ToString(), FLoadPackageAsyncDelegate::CreateUObject(this, &UOryxPreloadSubsystem::OnPackageLoaded, CurrentBatch));
+	}
+
+	UE_LOG(LogOryx, Log, TEXT("Preload: requested %d of %d packages for %s"), NumRequested, Preload->Packages.Num(), *MapName.ToString());
+	return true;
+}
+
+void UOryxPreloadSubsystem::OnPreLoadMap(const FString& MapName)
+{
+	PreloadMap(MapName);
+}
+
+void UOryxPreloadSubsystem::OnPackageLoaded(const FName& PackageName, UPackage* Package, EAsyncLoadingResult::Type Result, int32 Batch)
+{
+	if (Batch != CurrentBatch) return;
+
+	if (Result != EAsyncLoadingResult::Succeeded || !Package)
+	{
+		//Usually a list out of date with the content, the map loads whatever it really needs anyway
+		UE_LOG(LogOryx, Verbose, TEXT("Preload: %s failed to load"), *PackageName.ToString());
+	}
+	else if (!PreloadingMap.IsNone())
+	{
+		Hold(Package);
+	}
+
+	if (NumPending > 0 && --NumPending == 0)
+	{
+		UE_LOG(LogOryx, Log, TEXT("Preload: %s batch done in %.1f ms"), *PreloadingMap.ToString(), (FPlatformTime::Seconds() - PreloadStartTime) * 1000.0);
+	}
+}
+
+void UOryxPreloadSubsystem::Hold(UPackage* Package)
+{
+	//Nested ones too, an outer doesn't keep its inner objects alive
+	GetObjectsWithPackage(Package, Held);
+}
+
+void UOryxPreloadSubsystem::OnPostLoadMap(UWorld* World)
+{
+	if (PreloadingMap.IsNone()) return;
+
+	if (NumPending > 0)
+		UE_LOG(LogOryx, Log, TEXT("Preload: %s loaded with %d of %d preloads still in flight"), *PreloadingMap.ToString(), NumPending, NumRequested);
+
+	//The loaded world references what it needs now, anything else is free to go at the next collection
+	Held.Reset();
+	++CurrentBatch;
+	PreloadingMap = NAME_None;
+	NumRequested = 0;
+	NumPending = 0;
+}
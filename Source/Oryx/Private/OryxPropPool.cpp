@@ -0,0 +1,85 @@
+#include "OryxPropPool.h"
+#include "Oryx.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/World.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled props spawned"), STAT_OryxPropPoolSpawned, STATGROUP_Oryx);
+
+bool UOryxPropPool::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+AStaticMeshActor* UOryxPropPool::Acquire(UStaticMesh* Mesh, const FTransform& Transform)
+{
+	UWorld* World = GetWorld();
+	if (!Mesh || !World) return nullptr;
+
+	AStaticMeshActor* Prop = nullptr;
+	while (!Prop && Free.Num() > 0)
+	{
+		Prop = Free.Pop(EAllowShrinking::No);
+		if (!IsValid(Prop)) Prop = nullptr;
+	}
+
+	if (!Prop)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		Prop = World->SpawnActor<AStaticMeshActor>(AStaticMeshActor::StaticClass(), Transform, SpawnParams);
+		if (!Prop) return nullptr;
+
+		Prop->SetMobility(EComponentMobility::Movable);
+		UStaticMeshComponent* NewBody = Prop->GetStaticMeshComponent();
+		NewBody->SetCollisionProfileName(TEXT("OryxProp"));
+		NewBody->SetCanEverAffectNavigation(false);
+
+		if (World->GetNetMode() != NM_Standalone)
+		{
+			Prop->SetReplicates(true);
+			Prop->SetReplicateMovement(true);
+			NewBody->SetIsReplicated(true); //Mesh changes on reuse reach clients
+		}
+		INC_DWORD_STAT(STAT_OryxPropPoolSpawned);
+	}
+
+	UStaticMeshComponent* Body = Prop->GetStaticMeshComponent();
+	Body->SetStaticMesh(Mesh);
+	Body->EmptyOverrideMaterials();
+	Prop->SetActorTransform(Transform, false, nullptr, ETeleportType::TeleportPhysics);
+	Prop->SetActorHiddenInGame(false);
+	Prop->SetActorEnableCollision(true);
+	Body->SetSimulatePhysics(true);
+	return Prop;
+}
+
+void UOryxPropPool::Release(AStaticMeshActor* Prop)
+{
+	if (!IsValid(Prop)) return;
+
+	if (Free.Num() >= MaxFree)
+	{
+		Prop->Destroy();
+		return;
+	}
+
+	UStaticMeshComponent* Body = Prop->GetStaticMeshComponent();
+	Body->SetSimulatePhysics(false);
+	Prop->SetActorEnableCollision(false);
+	Prop->SetActorHiddenInGame(true);
+	Free.Add(Prop);
+}
+
+void UOryxPropPool::Retire(UPrimitiveComponent* Prop)
+{
+	AActor* Owner = Prop->GetOwner();
+	AStaticMeshActor* PropActor = Cast<AStaticMeshActor>(Owner);
+	UOryxPropPool* Pool = Owner->GetWorld()->GetSubsystem<UOryxPropPool>();
+	if (PropActor && Pool && PropActor->GetRootComponent() == Prop && !PropActor->HasAnyFlags(RF_WasLoaded))
+		Pool->Release(PropActor);
+	else if (Owner->GetRootComponent() == Prop)
+		Owner->Destroy();
+	else
+		Prop->DestroyComponent();
+}
@@ -0,0 +1,866 @@
+#include "OryxSaveSubsystem.h"
+#include "Oryx.h"
+#include "SpaceshipPawn.h"
+#include "PlayerPawnController.h"
+#include "GravityGun.h"
+#include "LandingPad.h"
+#include "OryxTrafficControl.h"
+#include "OryxPropPool.h"
+#include "ShipCargoHoldComponent.h"
+#include "Components/PrimitiveComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/Level.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Materials/MaterialInterface.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Async/MappedFileHandle.h"
+#include "Hash/CityHash.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DECLARE_CYCLE_STAT(TEXT("Save capture"), STAT_OryxSaveCapture, STATGROUP_Oryx);
+DECLARE_CYCLE_STAT(TEXT("Save load"), STAT_OryxSaveLoad, STATGROUP_Oryx);
+
+static FAutoConsoleCommandWithWorldAndArgs GOryxSaveCommand(
+	TEXT("Oryx.Save"),
+	TEXT("Oryx.Save [Slot] [delta] - write a snapshot of the world, delta only holds props changed since the slot's full snapshot"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UOryxSaveSubsystem* Saves = World ? World->GetSubsystem<UOryxSaveSubsystem>() : nullptr)
+			Saves->Save(Args.Num() > 0 ? Args[0] : TEXT("Quick"), Args.Num() > 1 && Args[1].Equals(TEXT("delta"), ESearchCase::IgnoreCase));
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs GOryxLoadCommand(
+	TEXT("Oryx.Load"),
+	TEXT("Oryx.Load [Slot] - restore a snapshot of the world and its delta"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UOryxSaveSubsystem* Saves = World ? World->GetSubsystem<UOryxSaveSubsystem>() : nullptr)
+			Saves->Load(Args.Num() > 0 ? Args[0] : TEXT("Quick"));
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs GOryxSaveBenchCommand(
+	TEXT("Oryx.Save.Bench"),
+	TEXT("Oryx.Save.Bench [Props] - time the game thread capture of a full snapshot with that many moved props spawned"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UOryxSaveSubsystem* Saves = World ? World->GetSubsystem<UOryxSaveSubsystem>() : nullptr)
+			Saves->RunBench(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10000);
+	}));
+
+//File layout: header, then each section's records back to back at a 16 byte aligned offset. Records are plain
+//data in native (little endian) layout so a mapped file is read in place. Later versions only append fields to
+//records, Stride lets an older reader step over them. Version 2 added sections, so the header grew and version 1
+//files are refused.
+namespace OryxSnapshot
+{
+	constexpr uint32 Magic = 0x534E5952; //"RYNS"
+	constexpr uint32 Version = 2;
+	constexpr uint32 MinVersion = 2;
+	constexpr uint64 SectionAlignment = 16;
+
+	enum class EKind : uint32 { Full, Delta };
+	enum ESection : uint32 { Ships, Pawns, Guns, Props, Cargo, CargoFloats, Strings, RetiredProps, NumSections };
+
+	struct FSection
+	{
+		uint64 Offset = 0;
+		uint32 Count = 0;
+		uint32 Stride = 0;
+	};
+
+	struct FHeader
+	{
+		uint32 Magic = OryxSnapshot::Magic;
+		uint32 Version = OryxSnapshot::Version;
+		EKind Kind = EKind::Full;
+		uint32 Reserved = 0;
+		uint64 SnapshotId = 0;
+		uint64 BaseId = 0; //Full snapshot a delta applies to
+		uint64 MapId = 0;
+		double GameTime = 0.0;
+		FSection Sections[NumSections];
+	};
+
+	struct FBodyRecord
+	{
+		double Location[3]; //Relative to the original world origin
+		float Rotation[4];
+		float LinearVelocity[3];
+		float AngularVelocity[3]; //deg/s
+	};
+
+	struct FShipRecord
+	{
+		uint64 Id;
+		uint64 PadId; //0 without a target pad
+		FBodyRecord Body;
+		uint8 LandingStage;
+		uint8 Padding[7];
+	};
+
+	struct FPawnRecord
+	{
+		uint64 Id;
+		FBodyRecord Body;
+		float CameraPitch;
+		float HorizontalVelocity[2];
+		float Padding;
+	};
+
+	struct FGunRecord
+	{
+		uint64 OwnerId; //Guns are spawned by their pawn, so they are found through it
+		uint64 HeldId; //0 when empty
+	};
+
+	struct FPropRecord
+	{
+		uint64 Id;
+		FBodyRecord Body;
+	};
+
+	//One stowed prop. Paths are byte offsets into Strings (UTF-8, null terminated, 0 is the empty string)
+	struct FCargoRecord
+	{
+		uint64 ShipId;
+		uint32 MeshPath;
+		uint32 MaterialPaths; //Override slots joined by ';', an empty entry keeps the mesh's material
+		uint32 FirstFloat; //Custom primitive data in CargoFloats
+		uint32 NumFloats;
+		float Scale[3];
+		float MassKg;
+	};
+
+	//Retired props are plain uint64 ids, Strings and CargoFloats plain bytes and floats
+	static_assert(sizeof(FHeader) == 176 && sizeof(FBodyRecord) == 64 && sizeof(FShipRecord) == 88 &&
+		sizeof(FPawnRecord) == 88 && sizeof(FGunRecord) == 16 && sizeof(FPropRecord) == 72 && sizeof(FCargoRecord) == 40,
+		"Snapshot layout changed, bump Version");
+
+	//Read only view of a snapshot file, mapped when the platform can
+	class FReader
+	{
+	public:
+		bool Open(const FString& Path)
+		{
+			IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+			auto Mapped = PlatformFile.OpenMappedEx(*Path);
+			if (Mapped.HasValue())
+			{
+				Handle = Mapped.StealValue();
+				Region.Reset(Handle->MapRegion(0, Handle->GetFileSize()));
+			}
+
+			if (Region.IsValid())
+			{
+				Bytes = TConstArrayView<uint8>(Region->GetMappedPtr(), static_cast<int32>(Region->GetMappedSize()));
+			}
+			else
+			{
+				if (!FFileHelper::LoadFileToArray(Loaded, *Path, FILEREAD_Silent)) return false;
+				Bytes = Loaded;
+			}
+
+			if (Bytes.Num() < static_cast<int32>(sizeof(FHeader))) return false;
+			const FHeader& Header = GetHeader();
+			if (Header.Magic != Magic || Header.Version < MinVersion) return false;
+
+			static constexpr uint32 Strides[NumSections] = { sizeof(FShipRecord), sizeof(FPawnRecord), sizeof(FGunRecord), sizeof(FPropRecord),
+				sizeof(FCargoRecord), sizeof(float), sizeof(ANSICHAR), sizeof(uint64) };
+			for (uint32 Section = 0; Section < NumSections; ++Section)
+			{
+				const FSection& Range = Header.Sections[Section];
+				if (Range.Count == 0) continue;
+				if (Range.Stride < Strides[Section] || Range.Offset % SectionAlignment != 0) return false;
+				if (Range.Offset + uint64(Range.Count) * Range.Stride > uint64(Bytes.Num())) return false;
+			}
+			return true;
+		}
+
+		const FHeader& GetHeader() const { return *reinterpret_cast<const FHeader*>(Bytes.GetData()); }
+
+		int32 Num(ESection Section) const { return GetHeader().Sections[Section].Count; }
+
+		template<typename T>
+		const T& Get(ESection Section, int32 Index) const
+		{
+			const FSection& Range = GetHeader().Sections[Section];
+			return *reinterpret_cast<const T*>(Bytes.GetData() + Range.Offset + uint64(Index) * Range.Stride);
+		}
+
+		//Empty when Offset doesn't start a terminated string inside Strings
+		FString GetString(uint32 Offset) const
+		{
+			const FSection& Range = GetHeader().Sections[Strings];
+			if (Offset >= Range.Count || Range.Stride != sizeof(ANSICHAR)) return FString();
+
+			const ANSICHAR* Start = reinterpret_cast<const ANSICHAR*>(Bytes.GetData() + Range.Offset + Offset);
+			const int32 MaxLength = static_cast<int32>(Range.Count - Offset);
+			const int32 Length = FCStringAnsi::Strnlen(Start, MaxLength);
+			if (Length == MaxLength) return FString();
+
+			const FUTF8ToTCHAR Converted(Start, Length);
+			return FString(Converted.Length(), Converted.Get());
+		}
+
+	private:
+		//Declared before the region, which has to be unmapped first
+		TUniquePtr<IMappedFileHandle> Handle;
+		TUniquePtr<IMappedFileRegion> Region;
+		TArray<uint8> Loaded;
+		TConstArrayView<uint8> Bytes;
+	};
+}
+
+using namespace OryxSnapshot;
+
+//Everything one snapshot holds, captured on the game thread and written out on a worker
+struct FOryxSnapshotBuffers
+{
+	TArray<FShipRecord> Ships;
+	TArray<FPawnRecord> Pawns;
+	TArray<FGunRecord> Guns;
+	TArray<FPropRecord> Props;
+	TArray<FCargoRecord> Cargo;
+	TArray<float> CargoFloats;
+	TArray<ANSICHAR> Strings;
+	TArray<uint64> RetiredProps;
+};
+
+//Same for the same object in PIE and standalone, and across runs, as long as the map keeps it
+static uint64 StableId(const UObject* Object)
+{
+	if (!Object) return 0;
+
+	const FString Path = UWorld::RemovePIEPrefix(Object->GetPathName());
+	return CityHash64(reinterpret_cast<const char*>(*Path), Path.Len() * sizeof(TCHAR));
+}
+
+static void CaptureBody(const UPrimitiveComponent* Component, const FVector& Origin, FBodyRecord& Out)
+{
+	const FVector Location = Component->GetComponentLocation() + Origin;
+	const FQuat Rotation = Component->GetComponentQuat();
+	const bool bSimulating = Component->IsSimulatingPhysics();
+	const FVector Linear = bSimulating ? Component->GetPhysicsLinearVelocity() : FVector::ZeroVector;
+	const FVector Angular = bSimulating ? Component->GetPhysicsAngularVelocityInDegrees() : FVector::ZeroVector;
+
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		Out.Location[Axis] = Location[Axis];
+		Out.LinearVelocity[Axis] = Linear[Axis];
+		Out.AngularVelocity[Axis] = Angular[Axis];
+	}
+	Out.Rotation[0] = Rotation.X;
+	Out.Rotation[1] = Rotation.Y;
+	Out.Rotation[2] = Rotation.Z;
+	Out.Rotation[3] = Rotation.W;
+}
+
+static void ApplyBody(UPrimitiveComponent* Component, const FVector& Origin, const FBodyRecord& Body)
+{
+	const FVector Location = FVector(Body.Location[0], Body.Location[1], Body.Location[2]) - Origin;
+	const FQuat Rotation = FQuat(Body.Rotation[0], Body.Rotation[1], Body.Rotation[2], Body.Rotation[3]).GetNormalized();
+	Component->SetWorldLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+
+	if (!Component->IsSimulatingPhysics()) return;
+
+	const FVector Linear(Body.LinearVelocity[0], Body.LinearVelocity[1], Body.LinearVelocity[2]);
+	const FVector Angular(Body.AngularVelocity[0], Body.AngularVelocity[1], Body.AngularVelocity[2]);
+	Component->SetPhysicsLinearVelocity(Linear);
+	Component->SetPhysicsAngularVelocityInDegrees(Angular);
+
+	//A pile at rest when saved loads at rest instead of settling again
+	if (Linear.IsNearlyZero() && Angular.IsNearlyZero())
+		Component->PutRigidBodyToSleep();
+	else
+		Component->WakeRigidBody();
+}
+
+template<typename T>
+static void CopySection(TArray<uint8>& Bytes, const FSection& Range, const TArray<T>& Records)
+{
+	if (Records.Num() > 0) FMemory::Memcpy(Bytes.GetData() + Range.Offset, Records.GetData(), Records.Num() * sizeof(T));
+}
+
+static bool WriteSnapshot(const FString& Path, FHeader Header, const FOryxSnapshotBuffers& Buffers)
+{
+	uint64 Offset = Align(sizeof(FHeader), SectionAlignment);
+	auto Layout = [&Header, &Offset](ESection Section, int32 Count, uint32 Stride)
+		{
+			Header.Sections[Section] = { Offset, static_cast<uint32>(Count), Stride };
+			Offset = Align(Offset + uint64(Count) * Stride, SectionAlignment);
+		};
+
+	Layout(Ships, Buffers.Ships.Num(), sizeof(FShipRecord));
+	Layout(Pawns, Buffers.Pawns.Num(), sizeof(FPawnRecord));
+	Layout(Guns, Buffers.Guns.Num(), sizeof(FGunRecord));
+	Layout(Props, Buffers.Props.Num(), sizeof(FPropRecord));
+	Layout(Cargo, Buffers.Cargo.Num(), sizeof(FCargoRecord));
+	Layout(CargoFloats, Buffers.CargoFloats.Num(), sizeof(float));
+	Layout(Strings, Buffers.Strings.Num(), sizeof(ANSICHAR));
+	Layout(RetiredProps, Buffers.RetiredProps.Num(), sizeof(uint64));
+
+	TArray<uint8> Bytes;
+	Bytes.SetNumZeroed(static_cast<int32>(Offset));
+	FMemory::Memcpy(Bytes.GetData(), &Header, sizeof(FHeader));
+	CopySection(Bytes, Header.Sections[Ships], Buffers.Ships);
+	CopySection(Bytes, Header.Sections[Pawns], Buffers.Pawns);
+	CopySection(Bytes, Header.Sections[Guns], Buffers.Guns);
+	CopySection(Bytes, Header.Sections[Props], Buffers.Props);
+	CopySection(Bytes, Header.Sections[Cargo], Buffers.Cargo);
+	CopySection(Bytes, Header.Sections[CargoFloats], Buffers.CargoFloats);
+	CopySection(Bytes, Header.Sections[Strings], Buffers.Strings);
+	CopySection(Bytes, Header.Sections[RetiredProps], Buffers.RetiredProps);
+
+	//Written aside and moved over, so a crash mid write leaves the previous snapshot intact
+	const FString TempPath = Path + TEXT(".tmp");
+	return FFileHelper::SaveArrayToFile(Bytes, *TempPath) && IFileManager::Get().Move(*Path, *TempPath, true);
+}
+
+bool UOryxSaveSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UOryxSaveSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UOryxSaveSubsystem, STATGROUP_Tickables);
+}
+
+FString UOryxSaveSubsystem::GetSnapshotPath(const FString& Slot, bool bDelta)
+{
+	return FPaths::ProjectSavedDir() / TEXT("Snapshots") / Slot + (bDelta ? TEXT(".oryxdelta") : TEXT(".oryxsnap"));
+}
+
+void UOryxSaveSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	bSupported = InWorld.GetNetMode() != NM_Client;
+	if (!bSupported) return;
+
+	for (const ULevel* Level : InWorld.GetLevels())
+		GatherProps(Level);
+
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UOryxSaveSubsystem::OnLevelAdded);
+}
+
+void UOryxSaveSubsystem::Deinitialize()
+{
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+
+	//Let a snapshot being written reach disk
+	WriteTask.Wait();
+
+	Super::Deinitialize();
+}
+
+void UOryxSaveSubsystem::OnLevelAdded(ULevel* Level, UWorld* InWorld)
+{
+	if (InWorld != GetWorld()) return;
+
+	//Streamed out props are gathered again with their level, retired ones stay so saves keep them out of the world
+	Props.RemoveAllSwap([](const FProp& Prop) { return !Prop.Component.IsValid() && !IsRetired(Prop); });
+	GatherProps(Level);
+}
+
+bool UOryxSaveSubsystem::IsRetired(const FProp& Prop)
+{
+	const ULevel* Level = Prop.Level.Get();
+	return !Prop.Component.IsValid() && Level && Level->bIsVisible;
+}
+
+void UOryxSaveSubsystem::GatherProps(const ULevel* Level)
+{
+	if (!Level) return;
+	const FVector Origin(GetWorld()->OriginLocation);
+
+	for (AActor* Actor : Level->Actors)
+	{
+		//Pawns are saved as pawns, not props
+		if (!Actor || Actor->IsA<APawn>()) continue;
+
+		TInlineComponentArray<UPrimitiveComponent*> Components(Actor);
+		for (UPrimitiveComponent* Component : Components)
+		{
+			if (!Component->IsSimulatingPhysics()) continue;
+
+			FProp& Prop = Props.AddDefaulted_GetRef();
+			Prop.Component = Component;
+			Prop.Level = Level;
+			Prop.Id = StableId(Component);
+			Prop.Location = Component->GetComponentLocation() + Origin;
+			Prop.Rotation = Component->GetComponentQuat();
+		}
+	}
+}
+
+void UOryxSaveSubsystem::Tick(float DeltaTime)
+{
+	if (!bSupported || AutosaveInterval <= 0.f) return;
+
+	TimeSinceAutosave += DeltaTime;
+	if (TimeSinceAutosave < AutosaveInterval || !WriteTask.IsCompleted()) return;
+	TimeSinceAutosave = 0.f;
+
+	const bool bDelta = AutosavesSinceFull < DeltasPerFull && Base.IsValid() && BaseSlot == AutosaveSlot;
+	Save(AutosaveSlot, bDelta);
+	AutosavesSinceFull = bDelta ? AutosavesSinceFull + 1 : 0;
+}
+
+bool UOryxSaveSubsystem::Save(const FString& Slot, bool bDelta)
+{
+	if (!bSupported) return false;
+
+	const double CaptureStart = FPlatformTime::Seconds();
+
+	UWorld* World = GetWorld();
+	bDelta = bDelta && Base.IsValid() && BaseSlot == Slot;
+
+	TSharedRef<FOryxSnapshotBuffers> Buffers = MakeShared<FOryxSnapshotBuffers>();
+	Capture(bDelta, *Buffers);
+
+	FHeader Header;
+	Header.Kind = bDelta ? EKind::Delta : EKind::Full;
+	Header.SnapshotId = FPlatformTime::Cycles64() ^ (uint64(FPlatformProcess::GetCurrentProcessId()) << 40);
+	Header.BaseId = bDelta ? BaseId : 0;
+	Header.MapId = StableId(World->GetOutermost());
+	Header.GameTime = World->GetTimeSeconds();
+
+	if (!bDelta)
+	{
+		Base = Buffers;
+		BaseId = Header.SnapshotId;
+		BaseSlot = Slot;
+		BasePropIndex.Reset();
+		for (int32 Index = 0; Index < Buffers->Props.Num(); ++Index)
+			BasePropIndex.Add(Buffers->Props[Index].Id, Index);
+	}
+
+	const double CaptureMs = (FPlatformTime::Seconds() - CaptureStart) * 1000.0;
+	UE_LOG(LogOryx, Log, TEXT("Save: %s %s captured in %.2f ms (%d ships, %d cargo, %d pawns, %d of %d props, %d retired)"),
+		*Slot, bDelta ? TEXT("delta") : TEXT("snapshot"), CaptureMs, Buffers->Ships.Num(), Buffers->Cargo.Num(), Buffers->Pawns.Num(),
+		Buffers->Props.Num(), Props.Num(), Buffers->RetiredProps.Num());
+
+	//One write at a time without the game thread waiting: a save straight after another is queued behind it, so
+	//files still reach disk in the order they were captured
+	WriteTask = UE::Tasks::Launch(UE_SOURCE_LOCATION,
+		[Header, Buffers, Path = GetSnapshotPath(Slot, bDelta), StaleDeltaPath = bDelta ? FString() : GetSnapshotPath(Slot, true)]()
+		{
+			const double WriteStart = FPlatformTime::Seconds();
+			if (!WriteSnapshot(Path, Header, *Buffers))
+			{
+				UE_LOG(LogOryx, Warning, TEXT("Save: failed to write %s"), *Path);
+				return;
+			}
+
+			//The old delta belongs to the snapshot just replaced, loading would ignore it anyway
+			if (!StaleDeltaPath.IsEmpty()) IFileManager::Get().Delete(*StaleDeltaPath, false, false, true);
+
+			UE_LOG(LogOryx, Log, TEXT("Save: wrote %s in %.2f ms"), *Path, (FPlatformTime::Seconds() - WriteStart) * 1000.0);
+		},
+		UE::Tasks::Prerequisites(WriteTask));
+
+	return true;
+}
+
+void UOryxSaveSubsystem::Capture(bool bDelta, FOryxSnapshotBuffers& Buffers) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_OryxSaveCapture);
+
+	UWorld* World = GetWorld();
+	const FVector Origin(World->OriginLocation);
+
+	//Each path is written once however many records use it
+	TMap<FString, uint32> StringOffsets;
+	Buffers.Strings.Add('\0');
+	auto AddString = [&Buffers, &StringOffsets](const FString& String) -> uint32
+		{
+			if (String.IsEmpty()) return 0;
+			if (const uint32* Existing = StringOffsets.Find(String)) return *Existing;
+
+			const uint32 Offset = Buffers.Strings.Num();
+			const FTCHARToUTF8 Utf8(*String);
+			Buffers.Strings.Append(reinterpret_cast<const ANSICHAR*>(Utf8.Get()), Utf8.Length());
+			Buffers.Strings.Add('\0');
+			StringOffsets.Add(String, Offset);
+			return Offset;
+		};
+
+	//Ships, their cargo, pawns and guns are few and always saved whole
+	for (TActorIterator<ASpaceshipPawn> It(World); It; ++It)
+	{
+		const UPrimitiveComponent* Body = Cast<UPrimitiveComponent>(It->GetRootComponent());
+		if (!Body) continue;
+
+		FShipRecord& Record = Buffers.Ships.AddZeroed_GetRef();
+		Record.Id = StableId(*It);
+		Record.PadId = StableId(It->GetTargetLandingPad());
+		Record.LandingStage = static_cast<uint8>(It->GetLandingStage());
+		CaptureBody(Body, Origin, Record.Body);
+
+		const UShipCargoHoldComponent* Hold = It->FindComponentByClass<UShipCargoHoldComponent>();
+		if (!Hold) continue;
+
+		for (const FShipCargoItem& Item : Hold->GetItems())
+		{
+			if (!Item.Mesh) continue;
+
+			FString MaterialPaths;
+			for (int32 Index = 0; Index < Item.Materials.Num(); ++Index)
+			{
+				if (Index > 0) MaterialPaths += TEXT(";");
+				if (Item.Materials[Index]) MaterialPaths += Item.Materials[Index]->GetPathName();
+			}
+
+			FCargoRecord& Stowed = Buffers.Cargo.AddZeroed_GetRef();
+			Stowed.ShipId = Record.Id;
+			Stowed.MeshPath = AddString(Item.Mesh->GetPathName());
+			Stowed.MaterialPaths = AddString(MaterialPaths);
+			Stowed.FirstFloat = Buffers.CargoFloats.Num();
+			Stowed.NumFloats = Item.CustomData.Num();
+			Stowed.Scale[0] = Item.Scale.X;
+			Stowed.Scale[1] = Item.Scale.Y;
+			Stowed.Scale[2] = Item.Scale.Z;
+			Stowed.MassKg = Item.MassKg;
+			Buffers.CargoFloats.Append(Item.CustomData);
+		}
+	}
+
+	for (TActorIterator<APlayerPawnController> It(World); It; ++It)
+	{
+		const UPrimitiveComponent* Body = Cast<UPrimitiveComponent>(It->GetRootComponent());
+		if (!Body) continue;
+
+		FPawnRecord& Record = Buffers.Pawns.AddZeroed_GetRef();
+		Record.Id = StableId(*It);
+		Record.CameraPitch = It->GetCameraPitch();
+		Record.HorizontalVelocity[0] = It->GetHorizontalVelocity().X;
+		Record.HorizontalVelocity[1] = It->GetHorizontalVelocity().Y;
+		CaptureBody(Body, Origin, Record.Body);
+	}
+
+	for (TActorIterator<AGravityGun> It(World); It; ++It)
+	{
+		if (!It->GetOwner()) continue;
+
+		FGunRecord& Record = Buffers.Guns.AddZeroed_GetRef();
+		Record.OwnerId = StableId(It->GetOwner());
+		Record.HeldId = StableId(It->GetHeldComponent());
+	}
+
+	//A full snapshot holds every prop away from where the map placed it, a delta every prop that changed since
+	const double RotateToleranceRad = FMath::DegreesToRadians(RotateTolerance);
+	auto Differs = [this, RotateToleranceRad](const FVector& LocationA, const FQuat& RotationA, const FVector& LocationB, const FQuat& RotationB)
+		{
+			return FVector::DistSquared(LocationA, LocationB) > FMath::Square(MoveTolerance) || RotationA.AngularDistance(RotationB) > RotateToleranceRad;
+		};
+
+	for (const FProp& Prop : Props)
+	{
+		const UPrimitiveComponent* Component = Prop.Component.Get();
+		if (!Component)
+		{
+			//Whole in deltas too, like ships
+			if (IsRetired(Prop)) Buffers.RetiredProps.Add(Prop.Id);
+			continue;
+		}
+
+		const FVector Location = Component->GetComponentLocation() + Origin;
+		const FQuat Rotation = Component->GetComponentQuat();
+
+		const int32* BaseIndex = bDelta ? BasePropIndex.Find(Prop.Id) : nullptr;
+		if (BaseIndex)
+		{
+			const FBodyRecord& Saved = Base->Props[*BaseIndex].Body;
+			const FVector SavedLocation(Saved.Location[0], Saved.Location[1], Saved.Location[2]);
+			const FQuat SavedRotation(Saved.Rotation[0], Saved.Rotation[1], Saved.Rotation[2], Saved.Rotation[3]);
+			if (!Differs(Location, Rotation, SavedLocation, SavedRotation)) continue;
+		}
+		else if (!Differs(Location, Rotation, Prop.Location, Prop.Rotation))
+		{
+			continue;
+		}
+
+		FPropRecord& Record = Buffers.Props.AddZeroed_GetRef();
+		Record.Id = Prop.Id;
+		CaptureBody(Component, Origin, Record.Body);
+	}
+}
+
+void UOryxSaveSubsystem::RunBench(int32 NumProps)
+{
+	UWorld* World = GetWorld();
+	UStaticMesh* Cube = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	if (!bSupported || !Cube || NumProps <= 0) return;
+
+	//Spread out high above the map so they don't touch anything, and registered away from where they were "placed"
+	//so every one of them counts as moved and is captured
+	const int32 Side = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(NumProps)));
+	const FVector Origin(World->OriginLocation);
+	const int32 FirstBenchProp = Props.Num();
+	TArray<AStaticMeshActor*> Spawned;
+	Spawned.Reserve(NumProps);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	for (int32 Index = 0; Index < NumProps; ++Index)
+	{
+		const FVector Location(Index % Side * 200.0, Index / Side * 200.0, 500000.0);
+		AStaticMeshActor* Actor = World->SpawnActor<AStaticMeshActor>(AStaticMeshActor::StaticClass(), FTransform(Location), SpawnParams);
+		if (!Actor) continue;
+
+		Actor->SetMobility(EComponentMobility::Movable);
+		UStaticMeshComponent* Body = Actor->GetStaticMeshComponent();
+		Body->SetStaticMesh(Cube);
+		Body->SetCollisionProfileName(TEXT("OryxProp"));
+		Body->SetEnableGravity(false);
+		Body->SetSimulatePhysics(true);
+		Spawned.Add(Actor);
+
+		FProp& Prop = Props.AddDefaulted_GetRef();
+		Prop.Component = Body;
+		Prop.Id = StableId(Body);
+		Prop.Location = Location + Origin + FVector(0.0, 0.0, 100.0);
+	}
+
+	constexpr int32 Runs = 5;
+	double BestMs = TNumericLimits<double>::Max();
+	double TotalMs = 0.0;
+	int32 NumCaptured = 0;
+	for (int32 Run = 0; Run < Runs; ++Run)
+	{
+		FOryxSnapshotBuffers Buffers;
+		const double StartTime = FPlatformTime::Seconds();
+		Capture(false, Buffers);
+		const double ElapsedMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+		BestMs = FMath::Min(BestMs, ElapsedMs);
+		TotalMs += ElapsedMs;
+		NumCaptured = Buffers.Props.Num();
+	}
+
+	UE_LOG(LogOryx, Display, TEXT("Save bench: %d props (%d captured), full capture %.2f ms best, %.2f ms average, %.3f us per prop"),
+		Spawned.Num(), NumCaptured, BestMs, TotalMs / Runs, BestMs * 1000.0 / FMath::Max(NumCaptured, 1));
+
+	Props.SetNum(FirstBenchProp);
+	for (AStaticMeshActor* Actor : Spawned)
+		Actor->Destroy();
+}
+
+bool UOryxSaveSubsystem::Load(const FString& Slot)
+{
+	if (!bSupported) return false;
+
+	//Loading reads the files back, a snapshot still being written has to reach disk first
+	WriteTask.Wait();
+
+	SCOPE_CYCLE_COUNTER(STAT_OryxSaveLoad);
+	const double LoadStart = FPlatformTime::Seconds();
+
+	UWorld* World = GetWorld();
+	const uint64 MapId = StableId(World->GetOutermost());
+
+	FReader Full;
+	if (!Full.Open(GetSnapshotPath(Slot, false)) || Full.GetHeader().Kind != EKind::Full)
+	{
+		UE_LOG(LogOryx, Warning, TEXT("Load: no valid snapshot in slot %s"), *Slot);
+		return false;
+	}
+	if (Full.GetHeader().MapId != MapId)
+	{
+		UE_LOG(LogOryx, Warning, TEXT("Load: slot %s was saved on another map"), *Slot);
+		return false;
+	}
+
+	FReader Delta;
+	const bool bHasDelta = Delta.Open(GetSnapshotPath(Slot, true)) && Delta.GetHeader().Kind == EKind::Delta &&
+		Delta.GetHeader().BaseId == Full.GetHeader().SnapshotId && Delta.GetHeader().MapId == MapId;
+
+	//Ships, pawns and guns are whole in both, the delta's are newer
+	const FReader& Latest = bHasDelta ? Delta : Full;
+	const FVector Origin(World->OriginLocation);
+	int32 NumMissing = 0;
+
+	TMap<uint64, int32> PropLookup;
+	PropLookup.Reserve(Props.Num());
+	for (int32 Index = 0; Index < Props.Num(); ++Index)
+	{
+		if (Props[Index].Component.IsValid()) PropLookup.Add(Props[Index].Id, Index);
+	}
+
+	//Props stowed or broken when the snapshot was taken leave the world again before anything is moved
+	TBitArray<> Restored(false, Props.Num());
+	for (int32 Index = 0; Index < Latest.Num(RetiredProps); ++Index)
+	{
+		const int32* PropIndex = PropLookup.Find(Latest.Get<uint64>(RetiredProps, Index));
+		if (!PropIndex) continue;
+
+		Restored[*PropIndex] = true;
+		UOryxPropPool::Retire(Props[*PropIndex].Component.Get());
+	}
+
+	//Delta first, so a prop in both only moves once and ends up where the delta has it
+	auto ApplyProps = [&](const FReader& Reader)
+		{
+			for (int32 Index = 0; Index < Reader.Num(OryxSnapshot::Props); ++Index)
+			{
+				const FPropRecord& Record = Reader.Get<FPropRecord>(OryxSnapshot::Props, Index);
+				const int32* PropIndex = PropLookup.Find(Record.Id);
+				if (!PropIndex)
+				{
+					++NumMissing;
+					continue;
+				}
+				if (Restored[*PropIndex]) continue;
+
+				Restored[*PropIndex] = true;
+				ApplyBody(Props[*PropIndex].Component.Get(), Origin, Record.Body);
+			}
+		};
+
+	if (bHasDelta) ApplyProps(Delta);
+	ApplyProps(Full);
+
+	//Props the snapshot left out were where the map placed them
+	for (int32 Index = 0; Index < Props.Num(); ++Index)
+	{
+		UPrimitiveComponent* Component = Props[Index].Component.Get();
+		if (!Component || Restored[Index]) continue;
+
+		const FVector Location = Props[Index].Location - Origin;
+		if (Component->GetComponentLocation().Equals(Location, MoveTolerance) && Component->GetComponentQuat().Equals(Props[Index].Rotation)) continue;
+
+		Component->SetWorldLocationAndRotation(Location, Props[Index].Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+		Component->SetPhysicsLinearVelocity(FVector::ZeroVector);
+		Component->SetPhysicsAngularVelocityInDegrees(FVector::ZeroVector);
+		Component->PutRigidBodyToSleep();
+	}
+
+	TMap<uint64, ASpaceshipPawn*> ShipLookup;
+	for (TActorIterator<ASpaceshipPawn> It(World); It; ++It)
+		ShipLookup.Add(StableId(*It), *It);
+
+	TMap<uint64, ALandingPad*> PadLookup;
+	for (TActorIterator<ALandingPad> It(World); It; ++It)
+		PadLookup.Add(StableId(*It), *It);
+
+	//Every pad is given up first, so one passing between ships isn't refused because the other still holds it
+	if (UOryxTrafficControl* Traffic = World->GetSubsystem<UOryxTrafficControl>())
+	{
+		for (int32 Index = 0; Index < Latest.Num(Ships); ++Index)
+		{
+			if (ASpaceshipPawn* const* Ship = ShipLookup.Find(Latest.Get<FShipRecord>(Ships, Index).Id)) Traffic->ReleasePad(*Ship);
+		}
+	}
+
+	//Every saved ship's hold is replaced, cargo whose mesh no longer exists is dropped
+	TMap<uint64, TArray<FShipCargoItem>> CargoByShip;
+	for (int32 Index = 0; Index < Latest.Num(Cargo); ++Index)
+	{
+		const FCargoRecord& Record = Latest.Get<FCargoRecord>(Cargo, Index);
+		const FString MeshPath = Latest.GetString(Record.MeshPath);
+		UStaticMesh* Mesh = MeshPath.IsEmpty() ? nullptr : LoadObject<UStaticMesh>(nullptr, *MeshPath);
+		if (!Mesh)
+		{
+			++NumMissing;
+			continue;
+		}
+
+		FShipCargoItem Item;
+		Item.Mesh = Mesh;
+		Item.Scale = FVector3f(Record.Scale[0], Record.Scale[1], Record.Scale[2]);
+		Item.MassKg = Record.MassKg;
+
+		TArray<FString> MaterialPaths;
+		Latest.GetString(Record.MaterialPaths).ParseIntoArray(MaterialPaths, TEXT(";"), false);
+		for (const FString& Path : MaterialPaths)
+			Item.Materials.Add(Path.IsEmpty() ? nullptr : LoadObject<UMaterialInterface>(nullptr, *Path));
+
+		if (uint64(Record.FirstFloat) + Record.NumFloats <= uint64(Latest.Num(CargoFloats)))
+		{
+			for (uint32 Float = 0; Float < Record.NumFloats; ++Float)
+				Item.CustomData.Add(Latest.Get<float>(CargoFloats, Record.FirstFloat + Float));
+		}
+
+		CargoByShip.FindOrAdd(Record.ShipId).Add(MoveTemp(Item));
+	}
+
+	for (int32 Index = 0; Index < Latest.Num(Ships); ++Index)
+	{
+		const FShipRecord& Record = Latest.Get<FShipRecord>(Ships, Index);
+		ASpaceshipPawn* const* Ship = ShipLookup.Find(Record.Id);
+		UPrimitiveComponent* Body = Ship ? Cast<UPrimitiveComponent>((*Ship)->GetRootComponent()) : nullptr;
+		if (!Body)
+		{
+			++NumMissing;
+			continue;
+		}
+
+		//Landing first, it turns physics off or back on and the velocities only apply to a simulating ship
+		ALandingPad* const* Pad = PadLookup.Find(Record.PadId);
+		(*Ship)->RestoreLanding(static_cast<ELandingStage>(Record.LandingStage), Pad ? *Pad : nullptr);
+		ApplyBody(Body, Origin, Record.Body);
+
+		if (UShipCargoHoldComponent* Hold = (*Ship)->FindComponentByClass<UShipCargoHoldComponent>())
+			Hold->RestoreItems(CargoByShip.FindRef(Record.Id));
+	}
+
+	TMap<uint64, APlayerPawnController*> PawnLookup;
+	for (TActorIterator<APlayerPawnController> It(World); It; ++It)
+		PawnLookup.Add(StableId(*It), *It);
+
+	for (int32 Index = 0; Index < Latest.Num(Pawns); ++Index)
+	{
+		const FPawnRecord& Record = Latest.Get<FPawnRecord>(Pawns, Index);
+		APlayerPawnController* const* Pawn = PawnLookup.Find(Record.Id);
+		UPrimitiveComponent* Body = Pawn ? Cast<UPrimitiveComponent>((*Pawn)->GetRootComponent()) : nullptr;
+		if (!Body)
+		{
+			++NumMissing;
+			continue;
+		}
+
+		ApplyBody(Body, Origin, Record.Body);
+		(*Pawn)->RestoreMovement(Record.CameraPitch, FVector2D(Record.HorizontalVelocity[0], Record.HorizontalVelocity[1]));
+	}
+
+	//Guns stream in after their pawn, one that isn't there yet just starts empty
+	TMap<uint64, AGravityGun*> GunLookup;
+	for (TActorIterator<AGravityGun> It(World); It; ++It)
+	{
+		if (It->GetOwner()) GunLookup.Add(StableId(It->GetOwner()), *It);
+	}
+
+	for (int32 Index = 0; Index < Latest.Num(Guns); ++Index)
+	{
+		const FGunRecord& Record = Latest.Get<FGunRecord>(Guns, Index);
+		AGravityGun* const* Gun = GunLookup.Find(Record.OwnerId);
+		if (!Gun) continue;
+
+		const int32* PropIndex = Record.HeldId ? PropLookup.Find(Record.HeldId) : nullptr;
+		(*Gun)->SetHeldComponent(PropIndex ? Props[*PropIndex].Component.Get() : nullptr);
+	}
+
+	//Later deltas are taken against the full snapshot, the delta file pairs with it
+	Base = MakeShared<FOryxSnapshotBuffers>();
+	Base->Props.SetNumUninitialized(Full.Num(OryxSnapshot::Props));
+	BasePropIndex.Reset();
+	for (int32 Index = 0; Index < Base->Props.Num(); ++Index)
+	{
+		Base->Props[Index] = Full.Get<FPropRecord>(OryxSnapshot::Props, Index);
+		BasePropIndex.Add(Base->Props[Index].Id, Index);
+	}
+	BaseId = Full.GetHeader().SnapshotId;
+	BaseSlot = Slot;
+	AutosavesSinceFull = 0;
+
+	UE_LOG(LogOryx, Log, TEXT("Load: %s%s restored in %.2f ms, %d saved object(s) not in this map"),
+		*Slot, bHasDelta ? TEXT(" and its delta") : TEXT(""), (FPlatformTime::Seconds() - LoadStart) * 1000.0, NumMissing);
+	return true;
+}
@@ -0,0 +1,32 @@
+#include "OryxShipAssetSubsystem.h"
+#include "SpaceshipPawn.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+
+void UOryxShipAssetSubsystem::Deinitialize()
+{
+	for (TPair<TWeakObjectPtr<UClass>, TSharedPtr<FStreamableHandle>>& Bundle : ShipBundles)
+	{
+		if (Bundle.Value.IsValid()) Bundle.Value->ReleaseHandle();
+	}
+	ShipBundles.Empty();
+
+	Super::Deinitialize();
+}
+
+TSharedPtr<FStreamableHandle> UOryxShipAssetSubsystem::PreloadShipAssets(TSubclassOf<ASpaceshipPawn> ShipClass)
+{
+	if (!ShipClass) return nullptr;
+	if (TSharedPtr<FStreamableHandle>* Existing = ShipBundles.Find(ShipClass.Get()))
+		return *Existing;
+
+	TArray<FSoftObjectPath> Paths;
+	ASpaceshipPawn::GetShipBundle(ShipClass, Paths);
+
+	TSharedPtr<FStreamableHandle> Handle = Paths.Num() > 0
+		? UAssetManager::GetStreamableManager().RequestAsyncLoad(Paths, FStreamableDelegate(), FStreamableManager::AsyncLoadHighPriority)
+		: nullptr;
+
+	ShipBundles.Add(ShipClass.Get(), Handle);
+	return Handle;
+}
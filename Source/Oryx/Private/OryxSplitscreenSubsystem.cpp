@@ -0,0 +1,239 @@
+#include "OryxSplitscreenSubsystem.h"
+#include "Oryx.h"
+#include "SpaceshipPawn.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "WorldCollision.h"
+
+DECLARE_CYCLE_STAT(TEXT("Splitscreen views and FX"), STAT_OryxSplitscreen, STATGROUP_Oryx);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shared ground traces"), STAT_OryxSharedGroundTraces, STATGROUP_Oryx);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ships with thruster FX"), STAT_OryxThrusterFXShips, STATGROUP_Oryx);
+
+static TAutoConsoleVariable<int32> CVarOryxSplitscreenMode(
+	TEXT("Oryx.Splitscreen.Mode"),
+	1,
+	TEXT("Local multiplayer mode: 0 off, 1 while two or more local players share the screen, 2 always"));
+
+static TAutoConsoleVariable<int32> CVarOryxSplitscreenFXShipsPerView(
+	TEXT("Oryx.Splitscreen.FXShipsPerView"),
+	4,
+	TEXT("Ships each viewport shows thruster FX for in local multiplayer, closest first"));
+
+static FAutoConsoleCommandWithWorldAndArgs GOryxSplitscreenPlayersCommand(
+	TEXT("Oryx.Splitscreen.Players"),
+	TEXT("Oryx.Splitscreen.Players <Count> - add local players until Count (up to 4) share the screen"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+		if (!GameInstance) return;
+
+		const int32 Count = FMath::Clamp(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 2, 1, 4);
+		while (GameInstance->GetNumLocalPlayers() < Count)
+		{
+			FString Error;
+			if (!GameInstance->CreateLocalPlayer(INDEX_NONE, Error, true))
+			{
+				UE_LOG(LogOryx, Warning, TEXT("Splitscreen: can't add a local player: %s"), *Error);
+				break;
+			}
+		}
+		UE_LOG(LogOryx, Display, TEXT("Splitscreen: %d local players"), GameInstance->GetNumLocalPlayers());
+	}));
+
+bool UOryxSplitscreenSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UOryxSplitscreenSubsystem::Deinitialize()
+{
+	if (bActive) ClearThrusterFX();
+	bActive = false;
+
+	Super::Deinitialize();
+}
+
+float UOryxSplitscreenSubsystem::GetViewDistance(const FVector& Location) const
+{
+	double ClosestSq = FMath::Square(static_cast<double>(FXCullDistance));
+	for (const FView& View : Views)
+		ClosestSq = FMath::Min(ClosestSq, FVector::DistSquared(View.Location, Location));
+	return static_cast<float>(FMath::Sqrt(ClosestSq));
+}
+
+bool UOryxSplitscreenSubsystem::QueryGround(const AActor* Pawn, const FVector& Start, const FVector& End, bool& bOutGrounded)
+{
+	if (!bActive || !Pawn) return false;
+
+	FGroundRequest& Request = GroundRequests.AddDefaulted_GetRef();
+	Request.Pawn = Pawn;
+	Request.Start = Start;
+	Request.End = End;
+
+	const bool* Grounded = GroundResults.Find(Pawn);
+	if (!Grounded) return false;
+
+	bOutGrounded = *Grounded;
+	return true;
+}
+
+void UOryxSplitscreenSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_OryxSplitscreen);
+
+	GatherViews();
+
+	const int32 Mode = CVarOryxSplitscreenMode.GetValueOnGameThread();
+	const bool bWasActive = bActive;
+	bActive = Mode >= 2 || (Mode == 1 && Views.Num() > 1);
+
+	//Pawns read last frame's answers during their tick, the batch going out now answers them next frame
+	GroundResults.Reset();
+
+	if (!bActive)
+	{
+		//Answers still out belong to a batch nobody asks about anymore
+		++GroundBatch;
+		GroundRequests.Reset();
+		GroundInFlight.Reset();
+		if (bWasActive) ClearThrusterFX();
+		return;
+	}
+
+	IssueGroundTraces();
+	UpdateThrusterFX();
+}
+
+void UOryxSplitscreenSubsystem::GatherViews()
+{
+	Views.Reset();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* Player = It->Get();
+		if (!Player || !Player->IsLocalController()) continue;
+
+		FView& View = Views.AddDefaulted_GetRef();
+		View.Player = Player;
+		FRotator Rotation;
+		Player->GetPlayerViewPoint(View.Location, Rotation);
+	}
+}
+
+void UOryxSplitscreenSubsystem::IssueGroundTraces()
+{
+	++GroundBatch;
+	GroundInFlight.Reset();
+
+	//Run together on the async trace threads instead of one blocking trace in each pawn's tick
+	const FTraceDelegate Delegate = FTraceDelegate::CreateUObject(this, &UOryxSplitscreenSubsystem::OnGroundTrace, GroundBatch);
+	for (const FGroundRequest& Request : GroundRequests)
+	{
+		const AActor* Pawn = Request.Pawn.Get();
+		if (!Pawn) continue;
+
+		const FCollisionQueryParams Params(SCENE_QUERY_STAT(OryxSharedGround), false, Pawn);
+		GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, Request.Start, Request.End, ECC_OryxWalkable, Params,
+			FCollisionResponseParams::DefaultResponseParam, &Delegate, GroundInFlight.Num());
+		GroundInFlight.Add(Request.Pawn);
+	}
+	GroundRequests.Reset();
+
+	INC_DWORD_STAT_BY(STAT_OryxSharedGroundTraces, GroundInFlight.Num());
+}
+
+void UOryxSplitscreenSubsystem::OnGroundTrace(const FTraceHandle& Handle, FTraceDatum& Datum, uint64 Batch)
+{
+	if (Batch != GroundBatch || !GroundInFlight.IsValidIndex(Datum.UserData)) return;
+
+	GroundResults.Add(GroundInFlight[Datum.UserData], Datum.OutHits.Num() > 0 && Datum.OutHits[0].bBlockingHit);
+}
+
+void UOryxSplitscreenSubsystem::UpdateThrusterFX()
+{
+	const int32 PerView = FMath::Max(CVarOryxSplitscreenFXShipsPerView.GetValueOnGameThread(), 0);
+	const double CullDistanceSq = FMath::Square(static_cast<double>(FXCullDistance));
+
+	TArray<ASpaceshipPawn*> Ships;
+	for (TActorIterator<ASpaceshipPawn> It(GetWorld()); It; ++It)
+		Ships.Add(*It);
+
+	//Each view picks its closest ships, the union of them keeps simulating. Ships out of every view's range are skipped
+	TArray<TArray<ASpaceshipPawn*, TInlineAllocator<8>>, TInlineAllocator<4>> Picked;
+	Picked.SetNum(Views.Num());
+	TSet<ASpaceshipPawn*> Shown;
+	TArray<TPair<double, ASpaceshipPawn*>> InRange;
+
+	Ships.RemoveAllSwap([this](const ASpaceshipPawn* Ship) { return GetViewDistance(Ship->GetActorLocation()) >= FXCullDistance; });
+	for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ++ViewIndex)
+	{
+		InRange.Reset();
+		for (ASpaceshipPawn* Ship : Ships)
+		{
+			const double DistanceSq = FVector::DistSquared(Views[ViewIndex].Location, Ship->GetActorLocation());
+			if (DistanceSq <= CullDistanceSq) InRange.Emplace(DistanceSq, Ship);
+		}
+		InRange.Sort([](const TPair<double, ASpaceshipPawn*>& A, const TPair<double, ASpaceshipPawn*>& B) { return A.Key < B.Key; });
+
+		for (int32 Index = 0; Index < FMath::Min(PerView, InRange.Num()); ++Index)
+		{
+			Picked[ViewIndex].Add(InRange[Index].Value);
+			Shown.Add(InRange[Index].Value);
+		}
+	}
+
+	//Last frame's hiding is undone first, a ship every view picks this frame ends up hidden nowhere
+	UnhideThrusterFX();
+
+	TArray<UPrimitiveComponent*, TInlineAllocator<5>> Effects;
+	for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ++ViewIndex)
+	{
+		APlayerController* Player = Views[ViewIndex].Player.Get();
+		if (!Player) continue;
+
+		TArray<TWeakObjectPtr<UPrimitiveComponent>>& Hidden = HiddenFX.Add(Player);
+		for (ASpaceshipPawn* Ship : Shown)
+		{
+			if (Picked[ViewIndex].Contains(Ship)) continue;
+
+			Ship->GetThrusterFX(Effects);
+			for (UPrimitiveComponent* Effect : Effects)
+			{
+				Player->HiddenPrimitiveComponents.Add(Effect);
+				Hidden.Add(Effect);
+			}
+		}
+	}
+
+	for (TActorIterator<ASpaceshipPawn> It(GetWorld()); It; ++It)
+		It->SetThrusterFXSignificant(Shown.Contains(*It));
+
+	INC_DWORD_STAT_BY(STAT_OryxThrusterFXShips, Shown.Num());
+}
+
+void UOryxSplitscreenSubsystem::UnhideThrusterFX()
+{
+	for (TPair<TWeakObjectPtr<APlayerController>, TArray<TWeakObjectPtr<UPrimitiveComponent>>>& Pair : HiddenFX)
+	{
+		if (APlayerController* Player = Pair.Key.Get())
+		{
+			for (const TWeakObjectPtr<UPrimitiveComponent>& Effect : Pair.Value)
+				Player->HiddenPrimitiveComponents.RemoveSwap(Effect);
+		}
+	}
+	HiddenFX.Reset();
+}
+
+void UOryxSplitscreenSubsystem::ClearThrusterFX()
+{
+	UnhideThrusterFX();
+	for (TActorIterator<ASpaceshipPawn> It(GetWorld()); It; ++It)
+		It->SetThrusterFXSignificant(true);
+}
+
+TStatId UOryxSplitscreenSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UOryxSplitscreenSubsystem, STATGROUP_Tickables);
+}
@@ -0,0 +1,332 @@
+#include "OryxTrafficControl.h"
+#include "Oryx.h"
+#include "LandingPad.h"
+#include "SpaceshipPawn.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Traffic control"), STAT_OryxTrafficControl, STATGROUP_Oryx);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ships waiting for a pad"), STAT_OryxTrafficWaiting, STATGROUP_Oryx);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Free landing pads"), STAT_OryxTrafficFreePads, STATGROUP_Oryx);
+
+static TAutoConsoleVariable<float> CVarOryxTrafficBudgetMs(
+	TEXT("Oryx.Traffic.BudgetMs"),
+	0.5f,
+	TEXT("Game thread milliseconds the pad assignment solver may use each frame, at least one ship is assigned per frame"));
+
+static FAutoConsoleCommand GOryxTrafficBenchCommand(
+	TEXT("Oryx.Traffic.Bench"),
+	TEXT("Oryx.Traffic.Bench [Ships] [Pads] - time one unsliced assignment solve on random costs"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumShips = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 256;
+		const int32 NumPads = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 32;
+		const int32 Rows = FMath::Min(NumShips, NumPads);
+		const int32 Cols = FMath::Max(NumShips, NumPads);
+		if (Rows <= 0) return;
+
+		TArray<float> Costs;
+		Costs.SetNumUninitialized(Rows * Cols);
+		for (float& Cost : Costs) Cost = FMath::FRandRange(0.f, 100000.f);
+
+		FOryxAssignmentSolver Solver;
+		const double StartTime = FPlatformTime::Seconds();
+		Solver.Start(MoveTemp(Costs), Rows, Cols);
+		Solver.Step(TNumericLimits<double>::Max());
+		UE_LOG(LogOryx, Display, TEXT("Traffic bench: %d ships x %d pads assigned in %.3f ms"), NumShips, NumPads, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	}));
+
+#pragma region Assignment Solver
+void FOryxAssignmentSolver::Start(TArray<float>&& InCosts, int32 InRows, int32 InCols)
+{
+	check(InRows <= InCols && InCosts.Num() == InRows * InCols);
+
+	Costs = MoveTemp(InCosts);
+	Rows = InRows;
+	Cols = InCols;
+	NextRow = 1;
+
+	U.Init(0.0, Rows + 1);
+	V.Init(0.0, Cols + 1);
+	RowForCol.Init(0, Cols + 1);
+	Way.Init(0, Cols + 1);
+}
+
+bool FOryxAssignmentSolver::Step(double Deadline)
+{
+	TArray<double> MinReduced;
+	TArray<bool> Used;
+
+	while (NextRow <= Rows)
+	{
+		//Grow the matching by one row along the cheapest augmenting path, adjusting potentials as we go
+		RowForCol[0] = NextRow;
+		int32 Col0 = 0;
+		MinReduced.Init(TNumericLimits<double>::Max(), Cols + 1);
+		Used.Init(false, Cols + 1);
+
+		do
+		{
+			Used[Col0] = true;
+			const int32 Row0 = RowForCol[Col0];
+			double Delta = TNumericLimits<double>::Max();
+			int32 Col1 = 0;
+
+			for (int32 Col = 1; Col <= Cols; ++Col)
+			{
+				if (Used[Col]) continue;
+
+				const double Reduced = Costs[(Row0 - 1) * Cols + (Col - 1)] - U[Row0] - V[Col];
+				if (Reduced < MinReduced[Col])
+				{
+					MinReduced[Col] = Reduced;
+					Way[Col] = Col0;
+				}
+				if (MinReduced[Col] < Delta)
+				{
+					Delta = MinReduced[Col];
+					Col1 = Col;
+				}
+			}
+
+			for (int32 Col = 0; Col <= Cols; ++Col)
+			{
+				if (Used[Col])
+				{
+					U[RowForCol[Col]] += Delta;
+					V[Col] -= Delta;
+				}
+				else
+				{
+					MinReduced[Col] -= Delta;
+				}
+			}
+
+			Col0 = Col1;
+		} while (RowForCol[Col0] != 0);
+
+		//Flip the path
+		do
+		{
+			const int32 Col1 = Way[Col0];
+			RowForCol[Col0] = RowForCol[Col1];
+			Col0 = Col1;
+		} while (Col0 != 0);
+
+		++NextRow;
+		if (FPlatformTime::Seconds() >= Deadline) break;
+	}
+
+	return NextRow > Rows;
+}
+
+void FOryxAssignmentSolver::GetAssignment(TArray<int32>& OutColumnForRow) const
+{
+	OutColumnForRow.Init(INDEX_NONE, Rows);
+	for (int32 Col = 1; Col <= Cols; ++Col)
+	{
+		if (RowForCol[Col] != 0) OutColumnForRow[RowForCol[Col] - 1] = Col - 1;
+	}
+}
+#pragma endregion
+
+bool UOryxTrafficControl::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UOryxTrafficControl::Deinitialize()
+{
+	Pads.Reset();
+	Waiting.Reset();
+	BatchShips.Reset();
+	BatchPads.Reset();
+	Super::Deinitialize();
+}
+
+UOryxTrafficControl::FPadState* UOryxTrafficControl::FindPadState(const ALandingPad* Pad)
+{
+	return Pads.FindByPredicate([Pad](const FPadState& State) { return State.Pad.Get() == Pad; });
+}
+
+const UOryxTrafficControl::FPadState* UOryxTrafficControl::FindPadState(const ALandingPad* Pad) const
+{
+	return Pads.FindByPredicate([Pad](const FPadState& State) { return State.Pad.Get() == Pad; });
+}
+
+void UOryxTrafficControl::RegisterPad(ALandingPad* Pad)
+{
+	if (Pad && !FindPadState(Pad))
+		Pads.AddDefaulted_GetRef().Pad = Pad;
+}
+
+void UOryxTrafficControl::UnregisterPad(ALandingPad* Pad)
+{
+	Pads.RemoveAll([Pad](const FPadState& State) { return State.Pad.Get() == Pad; });
+}
+
+void UOryxTrafficControl::RequestLanding(ASpaceshipPawn* Ship, FOnLandingPadAssigned OnAssigned)
+{
+	if (!Ship) return;
+
+	if (FLandingRequest* Existing = Waiting.FindByPredicate([Ship](const FLandingRequest& Request) { return Request.Ship.Get() == Ship; }))
+	{
+		Existing->OnAssigned = MoveTemp(OnAssigned); //Keeps its place in the queue
+		return;
+	}
+
+	FLandingRequest& Request = Waiting.AddDefaulted_GetRef();
+	Request.Ship = Ship;
+	Request.OnAssigned = MoveTemp(OnAssigned);
+	Request.RequestTime = GetWorld()->GetTimeSeconds();
+}
+
+void UOryxTrafficControl::CancelRequest(const ASpaceshipPawn* Ship)
+{
+	Waiting.RemoveAll([Ship](const FLandingRequest& Request) { return Request.Ship.Get() == Ship; });
+}
+
+bool UOryxTrafficControl::TryReservePad(ALandingPad* Pad, ASpaceshipPawn* Ship)
+{
+	FPadState* State = FindPadState(Pad);
+	if (!State) return true; //Pads outside traffic control are first come first served
+	if (State->ReservedBy.IsValid() && State->ReservedBy.Get() != Ship) return false;
+
+	//A ship only ever holds one pad, and no longer needs to queue
+	ReleasePad(Ship);
+	CancelRequest(Ship);
+
+	State->ReservedBy = Ship;
+	State->ReservedTime = GetWorld()->GetTimeSeconds();
+	return true;
+}
+
+void UOryxTrafficControl::ReleasePad(const ASpaceshipPawn* Ship)
+{
+	for (FPadState& State : Pads)
+	{
+		if (State.ReservedBy.Get() == Ship) State.ReservedBy.Reset();
+	}
+}
+
+bool UOryxTrafficControl::IsPadAvailableFor(const ALandingPad* Pad, const ASpaceshipPawn* Ship) const
+{
+	const FPadState* State = FindPadState(Pad);
+	return !State || !State->ReservedBy.IsValid() || State->ReservedBy.Get() == Ship;
+}
+
+void UOryxTrafficControl::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_OryxTrafficControl);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	//Take pads back from ships that went away, or that held one too long without ever landing
+	Pads.RemoveAll([](const FPadState& State) { return !State.Pad.IsValid(); });
+	int32 NumFreePads = 0;
+	for (FPadState& State : Pads)
+	{
+		const ASpaceshipPawn* Holder = State.ReservedBy.Get();
+		if (Holder && Holder->GetLandingStage() == ELandingStage::None && Now - State.ReservedTime > ReservationTimeout)
+		{
+			UE_LOG(LogOryx, Log, TEXT("Traffic: %s never landed on %s, reservation dropped"), *Holder->GetName(), *GetNameSafe(State.Pad.Get()));
+			Holder = nullptr;
+		}
+		if (!Holder) State.ReservedBy.Reset();
+		if (!State.ReservedBy.IsValid()) ++NumFreePads;
+	}
+
+	Waiting.RemoveAll([](const FLandingRequest& Request) { return !Request.Ship.IsValid(); });
+
+	if (!Solver.IsRunning() && Waiting.Num() > 0 && NumFreePads > 0 && Now >= NextBatchTime)
+	{
+		NextBatchTime = Now + AssignmentInterval;
+		StartBatch();
+	}
+
+	if (Solver.IsRunning())
+	{
+		const double Deadline = FPlatformTime::Seconds() + CVarOryxTrafficBudgetMs.GetValueOnGameThread() / 1000.0;
+		if (Solver.Step(Deadline)) ApplyBatch();
+	}
+
+	SET_DWORD_STAT(STAT_OryxTrafficWaiting, Waiting.Num());
+	SET_DWORD_STAT(STAT_OryxTrafficFreePads, NumFreePads);
+}
+
+void UOryxTrafficControl::StartBatch()
+{
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	BatchPads.Reset();
+	for (const FPadState& State : Pads)
+	{
+		if (!State.ReservedBy.IsValid() && BatchPads.Num() < MaxBatchSize) BatchPads.Add(State.Pad);
+	}
+
+	//Longest waiting ships first so a full queue still drains in order
+	Waiting.StableSort([](const FLandingRequest& A, const FLandingRequest& B) { return A.RequestTime < B.RequestTime; });
+
+	BatchShips.Reset();
+	TArray<double> WaitTimes;
+	for (int32 Index = 0; Index < Waiting.Num() && BatchShips.Num() < MaxBatchSize; ++Index)
+	{
+		BatchShips.Add(Waiting[Index].Ship);
+		WaitTimes.Add(Now - Waiting[Index].RequestTime);
+	}
+
+	if (BatchShips.Num() == 0 || BatchPads.Num() == 0) return;
+
+	//The solver wants rows <= columns, so the smaller side becomes the rows
+	bBatchShipsAreRows = BatchShips.Num() <= BatchPads.Num();
+	const int32 Rows = bBatchShipsAreRows ? BatchShips.Num() : BatchPads.Num();
+	const int32 Cols = bBatchShipsAreRows ? BatchPads.Num() : BatchShips.Num();
+
+	TArray<float> Costs;
+	Costs.SetNumUninitialized(Rows * Cols);
+	for (int32 ShipIndex = 0; ShipIndex < BatchShips.Num(); ++ShipIndex)
+	{
+		const FVector ShipLocation = BatchShips[ShipIndex]->GetActorLocation();
+		for (int32 PadIndex = 0; PadIndex < BatchPads.Num(); ++PadIndex)
+		{
+			const float Cost = FVector::Dist(ShipLocation, BatchPads[PadIndex]->GetApproachPoint()) - WaitCostPerSecond * WaitTimes[ShipIndex];
+			Costs[bBatchShipsAreRows ? ShipIndex * Cols + PadIndex : PadIndex * Cols + ShipIndex] = Cost;
+		}
+	}
+
+	Solver.Start(MoveTemp(Costs), Rows, Cols);
+}
+
+void UOryxTrafficControl::ApplyBatch()
+{
+	TArray<int32> ColumnForRow;
+	Solver.GetAssignment(ColumnForRow);
+
+	for (int32 Row = 0; Row < ColumnForRow.Num(); ++Row)
+	{
+		if (ColumnForRow[Row] == INDEX_NONE) continue;
+
+		ASpaceshipPawn* Ship = BatchShips[bBatchShipsAreRows ? Row : ColumnForRow[Row]].Get();
+		ALandingPad* Pad = BatchPads[bBatchShipsAreRows ? ColumnForRow[Row] : Row].Get();
+		FPadState* State = FindPadState(Pad);
+
+		//Things may have moved on while the batch was solving
+		const int32 RequestIndex = Waiting.IndexOfByPredicate([Ship](const FLandingRequest& Request) { return Request.Ship.Get() == Ship; });
+		if (!Ship || !State || State->ReservedBy.IsValid() || RequestIndex == INDEX_NONE) continue;
+
+		FOnLandingPadAssigned OnAssigned = MoveTemp(Waiting[RequestIndex].OnAssigned);
+		Waiting.RemoveAt(RequestIndex);
+
+		State->ReservedBy = Ship;
+		State->ReservedTime = GetWorld()->GetTimeSeconds();
+		OnAssigned.ExecuteIfBound(Pad);
+	}
+
+	BatchShips.Reset();
+	BatchPads.Reset();
+}
+
+TStatId UOryxTrafficControl::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UOryxTrafficControl, STATGROUP_Tickables);
+}
@@ -1,4 +1,5 @@
 #include "PlayerPawnController.h"
+#include "Oryx.h"
 // Components
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
@@ -11,12 +12,16 @@
 #include "GameFramework/PlayerController.h"
 #include "GameFramework/Actor.h"
 #include "Engine/World.h"
-#include "Engine/EngineTypes.h" //For ECC_Pawn
+#include "Engine/EngineTypes.h" //For UEngineTypes::ConvertToObjectType
 #include "Kismet/KismetSystemLibrary.h"
 #include "Kismet/GameplayStatics.h"
+#include "Net/UnrealNetwork.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
 // Custom classes
 #include "GravityGun.h"
 #include "SpaceshipPawn.h"
+#include "OryxSplitscreenSubsystem.h"
 
 APlayerPawnController::APlayerPawnController()
 {
@@ -29,7 +34,7 @@ APlayerPawnController::APlayerPawnController()
     Capsule->SetEnableGravity(false); //Disabling gravity, handling it manually
     Capsule->SetLinearDamping(5.f); //Damping horizontal velocity for smooth movement
     Capsule->SetAngularDamping(1000000.f); //Prevent unwanted rotations
-    Capsule->SetCollisionProfileName("PhysicsActor");
+    Capsule->SetCollisionProfileName("OryxPawn"); //Blocks like PhysicsActor, ignored by grab traces
     RootComponent = Capsule;
 
     //Setup mesh
@@ -45,34 +50,74 @@ APlayerPawnController::APlayerPawnController()
     Camera->bUsePawnControlRotation = false; //Manually handling camera rotation
 }
 
+void APlayerPawnController::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+    Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+    DOREPLIFETIME(APlayerPawnController, GravityGun);
+}
+
+void APlayerPawnController::NotifyControllerChanged()
+{
+    Super::NotifyControllerChanged();
+
+    //Runs on the owning client too (PossessedBy is server only), only a local player has input to map
+    const APlayerController* PC = Cast<APlayerController>(GetController());
+    if (!PC || !PC->IsLocalController()) return;
+
+    if (UEnhancedInputLocalPlayerSubsystem* Subsystem = ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(PC->GetLocalPlayer()))
+    {
+        if (MappingContext)
+            Subsystem->AddMappingContext(MappingContext, 0);
+    }
+}
+
 void APlayerPawnController::PossessedBy(AController* NewController)
 {
     Super::PossessedBy(NewController);
 
-    //Add input mapping context
-    if (APlayerController* PC = Cast<APlayerController>(GetController()))
+    //Spawning gravity gun, straight away if the class is already resident
+    if (GravityGunClass.IsNull() || GravityGun) return;
+
+    if (GravityGunClass.Get())
     {
-        if (UEnhancedInputLocalPlayerSubsystem* Subsystem = ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(PC->GetLocalPlayer()))
-        {
-            if (MappingContext)
-                Subsystem->AddMappingContext(MappingContext, 0);
-        }
+        SpawnGravityGun();
     }
-    //Spawning gravity gun
-    if (GravityGunClass)
+    else
     {
-        FActorSpawnParameters SpawnParams;
-        SpawnParams.Owner = this;
-        SpawnParams.Instigator = GetInstigator();
-        GravityGun = GetWorld()->SpawnActor<AGravityGun>(GravityGunClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParams);
-        if (GravityGun)
-            GravityGun->AttachToComponent(Camera, FAttachmentTransformRules::KeepRelativeTransform);
+        GravityGunClassHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(GravityGunClass.ToSoftObjectPath(),
+            FStreamableDelegate::CreateUObject(this, &APlayerPawnController::SpawnGravityGun));
     }
 }
 
+void APlayerPawnController::RestoreMovement(float InCameraPitch, const FVector2D& InHorizontalVelocity)
+{
+    CameraPitch = FMath::Clamp(InCameraPitch, -85.f, 85.f);
+    Camera->SetRelativeRotation(FRotator(CameraPitch, 0.f, 0.f));
+
+    //Tick rebuilds the capsule's horizontal velocity from this every frame
+    CurrentHorizontalVelocity = InHorizontalVelocity;
+}
+
+void APlayerPawnController::SpawnGravityGun()
+{
+    UClass* GunClass = GravityGunClass.Get();
+    if (!GunClass || GravityGun || !GetWorld()) return;
+
+    FActorSpawnParameters SpawnParams;
+    SpawnParams.Owner = this;
+    SpawnParams.Instigator = GetInstigator();
+    GravityGun = GetWorld()->SpawnActor<AGravityGun>(GunClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParams);
+    if (GravityGun)
+        GravityGun->AttachToComponent(Camera, FAttachmentTransformRules::KeepRelativeTransform);
+}
+
 void APlayerPawnController::Tick(float DeltaTime)
 {
     Super::Tick(DeltaTime);
+
+    //A remote player's pawn moves on their machine, the server only takes what they send
+    if (HasAuthority() && GetController() && !IsLocallyControlled()) return;
+
     CheckGrounded();
 
     //Apply gravity
@@ -108,6 +153,31 @@ void APlayerPawnController::Tick(float DeltaTime)
      
     //Apply velocity to capsule
     Capsule->SetPhysicsLinearVelocity(Velocity);
+
+    //Server checks gravity gun reach and hold targets against this pawn's view, keep its copy current
+    if (!HasAuthority() && IsLocallyControlled())
+    {
+        TimeSinceMovementSent += DeltaTime;
+        if (TimeSinceMovementSent >= 1.f / FMath::Max(MovementSendRate, 1.f))
+        {
+            TimeSinceMovementSent = 0.f;
+            ServerUpdateMovement(GetActorLocation(), GetActorRotation().Yaw, CameraPitch, Velocity);
+        }
+    }
+}
+
+void APlayerPawnController::ServerUpdateMovement_Implementation(FVector_NetQuantize10 Location, float Yaw, float Pitch, FVector_NetQuantize10 Velocity)
+{
+    //Moves are taken as sent, at most as far as the pawn could have gone since the last one (plus a fall)
+    const FVector Current = GetActorLocation();
+    const float MaxStep = (MoveSpeed + FMath::Abs(TerminalVelocity)) / FMath::Max(MovementSendRate, 1.f) * 4.f + 100.f;
+    const FVector Target = Current + (FVector(Location) - Current).GetClampedToMaxSize(MaxStep);
+
+    SetActorLocationAndRotation(Target, FRotator(0.f, Yaw, 0.f), false, nullptr, ETeleportType::TeleportPhysics);
+    Capsule->SetPhysicsLinearVelocity(Velocity);
+
+    CameraPitch = FMath::Clamp(Pitch, -85.f, 85.f);
+    Camera->SetRelativeRotation(FRotator(CameraPitch, 0.f, 0.f));
 }
 
 void APlayerPawnController::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
@@ -168,18 +238,55 @@ void APlayerPawnController::SetupPlayerInputComponent(UInputComponent* PlayerInp
     }
 }
 
+void APlayerPawnController::DispatchInput(EOryxInputAction Action, const FInputActionValue& Value)
+{
+    //Digital actions use the value as pressed/released, matching the Started/Completed bindings
+    const bool bPressed = Value.Get<bool>();
+
+    switch (Action)
+    {
+    case EOryxInputAction::MoveForward: bPressed ? ForwardPressed(Value) : ForwardReleased(Value); break;
+    case EOryxInputAction::MoveBackward: bPressed ? BackwardPressed(Value) : BackwardReleased(Value); break;
+    case EOryxInputAction::MoveLeft: bPressed ? LeftPressed(Value) : LeftReleased(Value); break;
+    case EOryxInputAction::MoveRight: bPressed ? RightPressed(Value) : RightReleased(Value); break;
+    case EOryxInputAction::Look: Look(Value); break;
+    case EOryxInputAction::Jump: Jump(Value); break;
+    case EOryxInputAction::BoardShip: TryBoardShip(); break;
+
+    case EOryxInputAction::GravityGrab: ToggleGrab(); break;
+    case EOryxInputAction::RotateRight: bPressed ? StartRotateRight() : StopRotateRight(); break;
+    case EOryxInputAction::RotateLeft: bPressed ? StartRotateLeft() : StopRotateLeft(); break;
+    case EOryxInputAction::RotateForward: bPressed ? StartRotateForward() : StopRotateForward(); break;
+    case EOryxInputAction::RotateBackward: bPressed ? StartRotateBackward() : StopRotateBackward(); break;
+    case EOryxInputAction::SnapHorizontal: SnapHorizontal(); break;
+    case EOryxInputAction::SnapVertical: SnapVertical(); break;
+    case EOryxInputAction::SnapForward: SnapForward(); break;
+    case EOryxInputAction::Spin: bPressed ? StartSpin() : StopSpin(); break;
+    case EOryxInputAction::Fire: FireObject(); break;
+
+    default: break;
+    }
+}
+
 //Movement input handlers
-void APlayerPawnController::ForwardPressed(const FInputActionValue&) { MoveInput.X = 1.f; }
-void APlayerPawnController::ForwardReleased(const FInputActionValue&) { if (MoveInput.X > 0.f) MoveInput.X = 0.f; }
-void APlayerPawnController::BackwardPressed(const FInputActionValue&) { MoveInput.X = -1.f; }
-void APlayerPawnController::BackwardReleased(const FInputActionValue&) { if (MoveInput.X < 0.f) MoveInput.X = 0.f; }
-void APlayerPawnController::RightPressed(const FInputActionValue&) { MoveInput.Y = 1.f; }
-void APlayerPawnController::RightReleased(const FInputActionValue&) { if (MoveInput.Y > 0.f) MoveInput.Y = 0.f; }
-void APlayerPawnController::LeftPressed(const FInputActionValue&) { MoveInput.Y = -1.f; }
-void APlayerPawnController::LeftReleased(const FInputActionValue&) { if (MoveInput.Y < 0.f) MoveInput.Y = 0.f; }
+//Pressed/released are recorded as explicit bools, Completed values aren't guaranteed to be zero
+void APlayerPawnController::ForwardPressed(const FInputActionValue&) { RecordDigital(EOryxInputAction::MoveForward, true); MoveInput.X = 1.f; }
+void APlayerPawnController::ForwardReleased(const FInputActionValue&) { RecordDigital(EOryxInputAction::MoveForward, false); if (MoveInput.X > 0.f) MoveInput.X = 0.f; }
+void APlayerPawnController::BackwardPressed(const FInputActionValue&) { RecordDigital(EOryxInputAction::MoveBackward, true); MoveInput.X = -1.f; }
+void APlayerPawnController::BackwardReleased(const FInputActionValue&) { RecordDigital(EOryxInputAction::MoveBackward, false); if (MoveInput.X < 0.f) MoveInput.X = 0.f; }
+void APlayerPawnController::RightPressed(const FInputActionValue&) { RecordDigital(EOryxInputAction::MoveRight, true); MoveInput.Y = 1.f; }
+void APlayerPawnController::RightReleased(const FInputActionValue&) { RecordDigital(EOryxInputAction::MoveRight, false); if (MoveInput.Y > 0.f) MoveInput.Y = 0.f; }
+void APlayerPawnController::LeftPressed(const FInputActionValue&) { RecordDigital(EOryxInputAction::MoveLeft, true); MoveInput.Y = -1.f; }
+void APlayerPawnController::LeftReleased(const FInputActionValue&) { RecordDigital(EOryxInputAction::MoveLeft, false); if (MoveInput.Y < 0.f) MoveInput.Y = 0.f; }
+
+void APlayerPawnController::RecordDigital(EOryxInputAction Action, bool bPressed)
+{
+    OryxInput::Record(this, Action, FInputActionValue(bPressed));
+}
 
 void APlayerPawnController::Look(const FInputActionValue& Value)
 {
+    OryxInput::Record(this, EOryxInputAction::Look, Value);
     FVector2D LookValue = Value.Get<FVector2D>();
     if (LookValue.IsNearlyZero()) return;
     float MouseSensitivity = 0.35f;
@@ -194,6 +301,7 @@ void APlayerPawnController::Look(const FInputActionValue& Value)
 
 void APlayerPawnController::Jump(const FInputActionValue&)
 {
+    RecordDigital(EOryxInputAction::Jump, true);
     if (bIsGrounded)
     {
         FVector Velocity = Capsule->GetPhysicsLinearVelocity();
@@ -209,33 +317,40 @@ void APlayerPawnController::CheckGrounded()
     if (!GetWorld()) return;
     FVector Start = Capsule->GetComponentLocation();
     FVector End = Start - FVector(0.f, 0.f, Capsule->GetScaledCapsuleHalfHeight() + 5.f);
+
+    //In split-screen every pawn's trace goes out in one shared batch, answered a frame later
+    if (UOryxSplitscreenSubsystem* Splitscreen = GetWorld()->GetSubsystem<UOryxSplitscreenSubsystem>())
+    {
+        if (Splitscreen->QueryGround(this, Start, End, bIsGrounded)) return;
+    }
+
     FHitResult Hit;
     FCollisionQueryParams Params;
     Params.AddIgnoredActor(this);
-    bIsGrounded = GetWorld()->LineTraceSingleByChannel(Hit, Start, End, ECC_Visibility, Params);
+    bIsGrounded = GetWorld()->LineTraceSingleByChannel(Hit, Start, End, ECC_OryxWalkable, Params);
 }
 
 #pragma region GravityGunMethods
-void APlayerPawnController::ToggleGrab() { if (GravityGun) GravityGun->ToggleGrab(); }
-void APlayerPawnController::SnapHorizontal() { if (GravityGun) GravityGun->SnapRotationToHorizontal(); }
-void APlayerPawnController::SnapVertical() { if (GravityGun) GravityGun->SnapRotationToVertical(); }
-void APlayerPawnController::SnapForward() { if (GravityGun) GravityGun->SnapRotationForward(); }
-void APlayerPawnController::StartSpin() { if (GravityGun) GravityGun->StartSpin(); }
-void APlayerPawnController::StopSpin() { if (GravityGun) GravityGun->StopSpin(); }
-void APlayerPawnController::FireObject() { if (GravityGun) GravityGun->FireObject(); }
+void APlayerPawnController::ToggleGrab() { RecordDigital(EOryxInputAction::GravityGrab, true); if (GravityGun) GravityGun->ToggleGrab(); }
+void APlayerPawnController::SnapHorizontal() { RecordDigital(EOryxInputAction::SnapHorizontal, true); if (GravityGun) GravityGun->SnapRotationToHorizontal(); }
+void APlayerPawnController::SnapVertical() { RecordDigital(EOryxInputAction::SnapVertical, true); if (GravityGun) GravityGun->SnapRotationToVertical(); }
+void APlayerPawnController::SnapForward() { RecordDigital(EOryxInputAction::SnapForward, true); if (GravityGun) GravityGun->SnapRotationForward(); }
+void APlayerPawnController::StartSpin() { RecordDigital(EOryxInputAction::Spin, true); if (GravityGun) GravityGun->StartSpin(); }
+void APlayerPawnController::StopSpin() { RecordDigital(EOryxInputAction::Spin, false); if (GravityGun) GravityGun->StopSpin(); }
+void APlayerPawnController::FireObject() { RecordDigital(EOryxInputAction::Fire, true); if (GravityGun) GravityGun->FireObject(); }
 
 //Manual rotation 
-void APlayerPawnController::StartRotateRight() { if (GravityGun) GravityGun->bRotateYawRight = true; }
-void APlayerPawnController::StopRotateRight() { if (GravityGun) GravityGun->bRotateYawRight = false; }
+void APlayerPawnController::StartRotateRight() { RecordDigital(EOryxInputAction::RotateRight, true); if (GravityGun) GravityGun->bRotateYawRight = true; }
+void APlayerPawnController::StopRotateRight() { RecordDigital(EOryxInputAction::RotateRight, false); if (GravityGun) GravityGun->bRotateYawRight = false; }
 
-void APlayerPawnController::StartRotateLeft() { if (GravityGun) GravityGun->bRotateYawLeft = true; }
-void APlayerPawnController::StopRotateLeft() { if (GravityGun) GravityGun->bRotateYawLeft = false; }
+void APlayerPawnController::StartRotateLeft() { RecordDigital(EOryxInputAction::RotateLeft, true); if (GravityGun) GravityGun->bRotateYawLeft = true; }
+void APlayerPawnController::StopRotateLeft() { RecordDigital(EOryxInputAction::RotateLeft, false); if (GravityGun) GravityGun->bRotateYawLeft = false; }
 
-void APlayerPawnController::StartRotateForward() { if (GravityGun) GravityGun->bRotatePitchUp = true; }
-void APlayerPawnController::StopRotateForward() { if (GravityGun) GravityGun->bRotatePitchUp = false; }
+void APlayerPawnController::StartRotateForward() { RecordDigital(EOryxInputAction::RotateForward, true); if (GravityGun) GravityGun->bRotatePitchUp = true; }
+void APlayerPawnController::StopRotateForward() { RecordDigital(EOryxInputAction::RotateForward, false); if (GravityGun) GravityGun->bRotatePitchUp = false; }
 
-void APlayerPawnController::StartRotateBackward() { if (GravityGun) GravityGun->bRotatePitchDown = true; }
-void APlayerPawnController::StopRotateBackward() { if (GravityGun) GravityGun->bRotatePitchDown = false; }
+void APlayerPawnController::StartRotateBackward() { RecordDigital(EOryxInputAction::RotateBackward, true); if (GravityGun) GravityGun->bRotatePitchDown = true; }
+void APlayerPawnController::StopRotateBackward() { RecordDigital(EOryxInputAction::RotateBackward, false); if (GravityGun) GravityGun->bRotatePitchDown = false; }
 #pragma endregion
 
 void APlayerPawnController::FindShip()
@@ -245,13 +360,13 @@ void APlayerPawnController::FindShip()
 
     TArray<AActor*> OverlappingActors;
     TArray<TEnumAsByte<EObjectTypeQuery>> ObjectTypes;
-    ObjectTypes.Add(UEngineTypes::ConvertToObjectType(ECC_Pawn));
+    ObjectTypes.Add(UEngineTypes::ConvertToObjectType(ECC_OryxShip)); //Only ship hulls reach the class filter
 
     UKismetSystemLibrary::SphereOverlapActors(
         GetWorld(),
         GetActorLocation(),
         BoardRadius,
-        TArray<TEnumAsByte<EObjectTypeQuery>>(),
+        ObjectTypes,
         ASpaceshipPawn::StaticClass(),
         TArray<AActor*>(),
         OverlappingActors
@@ -269,22 +384,16 @@ void APlayerPawnController::FindShip()
 
 void APlayerPawnController::TryBoardShip()
 {
+    RecordDigital(EOryxInputAction::BoardShip, true);
     FindShip();
 
     if (!NearbyShip) return;
 
+    //Only remove this player's gun, other players (and bots) keep theirs
     if (GravityGun)
     {
-        TArray<AActor*> FoundActors;
-        UGameplayStatics::GetAllActorsOfClass(GetWorld(), AActor::StaticClass(), FoundActors);
-
-        for (AActor* Actor : FoundActors)
-        {
-            if (Actor && Actor->GetName().Contains("BP_GravityGun"))
-            {
-                Actor->Destroy();
-            }
-        }
+        GravityGun->Destroy();
+        GravityGun = nullptr;
     }
 
     NearbyShip->TryBoard(this);
@@ -0,0 +1,358 @@
+#include "RockField.h"
+#include "Oryx.h"
+#include "Components/BoxComponent.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/World.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "Algo/BinarySearch.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Rock field streaming"), STAT_OryxRockFieldStream, STATGROUP_Oryx);
+DECLARE_CYCLE_STAT(TEXT("Rock field chunk generation"), STAT_OryxRockFieldGenerate, STATGROUP_Oryx);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rock chunks loaded"), STAT_OryxRockChunksLoaded, STATGROUP_Oryx);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rock chunks generating"), STAT_OryxRockChunksGenerating, STATGROUP_Oryx);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rock chunks waiting"), STAT_OryxRockChunksWaiting, STATGROUP_Oryx);
+
+static TAutoConsoleVariable<float> CVarOryxRocksBudgetMs(
+	TEXT("Oryx.Rocks.BudgetMs"),
+	1.0f,
+	TEXT("Game thread milliseconds each rock field may spend adding generated instances per frame, at least one mesh batch is always added"));
+
+ARockField::ARockField()
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	FieldBounds = CreateDefaultSubobject<UBoxComponent>(TEXT("FieldBounds"));
+	FieldBounds->SetBoxExtent(FVector(250000.f));
+	FieldBounds->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	FieldBounds->SetMobility(EComponentMobility::Static);
+	RootComponent = FieldBounds;
+
+	for (const TCHAR* Path : { TEXT("/Game/RockEnv_Pack/Meshes/Rocks/SM_Rock_1.SM_Rock_1"), TEXT("/Game/RockEnv_Pack/Meshes/Rocks/SM_Rock_2.SM_Rock_2"),
+		TEXT("/Game/RockEnv_Pack/Meshes/Rocks/SM_Rock_10.SM_Rock_10"), TEXT("/Game/RockEnv_Pack/Meshes/Cliff_Rocks/SM_Cliff_Rock_1.SM_Cliff_Rock_1"),
+		TEXT("/Game/RockEnv_Pack/Meshes/Mesa_Rocks/SM_Mesa_Rock_1.SM_Mesa_Rock_1") })
+	{
+		Meshes.AddDefaulted_GetRef().Mesh = TSoftObjectPtr<UStaticMesh>(FSoftObjectPath(Path));
+	}
+}
+
+void ARockField::BeginPlay()
+{
+	Super::BeginPlay();
+
+	TArray<FSoftObjectPath> Paths;
+	for (const FRockFieldMesh& Entry : Meshes)
+	{
+		if (!Entry.Mesh.IsNull()) Paths.AddUnique(Entry.Mesh.ToSoftObjectPath());
+	}
+	if (Paths.Num() == 0) return;
+
+	MeshesHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(Paths,
+		FStreamableDelegate::CreateUObject(this, &ARockField::OnMeshesLoaded));
+}
+
+void ARockField::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	//Workers only hold their chunk's data, so they can be left to finish on their own
+	for (TPair<FIntVector, FChunk>& Pair : Chunks)
+	{
+		if (Pair.Value.Data) Pair.Value.Data->bCancelled = true;
+	}
+	Chunks.Reset();
+	WantedChunks.Reset();
+
+	if (MeshesHandle.IsValid()) MeshesHandle->CancelHandle();
+	MeshesHandle.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ARockField::OnMeshesLoaded()
+{
+	//Snapshot the settings for the workers, changing them in the editor mid-play needs a restart
+	Params = FRockFieldParams();
+	Params.Seed = Seed;
+	Params.ChunkSize = ChunkSize;
+	Params.Bounds = FieldBounds->Bounds.GetBox();
+	Params.RocksPerChunk = RocksPerChunk;
+	Params.MinScale = MinScale;
+	Params.MaxScale = MaxScale;
+	Params.ScaleExponent = ScaleExponent;
+	Params.SolidMinScale = SolidMinScale;
+	Params.NoiseScale = NoiseScale;
+
+	LoadedMeshes.Reset();
+	float TotalWeight = 0.f;
+	for (const FRockFieldMesh& Entry : Meshes)
+	{
+		UStaticMesh* Mesh = Entry.Mesh.Get();
+		if (!Mesh || Entry.Weight <= 0.f) continue;
+
+		TotalWeight += Entry.Weight;
+		LoadedMeshes.Add(Mesh);
+		Params.CumulativeWeights.Add(TotalWeight);
+	}
+
+	bMeshesLoaded = LoadedMeshes.Num() > 0;
+	if (!bMeshesLoaded)
+		UE_LOG(LogOryx, Warning, TEXT("Rock field %s: no rock meshes loaded"), *GetName());
+}
+
+void ARockField::GenerateChunk(const FRockFieldParams& Params, const FIntVector& Coord, FRockChunkData& Out)
+{
+	SCOPE_CYCLE_COUNTER(STAT_OryxRockFieldGenerate);
+
+	const int32 NumMeshes = Params.CumulativeWeights.Num();
+	Out.SolidInstances.SetNum(NumMeshes);
+	Out.DustInstances.SetNum(NumMeshes);
+	if (NumMeshes == 0) return;
+
+	const FVector ChunkMin = FVector(Coord) * Params.ChunkSize;
+	const FBox LocalBounds(FVector::ZeroVector, Params.Bounds.GetSize());
+	const float TotalWeight = Params.CumulativeWeights.Last();
+	FRandomStream Random(HashCombine(GetTypeHash(Params.Seed), GetTypeHash(Coord)));
+
+	for (int32 Index = 0; Index < Params.RocksPerChunk; ++Index)
+	{
+		if ((Index & 63) == 0 && Out.bCancelled) return;
+
+		//Every draw happens before any rejection so one rock never shifts the ones after it
+		const FVector Location = ChunkMin + FVector(Random.FRand(), Random.FRand(), Random.FRand()) * Params.ChunkSize;
+		const float KeepRoll = Random.FRand();
+		const float ScaleRoll = Random.FRand();
+		const float MeshRoll = Random.FRand() * TotalWeight;
+		const FQuat Rotation(Random.VRand(), Random.FRandRange(0.f, UE_TWO_PI));
+
+		if (!LocalBounds.IsInside(Location)) continue;
+
+		//Low frequency noise gathers the rocks into clusters with empty space between them
+		const float Density = FMath::Clamp(FMath::PerlinNoise3D(Location * Params.NoiseScale) * 0.5f + 0.5f, 0.f, 1.f);
+		if (KeepRoll > Density * Density) continue;
+
+		const float Scale = FMath::Lerp(Params.MinScale, Params.MaxScale, FMath::Pow(ScaleRoll, Params.ScaleExponent));
+		const int32 MeshIndex = FMath::Min(Algo::LowerBound(Params.CumulativeWeights, MeshRoll), NumMeshes - 1);
+
+		TArray<TArray<FTransform>>& Instances = Scale >= Params.SolidMinScale ? Out.SolidInstances : Out.DustInstances;
+		Instances[MeshIndex].Emplace(Rotation, Location, FVector(Scale));
+	}
+}
+
+void ARockField::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!bMeshesLoaded) return;
+
+	SCOPE_CYCLE_COUNTER(STAT_OryxRockFieldStream);
+
+	UpdateWantedChunks();
+	LaunchChunkTasks();
+	ApplyChunks();
+}
+
+void ARockField::ApplyWorldOffset(const FVector& InOffset, bool bWorldShift)
+{
+	Super::ApplyWorldOffset(InOffset, bWorldShift);
+
+	//Applied instances move with their components, chunk coordinates and pending chunks are relative to this
+	Params.Bounds = Params.Bounds.ShiftBy(InOffset);
+}
+
+void ARockField::UpdateWantedChunks()
+{
+	const FVector Origin = Params.Bounds.Min;
+	const FIntVector MaxCoord(
+		FMath::CeilToInt(Params.Bounds.GetSize().X / Params.ChunkSize) - 1,
+		FMath::CeilToInt(Params.Bounds.GetSize().Y / Params.ChunkSize) - 1,
+		FMath::CeilToInt(Params.Bounds.GetSize().Z / Params.ChunkSize) - 1);
+
+	//Chunks to keep (a chunk beyond the load distance so they don't flicker at the edge), with their distance
+	//to the nearest pawn. Chunks within the load distance of the pawn or its predicted path are wanted.
+	const float KeepDistance = LoadDistance + Params.ChunkSize;
+	TMap<FIntVector, double> Keep;
+	TSet<FIntVector> Wanted;
+
+	auto GatherAround = [&](const FVector& Point, const FVector& PawnLocation)
+		{
+			const FIntVector Low(
+				FMath::Max(FMath::FloorToInt((Point.X - KeepDistance - Origin.X) / Params.ChunkSize), 0),
+				FMath::Max(FMath::FloorToInt((Point.Y - KeepDistance - Origin.Y) / Params.ChunkSize), 0),
+				FMath::Max(FMath::FloorToInt((Point.Z - KeepDistance - Origin.Z) / Params.ChunkSize), 0));
+			const FIntVector High(
+				FMath::Min(FMath::FloorToInt((Point.X + KeepDistance - Origin.X) / Params.ChunkSize), MaxCoord.X),
+				FMath::Min(FMath::FloorToInt((Point.Y + KeepDistance - Origin.Y) / Params.ChunkSize), MaxCoord.Y),
+				FMath::Min(FMath::FloorToInt((Point.Z + KeepDistance - Origin.Z) / Params.ChunkSize), MaxCoord.Z));
+
+			for (int32 Z = Low.Z; Z <= High.Z; ++Z)
+			for (int32 Y = Low.Y; Y <= High.Y; ++Y)
+			for (int32 X = Low.X; X <= High.X; ++X)
+			{
+				const FIntVector Coord(X, Y, Z);
+				const FVector ChunkMin = Origin + FVector(Coord) * Params.ChunkSize;
+				const FBox ChunkBox(ChunkMin, ChunkMin + FVector(Params.ChunkSize));
+
+				const double DistanceSq = ChunkBox.ComputeSquaredDistanceToPoint(Point);
+				if (DistanceSq > FMath::Square(KeepDistance)) continue;
+				if (DistanceSq <= FMath::Square(LoadDistance)) Wanted.Add(Coord);
+
+				const double PawnDistance = FMath::Sqrt(ChunkBox.ComputeSquaredDistanceToPoint(PawnLocation));
+				double& Priority = Keep.FindOrAdd(Coord, PawnDistance);
+				Priority = FMath::Min(Priority, PawnDistance);
+			}
+		};
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APawn* Pawn = It->Get() ? It->Get()->GetPawn() : nullptr;
+		if (!Pawn) continue;
+
+		//Sample the path the pawn will fly over the next PrefetchSeconds, about one sample per chunk
+		const FVector Location = Pawn->GetActorLocation();
+		const FVector Predicted = Location + Pawn->GetVelocity() * PrefetchSeconds;
+		const int32 NumSteps = FMath::Clamp(FMath::CeilToInt(FVector::Dist(Location, Predicted) / Params.ChunkSize), 0, 8);
+		for (int32 Step = 0; Step <= NumSteps; ++Step)
+			GatherAround(NumSteps > 0 ? FMath::Lerp(Location, Predicted, static_cast<float>(Step) / NumSteps) : Location, Location);
+	}
+
+	TArray<FIntVector> ToUnload;
+	for (const TPair<FIntVector, FChunk>& Pair : Chunks)
+	{
+		if (!Keep.Contains(Pair.Key)) ToUnload.Add(Pair.Key);
+	}
+	for (const FIntVector& Coord : ToUnload)
+		UnloadChunk(Coord);
+
+	WantedChunks.Reset();
+	for (const FIntVector& Coord : Wanted)
+	{
+		if (!Chunks.Contains(Coord)) WantedChunks.Emplace(Coord, Keep[Coord]);
+	}
+	WantedChunks.Sort([](const TPair<FIntVector, double>& A, const TPair<FIntVector, double>& B) { return A.Value < B.Value; });
+
+	INC_DWORD_STAT_BY(STAT_OryxRockChunksWaiting, WantedChunks.Num());
+}
+
+void ARockField::LaunchChunkTasks()
+{
+	int32 NumInFlight = 0;
+	for (const TPair<FIntVector, FChunk>& Pair : Chunks)
+	{
+		if (!Pair.Value.Task.IsCompleted()) ++NumInFlight;
+	}
+
+	for (int32 Index = 0; Index < WantedChunks.Num() && NumInFlight < MaxTasksInFlight; ++Index, ++NumInFlight)
+	{
+		const FIntVector Coord = WantedChunks[Index].Key;
+
+		FChunk& Chunk = Chunks.Add(Coord);
+		Chunk.Priority = WantedChunks[Index].Value;
+		Chunk.Data = MakeShared<FRockChunkData>();
+		Chunk.Task = UE::Tasks::Launch(UE_SOURCE_LOCATION,
+			[Data = Chunk.Data, FieldParams = Params, Coord]()
+			{
+				GenerateChunk(FieldParams, Coord, *Data);
+			});
+	}
+
+	INC_DWORD_STAT_BY(STAT_OryxRockChunksGenerating, NumInFlight);
+}
+
+void ARockField::ApplyChunks()
+{
+	TArray<FChunk*> Ready;
+	for (TPair<FIntVector, FChunk>& Pair : Chunks)
+	{
+		if (!Pair.Value.bApplied && Pair.Value.Task.IsCompleted()) Ready.Add(&Pair.Value);
+	}
+	Ready.Sort([](const FChunk& A, const FChunk& B) { return A.Priority < B.Priority; });
+
+	//Instances go in one mesh batch at a time, that's where the render and physics state cost lands
+	const double Deadline = FPlatformTime::Seconds() + CVarOryxRocksBudgetMs.GetValueOnGameThread() / 1000.0;
+	const int32 NumMeshes = LoadedMeshes.Num();
+	bool bAppliedAny = false;
+
+	for (FChunk* Chunk : Ready)
+	{
+		while (Chunk->NextBucket < NumMeshes * 2)
+		{
+			if (bAppliedAny && FPlatformTime::Seconds() >= Deadline) break;
+
+			const bool bSolid = Chunk->NextBucket < NumMeshes;
+			const int32 MeshIndex = Chunk->NextBucket % NumMeshes;
+			TArray<FTransform>& Instances = bSolid ? Chunk->Data->SolidInstances[MeshIndex] : Chunk->Data->DustInstances[MeshIndex];
+			++Chunk->NextBucket;
+			if (Instances.Num() == 0) continue;
+
+			for (FTransform& Instance : Instances)
+				Instance.AddToTranslation(Params.Bounds.Min);
+
+			UHierarchicalInstancedStaticMeshComponent* Component = AcquireComponent(LoadedMeshes[MeshIndex], bSolid);
+			Component->AddInstances(Instances, false, true, false);
+			Chunk->Components.Add(Component);
+			bAppliedAny = true;
+		}
+
+		if (Chunk->NextBucket < NumMeshes * 2) break;
+
+		Chunk->bApplied = true;
+		Chunk->Data.Reset(); //Instances live in the components now
+	}
+
+	INC_DWORD_STAT_BY(STAT_OryxRockChunksLoaded, Chunks.Num());
+}
+
+void ARockField::UnloadChunk(const FIntVector& Coord)
+{
+	FChunk Chunk;
+	if (!Chunks.RemoveAndCopyValue(Coord, Chunk)) return;
+
+	if (Chunk.Data) Chunk.Data->bCancelled = true;
+
+	for (UHierarchicalInstancedStaticMeshComponent* Component : Chunk.Components)
+	{
+		Component->ClearInstances();
+		FreeComponents.Add(Component);
+	}
+}
+
+UHierarchicalInstancedStaticMeshComponent* ARockField::AcquireComponent(UStaticMesh* Mesh, bool bSolid)
+{
+	//Static components can't change mesh once registered, so only reuse one that already has this mesh
+	UHierarchicalInstancedStaticMeshComponent* Component = nullptr;
+	for (int32 Index = FreeComponents.Num() - 1; Index >= 0; --Index)
+	{
+		if (FreeComponents[Index]->GetStaticMesh() != Mesh) continue;
+
+		Component = FreeComponents[Index];
+		FreeComponents.RemoveAtSwap(Index, EAllowShrinking::No);
+		break;
+	}
+
+	if (!Component)
+	{
+		Component = NewObject<UHierarchicalInstancedStaticMeshComponent>(this);
+		Component->SetupAttachment(RootComponent);
+		Component->SetMobility(EComponentMobility::Static);
+		Component->SetCanEverAffectNavigation(false);
+		Component->SetStaticMesh(Mesh);
+		//Culled at the load distance, rocks past it may not be there yet
+		Component->SetCullDistances(FMath::RoundToInt(LoadDistance * 0.8f), FMath::RoundToInt(LoadDistance));
+		Component->RegisterComponent();
+	}
+
+	Component->SetCastShadow(bSolid);
+	if (bSolid)
+	{
+		Component->SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+	}
+	else
+	{
+		Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	}
+	return Component;
+}
@@ -0,0 +1,28 @@
+#include "ShipArchetype.h"
+
+void UShipArchetype::PostInitProperties()
+{
+	Super::PostInitProperties();
+	UpdateDerivedValues(); //Covers the class default, which ships fall back to without an asset
+}
+
+void UShipArchetype::PostLoad()
+{
+	Super::PostLoad();
+	UpdateDerivedValues();
+}
+
+#if WITH_EDITOR
+void UShipArchetype::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	UpdateDerivedValues();
+}
+#endif
+
+void UShipArchetype::UpdateDerivedValues()
+{
+	InvMaxMouseRadius = MaxMouseRadius > 0.f ? 1.f / MaxMouseRadius : 0.f;
+	BrakeSpeed = LandingMoveSpeed * BrakeSpeedScale;
+	AlignDriftSpeed = LandingMoveSpeed * AlignDriftSpeedScale;
+}
@@ -0,0 +1,473 @@
+#include "ShipAvoidanceSubsystem.h"
+#include "OryxPilotScheduler.h"
+#include "Oryx.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Ship avoidance gather"), STAT_ShipAvoidanceGather, STATGROUP_Oryx);
+DECLARE_CYCLE_STAT(TEXT("Ship avoidance solve"), STAT_ShipAvoidanceSolve, STATGROUP_Oryx);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ship avoidance agents"), STAT_ShipAvoidanceAgents, STATGROUP_Oryx);
+
+static TAutoConsoleVariable<bool> CVarOryxAvoidanceEnable(
+	TEXT("Oryx.Avoidance.Enable"),
+	true,
+	TEXT("Solve reciprocal avoidance between ships, when off steered ships get their desired velocity back"));
+
+static FAutoConsoleCommand GOryxAvoidanceBenchCommand(
+	TEXT("Oryx.Avoidance.Bench"),
+	TEXT("Oryx.Avoidance.Bench [Count] - time one avoidance solve for Count synthetic ships converging on a point"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 Count = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000;
+		if (Count <= 0) return;
+
+		//Ships on a sphere all heading through its centre, the worst case for neighbour counts
+		FShipAvoidanceBatch Batch;
+		const float SphereRadius = 200.f * FMath::Sqrt(static_cast<float>(Count));
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			const FVector Position = FMath::VRand() * SphereRadius;
+			const FVector3f Preferred = FVector3f(-Position.GetSafeNormal() * 500.0);
+			Batch.Add(Position, Preferred, Preferred, 150.f, 600.f);
+		}
+
+		FShipAvoidanceSettings Settings;
+		TArray<FVector3f> Results;
+		const double StartTime = FPlatformTime::Seconds();
+		UShipAvoidanceSubsystem::Solve(Batch, Settings, Results);
+		UE_LOG(LogOryx, Display, TEXT("Avoidance bench: %d ships solved in %.3f ms"), Count, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	}));
+
+#pragma region ORCA
+//3D ORCA as in RVO2-3D (van den Berg et al.): each neighbour contributes a half-space of allowed velocities,
+//a linear program picks the allowed velocity closest to the preferred one.
+namespace OryxOrca
+{
+	static constexpr float Epsilon = 0.00001f;
+
+	struct FPlane
+	{
+		FVector3f Point;
+		FVector3f Normal;
+	};
+
+	struct FLine
+	{
+		FVector3f Point;
+		FVector3f Direction;
+	};
+
+	using FPlanes = TArray<FPlane, TInlineAllocator<16>>;
+
+	static bool LinearProgram1(const FPlanes& Planes, int32 PlaneNo, const FLine& Line, float Radius, const FVector3f& OptVelocity, bool bDirectionOpt, FVector3f& Result)
+	{
+		const float DotProduct = Line.Point | Line.Direction;
+		const float Discriminant = FMath::Square(DotProduct) + FMath::Square(Radius) - Line.Point.SizeSquared();
+		if (Discriminant < 0.f) return false; //Max speed sphere fully invalidates the line
+
+		const float SqrtDiscriminant = FMath::Sqrt(Discriminant);
+		float TLeft = -DotProduct - SqrtDiscriminant;
+		float TRight = -DotProduct + SqrtDiscriminant;
+
+		for (int32 Index = 0; Index < PlaneNo; ++Index)
+		{
+			const float Numerator = (Planes[Index].Point - Line.Point) | Planes[Index].Normal;
+			const float Denominator = Line.Direction | Planes[Index].Normal;
+
+			if (FMath::Square(Denominator) <= Epsilon)
+			{
+				if (Numerator > 0.f) return false; //Line is parallel to and outside the plane
+				continue;
+			}
+
+			const float T = Numerator / Denominator;
+			if (Denominator >= 0.f) TLeft = FMath::Max(TLeft, T);
+			else TRight = FMath::Min(TRight, T);
+
+			if (TLeft > TRight) return false;
+		}
+
+		if (bDirectionOpt)
+			Result = Line.Point + Line.Direction * ((OptVelocity | Line.Direction) > 0.f ? TRight : TLeft);
+		else
+			Result = Line.Point + Line.Direction * FMath::Clamp(Line.Direction | (OptVelocity - Line.Point), TLeft, TRight);
+
+		return true;
+	}
+
+	static bool LinearProgram2(const FPlanes& Planes, int32 PlaneNo, float Radius, const FVector3f& OptVelocity, bool bDirectionOpt, FVector3f& Result)
+	{
+		const FPlane& Plane = Planes[PlaneNo];
+		const float PlaneDist = Plane.Point | Plane.Normal;
+		const float PlaneDistSq = FMath::Square(PlaneDist);
+		const float RadiusSq = FMath::Square(Radius);
+		if (PlaneDistSq > RadiusSq) return false; //Max speed sphere fully invalidates the plane
+
+		const float PlaneRadiusSq = RadiusSq - PlaneDistSq;
+		const FVector3f PlaneCenter = Plane.Normal * PlaneDist;
+
+		if (bDirectionOpt)
+		{
+			const FVector3f PlaneOptVelocity = OptVelocity - Plane.Normal * (OptVelocity | Plane.Normal);
+			const float PlaneOptVelocityLengthSq = PlaneOptVelocity.SizeSquared();
+			Result = PlaneOptVelocityLengthSq <= Epsilon
+				? PlaneCenter
+				: PlaneCenter + PlaneOptVelocity * FMath::Sqrt(PlaneRadiusSq / PlaneOptVelocityLengthSq);
+		}
+		else
+		{
+			Result = OptVelocity + Plane.Normal * ((Plane.Point - OptVelocity) | Plane.Normal);
+			if (Result.SizeSquared() > RadiusSq)
+			{
+				const FVector3f PlaneResult = Result - PlaneCenter;
+				Result = PlaneCenter + PlaneResult * FMath::Sqrt(PlaneRadiusSq / PlaneResult.SizeSquared());
+			}
+		}
+
+		for (int32 Index = 0; Index < PlaneNo; ++Index)
+		{
+			if ((Planes[Index].Normal | (Planes[Index].Point - Result)) <= 0.f) continue;
+
+			//Result breaks an earlier plane, the answer lies on the line where both meet
+			const FVector3f CrossProduct = Planes[Index].Normal ^ Plane.Normal;
+			if (CrossProduct.SizeSquared() <= Epsilon) return false; //Parallel and opposing
+
+			FLine Line;
+			Line.Direction = CrossProduct.GetUnsafeNormal();
+			const FVector3f LineNormal = Line.Direction ^ Plane.Normal;
+			Line.Point = Plane.Point + LineNormal * (((Planes[Index].Point - Plane.Point) | Planes[Index].Normal) / (LineNormal | Planes[Index].Normal));
+
+			if (!LinearProgram1(Planes, Index, Line, Radius, OptVelocity, bDirectionOpt, Result)) return false;
+		}
+
+		return true;
+	}
+
+	//Returns the number of planes satisfied before one failed, Planes.Num() on success
+	static int32 LinearProgram3(const FPlanes& Planes, float Radius, const FVector3f& OptVelocity, bool bDirectionOpt, FVector3f& Result)
+	{
+		if (bDirectionOpt)
+			Result = OptVelocity * Radius;
+		else if (OptVelocity.SizeSquared() > FMath::Square(Radius))
+			Result = OptVelocity.GetUnsafeNormal() * Radius;
+		else
+			Result = OptVelocity;
+
+		for (int32 Index = 0; Index < Planes.Num(); ++Index)
+		{
+			if ((Planes[Index].Normal | (Planes[Index].Point - Result)) <= 0.f) continue;
+
+			const FVector3f Previous = Result;
+			if (!LinearProgram2(Planes, Index, Radius, OptVelocity, bDirectionOpt, Result))
+			{
+				Result = Previous;
+				return Index;
+			}
+		}
+
+		return Planes.Num();
+	}
+
+	//Infeasible: minimise the largest violation instead, so crowded agents still get the least bad velocity
+	static void LinearProgram4(const FPlanes& Planes, int32 BeginPlane, float Radius, FVector3f& Result)
+	{
+		float Distance = 0.f;
+		FPlanes Projected;
+
+		for (int32 Index = BeginPlane; Index < Planes.Num(); ++Index)
+		{
+			const FPlane& Plane = Planes[Index];
+			if ((Plane.Normal | (Plane.Point - Result)) <= Distance) continue;
+
+			Projected.Reset();
+			for (int32 Other = 0; Other < Index; ++Other)
+			{
+				FPlane ProjectedPlane;
+				const FVector3f CrossProduct = Planes[Other].Normal ^ Plane.Normal;
+
+				if (CrossProduct.SizeSquared() <= Epsilon)
+				{
+					if ((Plane.Normal | Planes[Other].Normal) > 0.f) continue; //Same direction
+					ProjectedPlane.Point = (Plane.Point + Planes[Other].Point) * 0.5f;
+				}
+				else
+				{
+					const FVector3f LineNormal = CrossProduct ^ Plane.Normal;
+					ProjectedPlane.Point = Plane.Point + LineNormal * (((Planes[Other].Point - Plane.Point) | Planes[Other].Normal) / (LineNormal | Planes[Other].Normal));
+				}
+
+				ProjectedPlane.Normal = (Planes[Other].Normal - Plane.Normal).GetSafeNormal();
+				Projected.Add(ProjectedPlane);
+			}
+
+			const FVector3f Previous = Result;
+			if (LinearProgram3(Projected, Radius, Plane.Normal, true, Result) < Projected.Num())
+				Result = Previous; //Only floating point error gets here, keep the last good answer
+
+			Distance = Plane.Normal | (Plane.Point - Result);
+		}
+	}
+}
+#pragma endregion
+
+void FShipAvoidanceBatch::Reset()
+{
+	Positions.Reset();
+	Velocities.Reset();
+	PreferredVelocities.Reset();
+	Radii.Reset();
+	MaxSpeeds.Reset();
+	Reciprocal.Reset();
+}
+
+void FShipAvoidanceBatch::Add(const FVector& Position, const FVector3f& Velocity, const FVector3f& Preferred, float Radius, float MaxSpeed, bool bReciprocal)
+{
+	Positions.Add(Position);
+	Velocities.Add(Velocity);
+	PreferredVelocities.Add(Preferred);
+	Radii.Add(Radius);
+	MaxSpeeds.Add(MaxSpeed);
+	Reciprocal.Add(bReciprocal);
+}
+
+void UShipAvoidanceSubsystem::Solve(const FShipAvoidanceBatch& Batch, const FShipAvoidanceSettings& Settings, TArray<FVector3f>& OutVelocities)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShipAvoidanceSolve);
+
+	const int32 Count = Batch.Num();
+	OutVelocities.SetNumUninitialized(Count);
+	if (Count == 0) return;
+
+	//Spatial hash with one neighbour distance per cell, so the 27 cells around an agent cover its whole range
+	const float CellSize = FMath::Max(Settings.NeighbourDistance, 1.f);
+	auto CellOf = [CellSize](const FVector& Position)
+		{
+			return FIntVector(FMath::FloorToInt32(Position.X / CellSize), FMath::FloorToInt32(Position.Y / CellSize), FMath::FloorToInt32(Position.Z / CellSize));
+		};
+
+	TMap<FIntVector, int32> CellHeads;
+	CellHeads.Reserve(Count);
+	TArray<int32> NextInCell;
+	NextInCell.SetNumUninitialized(Count);
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		int32& Head = CellHeads.FindOrAdd(CellOf(Batch.Positions[Index]), INDEX_NONE);
+		NextInCell[Index] = Head;
+		Head = Index;
+	}
+
+	const float NeighbourDistanceSq = FMath::Square(Settings.NeighbourDistance);
+	const float InvTimeHorizon = 1.f / FMath::Max(Settings.TimeHorizon, UE_KINDA_SMALL_NUMBER);
+	const float InvTimeStep = 1.f / FMath::Max(Settings.TimeStep, UE_KINDA_SMALL_NUMBER);
+	const int32 MaxNeighbours = FMath::Max(Settings.MaxNeighbours, 1);
+
+	ParallelFor(Count, [&](int32 Agent)
+		{
+			const FVector& Position = Batch.Positions[Agent];
+			const FVector3f& Velocity = Batch.Velocities[Agent];
+			const float Radius = Batch.Radii[Agent];
+
+			//Closest MaxNeighbours within range, kept sorted by distance
+			TArray<TPair<float, int32>, TInlineAllocator<16>> Neighbours;
+			const FIntVector Cell = CellOf(Position);
+			for (int32 Z = -1; Z <= 1; ++Z)
+			for (int32 Y = -1; Y <= 1; ++Y)
+			for (int32 X = -1; X <= 1; ++X)
+			{
+				const int32* Head = CellHeads.Find(Cell + FIntVector(X, Y, Z));
+				for (int32 Other = Head ? *Head : INDEX_NONE; Other != INDEX_NONE; Other = NextInCell[Other])
+				{
+					if (Other == Agent) continue;
+
+					const float DistanceSq = static_cast<float>(FVector::DistSquared(Position, Batch.Positions[Other]));
+					if (DistanceSq >= NeighbourDistanceSq) continue;
+					if (Neighbours.Num() == MaxNeighbours && DistanceSq >= Neighbours.Last().Key) continue;
+
+					int32 Slot = Neighbours.Num();
+					while (Slot > 0 && Neighbours[Slot - 1].Key > DistanceSq) --Slot;
+					Neighbours.Insert(TPair<float, int32>(DistanceSq, Other), Slot);
+					if (Neighbours.Num() > MaxNeighbours) Neighbours.Pop(EAllowShrinking::No);
+				}
+			}
+
+			OryxOrca::FPlanes Planes;
+			for (const TPair<float, int32>& Neighbour : Neighbours)
+			{
+				const int32 Other = Neighbour.Value;
+				const FVector3f RelativePosition = FVector3f(Batch.Positions[Other] - Position);
+				const FVector3f RelativeVelocity = Velocity - Batch.Velocities[Other];
+				const float DistanceSq = RelativePosition.SizeSquared();
+				const float CombinedRadius = Radius + Batch.Radii[Other];
+				const float CombinedRadiusSq = FMath::Square(CombinedRadius);
+
+				OryxOrca::FPlane Plane;
+				FVector3f U;
+
+				if (DistanceSq > CombinedRadiusSq)
+				{
+					//No collision yet: project onto the truncated velocity obstacle
+					FVector3f W = RelativeVelocity - RelativePosition * InvTimeHorizon;
+					const float WLengthSq = W.SizeSquared();
+					const float DotProduct = W | RelativePosition;
+
+					if (DotProduct < 0.f && FMath::Square(DotProduct) > CombinedRadiusSq * WLengthSq)
+					{
+						//Cut-off sphere
+						const float WLength = FMath::Sqrt(WLengthSq);
+						const FVector3f UnitW = W / FMath::Max(WLength, OryxOrca::Epsilon);
+						Plane.Normal = UnitW;
+						U = UnitW * (CombinedRadius * InvTimeHorizon - WLength);
+					}
+					else
+					{
+						//Cone side
+						const float A = DistanceSq;
+						const float B = RelativePosition | RelativeVelocity;
+						const float C = RelativeVelocity.SizeSquared() - (RelativePosition ^ RelativeVelocity).SizeSquared() / (DistanceSq - CombinedRadiusSq);
+						const float T = (B + FMath::Sqrt(FMath::Max(FMath::Square(B) - A * C, 0.f))) / A;
+						W = RelativeVelocity - RelativePosition * T;
+						const float WLength = W.Size();
+						const FVector3f UnitW = W / FMath::Max(WLength, OryxOrca::Epsilon);
+						Plane.Normal = UnitW;
+						U = UnitW * (CombinedRadius * T - WLength);
+					}
+				}
+				else
+				{
+					//Already overlapping: separate within one step
+					const FVector3f W = RelativeVelocity - RelativePosition * InvTimeStep;
+					const float WLength = W.Size();
+					const FVector3f UnitW = W / FMath::Max(WLength, OryxOrca::Epsilon);
+					Plane.Normal = UnitW;
+					U = UnitW * (CombinedRadius * InvTimeStep - WLength);
+				}
+
+				//Each agent takes half the responsibility, all of it against one that won't move aside (the player's ship)
+				Plane.Point = Velocity + (Batch.Reciprocal[Other] ? U * 0.5f : U);
+				Planes.Add(Plane);
+			}
+
+			FVector3f Result;
+			const float MaxSpeed = Batch.MaxSpeeds[Agent];
+			const int32 PlaneFail = OryxOrca::LinearProgram3(Planes, MaxSpeed, Batch.PreferredVelocities[Agent], false, Result);
+			if (PlaneFail < Planes.Num())
+				OryxOrca::LinearProgram4(Planes, PlaneFail, MaxSpeed, Result);
+
+			OutVelocities[Agent] = Result;
+		});
+}
+
+bool UShipAvoidanceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShipAvoidanceSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	//Tickables tick in the order they were registered: pilots think first, so their steering is solved this frame
+	Collection.InitializeDependency<UOryxPilotScheduler>();
+
+	Super::Initialize(Collection);
+}
+
+void UShipAvoidanceSubsystem::Deinitialize()
+{
+	Agents.Reset();
+	FreeHandles.Reset();
+	NumAgents = 0;
+	Super::Deinitialize();
+}
+
+int32 UShipAvoidanceSubsystem::RegisterAgent(const AActor* Owner, float Radius)
+{
+	if (!Owner) return INDEX_NONE;
+
+	const int32 Handle = FreeHandles.Num() > 0 ? FreeHandles.Pop(EAllowShrinking::No) : Agents.AddDefaulted();
+	Agents[Handle] = FAgent();
+	Agents[Handle].Owner = Owner;
+	Agents[Handle].Radius = Radius;
+	++NumAgents;
+	return Handle;
+}
+
+void UShipAvoidanceSubsystem::UnregisterAgent(int32 Handle)
+{
+	if (!Agents.IsValidIndex(Handle) || !Agents[Handle].Owner.IsValid()) return;
+
+	Agents[Handle] = FAgent();
+	FreeHandles.Add(Handle);
+	--NumAgents;
+}
+
+void UShipAvoidanceSubsystem::SetDesiredVelocity(int32 Handle, const FVector& Velocity, float MaxSpeed, int32 SteerFrames)
+{
+	if (!Agents.IsValidIndex(Handle)) return;
+
+	FAgent& Agent = Agents[Handle];
+	Agent.Desired = FVector3f(Velocity);
+	Agent.MaxSpeed = MaxSpeed;
+	Agent.DesiredFrame = GFrameCounter;
+	Agent.SteerFrames = FMath::Max(SteerFrames, 1);
+}
+
+FVector UShipAvoidanceSubsystem::GetAvoidanceVelocity(int32 Handle) const
+{
+	if (!Agents.IsValidIndex(Handle)) return FVector::ZeroVector;
+
+	const FAgent& Agent = Agents[Handle];
+	return FVector(Agent.bSolved && CVarOryxAvoidanceEnable.GetValueOnGameThread() ? Agent.Result : Agent.Desired);
+}
+
+void UShipAvoidanceSubsystem::Tick(float DeltaTime)
+{
+	SET_DWORD_STAT(STAT_ShipAvoidanceAgents, NumAgents);
+	if (NumAgents == 0 || !CVarOryxAvoidanceEnable.GetValueOnGameThread()) return;
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ShipAvoidanceGather);
+
+		Batch.Reset();
+		BatchHandles.Reset();
+		for (int32 Handle = 0; Handle < Agents.Num(); ++Handle)
+		{
+			FAgent& Agent = Agents[Handle];
+			const AActor* Owner = Agent.Owner.Get();
+			if (!Owner) continue;
+
+			//Steered agents move at what we gave them, everything else is an obstacle holding its course. An agent
+			//stays steered until its next steer is due, so one that thinks every few frames (or set its velocity
+			//after this ticked last frame) keeps heading for its route in between
+			const bool bSteered = GFrameCounter - Agent.DesiredFrame <= static_cast<uint64>(Agent.SteerFrames);
+			const FVector3f Velocity = bSteered && Agent.bSolved ? Agent.Result : FVector3f(Owner->GetVelocity());
+			const FVector3f Preferred = bSteered ? Agent.Desired : Velocity;
+			const float MaxSpeed = bSteered ? Agent.MaxSpeed : Velocity.Size();
+
+			Batch.Add(Owner->GetActorLocation(), Velocity, Preferred, Agent.Radius, MaxSpeed, bSteered);
+			BatchHandles.Add(Handle);
+		}
+	}
+
+	FShipAvoidanceSettings Settings;
+	Settings.NeighbourDistance = NeighbourDistance;
+	Settings.MaxNeighbours = MaxNeighbours;
+	Settings.TimeHorizon = TimeHorizon;
+	Settings.TimeStep = FMath::Max(DeltaTime, UE_KINDA_SMALL_NUMBER);
+	Solve(Batch, Settings, BatchResults);
+
+	//An obstacle's answer is just its current velocity, it would hand a stale steerer that instead of its route
+	for (int32 Slot = 0; Slot < BatchHandles.Num(); ++Slot)
+	{
+		if (!Batch.Reciprocal[Slot]) continue;
+
+		FAgent& Agent = Agents[BatchHandles[Slot]];
+		Agent.Result = BatchResults[Slot];
+		Agent.bSolved = true;
+	}
+}
+
+TStatId UShipAvoidanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShipAvoidanceSubsystem, STATGROUP_Tickables);
+}
@@ -0,0 +1,107 @@
+#include "ShipCameraRigComponent.h"
+#include "Oryx.h"
+#include "SpaceshipPawn.h"
+#include "Camera/CameraComponent.h"
+#include "Components/PrimitiveComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Ship camera rig"), STAT_OryxShipCameraRig, STATGROUP_Oryx);
+
+//Critically damped spring, Value reaches Target in about SmoothTime without overshooting
+static void SpringTowards(FVector& Value, FVector& Rate, const FVector& Target, float DeltaTime, float SmoothTime)
+{
+	if (SmoothTime <= UE_KINDA_SMALL_NUMBER)
+	{
+		Value = Target;
+		Rate = FVector::ZeroVector;
+		return;
+	}
+
+	const float Omega = 2.f / SmoothTime;
+	const float X = Omega * DeltaTime;
+	const float Decay = 1.f / (1.f + X + 0.48f * X * X + 0.235f * X * X * X);
+	const FVector Change = Value - Target;
+	const FVector Temp = (Rate + Change * Omega) * DeltaTime;
+	Rate = (Rate - Temp * Omega) * Decay;
+	Value = Target + (Change + Temp) * Decay;
+}
+
+UShipCameraRigComponent::UShipCameraRigComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+}
+
+void UShipCameraRigComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	Ship = Cast<ASpaceshipPawn>(GetOwner());
+	RefreshLocalControl();
+}
+
+void UShipCameraRigComponent::RefreshLocalControl()
+{
+	if (!Ship || !HasBegunPlay()) return;
+
+	const bool bLocal = Ship->IsLocallyControlled() && Ship->IsPlayerControlled();
+	if (bLocal && !Camera) AcquireCamera();
+
+	if (bLocal && !IsComponentTickEnabled()) bSnap = true; //Boarding again shouldn't spring in from where we left
+	SetComponentTickEnabled(bLocal);
+}
+
+void UShipCameraRigComponent::AcquireCamera()
+{
+	const USceneComponent* Root = Ship->GetRootComponent();
+
+	Camera = Ship->FindComponentByClass<UCameraComponent>();
+	if (Camera)
+	{
+		Offset = Root->GetComponentTransform().InverseTransformPosition(Camera->GetComponentLocation());
+	}
+	else
+	{
+		Camera = NewObject<UCameraComponent>(Ship, TEXT("ShipCamera"));
+		Camera->RegisterComponent();
+	}
+
+	//Detached, so the transform update of the ship body doesn't drag it along a frame behind the rig
+	Camera->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+	Camera->SetActive(true);
+}
+
+void UShipCameraRigComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (!Ship || !Camera) return;
+
+	SCOPE_CYCLE_COUNTER(STAT_OryxShipCameraRig);
+
+	//Post physics, so this is the pose the body will be rendered at this frame
+	const UPrimitiveComponent* Body = CastChecked<UPrimitiveComponent>(Ship->GetRootComponent());
+	const FVector ShipLocation = Body->GetComponentLocation();
+	const FQuat ShipRotation = Body->GetComponentQuat();
+	const FVector Velocity = Body->GetPhysicsLinearVelocity();
+
+	if (bSnap)
+	{
+		SmoothedRotation = ShipRotation;
+		CurrentOffset = ShipRotation.RotateVector(Offset);
+		OffsetRate = FVector::ZeroVector;
+		bSnap = false;
+	}
+	else
+	{
+		SmoothedRotation = FQuat::Slerp(SmoothedRotation, ShipRotation, 1.f - FMath::Exp(-DeltaTime / FMath::Max(RotationSmoothTime, UE_KINDA_SMALL_NUMBER)));
+		SpringTowards(CurrentOffset, OffsetRate, SmoothedRotation.RotateVector(Offset), DeltaTime, LocationSmoothTime);
+	}
+
+	//Aim where the ship is about to be, so at speed it stays centred instead of sliding ahead of the view
+	const FVector Lead = Velocity.GetClampedToMaxSize(MaxLead / FMath::Max(LeadTime, UE_KINDA_SMALL_NUMBER)) * LeadTime;
+	const FVector CameraLocation = ShipLocation + CurrentOffset;
+	const FVector AimDirection = (ShipLocation + Lead - CameraLocation).GetSafeNormal(UE_SMALL_NUMBER, SmoothedRotation.GetForwardVector());
+
+	Camera->SetWorldLocationAndRotation(CameraLocation, FRotationMatrix::MakeFromXZ(AimDirection, SmoothedRotation.GetUpVector()).ToQuat());
+}
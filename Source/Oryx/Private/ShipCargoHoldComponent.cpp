@@ -0,0 +1,206 @@
+#include "ShipCargoHoldComponent.h"
+#include "Oryx.h"
+#include "OryxEventSubsystem.h"
+#include "OryxCargoSubsystem.h"
+#include "OryxPropPool.h"
+#include "OryxFractureSubsystem.h"
+#include "GravityGun.h"
+#include "DebrisField.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cargo props stowed"), STAT_OryxCargoStowed, STATGROUP_Oryx);
+
+static FAutoConsoleCommandWithWorldAndArgs GOryxCargoEjectCommand(
+	TEXT("Oryx.Cargo.Eject"),
+	TEXT("Oryx.Cargo.Eject [Count] - eject Count props from the local player's ship, all of them for 0"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const APlayerController* Player = World ? World->GetFirstPlayerController() : nullptr;
+		const APawn* Pawn = Player ? Player->GetPawn() : nullptr;
+		if (UShipCargoHoldComponent* Hold = Pawn ? Pawn->FindComponentByClass<UShipCargoHoldComponent>() : nullptr)
+			Hold->Eject(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1);
+	}));
+
+UShipCargoHoldComponent::UShipCargoHoldComponent()
+{
+	//Only ticks while props are being watched or ejected
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+}
+
+void UShipCargoHoldComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (!GetOwner()->HasAuthority()) return;
+
+	if (const UPrimitiveComponent* Body = Cast<UPrimitiveComponent>(GetOwner()->GetRootComponent()))
+		EmptyMassKg = Body->GetMass();
+
+	if (UOryxCargoSubsystem* Cargo = GetWorld()->GetSubsystem<UOryxCargoSubsystem>())
+	{
+		Cargo->RegisterHold(this);
+		bRegistered = true;
+	}
+}
+
+void UShipCargoHoldComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UOryxCargoSubsystem* Cargo = bRegistered ? GetWorld()->GetSubsystem<UOryxCargoSubsystem>() : nullptr)
+		Cargo->UnregisterHold(this);
+	bRegistered = false;
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UShipCargoHoldComponent::Watch(UStaticMeshComponent* Component)
+{
+	if (!Component) return;
+
+	Watched.Add({ Component, GetWorld()->GetTimeSeconds() + WatchSeconds });
+	SetComponentTickEnabled(true);
+}
+
+void UShipCargoHoldComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	const FVector Center = GetComponentLocation();
+
+	for (int32 Index = Watched.Num() - 1; Index >= 0; --Index)
+	{
+		UStaticMeshComponent* Component = Watched[Index].Component.Get();
+		if (!Component || Now > Watched[Index].Until)
+		{
+			Watched.RemoveAtSwap(Index);
+			continue;
+		}
+
+		//Regrabbed props stay watched, letting go inside the intake stows them
+		const bool bInIntake = FVector::DistSquared(Component->Bounds.Origin, Center) <= FMath::Square(IntakeRadius + Component->Bounds.SphereRadius);
+		if (!bInIntake || !CanStow(Component)) continue;
+
+		Stow(Component);
+		Watched.RemoveAtSwap(Index);
+	}
+
+	if (PendingEjects > 0)
+	{
+		EjectCooldown -= DeltaTime;
+		if (EjectCooldown <= 0.f)
+		{
+			EjectNext();
+			EjectCooldown = EjectInterval;
+		}
+	}
+
+	if (Watched.Num() == 0 && PendingEjects == 0) SetComponentTickEnabled(false);
+}
+
+bool UShipCargoHoldComponent::CanStow(const UStaticMeshComponent* Component) const
+{
+	if (Items.Num() >= MaxItems || !Component->GetStaticMesh() || !Component->IsSimulatingPhysics()) return false;
+
+	//Pawns are never cargo, promoted debris belongs to its field's simulation and fracture pieces to their break
+	const AActor* Owner = Component->GetOwner();
+	if (!Owner || Owner == GetOwner() || Owner->IsA<APawn>() || Owner->IsA<ADebrisField>()) return false;
+
+	const UOryxFractureSubsystem* Fracture = GetWorld()->GetSubsystem<UOryxFractureSubsystem>();
+	if (Fracture && Fracture->IsRubble(Owner)) return false;
+
+	for (TActorIterator<AGravityGun> It(GetWorld()); It; ++It)
+	{
+		if (It->GetHeldComponent() == Component) return false;
+	}
+	return true;
+}
+
+void UShipCargoHoldComponent::Stow(UStaticMeshComponent* Component)
+{
+	FShipCargoItem& Item = Items.AddDefaulted_GetRef();
+	Item.Mesh = Component->GetStaticMesh();
+	Item.Materials = ObjectPtrDecay(Component->OverrideMaterials);
+	Item.Scale = FVector3f(Component->GetComponentScale());
+	Item.MassKg = Component->GetMass();
+	Item.CustomData = Component->GetCustomPrimitiveData().Data;
+
+	CargoMassKg += Item.MassKg;
+	UpdateShipMass();
+	UOryxEventSubsystem::Push(this, EOryxEventType::Stow, GetOwner(), Component, static_cast<uint8>(FMath::Min(Items.Num(), 255)));
+
+	UOryxPropPool::Retire(Component);
+	INC_DWORD_STAT(STAT_OryxCargoStowed);
+}
+
+void UShipCargoHoldComponent::Eject(int32 Count)
+{
+	if (!GetOwner()->HasAuthority()) return;
+
+	PendingEjects = FMath::Min(Count > 0 ? PendingEjects + Count : Items.Num(), Items.Num());
+	if (PendingEjects > 0) SetComponentTickEnabled(true);
+}
+
+void UShipCargoHoldComponent::EjectNext()
+{
+	UOryxPropPool* Pool = GetWorld()->GetSubsystem<UOryxPropPool>();
+	if (Items.Num() == 0 || !Pool)
+	{
+		PendingEjects = 0;
+		return;
+	}
+	--PendingEjects;
+
+	const FShipCargoItem Item = Items.Pop(EAllowShrinking::No);
+	CargoMassKg = FMath::Max(CargoMassKg - Item.MassKg, 0.f);
+	UpdateShipMass();
+	if (!Item.Mesh) return;
+
+	//Clear of the ship by EjectDistance whatever the prop's size
+	const AActor* Ship = GetOwner();
+	const FVector Direction = Ship->GetActorTransform().TransformVectorNoScale(EjectDirection.GetSafeNormal());
+	const float ItemRadius = Item.Mesh->GetBounds().SphereRadius * FVector(Item.Scale).GetAbsMax();
+	const FVector Location = GetComponentLocation() + Direction * (EjectDistance + ItemRadius);
+
+	AStaticMeshActor* Prop = Pool->Acquire(Item.Mesh, FTransform(Ship->GetActorQuat(), Location, FVector(Item.Scale)));
+	if (!Prop) return;
+
+	UStaticMeshComponent* Body = Prop->GetStaticMeshComponent();
+	for (int32 Index = 0; Index < Item.Materials.Num(); ++Index)
+	{
+		if (Item.Materials[Index]) Body->SetMaterial(Index, Item.Materials[Index]);
+	}
+	for (int32 Index = 0; Index < Item.CustomData.Num(); ++Index)
+		Body->SetCustomPrimitiveDataFloat(Index, Item.CustomData[Index]);
+
+	Body->SetMassOverrideInKg(NAME_None, Item.MassKg, true);
+	Body->SetPhysicsLinearVelocity(Ship->GetVelocity() + Direction * EjectSpeed);
+
+	UOryxEventSubsystem::Push(this, EOryxEventType::Eject, Ship, Body, static_cast<uint8>(FMath::Min(Items.Num(), 255)));
+}
+
+void UShipCargoHoldComponent::RestoreItems(TArray<FShipCargoItem> InItems)
+{
+	Items = MoveTemp(InItems);
+	PendingEjects = 0;
+
+	CargoMassKg = 0.f;
+	for (const FShipCargoItem& Item : Items)
+		CargoMassKg += Item.MassKg;
+	UpdateShipMass();
+}
+
+void UShipCargoHoldComponent::UpdateShipMass()
+{
+	if (!bCargoAddsMass || EmptyMassKg <= 0.f) return;
+
+	if (UPrimitiveComponent* Body = Cast<UPrimitiveComponent>(GetOwner()->GetRootComponent()))
+		Body->SetMassOverrideInKg(NAME_None, EmptyMassKg + CargoMassKg, true);
+}
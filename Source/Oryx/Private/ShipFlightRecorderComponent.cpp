@@ -0,0 +1,228 @@
+#include "ShipFlightRecorderComponent.h"
+#include "Oryx.h"
+#include "SpaceshipPawn.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+
+static constexpr uint32 FlightRecordMagic = 0x52465952; //"RYFR"
+static constexpr uint32 FlightRecordVersion = 1;
+
+//Live recorders, only changed on the game thread in BeginPlay/EndPlay
+static TArray<UShipFlightRecorderComponent*> GFlightRecorders;
+static FCriticalSection GFlightRecordersLock;
+static FDelegateHandle GFlightRecorderCrashHandle; //Registered while any recorder is alive
+
+//Runs inside the system error handler: the crashing thread may hold the lock or the allocator, so neither is touched
+static void DumpFlightRecordersOnCrash()
+{
+	for (UShipFlightRecorderComponent* Recorder : GFlightRecorders)
+		Recorder->DumpOnCrash();
+}
+
+//Header, then one contiguous column per field in the same order as the CSV header
+static void WriteColumnar(FArchive& Ar, const TArray<FShipFlightSample>& Samples)
+{
+	uint32 Magic = FlightRecordMagic;
+	uint32 Version = FlightRecordVersion;
+	int32 NumSamples = Samples.Num();
+	Ar << Magic << Version << NumSamples;
+
+	auto WriteColumn = [&](auto Getter)
+		{
+			for (const FShipFlightSample& S : Samples)
+			{
+				auto Value = Getter(S);
+				Ar << Value;
+			}
+		};
+
+	WriteColumn([](const FShipFlightSample& S) { return S.Time; });
+	WriteColumn([](const FShipFlightSample& S) { return S.Frame; });
+	WriteColumn([](const FShipFlightSample& S) { return S.LandingStage; });
+	WriteColumn([](const FShipFlightSample& S) { return S.ActiveThrusters; });
+	for (int32 Axis = 0; Axis < 3; ++Axis) WriteColumn([Axis](const FShipFlightSample& S) { return S.Location[Axis]; });
+	WriteColumn([](const FShipFlightSample& S) { return S.Rotation.X; });
+	WriteColumn([](const FShipFlightSample& S) { return S.Rotation.Y; });
+	WriteColumn([](const FShipFlightSample& S) { return S.Rotation.Z; });
+	WriteColumn([](const FShipFlightSample& S) { return S.Rotation.W; });
+	for (int32 Axis = 0; Axis < 3; ++Axis) WriteColumn([Axis](const FShipFlightSample& S) { return S.LinearVelocity[Axis]; });
+	for (int32 Axis = 0; Axis < 3; ++Axis) WriteColumn([Axis](const FShipFlightSample& S) { return S.AngularVelocity[Axis]; });
+	for (int32 Axis = 0; Axis < 3; ++Axis) WriteColumn([Axis](const FShipFlightSample& S) { return S.AppliedForce[Axis]; });
+}
+
+static FAutoConsoleCommand GOryxFlightRecorderDumpCommand(
+	TEXT("Oryx.FlightRecorder.Dump"),
+	TEXT("Oryx.FlightRecorder.Dump [csv|bin] - write every ship's flight recorder to Saved/FlightRecorder"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const bool bCsv = Args.Num() > 0 && Args[0].Equals(TEXT("csv"), ESearchCase::IgnoreCase);
+		const int32 NumFiles = UShipFlightRecorderComponent::DumpAll(bCsv);
+		UE_LOG(LogOryx, Display, TEXT("Flight recorder: wrote %d file(s)"), NumFiles);
+	}));
+
+UShipFlightRecorderComponent::UShipFlightRecorderComponent()
+{
+	//Sample after physics so the recorded state is the result of this frame's forces
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+}
+
+void UShipFlightRecorderComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	Ship = Cast<ASpaceshipPawn>(GetOwner());
+	Samples.SetNum(FMath::Max(Capacity, 1)); //Allocated once, never grows
+	WriteIndex.store(0);
+
+	//Everything the crash dump needs is allocated now, the crash path only copies into it
+	CrashSamples.Reserve(Samples.Num());
+	CrashBuffer.Reserve(64 + Samples.Num() * sizeof(FShipFlightSample));
+	const FString Directory = FPaths::ProjectSavedDir() / TEXT("FlightRecorder");
+	IFileManager::Get().MakeDirectory(*Directory, true);
+	CrashPath = Directory / FString::Printf(TEXT("%s_Crash.oryxflight"), *GetOwner()->GetName());
+
+	FScopeLock Lock(&GFlightRecordersLock);
+	GFlightRecorders.Add(this);
+
+	//Physics explosions usually end in a crash, so keep the last seconds of every ship
+	if (!GFlightRecorderCrashHandle.IsValid())
+		GFlightRecorderCrashHandle = FCoreDelegates::OnHandleSystemError.AddStatic(&DumpFlightRecordersOnCrash);
+}
+
+void UShipFlightRecorderComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	{
+		FScopeLock Lock(&GFlightRecordersLock);
+		GFlightRecorders.Remove(this);
+
+		//Last ship gone, which includes world teardown on shutdown
+		if (GFlightRecorders.Num() == 0 && GFlightRecorderCrashHandle.IsValid())
+		{
+			FCoreDelegates::OnHandleSystemError.Remove(GFlightRecorderCrashHandle);
+			GFlightRecorderCrashHandle.Reset();
+		}
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+void UShipFlightRecorderComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (!Ship || Samples.Num() == 0) return;
+
+	const uint64 Index = WriteIndex.load(std::memory_order_relaxed);
+	FShipFlightSample& Sample = Samples[Index % Samples.Num()];
+
+	Sample.Time = GetWorld()->GetTimeSeconds();
+	Sample.Frame = static_cast<uint32>(GFrameCounter);
+	Sample.LandingStage = static_cast<uint8>(Ship->GetLandingStage());
+	Sample.ActiveThrusters = static_cast<uint8>(Ship->GetActiveThrusters());
+	Sample.Location = Ship->GetActorLocation() + FVector(GetWorld()->OriginLocation); //Continuous across origin rebases
+	Sample.Rotation = FQuat4f(Ship->GetActorQuat());
+	Sample.AppliedForce = FVector3f(Ship->GetLastAppliedForce());
+
+	if (const UPrimitiveComponent* Body = Cast<UPrimitiveComponent>(Ship->GetRootComponent()))
+	{
+		Sample.LinearVelocity = FVector3f(Body->GetPhysicsLinearVelocity());
+		Sample.AngularVelocity = FVector3f(Body->GetPhysicsAngularVelocityInDegrees());
+	}
+
+	//Publish after the slot is fully written
+	WriteIndex.store(Index + 1, std::memory_order_release);
+}
+
+void UShipFlightRecorderComponent::CopySamples(TArray<FShipFlightSample>& OutSamples) const
+{
+	OutSamples.Reset();
+	const uint64 BufferSize = Samples.Num();
+	if (BufferSize == 0) return;
+
+	const uint64 End = WriteIndex.load(std::memory_order_acquire);
+	const uint64 Start = End > BufferSize ? End - BufferSize : 0;
+
+	OutSamples.Reserve(static_cast<int32>(End - Start));
+	for (uint64 Index = Start; Index < End; ++Index)
+		OutSamples.Add(Samples[Index % BufferSize]);
+
+	//The writer kept going while we copied: drop slots it may have overwritten
+	const uint64 EndAfterCopy = WriteIndex.load(std::memory_order_acquire);
+	const uint64 FirstValid = EndAfterCopy > BufferSize - 1 ? EndAfterCopy - (BufferSize - 1) : 0;
+	if (FirstValid > Start)
+		OutSamples.RemoveAt(0, static_cast<int32>(FMath::Min(FirstValid - Start, End - Start)), EAllowShrinking::No);
+}
+
+bool UShipFlightRecorderComponent::DumpCsv(const FString& Path) const
+{
+	TArray<FShipFlightSample> Copy;
+	CopySamples(Copy);
+
+	FString Csv = TEXT("Time,Frame,LandingStage,ActiveThrusters,LocX,LocY,LocZ,RotX,RotY,RotZ,RotW,VelX,VelY,VelZ,AngVelX,AngVelY,AngVelZ,ForceX,ForceY,ForceZ\n");
+	for (const FShipFlightSample& S : Copy)
+	{
+		Csv += FString::Printf(TEXT("%.4f,%u,%u,%u,%.2f,%.2f,%.2f,%.5f,%.5f,%.5f,%.5f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.1f,%.1f,%.1f\n"),
+			S.Time, S.Frame, S.LandingStage, S.ActiveThrusters,
+			S.Location.X, S.Location.Y, S.Location.Z,
+			S.Rotation.X, S.Rotation.Y, S.Rotation.Z, S.Rotation.W,
+			S.LinearVelocity.X, S.LinearVelocity.Y, S.LinearVelocity.Z,
+			S.AngularVelocity.X, S.AngularVelocity.Y, S.AngularVelocity.Z,
+			S.AppliedForce.X, S.AppliedForce.Y, S.AppliedForce.Z);
+	}
+	return FFileHelper::SaveStringToFile(Csv, *Path);
+}
+
+bool UShipFlightRecorderComponent::DumpColumnar(const FString& Path) const
+{
+	TArray<FShipFlightSample> Copy;
+	CopySamples(Copy);
+
+	TUniquePtr<FArchive> Ar(IFileManager::Get().CreateFileWriter(*Path));
+	if (!Ar) return false;
+
+	WriteColumnar(*Ar, Copy);
+	return Ar->Close();
+}
+
+void UShipFlightRecorderComponent::DumpOnCrash()
+{
+	//Both arrays were reserved for a full buffer in BeginPlay, so filling them doesn't allocate
+	CopySamples(CrashSamples);
+	CrashBuffer.Reset();
+	FMemoryWriter Ar(CrashBuffer);
+	WriteColumnar(Ar, CrashSamples);
+
+	//Opening the file is the one allocation left, the platform file layer skips the file manager's caches
+	if (IFileHandle* File = FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*CrashPath))
+	{
+		File->Write(CrashBuffer.GetData(), CrashBuffer.Num());
+		delete File;
+	}
+}
+
+int32 UShipFlightRecorderComponent::DumpAll(bool bCsv)
+{
+	const FString Directory = FPaths::ProjectSavedDir() / TEXT("FlightRecorder");
+	const FString Stamp = FDateTime::Now().ToString(TEXT("%Y%m%d-%H%M%S"));
+
+	FScopeLock Lock(&GFlightRecordersLock);
+
+	int32 NumWritten = 0;
+	for (const UShipFlightRecorderComponent* Recorder : GFlightRecorders)
+	{
+		const FString Name = Recorder->GetOwner() ? Recorder->GetOwner()->GetName() : TEXT("Ship");
+		const FString Path = Directory / FString::Printf(TEXT("%s_%s.%s"), *Name, *Stamp, bCsv ? TEXT("csv") : TEXT("oryxflight"));
+
+		if (bCsv ? Recorder->DumpCsv(Path) : Recorder->DumpColumnar(Path))
+			++NumWritten;
+	}
+	return NumWritten;
+}
@@ -0,0 +1,517 @@
+#include "ShipNavOctree.h"
+#include "Oryx.h"
+#include "Algo/Reverse.h"
+#include "Async/ParallelFor.h"
+
+static constexpr int32 MaxBuildDepth = 12; //4096 leaves across, plenty for a single map
+
+static FVector ChildCenter(const FVector& Center, float HalfSize, int32 Octant)
+{
+	const float Quarter = HalfSize * 0.5f;
+	return Center + FVector((Octant & 1) ? Quarter : -Quarter, (Octant & 2) ? Quarter : -Quarter, (Octant & 4) ? Quarter : -Quarter);
+}
+
+static constexpr int32 MaxCellsPerShape = 512; //Larger shapes skip the grid
+static constexpr int32 MaxCellsPerLookup = 64; //Larger cubes walk every shape instead
+
+void FShipNavGeometry::AddBox(const FVector& Center, const FQuat& Rotation, const FVector& HalfExtent)
+{
+	FShape& Shape = Shapes.AddDefaulted_GetRef();
+	Shape.Center = Center;
+	Shape.Axes[0] = Rotation.GetAxisX();
+	Shape.Axes[1] = Rotation.GetAxisY();
+	Shape.Axes[2] = Rotation.GetAxisZ();
+	Shape.HalfExtent = HalfExtent.GetAbs();
+}
+
+void FShipNavGeometry::AddSphere(const FVector& Center, float Radius)
+{
+	FShape& Shape = Shapes.AddDefaulted_GetRef();
+	Shape.Center = Center;
+	Shape.HalfExtent = FVector(FMath::Abs(Radius));
+	Shape.bSphere = true;
+}
+
+void FShipNavGeometry::Finalize(float InCellSize, float InInflate)
+{
+	CellSize = FMath::Max(InCellSize, 1.f);
+	Inflate = FMath::Max(InInflate, 0.f);
+	Cells.Reset();
+	LargeShapes.Reset();
+
+	for (int32 Index = 0; Index < Shapes.Num(); ++Index)
+	{
+		FShape& Shape = Shapes[Index];
+
+		//World extent of an oriented box is the sum of its axes' projections
+		FVector Extent = Shape.HalfExtent;
+		if (!Shape.bSphere)
+		{
+			Extent = FVector::ZeroVector;
+			for (int32 Axis = 0; Axis < 3; ++Axis)
+				Extent += Shape.Axes[Axis].GetAbs() * Shape.HalfExtent[Axis];
+		}
+		Shape.Bounds = FBox::BuildAABB(Shape.Center, Extent + FVector(Inflate));
+
+		const FIntVector Min = GetCell(Shape.Bounds.Min);
+		const FIntVector Max = GetCell(Shape.Bounds.Max);
+		if (static_cast<int64>(Max.X - Min.X + 1) * (Max.Y - Min.Y + 1) * (Max.Z - Min.Z + 1) > MaxCellsPerShape)
+		{
+			LargeShapes.Add(Index);
+			continue;
+		}
+
+		for (int32 Z = Min.Z; Z <= Max.Z; ++Z)
+			for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+				for (int32 X = Min.X; X <= Max.X; ++X)
+					Cells.FindOrAdd(FIntVector(X, Y, Z)).Add(Index);
+	}
+}
+
+FIntVector FShipNavGeometry::GetCell(const FVector& Location) const
+{
+	return FIntVector(FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize), FMath::FloorToInt32(Location.Z / CellSize));
+}
+
+bool FShipNavGeometry::Overlaps(const FVector& Center, float HalfSize) const
+{
+	const FBox Cube = FBox::BuildAABB(Center, FVector(HalfSize));
+	auto Test = [&](int32 Index)
+		{
+			const FShape& Shape = Shapes[Index];
+			return Shape.Bounds.Intersect(Cube) && Overlaps(Shape, Center, HalfSize);
+		};
+
+	const FIntVector Min = GetCell(Cube.Min);
+	const FIntVector Max = GetCell(Cube.Max);
+	if (static_cast<int64>(Max.X - Min.X + 1) * (Max.Y - Min.Y + 1) * (Max.Z - Min.Z + 1) > MaxCellsPerLookup)
+	{
+		//Cubes near the root, cheaper to check every shape's bounds than to visit their cells
+		for (int32 Index = 0; Index < Shapes.Num(); ++Index)
+			if (Test(Index)) return true;
+		return false;
+	}
+
+	for (const int32 Index : LargeShapes)
+		if (Test(Index)) return true;
+
+	for (int32 Z = Min.Z; Z <= Max.Z; ++Z)
+		for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+			for (int32 X = Min.X; X <= Max.X; ++X)
+			{
+				if (const TArray<int32>* InCell = Cells.Find(FIntVector(X, Y, Z)))
+				{
+					for (const int32 Index : *InCell)
+						if (Test(Index)) return true;
+				}
+			}
+	return false;
+}
+
+bool FShipNavGeometry::Overlaps(const FShape& Shape, const FVector& Center, float HalfSize) const
+{
+	//The cube grows by Inflate rather than the shape, same as the overlap tests this replaces
+	const double Half = HalfSize + Inflate;
+	const FVector T = Shape.Center - Center;
+
+	if (Shape.bSphere)
+	{
+		const FVector Outside(FMath::Max(FMath::Abs(T.X) - Half, 0.0), FMath::Max(FMath::Abs(T.Y) - Half, 0.0), FMath::Max(FMath::Abs(T.Z) - Half, 0.0));
+		return Outside.SizeSquared() <= FMath::Square(Shape.HalfExtent.X);
+	}
+
+	//Separating axis test of an axis aligned cube against an oriented box (Ericson, Real-Time Collision Detection 4.4)
+	double R[3][3], AbsR[3][3];
+	for (int32 I = 0; I < 3; ++I)
+		for (int32 J = 0; J < 3; ++J)
+		{
+			R[I][J] = Shape.Axes[J][I];
+			AbsR[I][J] = FMath::Abs(R[I][J]) + UE_KINDA_SMALL_NUMBER; //Parallel edges would give a zero cross product
+		}
+
+	const FVector& E = Shape.HalfExtent;
+	for (int32 I = 0; I < 3; ++I)
+	{
+		if (FMath::Abs(T[I]) > Half + E.X * AbsR[I][0] + E.Y * AbsR[I][1] + E.Z * AbsR[I][2]) return false;
+	}
+	for (int32 J = 0; J < 3; ++J)
+	{
+		if (FMath::Abs(T | Shape.Axes[J]) > Half * (AbsR[0][J] + AbsR[1][J] + AbsR[2][J]) + E[J]) return false;
+	}
+	for (int32 I = 0; I < 3; ++I)
+	{
+		const int32 I1 = (I + 1) % 3, I2 = (I + 2) % 3;
+		for (int32 J = 0; J < 3; ++J)
+		{
+			const int32 J1 = (J + 1) % 3, J2 = (J + 2) % 3;
+			const double Ra = Half * (AbsR[I1][J] + AbsR[I2][J]);
+			const double Rb = E[J1] * AbsR[I][J2] + E[J2] * AbsR[I][J1];
+			if (FMath::Abs(T[I2] * R[I1][J] - T[I1] * R[I2][J]) > Ra + Rb) return false;
+		}
+	}
+	return true;
+}
+
+bool FShipNavOctree::Build(const FBox& Bounds, float InLeafSize, const FBlockedTest& IsBlocked, const std::atomic<bool>& bCancel)
+{
+	Nodes.Reset();
+	Neighbours.Reset();
+	NumFreeLeaves = 0;
+	LeafSize = FMath::Max(InLeafSize, 1.f);
+
+	//Cube around the bounds, sized so repeated halving lands exactly on LeafSize. Bounds wider than the deepest tree
+	//covers get coarser leaves instead of being cut off
+	const float Extent = Bounds.GetExtent().GetMax() * 2.f;
+	const float MaxExtent = LeafSize * (1 << MaxBuildDepth);
+	if (Extent > MaxExtent)
+	{
+		const float GrownLeafSize = FMath::CeilToFloat(Extent / (1 << MaxBuildDepth));
+		UE_LOG(LogOryx, Warning, TEXT("Ship nav: bounds of %.0f cm exceed %d leaves of %.0f cm, building with %.0f cm leaves"),
+			Extent, 1 << MaxBuildDepth, LeafSize, GrownLeafSize);
+		LeafSize = GrownLeafSize;
+	}
+	const int32 Depth = FMath::Clamp(FMath::CeilToInt(FMath::Log2(Extent / LeafSize)), 2, MaxBuildDepth);
+	const float RootHalfSize = LeafSize * (1 << Depth) * 0.5f;
+	const FVector RootCenter = Bounds.GetCenter();
+
+	//The top two levels are always split so the 64 cells below them can be built in parallel
+	Nodes.AddDefaulted(1 + 8 + 64);
+	Nodes[0].Center = FVector3f(RootCenter);
+	Nodes[0].HalfSize = RootHalfSize;
+	Nodes[0].FirstChild = 1;
+	for (int32 Octant = 0; Octant < 8; ++Octant)
+	{
+		FShipNavNode& Child = Nodes[1 + Octant];
+		Child.Center = FVector3f(ChildCenter(RootCenter, RootHalfSize, Octant));
+		Child.HalfSize = RootHalfSize * 0.5f;
+		Child.FirstChild = 9 + Octant * 8;
+	}
+	for (int32 Cell = 0; Cell < 64; ++Cell)
+	{
+		const FShipNavNode& Parent = Nodes[1 + Cell / 8];
+		Nodes[9 + Cell].Center = FVector3f(ChildCenter(FVector(Parent.Center), Parent.HalfSize, Cell % 8));
+		Nodes[9 + Cell].HalfSize = Parent.HalfSize * 0.5f;
+	}
+
+	TArray<TArray<FShipNavNode>> Subtrees;
+	Subtrees.SetNum(64);
+	ParallelFor(64, [&](int32 Cell)
+		{
+			const FShipNavNode& Root = Nodes[9 + Cell];
+			Subtrees[Cell].AddDefaulted();
+			BuildNode(Subtrees[Cell], 0, FVector(Root.Center), Root.HalfSize, IsBlocked, bCancel);
+		});
+
+	if (bCancel.load())
+	{
+		Nodes.Reset();
+		return false;
+	}
+
+	//Stitch the subtrees in, each local root replaces its placeholder cell
+	for (int32 Cell = 0; Cell < 64; ++Cell)
+	{
+		const TArray<FShipNavNode>& Local = Subtrees[Cell];
+		const int32 Offset = Nodes.Num() - 1; //Local index 1 lands at Nodes.Num()
+
+		auto Remap = [Offset](FShipNavNode Node)
+			{
+				if (!Node.IsLeaf()) Node.FirstChild += Offset;
+				return Node;
+			};
+
+		Nodes[9 + Cell] = Remap(Local[0]);
+		for (int32 Index = 1; Index < Local.Num(); ++Index)
+			Nodes.Add(Remap(Local[Index]));
+	}
+
+	BuildNeighbours();
+	return !bCancel.load();
+}
+
+void FShipNavOctree::BuildNode(TArray<FShipNavNode>& OutNodes, int32 Index, const FVector& Center, float HalfSize, const FBlockedTest& IsBlocked, const std::atomic<bool>& bCancel) const
+{
+	OutNodes[Index].Center = FVector3f(Center);
+	OutNodes[Index].HalfSize = HalfSize;
+
+	//Open space stays one big leaf
+	if (bCancel.load(std::memory_order_relaxed) || !IsBlocked(Center, HalfSize)) return;
+
+	if (HalfSize * 2.f <= LeafSize * 1.01f)
+	{
+		OutNodes[Index].bBlocked = true;
+		return;
+	}
+
+	//Children are allocated together so a node only needs the index of the first
+	const int32 FirstChild = OutNodes.AddDefaulted(8);
+	OutNodes[Index].FirstChild = FirstChild;
+	for (int32 Octant = 0; Octant < 8; ++Octant)
+		BuildNode(OutNodes, FirstChild + Octant, ChildCenter(Center, HalfSize, Octant), HalfSize * 0.5f, IsBlocked, bCancel);
+}
+
+void FShipNavOctree::BuildNeighbours()
+{
+	TArray<int32> FreeLeaves;
+	for (int32 Index = 0; Index < Nodes.Num(); ++Index)
+	{
+		if (Nodes[Index].IsLeaf() && !Nodes[Index].bBlocked) FreeLeaves.Add(Index);
+	}
+	NumFreeLeaves = FreeLeaves.Num();
+
+	TArray<TArray<int32>> LeafNeighbours;
+	LeafNeighbours.SetNum(FreeLeaves.Num());
+
+	ParallelFor(FreeLeaves.Num(), [&](int32 Slot)
+		{
+			const FShipNavNode& Node = Nodes[FreeLeaves[Slot]];
+			const FVector Center(Node.Center);
+
+			//A flat slab just past each face, inset so leaves touching only at an edge or corner don't count
+			const float Skin = LeafSize * 0.25f;
+			for (int32 Axis = 0; Axis < 3; ++Axis)
+			{
+				for (const float Side : { -1.f, 1.f })
+				{
+					FVector Min = Center - FVector(Node.HalfSize - Skin);
+					FVector Max = Center + FVector(Node.HalfSize - Skin);
+					Min[Axis] = Max[Axis] = Center[Axis] + Side * (Node.HalfSize + Skin);
+					QueryFreeLeaves(0, FBox(Min, Max), LeafNeighbours[Slot]);
+				}
+			}
+		});
+
+	//Flatten into one array so the search touches a single allocation
+	for (int32 Slot = 0; Slot < FreeLeaves.Num(); ++Slot)
+	{
+		FShipNavNode& Node = Nodes[FreeLeaves[Slot]];
+		Node.FirstNeighbour = Neighbours.Num();
+		Node.NumNeighbours = LeafNeighbours[Slot].Num();
+		Neighbours.Append(LeafNeighbours[Slot]);
+	}
+}
+
+int32 FShipNavOctree::FindLeaf(const FVector& Location) const
+{
+	if (!IsValid() || !Nodes[0].GetBox().IsInsideOrOn(Location)) return INDEX_NONE;
+
+	int32 Index = 0;
+	while (!Nodes[Index].IsLeaf())
+	{
+		const FVector3f& Center = Nodes[Index].Center;
+		const int32 Octant = (Location.X >= Center.X ? 1 : 0) | (Location.Y >= Center.Y ? 2 : 0) | (Location.Z >= Center.Z ? 4 : 0);
+		Index = Nodes[Index].FirstChild + Octant;
+	}
+	return Index;
+}
+
+int32 FShipNavOctree::FindNearestFreeLeaf(const FVector& Location, float SearchRadius) const
+{
+	const int32 Leaf = FindLeaf(Location);
+	if (Leaf != INDEX_NONE && !Nodes[Leaf].bBlocked) return Leaf;
+
+	TArray<int32> Candidates;
+	QueryFreeLeaves(FBox::BuildAABB(Location, FVector(SearchRadius)), Candidates);
+
+	int32 Best = INDEX_NONE;
+	double BestDistanceSq = TNumericLimits<double>::Max();
+	for (const int32 Candidate : Candidates)
+	{
+		const double DistanceSq = Nodes[Candidate].GetBox().ComputeSquaredDistanceToPoint(Location);
+		if (DistanceSq < BestDistanceSq)
+		{
+			BestDistanceSq = DistanceSq;
+			Best = Candidate;
+		}
+	}
+	return Best;
+}
+
+void FShipNavOctree::QueryFreeLeaves(const FBox& Box, TArray<int32>& OutLeaves) const
+{
+	if (IsValid()) QueryFreeLeaves(0, Box, OutLeaves);
+}
+
+void FShipNavOctree::QueryFreeLeaves(int32 NodeIndex, const FBox& Box, TArray<int32>& OutLeaves) const
+{
+	const FShipNavNode& Node = Nodes[NodeIndex];
+	if (!Node.GetBox().Intersect(Box)) return;
+
+	if (Node.IsLeaf())
+	{
+		if (!Node.bBlocked) OutLeaves.Add(NodeIndex);
+		return;
+	}
+
+	for (int32 Octant = 0; Octant < 8; ++Octant)
+		QueryFreeLeaves(Node.FirstChild + Octant, Box, OutLeaves);
+}
+
+bool FShipNavOctree::IsSegmentFree(const FVector& A, const FVector& B) const
+{
+	const FVector Delta = B - A;
+	const double Length = Delta.Size();
+	const FVector Direction = Length > UE_KINDA_SMALL_NUMBER ? Delta / Length : FVector::ZeroVector;
+	const double Nudge = LeafSize * 0.01; //Steps over the shared face into the next leaf
+
+	double Distance = 0.0;
+	while (true)
+	{
+		const FVector Point = A + Direction * Distance;
+		const int32 Leaf = FindLeaf(Point);
+		if (Leaf == INDEX_NONE || Nodes[Leaf].bBlocked) return false;
+		if (Distance >= Length) return true;
+
+		//Distance along the segment to where it leaves this leaf
+		const FShipNavNode& Node = Nodes[Leaf];
+		double Exit = TNumericLimits<double>::Max();
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			if (Direction[Axis] > UE_SMALL_NUMBER)
+				Exit = FMath::Min(Exit, (Node.Center[Axis] + Node.HalfSize - Point[Axis]) / Direction[Axis]);
+			else if (Direction[Axis] < -UE_SMALL_NUMBER)
+				Exit = FMath::Min(Exit, (Node.Center[Axis] - Node.HalfSize - Point[Axis]) / Direction[Axis]);
+		}
+
+		Distance = FMath::Min(Distance + FMath::Max(Exit, 0.0) + Nudge, Length);
+	}
+}
+
+EShipNavResult FShipNavOctree::FindPath(const FVector& Start, const FVector& End, int32 MaxExpansions, TArray<FVector>& OutPath) const
+{
+	OutPath.Reset();
+	if (!IsValid()) return EShipNavResult::Failed;
+
+	//Endpoints inside geometry snap to the closest free leaf
+	const float SnapRadius = LeafSize * 4.f;
+	const int32 StartLeaf = FindNearestFreeLeaf(Start, SnapRadius);
+	const int32 GoalLeaf = FindNearestFreeLeaf(End, SnapRadius);
+	if (StartLeaf == INDEX_NONE || GoalLeaf == INDEX_NONE) return EShipNavResult::Failed;
+
+	if (StartLeaf == GoalLeaf || IsSegmentFree(Start, End))
+	{
+		OutPath = { Start, End };
+		return EShipNavResult::Success;
+	}
+
+	struct FSearchNode
+	{
+		FVector Position;
+		double Cost = 0.0;
+		int32 Parent = INDEX_NONE;
+		bool bClosed = false;
+	};
+
+	struct FOpenEntry
+	{
+		double Estimate;
+		int32 Leaf;
+	};
+	auto Cheapest = [](const FOpenEntry& A, const FOpenEntry& B) { return A.Estimate < B.Estimate; };
+
+	//The endpoint leaves use the real endpoints so the first and last legs are exact
+	auto PositionOf = [&](int32 Leaf)
+		{
+			return Leaf == StartLeaf ? Start : Leaf == GoalLeaf ? End : FVector(Nodes[Leaf].Center);
+		};
+
+	TMap<int32, FSearchNode> Visited;
+	Visited.Reserve(FMath::Min(MaxExpansions * 4, 65536));
+	TArray<FOpenEntry> Open;
+
+	Visited.Add(StartLeaf, { Start, 0.0, INDEX_NONE, false });
+	Open.HeapPush({ FVector::Dist(Start, End), StartLeaf }, Cheapest);
+
+	int32 Closest = StartLeaf;
+	double ClosestDistance = FVector::Dist(Start, End);
+	int32 Expansions = 0;
+	bool bReachedGoal = false;
+
+	while (Open.Num() > 0)
+	{
+		FOpenEntry Entry;
+		Open.HeapPop(Entry, Cheapest, EAllowShrinking::No);
+
+		//Copied out, Visited may rehash while the neighbours are added
+		FSearchNode Current = Visited[Entry.Leaf];
+		if (Current.bClosed) continue;
+		Visited[Entry.Leaf].bClosed = true;
+
+		if (Entry.Leaf == GoalLeaf)
+		{
+			bReachedGoal = true;
+			break;
+		}
+		if (++Expansions > MaxExpansions) break;
+
+		const double DistanceToGoal = FVector::Dist(Current.Position, End);
+		if (DistanceToGoal < ClosestDistance)
+		{
+			ClosestDistance = DistanceToGoal;
+			Closest = Entry.Leaf;
+		}
+
+		const FShipNavNode& Node = Nodes[Entry.Leaf];
+		for (int32 Slot = 0; Slot < Node.NumNeighbours; ++Slot)
+		{
+			const int32 Neighbour = Neighbours[Node.FirstNeighbour + Slot];
+			const FSearchNode* Existing = Visited.Find(Neighbour);
+			if (Existing && Existing->bClosed) continue;
+
+			const FVector NeighbourPosition = PositionOf(Neighbour);
+
+			//Theta*: link straight to our parent when it can see the neighbour, cutting the corner through us
+			int32 Parent = Entry.Leaf;
+			FVector ParentPosition = Current.Position;
+			double ParentCost = Current.Cost;
+			if (Current.Parent != INDEX_NONE)
+			{
+				const FSearchNode& GrandParent = Visited[Current.Parent];
+				if (IsSegmentFree(GrandParent.Position, NeighbourPosition))
+				{
+					Parent = Current.Parent;
+					ParentPosition = GrandParent.Position;
+					ParentCost = GrandParent.Cost;
+				}
+			}
+
+			const double Cost = ParentCost + FVector::Dist(ParentPosition, NeighbourPosition);
+			if (Existing && Cost >= Existing->Cost) continue;
+
+			Visited.Add(Neighbour, { NeighbourPosition, Cost, Parent, false });
+			Open.HeapPush({ Cost + FVector::Dist(NeighbourPosition, End), Neighbour }, Cheapest);
+		}
+	}
+
+	//Out of budget or disconnected: head for whatever got closest
+	const int32 Last = bReachedGoal ? GoalLeaf : Closest;
+	if (Last == StartLeaf) return EShipNavResult::Failed;
+
+	for (int32 Leaf = Last; Leaf != INDEX_NONE; Leaf = Visited[Leaf].Parent)
+		OutPath.Add(Visited[Leaf].Position);
+	Algo::Reverse(OutPath);
+
+	return bReachedGoal ? EShipNavResult::Success : EShipNavResult::Partial;
+}
+
+void FShipNavOctree::Serialize(FArchive& Ar)
+{
+	Ar << LeafSize << NumFreeLeaves;
+
+	int32 NumNodes = Nodes.Num();
+	Ar << NumNodes;
+	if (Ar.IsLoading())
+	{
+		if (NumNodes < 0)
+		{
+			Ar.SetError();
+			return;
+		}
+		Nodes.SetNum(NumNodes);
+	}
+
+	for (FShipNavNode& Node : Nodes)
+		Ar << Node.Center << Node.HalfSize << Node.FirstChild << Node.bBlocked << Node.FirstNeighbour << Node.NumNeighbours;
+
+	Ar << Neighbours;
+}
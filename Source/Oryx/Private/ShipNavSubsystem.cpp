@@ -0,0 +1,326 @@
+#include "ShipNavSubsystem.h"
+#include "Oryx.h"
+#include "EngineUtils.h"
+#include "Engine/World.h"
+#include "Components/PrimitiveComponent.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Paths.h"
+
+DECLARE_CYCLE_STAT(TEXT("Ship nav dispatch"), STAT_ShipNavDispatch, STATGROUP_Oryx);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ship nav queries in flight"), STAT_ShipNavQueriesInFlight, STATGROUP_Oryx);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ship nav queries pending"), STAT_ShipNavQueriesPending, STATGROUP_Oryx);
+
+static constexpr uint32 NavCacheMagic = 0x564E524F; //"ORNV"
+static constexpr uint32 NavCacheVersion = 2;
+
+static FAutoConsoleCommandWithWorld GOryxNavRebuildCommand(
+	TEXT("Oryx.Nav.Rebuild"),
+	TEXT("Rebuild the ship navigation octree for this map, ignoring the cache"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UShipNavSubsystem* Nav = World ? World->GetSubsystem<UShipNavSubsystem>() : nullptr)
+			Nav->Rebuild(false);
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs GOryxNavBenchCommand(
+	TEXT("Oryx.Nav.Bench"),
+	TEXT("Oryx.Nav.Bench [Count] - time Count path queries between random free points"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (const UShipNavSubsystem* Nav = World ? World->GetSubsystem<UShipNavSubsystem>() : nullptr)
+			Nav->RunBenchmark(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000);
+	}));
+
+bool UShipNavSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShipNavSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+	Rebuild(true);
+}
+
+void UShipNavSubsystem::Deinitialize()
+{
+	CancelBuild();
+
+	//Searches only read the octree they hold a reference to, but their delegates must not outlive the world
+	for (const TSharedPtr<FQuery>& Query : RunningQueries)
+		Query->Task.Wait();
+	RunningQueries.Reset();
+	PendingQueries.Reset();
+	Octree.Reset();
+
+	Super::Deinitialize();
+}
+
+void UShipNavSubsystem::CancelBuild()
+{
+	if (!BuildTask.IsValid()) return;
+
+	bCancelBuild = true;
+	BuildTask.Wait();
+	BuildTask = UE::Tasks::FTask();
+	BuildingOctree.Reset();
+}
+
+FVector UShipNavSubsystem::GetOriginOffset() const
+{
+	return FVector(GetWorld()->OriginLocation);
+}
+
+//Simple collision of Primitive in the octree's frame. Without any (landscape, complex as simple) its bounds stand in
+static void GatherCollision(const UPrimitiveComponent& Primitive, const FVector& Offset, FShipNavGeometry& Geometry)
+{
+	const UBodySetup* BodySetup = Primitive.GetBodySetup();
+	if (!BodySetup || BodySetup->AggGeom.GetElementCount() == 0)
+	{
+		const FBox Box = Primitive.Bounds.GetBox();
+		Geometry.AddBox(Box.GetCenter() + Offset, FQuat::Identity, Box.GetExtent());
+		return;
+	}
+
+	//Scale is applied per element axis, the way physics does it
+	const FTransform ComponentTM = Primitive.GetComponentTransform();
+	auto AddElement = [&](const FTransform& ElementTM, const FVector& HalfExtent)
+		{
+			const FTransform WorldTM = ElementTM * ComponentTM;
+			Geometry.AddBox(WorldTM.GetLocation() + Offset, WorldTM.GetRotation(), HalfExtent * WorldTM.GetScale3D().GetAbs());
+		};
+
+	const FKAggregateGeom& Agg = BodySetup->AggGeom;
+	for (const FKBoxElem& Box : Agg.BoxElems)
+		AddElement(Box.GetTransform(), FVector(Box.X, Box.Y, Box.Z) * 0.5f);
+	for (const FKSphylElem& Sphyl : Agg.SphylElems)
+		AddElement(Sphyl.GetTransform(), FVector(Sphyl.Radius, Sphyl.Radius, Sphyl.Length * 0.5f + Sphyl.Radius));
+	for (const FKTaperedCapsuleElem& Capsule : Agg.TaperedCapsuleElems)
+	{
+		const float Radius = FMath::Max(Capsule.Radius0, Capsule.Radius1);
+		AddElement(Capsule.GetTransform(), FVector(Radius, Radius, Capsule.Length * 0.5f + Radius));
+	}
+	for (const FKConvexElem& Convex : Agg.ConvexElems)
+		AddElement(FTransform(Convex.ElemBox.GetCenter()) * Convex.GetTransform(), Convex.ElemBox.GetExtent());
+	for (const FKSphereElem& Sphere : Agg.SphereElems)
+		Geometry.AddSphere(ComponentTM.TransformPosition(Sphere.Center) + Offset, Sphere.Radius * ComponentTM.GetScale3D().GetAbsMax());
+}
+
+uint32 UShipNavSubsystem::GatherStaticGeometry(FBox& OutBounds, FShipNavGeometry* OutGeometry) const
+{
+	OutBounds.Init();
+	uint32 Fingerprint = 0;
+	const FVector Offset = GetOriginOffset();
+
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		It->ForEachComponent<UPrimitiveComponent>(false, [&](const UPrimitiveComponent* Primitive)
+			{
+				if (Primitive->Mobility != EComponentMobility::Static || !Primitive->IsCollisionEnabled() ||
+					Primitive->GetCollisionObjectType() != ECC_WorldStatic) return;
+
+				const FBox Box = Primitive->Bounds.GetBox().ShiftBy(Offset);
+				OutBounds += Box;
+
+				//Summed so the result doesn't depend on actor iteration order
+				Fingerprint += FCrc::MemCrc32(&Box.Max, sizeof(Box.Max), FCrc::MemCrc32(&Box.Min, sizeof(Box.Min)));
+
+				if (OutGeometry) GatherCollision(*Primitive, Offset, *OutGeometry);
+			});
+	}
+
+	OutBounds = OutBounds.IsValid ? OutBounds.ExpandBy(BoundsPadding) : FBox::BuildAABB(Offset, FVector(BoundsPadding));
+	return Fingerprint;
+}
+
+FString UShipNavSubsystem::GetCachePath() const
+{
+	return FPaths::ProjectSavedDir() / TEXT("ShipNav") / UWorld::RemovePIEPrefix(GetWorld()->GetMapName()) + TEXT(".oryxnav");
+}
+
+bool UShipNavSubsystem::LoadCache(const FString& Path, uint32 Fingerprint)
+{
+	TUniquePtr<FArchive> Ar(IFileManager::Get().CreateFileReader(*Path));
+	if (!Ar) return false;
+
+	uint32 Magic = 0, Version = 0, CachedFingerprint = 0;
+	float CachedLeafSize = 0.f, CachedAgentRadius = 0.f;
+	*Ar << Magic << Version << CachedFingerprint << CachedLeafSize << CachedAgentRadius;
+
+	//Any change to the level's static collision or the build settings invalidates the cache
+	if (Magic != NavCacheMagic || Version != NavCacheVersion || CachedFingerprint != Fingerprint ||
+		CachedLeafSize != LeafSize || CachedAgentRadius != AgentRadius)
+		return false;
+
+	TSharedPtr<FShipNavOctree> Loaded = MakeShared<FShipNavOctree>();
+	Loaded->Serialize(*Ar);
+	if (Ar->IsError() || !Loaded->IsValid()) return false;
+
+	Octree = Loaded;
+	UE_LOG(LogOryx, Log, TEXT("Ship nav: loaded %d nodes (%d free leaves) from %s"), Octree->GetNumNodes(), Octree->GetNumFreeLeaves(), *Path);
+	return true;
+}
+
+bool UShipNavSubsystem::SaveCache(const FString& Path, uint32 Fingerprint, float RequestedLeafSize, float BuiltAgentRadius, FShipNavOctree& Built)
+{
+	TUniquePtr<FArchive> Ar(IFileManager::Get().CreateFileWriter(*Path));
+	if (!Ar) return false;
+
+	uint32 Magic = NavCacheMagic;
+	uint32 Version = NavCacheVersion;
+	//The configured leaf size, not the built one, which grows on maps too large for it
+	*Ar << Magic << Version << Fingerprint << RequestedLeafSize << BuiltAgentRadius;
+	Built.Serialize(*Ar);
+
+	return Ar->Close();
+}
+
+void UShipNavSubsystem::Rebuild(bool bUseCache)
+{
+	UWorld* World = GetWorld();
+	if (!World) return;
+
+	CancelBuild();
+
+	FBox Bounds;
+	const uint32 Fingerprint = GatherStaticGeometry(Bounds, nullptr);
+	const FString CachePath = GetCachePath();
+	if (bUseCache && LoadCache(CachePath, Fingerprint)) return;
+
+	//Workers can't query the physics scene, so the collision is copied out here and they only test the copy
+	TSharedPtr<FShipNavGeometry> Geometry = MakeShared<FShipNavGeometry>();
+	GatherStaticGeometry(Bounds, Geometry.Get());
+
+	UE_LOG(LogOryx, Log, TEXT("Ship nav: building octree over %s from %d shapes"), *Bounds.ToString(), Geometry->GetNumShapes());
+
+	bCancelBuild = false;
+	bBuildSucceeded = false;
+	BuildStartTime = FPlatformTime::Seconds();
+	BuildingOctree = MakeShared<FShipNavOctree>();
+
+	BuildTask = UE::Tasks::Launch(UE_SOURCE_LOCATION,
+		[this, Building = BuildingOctree, Geometry, Bounds, Fingerprint, CachePath, Inflate = AgentRadius, Leaf = LeafSize]()
+		{
+			Geometry->Finalize(Leaf * 8.f, Inflate);
+			const FShipNavOctree::FBlockedTest IsBlocked = [Geometry](const FVector& Center, float HalfSize)
+				{
+					return Geometry->Overlaps(Center, HalfSize);
+				};
+			if (!Building->Build(Bounds, Leaf, IsBlocked, bCancelBuild)) return;
+
+			bBuildSucceeded = true;
+			if (!SaveCache(CachePath, Fingerprint, Leaf, Inflate, *Building))
+				UE_LOG(LogOryx, Warning, TEXT("Ship nav: failed to write cache %s"), *CachePath);
+		});
+}
+
+void UShipNavSubsystem::RequestPath(const FVector& Start, const FVector& End, FOnShipNavPathFound OnFound)
+{
+	TSharedPtr<FQuery> Query = MakeShared<FQuery>();
+	Query->Start = Start + GetOriginOffset();
+	Query->End = End + GetOriginOffset();
+	Query->OnFound = MoveTemp(OnFound);
+	PendingQueries.Add(Query);
+}
+
+void UShipNavSubsystem::Tick(float DeltaTime)
+{
+	if (BuildTask.IsValid() && BuildTask.IsCompleted())
+	{
+		if (bBuildSucceeded)
+		{
+			Octree = BuildingOctree;
+			UE_LOG(LogOryx, Log, TEXT("Ship nav: built %d nodes (%d free leaves) in %.2f s"),
+				Octree->GetNumNodes(), Octree->GetNumFreeLeaves(), FPlatformTime::Seconds() - BuildStartTime);
+		}
+		BuildTask = UE::Tasks::FTask();
+		BuildingOctree.Reset();
+	}
+
+	DispatchQueries();
+}
+
+void UShipNavSubsystem::DispatchQueries()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShipNavDispatch);
+
+	//Results are delivered here so callers never see a callback from a worker, in the world's current frame
+	const FVector Offset = GetOriginOffset();
+	for (int32 Index = 0; Index < RunningQueries.Num();)
+	{
+		const TSharedPtr<FQuery>& Query = RunningQueries[Index];
+		if (!Query->Task.IsCompleted())
+		{
+			++Index;
+			continue;
+		}
+
+		for (FVector& Point : Query->Path)
+			Point -= Offset;
+		Query->OnFound.ExecuteIfBound(Query->Result, Query->Path);
+		RunningQueries.RemoveAt(Index, EAllowShrinking::No); //Keep request order
+	}
+
+	//Queries wait until an octree exists (first build of a map, or after Oryx.Nav.Rebuild with no cache)
+	if (Octree.IsValid())
+	{
+		const int32 NumToStart = FMath::Min(PendingQueries.Num(), MaxQueriesInFlight - RunningQueries.Num());
+		for (int32 Index = 0; Index < NumToStart; ++Index)
+		{
+			TSharedPtr<FQuery> Query = PendingQueries[Index];
+			Query->Task = UE::Tasks::Launch(UE_SOURCE_LOCATION,
+				[Query, Searched = Octree, Budget = MaxExpansionsPerQuery]()
+				{
+					Query->Result = Searched->FindPath(Query->Start, Query->End, Budget, Query->Path);
+				});
+			RunningQueries.Add(MoveTemp(Query));
+		}
+		PendingQueries.RemoveAt(0, FMath::Max(NumToStart, 0), EAllowShrinking::No);
+	}
+
+	SET_DWORD_STAT(STAT_ShipNavQueriesInFlight, RunningQueries.Num());
+	SET_DWORD_STAT(STAT_ShipNavQueriesPending, PendingQueries.Num());
+}
+
+void UShipNavSubsystem::RunBenchmark(int32 Count) const
+{
+	if (!Octree.IsValid() || Count <= 0)
+	{
+		UE_LOG(LogOryx, Warning, TEXT("Ship nav bench: no octree yet"));
+		return;
+	}
+
+	//Endpoints are drawn up front so only the searches are timed
+	const FBox Bounds = Octree->GetNode(0).GetBox();
+	TArray<TPair<FVector, FVector>> Endpoints;
+	for (int32 Index = 0; Index < Count; ++Index)
+		Endpoints.Emplace(FMath::RandPointInBox(Bounds), FMath::RandPointInBox(Bounds));
+
+	std::atomic<int32> NumSuccess{ 0 };
+	std::atomic<int32> NumPartial{ 0 };
+
+	const double StartTime = FPlatformTime::Seconds();
+	ParallelFor(Count, [&](int32 Index)
+		{
+			TArray<FVector> Path;
+			switch (Octree->FindPath(Endpoints[Index].Key, Endpoints[Index].Value, MaxExpansionsPerQuery, Path))
+			{
+			case EShipNavResult::Success: ++NumSuccess; break;
+			case EShipNavResult::Partial: ++NumPartial; break;
+			default: break;
+			}
+		});
+	const double Elapsed = FPlatformTime::Seconds() - StartTime;
+
+	UE_LOG(LogOryx, Display, TEXT("Ship nav bench: %d queries in %.1f ms (%.0f/s), %d found, %d partial, %d failed"),
+		Count, Elapsed * 1000.0, Count / FMath::Max(Elapsed, UE_SMALL_NUMBER), NumSuccess.load(), NumPartial.load(),
+		Count - NumSuccess.load() - NumPartial.load());
+}
+
+TStatId UShipNavSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShipNavSubsystem, STATGROUP_Tickables);
+}
@@ -0,0 +1,119 @@
+#include "ShipStreamingSourceComponent.h"
+#include "Oryx.h"
+#include "SpaceshipPawn.h"
+#include "LandingPad.h"
+#include "Engine/World.h"
+#include "WorldPartition/WorldPartitionSubsystem.h"
+
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Ship streaming stall (ms)"), STAT_OryxStreamingStallMs, STATGROUP_Oryx);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Ship streaming stall total (s)"), STAT_OryxStreamingStallTotal, STATGROUP_Oryx);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ship look-ahead sources"), STAT_OryxStreamingLookAheads, STATGROUP_Oryx);
+
+UShipStreamingSourceComponent::UShipStreamingSourceComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+}
+
+void UShipStreamingSourceComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	Ship = Cast<ASpaceshipPawn>(GetOwner());
+	NumLookAheads = LookAheadTimes.Num();
+
+	//Names are built once, the world partition asks for sources every frame
+	for (int32 Index = 0; Index < LookAheadTimes.Num(); ++Index)
+		LookAheadNames.Add(FName(*FString::Printf(TEXT("%s_LookAhead%d"), *GetOwner()->GetName(), Index)));
+	LandingName = FName(*FString::Printf(TEXT("%s_Landing"), *GetOwner()->GetName()));
+
+	if (UWorldPartitionSubsystem* WorldPartition = GetWorld()->GetSubsystem<UWorldPartitionSubsystem>())
+	{
+		WorldPartition->RegisterStreamingSourceProvider(this);
+		bRegistered = true;
+	}
+}
+
+void UShipStreamingSourceComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bRegistered)
+	{
+		if (UWorldPartitionSubsystem* WorldPartition = GetWorld()->GetSubsystem<UWorldPartitionSubsystem>())
+			WorldPartition->UnregisterStreamingSourceProvider(this);
+		bRegistered = false;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+bool UShipStreamingSourceComponent::ShouldStream() const
+{
+	return bRegistered && Ship && Ship->IsPlayerControlled() && (Ship->IsLocallyControlled() || Ship->HasAuthority());
+}
+
+void UShipStreamingSourceComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (!ShouldStream()) return;
+
+	//Saturated I/O goes to what's needed soonest: drop to the nearest look-ahead, then add the rest back one a frame
+	const int32 NumLoading = GetNumAsyncPackages();
+	if (NumLoading > SaturatedAsyncPackages)
+	{
+		NumLookAheads = FMath::Min(LookAheadTimes.Num(), 1);
+	}
+	else if (NumLoading < SaturatedAsyncPackages / 2)
+	{
+		NumLookAheads = FMath::Min(NumLookAheads + 1, LookAheadTimes.Num());
+	}
+	INC_DWORD_STAT_BY(STAT_OryxStreamingLookAheads, NumLookAheads);
+
+	//Stalled while the cells the ship is in aren't active yet, whatever the look-ahead is doing
+	const UWorldPartitionSubsystem* WorldPartition = GetWorld()->GetSubsystem<UWorldPartitionSubsystem>();
+	const TArray<FWorldPartitionStreamingQuerySource> QuerySources = { FWorldPartitionStreamingQuerySource(Ship->GetActorLocation()) };
+	if (WorldPartition && !WorldPartition->IsStreamingCompleted(EWorldPartitionRuntimeCellState::Activated, QuerySources, false))
+	{
+		StallSeconds += DeltaTime;
+		INC_FLOAT_STAT_BY(STAT_OryxStreamingStallMs, DeltaTime * 1000.f);
+		INC_FLOAT_STAT_BY(STAT_OryxStreamingStallTotal, DeltaTime);
+	}
+}
+
+bool UShipStreamingSourceComponent::GetStreamingSources(TArray<FWorldPartitionStreamingSource>& OutStreamingSources) const
+{
+	if (!ShouldStream()) return false;
+
+	const int32 NumBefore = OutStreamingSources.Num();
+	const FVector Location = Ship->GetActorLocation();
+	const FVector Velocity = Ship->GetVelocity();
+	const float Speed = Velocity.Size();
+
+	auto AddSource = [&OutStreamingSources](FName Name, const FVector& SourceLocation, const FRotator& Rotation, EStreamingSourcePriority Priority, float SourceVelocity)
+		{
+			FWorldPartitionStreamingSource& Source = OutStreamingSources.AddDefaulted_GetRef();
+			Source.Name = Name;
+			Source.Location = SourceLocation;
+			Source.Rotation = Rotation;
+			Source.TargetState = EStreamingSourceTargetState::Activated;
+			Source.bBlockOnSlowLoading = false; //Never hitch for a guess about the future
+			Source.Priority = Priority;
+			Source.Velocity = SourceVelocity;
+		};
+
+	if (Speed >= MinLookAheadSpeed)
+	{
+		static const EStreamingSourcePriority Priorities[] = { EStreamingSourcePriority::High, EStreamingSourcePriority::Normal, EStreamingSourcePriority::Low };
+		for (int32 Index = 0; Index < NumLookAheads; ++Index)
+		{
+			const EStreamingSourcePriority Priority = Priorities[FMath::Min(Index, static_cast<int32>(UE_ARRAY_COUNT(Priorities)) - 1)];
+			AddSource(LookAheadNames[Index], Location + Velocity * LookAheadTimes[Index], Velocity.Rotation(), Priority, Speed);
+		}
+	}
+
+	//The pad the landing sequence is flying to is certain, so it outranks the look-ahead
+	const ELandingStage Stage = Ship->GetLandingStage();
+	if (const ALandingPad* Pad = Ship->GetTargetLandingPad(); Pad && Stage != ELandingStage::None && Stage != ELandingStage::Landed)
+		AddSource(LandingName, Pad->GetActorLocation(), Pad->GetActorRotation(), EStreamingSourcePriority::High, 0.f);
+
+	return OutStreamingSources.Num() > NumBefore;
+}
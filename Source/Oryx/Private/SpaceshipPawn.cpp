@@ -11,8 +11,28 @@
 #include "Components/SceneComponent.h"			//For scene components (thruster attach points).
 #include "LandingPad.h"							//For referencing landing pad.
 #include "PlayerPawnController.h"
+#include "ShipFlightRecorderComponent.h"
+#include "ShipStreamingSourceComponent.h"
+#include "ShipCameraRigComponent.h"
+#include "ShipCargoHoldComponent.h"
+#include "ShipArchetype.h"
+#include "ShipNavSubsystem.h"
+#include "ShipAvoidanceSubsystem.h"
+#include "OryxTrafficControl.h"
+#include "OryxEventSubsystem.h"
+#include "OryxShipAssetSubsystem.h"
+#include "Oryx.h"
+#include "Engine/GameInstance.h"
+#include "Engine/AssetManager.h"					//For the shared streamable manager.
+#include "Engine/StreamableManager.h"			//Async loading of soft referenced FX and classes.
+#include "HAL/IConsoleManager.h"
 #pragma endregion
 
+static TAutoConsoleVariable<int32> CVarOryxThrusterFXLod(
+	TEXT("Oryx.Ship.ThrusterFXLod"),
+	0,
+	TEXT("Which ships show thruster FX: 0 all, 1 player flown ships only, 2 only the local player's ship"));
+
 //Constructor - Sets up component heirarchy, physics, and vfx
 ASpaceshipPawn::ASpaceshipPawn()
 {
@@ -22,6 +42,7 @@ ASpaceshipPawn::ASpaceshipPawn()
 	//Static mesh acts as the physical body for the ship
 	ShipMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("ShipMesh"));
 	RootComponent = ShipMesh;
+	ShipMesh->SetCollisionProfileName(TEXT("OryxShip")); //Boarding and pad triggers only look for this object type
 
 	//Enable physics simulation for movement via forces
 	ShipMesh->SetSimulatePhysics(true);
@@ -70,6 +91,76 @@ ASpaceshipPawn::ASpaceshipPawn()
 	RightBrakeThrusterFX->SetupAttachment(ReverseRightThruster);
 	RightBrakeThrusterFX->bAutoActivate = false;
 #pragma endregion
+
+	//Always-on telemetry ring buffer, see Oryx.FlightRecorder.Dump
+	FlightRecorder = CreateDefaultSubobject<UShipFlightRecorderComponent>(TEXT("FlightRecorder"));
+
+	//Streams World Partition cells ahead of the ship, not just around it
+	StreamingSource = CreateDefaultSubobject<UShipStreamingSourceComponent>(TEXT("StreamingSource"));
+
+	//Post-physics chase camera, only awake on the ship the local player flies
+	CameraRig = CreateDefaultSubobject<UShipCameraRigComponent>(TEXT("CameraRig"));
+
+	//Props fed in with the gravity gun are stowed as records instead of riding along as bodies
+	CargoHold = CreateDefaultSubobject<UShipCargoHoldComponent>(TEXT("CargoHold"));
+	CargoHold->SetupAttachment(ShipMesh);
+}
+
+void ASpaceshipPawn::PostLoad()
+{
+	Super::PostLoad();
+
+#if WITH_EDITORONLY_DATA
+	//Blueprints saved with their own tuning keep it: the overridden values move into an archetype owned by this ship,
+	//saved with it on the next resave. Ships that already point at an asset keep the asset
+	const UShipArchetype* Defaults = GetDefault<UShipArchetype>();
+	const bool bOverridden = MaxMouseRadius_DEPRECATED != Defaults->MaxMouseRadius
+		|| RotationInterpSpeed_DEPRECATED != Defaults->RotationInterpSpeed
+		|| ForwardThrusterForce_DEPRECATED != Defaults->ForwardThrusterForce
+		|| SideThrusterForce_DEPRECATED != Defaults->SideThrusterForce
+		|| LandingMoveSpeed_DEPRECATED != Defaults->LandingMoveSpeed
+		|| LandingRotateSpeed_DEPRECATED != Defaults->LandingRotateSpeed
+		|| LandingDescendSpeed_DEPRECATED != Defaults->LandingDescendSpeed;
+
+	if (bOverridden && !Archetype)
+	{
+		UShipArchetype* Migrated = NewObject<UShipArchetype>(this);
+		Migrated->MaxMouseRadius = MaxMouseRadius_DEPRECATED;
+		Migrated->RotationInterpSpeed = RotationInterpSpeed_DEPRECATED;
+		Migrated->ForwardThrusterForce = ForwardThrusterForce_DEPRECATED;
+		Migrated->SideThrusterForce = SideThrusterForce_DEPRECATED;
+		Migrated->LandingMoveSpeed = LandingMoveSpeed_DEPRECATED;
+		Migrated->LandingRotateSpeed = LandingRotateSpeed_DEPRECATED;
+		Migrated->LandingDescendSpeed = LandingDescendSpeed_DEPRECATED;
+		Migrated->UpdateDerivedValues();
+		Archetype = Migrated;
+
+		UE_LOG(LogOryx, Log, TEXT("%s: per-ship tuning moved into an archetype, resave to keep it"), *GetPathName());
+	}
+
+	//Migrated once, later loads of the same object don't see the old values again
+	MaxMouseRadius_DEPRECATED = Defaults->MaxMouseRadius;
+	RotationInterpSpeed_DEPRECATED = Defaults->RotationInterpSpeed;
+	ForwardThrusterForce_DEPRECATED = Defaults->ForwardThrusterForce;
+	SideThrusterForce_DEPRECATED = Defaults->SideThrusterForce;
+	LandingMoveSpeed_DEPRECATED = Defaults->LandingMoveSpeed;
+	LandingRotateSpeed_DEPRECATED = Defaults->LandingRotateSpeed;
+	LandingDescendSpeed_DEPRECATED = Defaults->LandingDescendSpeed;
+#endif
+}
+
+void ASpaceshipPawn::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	//Blueprints made before the OryxShip profile saved their own (PhysicsActor) on the hull, which hides the ship from
+	//boarding queries and pad triggers. The hull's profile is the native one whatever the Blueprint holds
+	if (ShipMesh && ShipMesh->GetCollisionProfileName() != TEXT("OryxShip"))
+	{
+		UE_LOG(LogOryx, Log, TEXT("%s: hull collision profile %s reset to OryxShip, reset it in %s to keep it"),
+			*GetName(), *ShipMesh->GetCollisionProfileName().ToString(), *GetClass()->GetName());
+		ShipMesh->SetCollisionProfileName(TEXT("OryxShip"));
+	}
 }
 
 //Called when the game starts or when spawned
@@ -108,15 +199,86 @@ void ASpaceshipPawn::BeginPlay()
 	}
 #pragma endregion
 
-#pragma region Assign Niagara FX if specified in editor
-	if (MainThrusterEffect) MainThrusterFX->SetAsset(MainThrusterEffect);
-	if (LeftThrusterEffect) LeftThrusterFX->SetAsset(LeftThrusterEffect);
-	if (RightThrusterEffect) RightThrusterFX->SetAsset(RightThrusterEffect);
-	if (LeftBrakeThrusterEffect) LeftBrakeThrusterFX->SetAsset(LeftBrakeThrusterEffect);
-	if (RightBrakeThrusterEffect) RightBrakeThrusterFX->SetAsset(RightBrakeThrusterEffect);
-#pragma endregion
+	RequestShipAssets();
+
+	//Every ship is an obstacle to autopilots, even while the player flies it
+	if (UShipAvoidanceSubsystem* Avoidance = GetWorld()->GetSubsystem<UShipAvoidanceSubsystem>())
+		AvoidanceHandle = Avoidance->RegisterAgent(this, ShipMesh->Bounds.SphereRadius);
+}
+
+void ASpaceshipPawn::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UShipAvoidanceSubsystem* Avoidance = GetWorld()->GetSubsystem<UShipAvoidanceSubsystem>())
+		Avoidance->UnregisterAgent(AvoidanceHandle);
+	AvoidanceHandle = INDEX_NONE;
+
+	if (UOryxTrafficControl* Traffic = GetWorld()->GetSubsystem<UOryxTrafficControl>())
+		Traffic->ReleasePad(this);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ASpaceshipPawn::NotifyControllerChanged()
+{
+	Super::NotifyControllerChanged();
+	CameraRig->RefreshLocalControl();
+}
+
+void ASpaceshipPawn::ApplyWorldOffset(const FVector& InOffset, bool bWorldShift)
+{
+	Super::ApplyWorldOffset(InOffset, bWorldShift);
+
+	//An origin rebase mid-landing keeps the remaining approach under the ship
+	for (FVector& Point : LandingPath)
+		Point += InOffset;
+}
+
+#pragma region Asset Streaming
+void ASpaceshipPawn::GetShipBundle(TSubclassOf<ASpaceshipPawn> ShipClass, TArray<FSoftObjectPath>& OutPaths)
+{
+	if (!ShipClass) return;
+
+	//Bundle is whatever the class defaults reference: thruster FX plus the pawn spawned on exit
+	const ASpaceshipPawn* Defaults = ShipClass->GetDefaultObject<ASpaceshipPawn>();
+	for (const TSoftObjectPtr<UNiagaraSystem>* Effect : { &Defaults->MainThrusterEffect, &Defaults->LeftThrusterEffect,
+		&Defaults->RightThrusterEffect, &Defaults->LeftBrakeThrusterEffect, &Defaults->RightBrakeThrusterEffect })
+	{
+		if (!Effect->IsNull() && !IsRunningDedicatedServer()) OutPaths.AddUnique(Effect->ToSoftObjectPath());
+	}
+	if (!Defaults->PlayerPawnClass.IsNull()) OutPaths.AddUnique(Defaults->PlayerPawnClass.ToSoftObjectPath());
 }
 
+void ASpaceshipPawn::RequestShipAssets()
+{
+	//Class-wide bundle keeps the assets resident, the per-ship request below only waits for it
+	if (UOryxShipAssetSubsystem* ShipAssets = GetGameInstance() ? GetGameInstance()->GetSubsystem<UOryxShipAssetSubsystem>() : nullptr)
+		ShipAssets->PreloadShipAssets(GetClass());
+
+	TArray<FSoftObjectPath> Paths;
+	for (const TSoftObjectPtr<UNiagaraSystem>* Effect : { &MainThrusterEffect, &LeftThrusterEffect,
+		&RightThrusterEffect, &LeftBrakeThrusterEffect, &RightBrakeThrusterEffect })
+	{
+		if (!Effect->IsNull()) Paths.AddUnique(Effect->ToSoftObjectPath());
+	}
+
+	//Dedicated servers never render, so leave the FX components empty
+	if (Paths.Num() == 0 || GetNetMode() == NM_DedicatedServer) return;
+
+	ShipAssetsHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(Paths,
+		FStreamableDelegate::CreateUObject(this, &ASpaceshipPawn::ApplyThrusterEffects));
+}
+
+//Assign Niagara FX once streamed in, thrusting before that just shows no FX
+void ASpaceshipPawn::ApplyThrusterEffects()
+{
+	if (UNiagaraSystem* Effect = MainThrusterEffect.Get()) MainThrusterFX->SetAsset(Effect);
+	if (UNiagaraSystem* Effect = LeftThrusterEffect.Get()) LeftThrusterFX->SetAsset(Effect);
+	if (UNiagaraSystem* Effect = RightThrusterEffect.Get()) RightThrusterFX->SetAsset(Effect);
+	if (UNiagaraSystem* Effect = LeftBrakeThrusterEffect.Get()) LeftBrakeThrusterFX->SetAsset(Effect);
+	if (UNiagaraSystem* Effect = RightBrakeThrusterEffect.Get()) RightBrakeThrusterFX->SetAsset(Effect);
+}
+#pragma endregion
+
 // Called every frame
 void ASpaceshipPawn::Tick(float DeltaTime)
 {
@@ -124,6 +286,12 @@ void ASpaceshipPawn::Tick(float DeltaTime)
 
 	RestrictMouseToCircle(); //Clamp mouse offset for steering
 
+	//Cleared every frame so landing and landed frames record no thrust
+	ActiveThrusters = EShipThrusterFlags::None;
+	LastAppliedForce = FVector::ZeroVector;
+
+	UpdateThrusterFXLod();
+
 	//Landing sequence logic
 	if (bIsLanding && TargetLandingPad)
 	{
@@ -169,13 +337,14 @@ void ASpaceshipPawn::SetupPlayerInputComponent(UInputComponent* PlayerInputCompo
 }
 
 #pragma region Input Callbacks
-void ASpaceshipPawn::OnForwardThrust(const FInputActionValue& Value) { bForwardThrust = Value.Get<bool>(); }
-void ASpaceshipPawn::OnLeftThrust(const FInputActionValue& Value) { bLeftThrust = Value.Get<bool>(); }
-void ASpaceshipPawn::OnRightThrust(const FInputActionValue& Value) { bRightThrust = Value.Get<bool>(); }
-void ASpaceshipPawn::OnBrake(const FInputActionValue& Value) { bBrake = Value.Get<bool>(); }
+void ASpaceshipPawn::OnForwardThrust(const FInputActionValue& Value) { OryxInput::Record(this, EOryxInputAction::ForwardThrust, Value); bForwardThrust = Value.Get<bool>(); }
+void ASpaceshipPawn::OnLeftThrust(const FInputActionValue& Value) { OryxInput::Record(this, EOryxInputAction::LeftThrust, Value); bLeftThrust = Value.Get<bool>(); }
+void ASpaceshipPawn::OnRightThrust(const FInputActionValue& Value) { OryxInput::Record(this, EOryxInputAction::RightThrust, Value); bRightThrust = Value.Get<bool>(); }
+void ASpaceshipPawn::OnBrake(const FInputActionValue& Value) { OryxInput::Record(this, EOryxInputAction::Brake, Value); bBrake = Value.Get<bool>(); }
 
 void ASpaceshipPawn::OnAllThrusters(const FInputActionValue& Value)
 {
+	OryxInput::Record(this, EOryxInputAction::AllThrusters, Value);
 	bool bPressed = Value.Get<bool>();
 
 	if (LandingStage == ELandingStage::Landed && bPressed)
@@ -186,13 +355,37 @@ void ASpaceshipPawn::OnAllThrusters(const FInputActionValue& Value)
 
 	bAllThrusters = Value.Get<bool>();
 }
+
+const UShipArchetype& ASpaceshipPawn::GetArchetype() const
+{
+	//Ships without an asset share the class default, which carries the original tuning values
+	return Archetype ? *Archetype : *GetDefault<UShipArchetype>();
+}
+
+void ASpaceshipPawn::DispatchInput(EOryxInputAction Action, const FInputActionValue& Value)
+{
+	switch (Action)
+	{
+	case EOryxInputAction::ForwardThrust: OnForwardThrust(Value); break;
+	case EOryxInputAction::LeftThrust: OnLeftThrust(Value); break;
+	case EOryxInputAction::RightThrust: OnRightThrust(Value); break;
+	case EOryxInputAction::AllThrusters: OnAllThrusters(Value); break;
+	case EOryxInputAction::Brake: OnBrake(Value); break;
+	case EOryxInputAction::Land: OnLand(Value); break;
+
+	//Without a player controller nothing overwrites MouseOffset, so steering sticks until changed
+	case EOryxInputAction::Steer: MouseOffset = Value.Get<FVector2D>().GetClampedToMaxSize(1.f); break;
+
+	default: break;
+	}
+}
 #pragma endregion
 
 //Limists mouse range for steering
 void ASpaceshipPawn::RestrictMouseToCircle()
 {
 	APlayerController* PC = Cast<APlayerController>(GetController());
-	if (!PC) return;
+	if (!PC || OryxInput::IsPlayingBack(this)) return; //Replayed steering comes from the recording
 
 	int32 ScreenX, ScreenY;
 	PC->GetViewportSize(ScreenX, ScreenY);
@@ -206,14 +399,21 @@ void ASpaceshipPawn::RestrictMouseToCircle()
 	FVector2D Offset = MousePos - ScreenCenter;
 
 	//Clamp offset within circular radius
-	if (Offset.Size() > MaxMouseRadius)
+	const UShipArchetype& Tuning = GetArchetype();
+	if (Offset.Size() > Tuning.MaxMouseRadius)
 	{
-		Offset = Offset.GetSafeNormal() * MaxMouseRadius;
+		Offset = Offset.GetSafeNormal() * Tuning.MaxMouseRadius;
 		FVector2D ClampedPos = ScreenCenter + Offset;
 		PC->SetMouseLocation(ClampedPos.X, ClampedPos.Y);
 	}
 
-	MouseOffset = Offset / MaxMouseRadius; //normalized to [-1,1] range for easier directional math
+	FVector2D NewOffset = Offset * Tuning.InvMaxMouseRadius; //normalized to [-1,1] range for easier directional math
+
+	//Mouse steering isn't an input action, record it as Steer whenever it moves
+	if (!NewOffset.Equals(MouseOffset))
+		OryxInput::Record(this, EOryxInputAction::Steer, FInputActionValue(NewOffset));
+
+	MouseOffset = NewOffset;
 }
 
 //Smoothly turns ship towards mouse offset
@@ -236,15 +436,16 @@ void ASpaceshipPawn::UpdateRotation(float DeltaTime)
 	//Pitch (X-axis rotation) controls nose up/down.
 	//We invert the Y offset because in screen space:
 	//- moving the mouse up gives a negative Y value, but we want the nose to go up (positive pitch).
-	float TargetPitch = -Offset.Y * 45.f;  //Up to +/-45 degrees max pitch
+	const UShipArchetype& Tuning = GetArchetype();
+	float TargetPitch = -Offset.Y * Tuning.MaxSteerAngle;  //Up to +/-MaxSteerAngle degrees pitch
 
 	//Yaw (Z-axis rotation) controls turning left/right (like steering).
 	//Positive X (mouse right) -> positive yaw -> turn right.
-	float TargetYaw = Offset.X * 45.f;     //Up to +/-45 degrees max yaw
+	float TargetYaw = Offset.X * Tuning.MaxSteerAngle;     //Up to +/-MaxSteerAngle degrees yaw
 
 	//Roll (Y-axis rotation) gives the ship a banking effect when turning.
 	//It uses only the X offset (horizontal movement) to roll into turns.
-	float TargetRoll = Offset.X * 45.f;    //Up to +/-30 degrees max roll
+	float TargetRoll = Offset.X * Tuning.MaxSteerAngle;    //Up to +/-MaxSteerAngle degrees roll
 
 
 	//Combine these into a target rotation relative to the current one.
@@ -264,30 +465,63 @@ void ASpaceshipPawn::UpdateRotation(float DeltaTime)
 
 	//Smoothly interpolate toward the target rotation.
 	//This makes the ship’s movement feel smooth and responsive rather than snappy.
-	FRotator NewRot = FMath::RInterpTo(CurrentRot, TargetRot, DeltaTime, RotationInterpSpeed);
+	FRotator NewRot = FMath::RInterpTo(CurrentRot, TargetRot, DeltaTime, Tuning.RotationInterpSpeed);
 
 	//Finally, apply the new rotation to the ship.
 	SetActorRotation(NewRot);
 }
 
+void ASpaceshipPawn::UpdateThrusterFXLod()
+{
+	const int32 Lod = CVarOryxThrusterFXLod.GetValueOnGameThread();
+	const bool bShow = bThrusterFXSignificant && (Lod <= 0 || (Lod == 1 ? IsPlayerControlled() : IsLocallyControlled() && IsPlayerControlled()));
+	if (bShow == bThrusterFXShown) return;
+
+	//Paused rather than deactivated, so the thruster code keeps seeing them active and doesn't restart them
+	bThrusterFXShown = bShow;
+	for (UNiagaraComponent* Effect : { MainThrusterFX, LeftThrusterFX, RightThrusterFX, LeftBrakeThrusterFX, RightBrakeThrusterFX })
+	{
+		if (!Effect) continue;
+		Effect->SetPaused(!bShow);
+		Effect->SetVisibility(bShow);
+	}
+}
+
+void ASpaceshipPawn::GetThrusterFX(TArray<UPrimitiveComponent*, TInlineAllocator<5>>& OutEffects) const
+{
+	OutEffects.Reset();
+	for (UNiagaraComponent* Effect : { MainThrusterFX, LeftThrusterFX, RightThrusterFX, LeftBrakeThrusterFX, RightBrakeThrusterFX })
+	{
+		if (Effect) OutEffects.Add(Effect);
+	}
+}
+
 //Applies forces and activaes FX as needed
 void ASpaceshipPawn::ApplyThrusters(float DeltaTime)
 {
 	if (!ShipMesh || LandingStage == ELandingStage::Landed) return;
 
+	const float ForwardThrusterForce = GetArchetype().ForwardThrusterForce;
+	const float SideThrusterForce = GetArchetype().SideThrusterForce;
+
 	//Lambda helper for applying forces at thruster locations
-	auto ApplyForceAt = [&](USceneComponent* Thruster, float Force)
+	auto ApplyForceAt = [&](USceneComponent* Thruster, float Force, EShipThrusterFlags Flag)
 		{
 			if (Thruster)
-				ShipMesh->AddForceAtLocation(Thruster->GetForwardVector() * Force, Thruster->GetComponentLocation());
+			{
+				const FVector ThrustForce = Thruster->GetForwardVector() * Force;
+				ShipMesh->AddForceAtLocation(ThrustForce, Thruster->GetComponentLocation());
+				LastAppliedForce += ThrustForce;
+				ActiveThrusters |= Flag;
+			}
 		};
 
 	if (bAllThrusters)
 	{
 		//Apply all forces
-		ApplyForceAt(MainThruster, ForwardThrusterForce);
-		ApplyForceAt(LeftThruster, SideThrusterForce);
-		ApplyForceAt(RightThruster, SideThrusterForce);
+		ApplyForceAt(MainThruster, ForwardThrusterForce, EShipThrusterFlags::Main);
+		ApplyForceAt(LeftThruster, SideThrusterForce, EShipThrusterFlags::Left);
+		ApplyForceAt(RightThruster, SideThrusterForce, EShipThrusterFlags::Right);
 
 		//Activate FX
 		if (MainThrusterFX && !MainThrusterFX->IsActive()) MainThrusterFX->Activate(true);
@@ -299,7 +533,7 @@ void ASpaceshipPawn::ApplyThrusters(float DeltaTime)
 		//Main Thruster
 		if (bForwardThrust)
 		{
-			ApplyForceAt(MainThruster, ForwardThrusterForce);
+			ApplyForceAt(MainThruster, ForwardThrusterForce, EShipThrusterFlags::Main);
 			if (MainThrusterFX && !MainThrusterFX->IsActive()) MainThrusterFX->Activate(true);
 		}
 		else if (MainThrusterFX && MainThrusterFX->IsActive())
@@ -310,7 +544,7 @@ void ASpaceshipPawn::ApplyThrusters(float DeltaTime)
 		//Left Thruster
 		if (bLeftThrust)
 		{
-			ApplyForceAt(LeftThruster, SideThrusterForce);
+			ApplyForceAt(LeftThruster, SideThrusterForce, EShipThrusterFlags::Left);
 			if (LeftThrusterFX && !LeftThrusterFX->IsActive()) LeftThrusterFX->Activate(true);
 		}
 		else if (LeftThrusterFX && LeftThrusterFX->IsActive())
@@ -321,7 +555,7 @@ void ASpaceshipPawn::ApplyThrusters(float DeltaTime)
 		//Right Thruster
 		if (bRightThrust)
 		{
-			ApplyForceAt(RightThruster, SideThrusterForce);
+			ApplyForceAt(RightThruster, SideThrusterForce, EShipThrusterFlags::Right);
 			if (RightThrusterFX && !RightThrusterFX->IsActive()) RightThrusterFX->Activate(true);
 		}
 		else if (RightThrusterFX && RightThrusterFX->IsActive())
@@ -333,8 +567,8 @@ void ASpaceshipPawn::ApplyThrusters(float DeltaTime)
 	//Brake Thrusters (independent of others)
 	if (bBrake)
 	{
-		ApplyForceAt(ReverseLeftThruster, -SideThrusterForce);
-		ApplyForceAt(ReverseRightThruster, -SideThrusterForce);
+		ApplyForceAt(ReverseLeftThruster, -SideThrusterForce, EShipThrusterFlags::BrakeLeft);
+		ApplyForceAt(ReverseRightThruster, -SideThrusterForce, EShipThrusterFlags::BrakeRight);
 
 		if (LeftBrakeThrusterFX && !LeftBrakeThrusterFX->IsActive()) LeftBrakeThrusterFX->Activate(true);
 		if (RightBrakeThrusterFX && !RightBrakeThrusterFX->IsActive()) RightBrakeThrusterFX->Activate(true);
@@ -349,6 +583,7 @@ void ASpaceshipPawn::ApplyThrusters(float DeltaTime)
 //Input function to trigger landing
 void ASpaceshipPawn::OnLand(const FInputActionValue& Value)
 {
+	OryxInput::Record(this, EOryxInputAction::Land, Value);
 	if (bIsLanding) return;
 	if (LandingStage == ELandingStage::Landed)
 	{
@@ -366,6 +601,16 @@ void ASpaceshipPawn::StartLanding(ALandingPad* LandingPad)
 {
 	if (!LandingPad) return;
 
+	//One ship per pad, the reservation is held until takeoff
+	if (UOryxTrafficControl* Traffic = GetWorld()->GetSubsystem<UOryxTrafficControl>())
+	{
+		if (!Traffic->TryReservePad(LandingPad, this))
+		{
+			UOryxEventSubsystem::Push(this, EOryxEventType::PadDenied, this, LandingPad);
+			return;
+		}
+	}
+
 	TargetLandingPad = LandingPad;
 	bIsLanding = true;
 
@@ -375,25 +620,78 @@ void ASpaceshipPawn::StartLanding(ALandingPad* LandingPad)
 	bAllThrusters = false;
 	bBrake = false;
 
-	LandingStage = ELandingStage::RotateToPad;
+	SetLandingStage(ELandingStage::RotateToPad);
+
+	//Route the approach around terrain, until a path arrives (or without nav data) fly straight at the pad
+	LandingPath.Reset();
+	LandingPathIndex = 0;
+	if (UShipNavSubsystem* Nav = GetWorld()->GetSubsystem<UShipNavSubsystem>())
+	{
+		const FVector TargetAbovePad = LandingPad->GetActorLocation() + FVector(0.f, 0.f, GetArchetype().ApproachHeight);
+		Nav->RequestPath(GetActorLocation(), TargetAbovePad,
+			FOnShipNavPathFound::CreateUObject(this, &ASpaceshipPawn::OnLandingPathFound, ++LandingPathRequest));
+	}
+}
+
+void ASpaceshipPawn::OnLandingPathFound(EShipNavResult Result, const TArray<FVector>& Path, uint32 RequestId)
+{
+	if (RequestId != LandingPathRequest || !bIsLanding || Result == EShipNavResult::Failed) return;
+
+	LandingPath = Path;
+	LandingPathIndex = 1; //Path[0] is where the ship was when it asked
+}
+
+FVector ASpaceshipPawn::SteerAroundTraffic(const FVector& DesiredVelocity, int32 SteerFrames)
+{
+	UShipAvoidanceSubsystem* Avoidance = GetWorld()->GetSubsystem<UShipAvoidanceSubsystem>();
+	if (!Avoidance || AvoidanceHandle == INDEX_NONE) return DesiredVelocity;
+
+	//Solved after every actor has ticked, so this is last frame's answer
+	Avoidance->SetDesiredVelocity(AvoidanceHandle, DesiredVelocity, DesiredVelocity.Size(), SteerFrames);
+	return Avoidance->GetAvoidanceVelocity(AvoidanceHandle);
+}
+
+FVector ASpaceshipPawn::GetLandingWaypoint(const FVector& ShipLocation, const FVector& FinalTarget)
+{
+	//The last leg always aims at the live target above the pad
+	const float AcceptRadius = GetArchetype().WaypointAcceptRadius;
+	while (LandingPathIndex < LandingPath.Num() - 1 && FVector::Dist(ShipLocation, LandingPath[LandingPathIndex]) < AcceptRadius)
+		++LandingPathIndex;
+
+	return LandingPathIndex < LandingPath.Num() - 1 ? LandingPath[LandingPathIndex] : FinalTarget;
 }
 
 //Function that handles the entire landing sequence
+//Whether the rotation left to reach Target, in the ship's own frame and in doubles, is under Tolerance degrees on
+//each axis. Comparing world space euler angles goes wrong across the 180/-180 wrap and near vertical pitch.
+static bool IsAlignedWithin(const FQuat& Current, const FRotator& Target, double Tolerance)
+{
+	const FRotator Remaining = (Current.Inverse() * Target.Quaternion()).Rotator();
+	return FMath::Abs(Remaining.Yaw) < Tolerance && FMath::Abs(Remaining.Pitch) < Tolerance && FMath::Abs(Remaining.Roll) < Tolerance;
+}
+
 void ASpaceshipPawn::LandingSequence(float DeltaTime)
 {
 	//Current ship and landing pad position
 	FVector ShipLocation = GetActorLocation();
 	FVector PadLocation = TargetLandingPad->GetActorLocation();
 
+	const UShipArchetype& Tuning = GetArchetype();
+
 	//Define a target above the pad to approach before descending
-	FVector TargetAbovePad = PadLocation + FVector(0.f, 0.f, 1000.f); //vertical offset above the pad
+	FVector TargetAbovePad = PadLocation + FVector(0.f, 0.f, Tuning.ApproachHeight); //vertical offset above the pad
 	FVector DirectionToPad = (TargetAbovePad - ShipLocation); //Vector from ship to pad
 	float DistanceToTarget = DirectionToPad.Size();
 	DirectionToPad.Normalize();
 
+	//Heading for the next nav waypoint, the same as DirectionToPad on the final leg
+	const FVector Waypoint = GetLandingWaypoint(ShipLocation, TargetAbovePad);
+	const bool bFinalLeg = Waypoint == TargetAbovePad;
+	const FVector DirectionToWaypoint = (Waypoint - ShipLocation).GetSafeNormal();
+
 	//Get current rotation of the ship
 	FRotator CurrentRot = GetActorRotation();
-	FRotator TargetRot = DirectionToPad.Rotation(); //Converts direction vector to rotator
+	FRotator TargetRot = DirectionToWaypoint.Rotation(); //Converts direction vector to rotator
 	FRotator NewRot = CurrentRot; //New rotation to interpolate toward
 
 	switch (LandingStage)
@@ -409,15 +707,13 @@ void ASpaceshipPawn::LandingSequence(float DeltaTime)
 
 		//Interpolate current rotation toward target rotation
 		//FMath::RInterpTo performs frame-independent rotation interpolation
-		NewRot = FMath::RInterpTo(CurrentRot, TargetRot, DeltaTime, LandingRotateSpeed);
+		NewRot = FMath::RInterpTo(CurrentRot, TargetRot, DeltaTime, Tuning.LandingRotateSpeed);
 		SetActorRotation(NewRot);
 
-		//Ensuring ship is rotated within +/- 2.5 degrees on all axis
-		if (FMath::Abs(NewRot.Pitch - TargetRot.Pitch) < 2.5f &&
-			FMath::Abs(NewRot.Yaw - TargetRot.Yaw) < 2.5f &&
-			FMath::Abs(NewRot.Roll - TargetRot.Roll) < 2.5f)
+		//Ensuring ship is rotated within +/- FacePadTolerance degrees on all axis
+		if (IsAlignedWithin(GetActorQuat(), TargetRot, Tuning.FacePadTolerance))
 		{
-			LandingStage = ELandingStage::MoveToPad; //Go to moving phase
+			SetLandingStage(ELandingStage::MoveToPad); //Go to moving phase
 			if (!MainThrusterFX->IsActive()) MainThrusterFX->Activate(true);
 		}
 		break;
@@ -425,13 +721,17 @@ void ASpaceshipPawn::LandingSequence(float DeltaTime)
 
 	case ELandingStage::MoveToPad: //Move towards pad
 	{
-		//Move ship forward along normalized direction vector
-		FVector NewLocation = ShipLocation + DirectionToPad * LandingMoveSpeed * DeltaTime;
+		//Keep turning into each waypoint while following a path
+		if (!bFinalLeg)
+			SetActorRotation(FMath::RInterpTo(CurrentRot, TargetRot, DeltaTime, Tuning.LandingRotateSpeed));
+
+		//Move ship forward along normalized direction vector, giving way to other traffic
+		FVector NewLocation = ShipLocation + SteerAroundTraffic(DirectionToWaypoint * Tuning.LandingMoveSpeed) * DeltaTime;
 		SetActorLocation(NewLocation);
 
-		if (DistanceToTarget < 1000.f) //When ship within the specified range begin braking
+		if (bFinalLeg && DistanceToTarget < Tuning.BrakeDistance) //When ship within the specified range begin braking
 		{
-			LandingStage = ELandingStage::ApplyBrakes;
+			SetLandingStage(ELandingStage::ApplyBrakes);
 			if (MainThrusterFX->IsActive()) MainThrusterFX->Deactivate();
 			if (!LeftBrakeThrusterFX->IsActive()) LeftBrakeThrusterFX->Activate(true);
 			if (!RightBrakeThrusterFX->IsActive()) RightBrakeThrusterFX->Activate(true);
@@ -441,15 +741,15 @@ void ASpaceshipPawn::LandingSequence(float DeltaTime)
 
 	case ELandingStage::ApplyBrakes: //Apply 'brakes' slowing approach
 	{
-		float SlowSpeed = LandingMoveSpeed * 0.4f; //Reduce speed to 40% of the previous speed
+		const float SlowSpeed = Tuning.BrakeSpeed; //LandingMoveSpeed scaled by BrakeSpeedScale
 
 		//Continue moving toward target
-		FVector NewLocation = ShipLocation + DirectionToPad * SlowSpeed * DeltaTime;
+		FVector NewLocation = ShipLocation + SteerAroundTraffic(DirectionToPad * SlowSpeed) * DeltaTime;
 		SetActorLocation(NewLocation);
 
-		if (DistanceToTarget < 300.f) //When ship within the specified range begin rotational alignment
+		if (DistanceToTarget < Tuning.AlignDistance) //When ship within the specified range begin rotational alignment
 		{
-			LandingStage = ELandingStage::AlignRotation;
+			SetLandingStage(ELandingStage::AlignRotation);
 			LeftBrakeThrusterFX->Deactivate();
 			RightBrakeThrusterFX->Deactivate();
 		}
@@ -490,7 +790,7 @@ void ASpaceshipPawn::LandingSequence(float DeltaTime)
 		// Smoothly interpolate rotation toward target
 		CurrentRot = GetActorRotation();
 		TargetRot = FRotator(0.f, TargetYaw, 0.f);
-		NewRot = FMath::RInterpTo(CurrentRot, TargetRot, DeltaTime, LandingRotateSpeed);
+		NewRot = FMath::RInterpTo(CurrentRot, TargetRot, DeltaTime, Tuning.LandingRotateSpeed);
 		SetActorRotation(NewRot);
 
 		//Horizontal drift toward pad (ignore Z)
@@ -498,16 +798,13 @@ void ASpaceshipPawn::LandingSequence(float DeltaTime)
 		DriftDirection.Z = 0.f; //remove vertical component
 		DriftDirection.Normalize();
 
-		FVector NewLocation = GetActorLocation() + DriftDirection * (LandingMoveSpeed * 0.2f) * DeltaTime;
+		FVector NewLocation = GetActorLocation() + DriftDirection * Tuning.AlignDriftSpeed * DeltaTime;
 		SetActorLocation(NewLocation);
 
-		float RotationTolerance = 1.f;
-		//Once yaw is aligned within tolerance, move to descend
-		if (FMath::Abs(FRotator::NormalizeAxis(NewRot.Yaw - TargetRot.Yaw)) < RotationTolerance &&
-			FMath::Abs(FRotator::NormalizeAxis(NewRot.Pitch - TargetRot.Pitch)) < RotationTolerance &&
-			FMath::Abs(FRotator::NormalizeAxis(NewRot.Roll - TargetRot.Roll)) < RotationTolerance)
+		//Once aligned within tolerance, move to descend
+		if (IsAlignedWithin(GetActorQuat(), TargetRot, Tuning.RotationTolerance))
 		{
-			LandingStage = ELandingStage::Descend;
+			SetLandingStage(ELandingStage::Descend);
 		}
 
 		break;
@@ -517,16 +814,16 @@ void ASpaceshipPawn::LandingSequence(float DeltaTime)
 	{
 		//Move ship downward by LandingDescendSpeed per second
 		FVector DescendLoc = ShipLocation;
-		DescendLoc.Z -= LandingDescendSpeed * DeltaTime;
+		DescendLoc.Z -= Tuning.LandingDescendSpeed * DeltaTime;
 
 		//'true' enableds collision chekcs during movement
 		SetActorLocation(DescendLoc, true);
 
 		//Stop descending once ships Z is close to the pads surface
-		if (ShipLocation.Z <= PadLocation.Z + 300.f)
+		if (ShipLocation.Z <= PadLocation.Z + Tuning.TouchdownHeight)
 		{
 
-			LandingStage = ELandingStage::Landed;
+			SetLandingStage(ELandingStage::Landed);
 			bIsLanding = false; //Landing complete
 
 			LockShipOnPad(true);
@@ -535,11 +832,6 @@ void ASpaceshipPawn::LandingSequence(float DeltaTime)
 			MainThrusterFX->Deactivate();
 			LeftBrakeThrusterFX->Deactivate();
 			RightBrakeThrusterFX->Deactivate();
-			
-			if (GEngine)
-			{
-				GEngine->AddOnScreenDebugMessage(-1, 3.f, FColor::Green, TEXT("Landing Complete"));
-			}
 		}
 		break;
 	}
@@ -598,6 +890,41 @@ void ASpaceshipPawn::LockShipOnPad(bool bLock)
 	}
 }
 
+void ASpaceshipPawn::SetLandingStage(ELandingStage NewStage)
+{
+	if (LandingStage == NewStage) return;
+
+	LandingStage = NewStage;
+	UOryxEventSubsystem::Push(this, EOryxEventType::LandingStage, this, TargetLandingPad, static_cast<uint8>(NewStage));
+}
+
+void ASpaceshipPawn::RestoreLanding(ELandingStage Stage, ALandingPad* Pad)
+{
+	UOryxTrafficControl* Traffic = GetWorld()->GetSubsystem<UOryxTrafficControl>();
+	if (LandingStage == ELandingStage::Landed) LockShipOnPad(false);
+	if (Traffic) Traffic->ReleasePad(this);
+
+	//Drop any approach path still on its way for the landing before
+	LandingPath.Reset();
+	LandingPathIndex = 0;
+	++LandingPathRequest;
+
+	//Stages are set without events: a loaded game is not a takeoff or a landing the player should be told about
+	if (!Pad || Stage == ELandingStage::None || (Traffic && !Traffic->TryReservePad(Pad, this)))
+	{
+		TargetLandingPad = nullptr;
+		bIsLanding = false;
+		LandingStage = ELandingStage::None;
+		return;
+	}
+
+	//Without a path the approach flies straight at the pad, as it does before one arrives
+	TargetLandingPad = Pad;
+	bIsLanding = Stage != ELandingStage::Landed;
+	LandingStage = Stage;
+	if (Stage == ELandingStage::Landed) LockShipOnPad(true);
+}
+
 void ASpaceshipPawn::StartTakeoff()
 {
 	// only allow takeoff from landed state
@@ -608,30 +935,37 @@ void ASpaceshipPawn::StartTakeoff()
 	// Give a strong upward impulse to break free from pad
 	if (ShipMesh)
 	{
-		const FVector UpImpulse = FVector(0.f, 0.f, 25000.f);
+		const FVector UpImpulse = FVector(0.f, 0.f, GetArchetype().TakeoffImpulse);
 		ShipMesh->AddImpulse(UpImpulse);
 	}
 
 	//Reset landing state so normal controls resume
-	LandingStage = ELandingStage::None;
+	SetLandingStage(ELandingStage::None);
 	bIsLanding = false;
 
-	if (GEngine)
-	{
-		GEngine->AddOnScreenDebugMessage(-1, 2.f, FColor::Cyan, TEXT("Takeoff initiated"));
-	}
+	if (UOryxTrafficControl* Traffic = GetWorld()->GetSubsystem<UOryxTrafficControl>())
+		Traffic->ReleasePad(this);
 }
 
 void ASpaceshipPawn::OnExitShip()
 {
-	APlayerController* PC = Cast<APlayerController>(GetController());
-	if (!PC || !PlayerPawnClass) return;
+	AController* OwningController = GetController();
+	if (!OwningController || PlayerPawnClass.IsNull()) return;
+
+	//Normally streamed in with the ship bundle, only blocks if exiting before it finished
+	UClass* PawnClass = PlayerPawnClass.Get();
+	if (!PawnClass)
+	{
+		UE_LOG(LogOryx, Warning, TEXT("%s: exit pawn class not streamed in yet, loading synchronously"), *GetName());
+		PawnClass = PlayerPawnClass.LoadSynchronous();
+		if (!PawnClass) return;
+	}
 
 	UWorld* World = GetWorld();
 	if (!World) return;
 
 	//Safe spawn location beside the ship
-	const FVector SpawnLocation = GetActorLocation() + GetActorRightVector() * 500.f;
+	const FVector SpawnLocation = GetActorLocation() + GetActorRightVector() * GetArchetype().ExitDistance;
 	const FRotator SpawnRotation = GetActorRotation();
 
 	//Spawn player pawn
@@ -639,28 +973,36 @@ void ASpaceshipPawn::OnExitShip()
 	SpawnParams.Owner = this;
 	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
 
-	APawn* NewPlayerPawn = World->SpawnActor<APawn>(PlayerPawnClass, SpawnLocation, SpawnRotation, SpawnParams);
+	APawn* NewPlayerPawn = World->SpawnActor<APawn>(PawnClass, SpawnLocation, SpawnRotation, SpawnParams);
 	if (!NewPlayerPawn) return;
 
-	//Transfer control
-	PC->UnPossess();
-	PC->Possess(NewPlayerPawn);
+	//Transfer control (bots use plain controllers, so only players get input mode changes)
+	OwningController->UnPossess();
+	OwningController->Possess(NewPlayerPawn);
+	UOryxEventSubsystem::Push(this, EOryxEventType::Exit, this, NewPlayerPawn);
 
 	//re-enable mouse locking
-	PC->bShowMouseCursor = false;
-	FInputModeGameOnly InputMode;
-	PC->SetInputMode(InputMode);
+	if (APlayerController* PC = Cast<APlayerController>(OwningController))
+	{
+		PC->bShowMouseCursor = false;
+		FInputModeGameOnly InputMode;
+		PC->SetInputMode(InputMode);
+	}
 }
 
 void ASpaceshipPawn::TryBoard(APlayerPawnController* PlayerPawn)
 {
 	if (!PlayerPawn) return;
 
-	APlayerController* PC = Cast<APlayerController>(PlayerPawn->GetController());
-	if (!PC) return;
+	AController* OwningController = PlayerPawn->GetController();
+	if (!OwningController) return;
 
-	PC->UnPossess();
-	PC->Possess(this);
+	OwningController->UnPossess();
+	OwningController->Possess(this);
+	UOryxEventSubsystem::Push(this, EOryxEventType::Board, this, PlayerPawn);
+
+	APlayerController* PC = Cast<APlayerController>(OwningController);
+	if (!PC) return;
 
 	if (ULocalPlayer* LP = PC->GetLocalPlayer())
 	{
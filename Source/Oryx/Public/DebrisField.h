@@ -0,0 +1,109 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Tasks/Task.h"
+#include "DebrisSimulation.h"
+#include "DebrisField.generated.h"
+
+class UInstancedStaticMeshComponent;
+class UStaticMeshComponent;
+class UStaticMesh;
+struct FStreamableHandle;
+
+//Thousands of floating props drifting and pulling on each other. FDebrisSimulation steps on a worker while the
+//game thread draws the previous step through one instanced mesh. Only debris a ship flies close to, or that a
+//gravity gun trace passes near, becomes a real physics body, and goes back to being a particle once left alone.
+//Each machine simulates its own field, so promoted bodies are local and can't be grabbed through a remote server.
+UCLASS()
+class ORYX_API ADebrisField : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ADebrisField();
+
+	virtual void Tick(float DeltaTime) override;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	void OnMeshLoaded();
+	void LaunchStep();
+	void GatherPromoters(TArray<FDebrisPromoter>& OutPromoters) const;
+	void Promote(int32 Particle);
+	void SyncPromoted(const TArray<FDebrisPromoter>& Promoters);
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Debris")
+	UInstancedStaticMeshComponent* Instances;
+
+	UPROPERTY(EditAnywhere, Category = "Debris")
+	TSoftObjectPtr<UStaticMesh> DebrisMesh;
+
+	UPROPERTY(EditAnywhere, Category = "Debris", meta = (ClampMin = "0"))
+	int32 Count = 10000;
+
+	UPROPERTY(EditAnywhere, Category = "Debris")
+	FVector Extent = FVector(20000.f); //Half size of the box the debris starts in and is kept near
+
+	UPROPERTY(EditAnywhere, Category = "Debris")
+	int32 Seed = 7;
+
+	UPROPERTY(EditAnywhere, Category = "Debris")
+	float MinMass = 1.f;
+
+	UPROPERTY(EditAnywhere, Category = "Debris")
+	float MaxMass = 10.f;
+
+	UPROPERTY(EditAnywhere, Category = "Debris")
+	float ScalePerCubeRootMass = 0.3f; //Mesh scale of a unit mass, bigger masses are bigger props
+
+	UPROPERTY(EditAnywhere, Category = "Debris")
+	float KilogramsPerMass = 50.f; //Physics mass once promoted
+
+	UPROPERTY(EditAnywhere, Category = "Debris|Simulation")
+	float GravityConstant = 2000000.f;
+
+	UPROPERTY(EditAnywhere, Category = "Debris|Simulation")
+	float Theta = 0.7f;
+
+	UPROPERTY(EditAnywhere, Category = "Debris|Promotion")
+	float ShipPromoteRadius = 2000.f; //Added to the ship's own bounds
+
+	UPROPERTY(EditAnywhere, Category = "Debris|Promotion")
+	float GunPromoteRadius = 200.f; //Around the gravity gun's grab trace
+
+	UPROPERTY(EditAnywhere, Category = "Debris|Promotion")
+	float DemoteScale = 1.5f; //Bodies go back to particles this many promote radii away, so they don't flip back and forth
+
+	UPROPERTY(EditAnywhere, Category = "Debris|Promotion", meta = (ClampMin = "0"))
+	int32 MaxPromoted = 64;
+
+	//Physics bodies standing in for promoted particles, and the particle each one is
+	UPROPERTY(Transient)
+	TArray<UStaticMeshComponent*> PromotedBodies;
+	TArray<int32> PromotedParticles;
+
+	//Demoted bodies stay in place, frozen, until the instance that replaces them has been drawn
+	UPROPERTY(Transient)
+	TArray<UStaticMeshComponent*> DemotingBodies;
+
+	UPROPERTY(Transient)
+	TArray<UStaticMeshComponent*> FreeBodies;
+
+	//Everything the worker touches, kept alive by the task if the field goes away mid step
+	struct FStepState
+	{
+		FDebrisSimulation Simulation;
+		TArray<FDebrisPromoter> Promoters;
+		TArray<int32> Promote;
+		TArray<FTransform> Transforms;
+		float DeltaTime = 0.f;
+	};
+
+	TSharedPtr<FStepState> State;
+	UE::Tasks::FTask StepTask;
+	float PendingTime = 0.f; //Game time not yet simulated
+	TSharedPtr<FStreamableHandle> MeshHandle;
+};
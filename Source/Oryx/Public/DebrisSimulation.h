@@ -0,0 +1,107 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+//Capsule around something that wants real physics bodies near it (a ship, a gravity gun trace), field local space.
+//Start == End makes it a sphere.
+struct FDebrisPromoter
+{
+	FVector3f Start = FVector3f::ZeroVector;
+	FVector3f End = FVector3f::ZeroVector;
+	float Radius = 0.f;
+
+	float DistanceSquaredTo(const FVector3f& Point) const
+	{
+		const FVector3f Segment = End - Start;
+		const float LengthSq = Segment.SizeSquared();
+		const float Alpha = LengthSq > UE_SMALL_NUMBER ? FMath::Clamp(((Point - Start) | Segment) / LengthSq, 0.f, 1.f) : 0.f;
+		return FVector3f::DistSquared(Point, Start + Segment * Alpha);
+	}
+};
+
+//One cell of the Barnes-Hut tree, its particles are the range [First, First + Count) of the sorted order
+struct FDebrisTreeNode
+{
+	FVector3f Center = FVector3f::ZeroVector;
+	float HalfSize = 0.f;
+	FVector3f CenterOfMass = FVector3f::ZeroVector;
+	float Mass = 0.f;
+	int32 FirstChild = INDEX_NONE; //NumChildren consecutive non-empty children, INDEX_NONE for leaves
+	int32 NumChildren = 0;
+	int32 First = 0;
+	int32 Count = 0;
+
+	bool IsLeaf() const { return FirstChild == INDEX_NONE; }
+};
+
+//Zero-g debris attracting each other, particles only. Each step rebuilds a Barnes-Hut octree from Morton sorted
+//particles, then every leaf gathers one interaction list (far cells as point masses, near particles directly)
+//and evaluates it for all its particles four at a time with SIMD. Plain data, so a whole Step can run on a
+//worker while the game thread renders the previous one.
+class ORYX_API FDebrisSimulation
+{
+public:
+	struct FSettings
+	{
+		float GravityConstant = 2000000.f; //cm^3 / (mass s^2), tuned for masses around 1-10 a few meters apart
+		float Softening = 100.f; //Keeps close passes from slingshotting
+		float Theta = 0.7f; //Opening angle, smaller is more accurate and slower
+		float Damping = 0.02f; //Per second, stops the field slowly heating up
+		float MaxSpeed = 800.f;
+		float ContainStrength = 50.f; //Acceleration back towards the field for particles outside Extent
+		int32 LeafSize = 16;
+	};
+
+	//Scatters Count particles in the box of half size Extent with small random drift and spin
+	void Init(int32 Count, const FVector3f& InExtent, float MinMass, float MaxMass, int32 Seed);
+
+	//Advances every particle that isn't promoted, and lists the ones now inside a promoter
+	void Step(float DeltaTime, TConstArrayView<FDebrisPromoter> Promoters, TArray<int32>& OutPromote);
+
+	//Instance transform per particle in field local space, promoted ones collapsed to zero scale
+	void WriteTransforms(TArray<FTransform>& OutTransforms, float ScalePerCubeRootMass) const;
+
+	int32 Num() const { return PosX.Num(); }
+	float GetMass(int32 Index) const { return Mass[Index]; }
+	FVector3f GetPosition(int32 Index) const { return FVector3f(PosX[Index], PosY[Index], PosZ[Index]); }
+	FVector3f GetVelocity(int32 Index) const { return FVector3f(VelX[Index], VelY[Index], VelZ[Index]); }
+	FQuat4f GetRotation(int32 Index) const { return FQuat4f(SpinAxis[Index], SpinAngle[Index]); }
+	bool IsPromoted(int32 Index) const { return bPromoted[Index]; }
+
+	//Promoted particles are moved by physics, they still pull on the rest from wherever physics puts them
+	void SetPromoted(int32 Index, bool bInPromoted) { bPromoted[Index] = bInPromoted; }
+	void SetState(int32 Index, const FVector3f& Position, const FVector3f& Velocity);
+	void SetRotation(int32 Index, const FQuat4f& Rotation);
+
+	FSettings Settings;
+
+	double LastBuildMs = 0.0;
+	double LastForceMs = 0.0;
+	double LastIntegrateMs = 0.0;
+
+private:
+	void BuildTree();
+	void BuildNode(int32 NodeIndex, int32 Begin, int32 End, int32 Level);
+	void GatherInteractions(int32 LeafIndex, TArray<float>& OutX, TArray<float>& OutY, TArray<float>& OutZ, TArray<float>& OutMass) const;
+	void ComputeLeafAccelerations(int32 LeafIndex);
+
+	FVector3f Extent = FVector3f(10000.f);
+
+	//Structure of arrays, indexed by particle
+	TArray<float> PosX, PosY, PosZ;
+	TArray<float> VelX, VelY, VelZ;
+	TArray<float> AccX, AccY, AccZ;
+	TArray<float> Mass;
+	TArray<FVector3f> SpinAxis;
+	TArray<float> SpinAngle;
+	TArray<float> SpinRate;
+	TArray<bool> bPromoted;
+
+	//Tree over the current positions
+	TArray<uint64> SortedKeys; //Morton code << 32 | particle
+	TArray<int32> Order; //Particles in Morton order, leaves index ranges of this
+	TArray<FDebrisTreeNode> Nodes;
+	TArray<int32> Leaves;
+	FVector3f TreeMin = FVector3f::ZeroVector;
+	float TreeSize = 1.f;
+};
@@ -13,6 +13,4 @@ UCLASS()
 class ORYX_API AFPSProjectGameMode : public AGameModeBase
 {
 	GENERATED_BODY()
-	
-	virtual void StartPlay() override;
 };
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Tasks/Task.h"
+#include <atomic>
+#include "FoliageField.generated.h"
+
+class UBoxComponent;
+class UHierarchicalInstancedStaticMeshComponent;
+class UStaticMesh;
+struct FStreamableHandle;
+struct FTraceDatum;
+struct FTraceHandle;
+
+//One kind of plant scattered by a foliage field, each instance picks one of the meshes
+USTRUCT()
+struct FFoliageFieldLayer
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = "Foliage Field")
+	TArray<TSoftObjectPtr<UStaticMesh>> Meshes;
+
+	UPROPERTY(EditAnywhere, Category = "Foliage Field", meta = (ClampMin = "0"))
+	int32 InstancesPerCell = 400; //Before slope and clumping thin them out
+
+	UPROPERTY(EditAnywhere, Category = "Foliage Field")
+	float MinScale = 0.8f;
+
+	UPROPERTY(EditAnywhere, Category = "Foliage Field")
+	float MaxScale = 1.2f;
+
+	UPROPERTY(EditAnywhere, Category = "Foliage Field", meta = (ClampMin = "0", ClampMax = "90"))
+	float MaxSlope = 35.f; //Degrees, steeper ground stays bare
+
+	UPROPERTY(EditAnywhere, Category = "Foliage Field", meta = (ClampMin = "0", ClampMax = "1"))
+	float AlignToSurface = 0.5f; //0 grows straight up, 1 along the ground's normal
+
+	UPROPERTY(EditAnywhere, Category = "Foliage Field")
+	float SinkDepth = 5.f; //Pushed into the ground so the base never floats on a sampled slope
+
+	UPROPERTY(EditAnywhere, Category = "Foliage Field")
+	float NoiseScale = 0.0005f; //Size of the clumps, smaller is bigger. 0 spreads evenly
+
+	UPROPERTY(EditAnywhere, Category = "Foliage Field")
+	float CullDistance = 8000.f;
+
+	UPROPERTY(EditAnywhere, Category = "Foliage Field")
+	bool bCollision = false;
+
+	UPROPERTY(EditAnywhere, Category = "Foliage Field")
+	bool bCastShadow = false;
+};
+
+//Numbers a worker needs from a layer, with the meshes that actually loaded
+struct FFoliageLayerParams
+{
+	int32 FirstBucket = 0; //Of its meshes in FFoliageCellData::Instances
+	int32 NumMeshes = 0;
+	int32 InstancesPerCell = 0;
+	float MinScale = 1.f;
+	float MaxScale = 1.f;
+	float MinNormalZ = 0.f;
+	float AlignToSurface = 0.f;
+	float SinkDepth = 0.f;
+	float NoiseScale = 0.f;
+};
+
+//Everything a worker needs to scatter a cell, copied off the actor so no UObject is touched off the game thread
+struct FFoliageFieldParams
+{
+	int32 Seed = 0;
+	float CellSize = 2400.f;
+	int32 SamplesPerSide = 9;
+	FBox Bounds = FBox(ForceInit);
+	TArray<FFoliageLayerParams> Layers;
+	int32 NumBuckets = 0;
+};
+
+//Ground under a cell, a grid of SamplesPerSide squared traces taken on the game thread (well, the async trace
+//threads) before the worker starts. The worker interpolates between them instead of tracing per instance.
+struct FFoliageSurfaceSample
+{
+	FVector3f Normal = FVector3f::UpVector;
+	float Height = 0.f; //Above Bounds.Min.Z
+	bool bHit = false;
+};
+
+//Instances of one cell per mesh bucket relative to the field's Bounds.Min, filled on a worker. Not world space so a
+//cell finished across an origin rebase still lands in the right place.
+struct FFoliageCellData
+{
+	TArray<FFoliageSurfaceSample> Surface;
+	TArray<TArray<FTransform>> Instances;
+	std::atomic<bool> bCancelled{ false };
+};
+
+//Seeded runtime foliage scattered over whatever ECC_OryxWalkable ground is inside its box (ships, props and pawns
+//don't count), so large areas can be dressed without painting instances into the map. The box is cut into square
+//cells streamed in around every player pawn. Each cell traces a coarse grid of ground samples asynchronously, then
+//a worker scatters every layer over the interpolated surface. Finished cells are handed to pooled HISM components
+//under Oryx.Foliage.BudgetMs per frame.
+//Console: Oryx.Foliage.Bench
+UCLASS()
+class ORYX_API AFoliageField : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AFoliageField();
+
+	virtual void Tick(float DeltaTime) override;
+	virtual void ApplyWorldOffset(const FVector& InOffset, bool bWorldShift) override;
+
+	//Same params, coordinate and surface always give the same plants
+	static void ScatterCell(const FFoliageFieldParams& Params, const FIntPoint& Coord, FFoliageCellData& Data);
+
+	int32 GetNumLoadedCells() const { return Cells.Num(); }
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	void OnMeshesLoaded();
+	void UpdateWantedCells();
+	void StartCells();
+	void LaunchCellTasks();
+	void ApplyCells();
+	void UnloadCell(const FIntPoint& Coord);
+	void OnSurfaceTrace(const FTraceHandle& Handle, FTraceDatum& Datum, FIntPoint Coord, uint32 Serial);
+
+	UHierarchicalInstancedStaticMeshComponent* AcquireComponent(int32 Bucket);
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Foliage Field")
+	UBoxComponent* FieldBounds;
+
+	UPROPERTY(EditAnywhere, Category = "Foliage Field")
+	TArray<FFoliageFieldLayer> Layers;
+
+	UPROPERTY(EditAnywhere, Category = "Foliage Field")
+	int32 Seed = 7919;
+
+	UPROPERTY(EditAnywhere, Category = "Foliage Field", meta = (ClampMin = "100"))
+	float CellSize = 2400.f;
+
+	UPROPERTY(EditAnywhere, Category = "Foliage Field", meta = (ClampMin = "2", ClampMax = "33"))
+	int32 SamplesPerSide = 9; //Ground traces along each side of a cell
+
+	UPROPERTY(EditAnywhere, Category = "Foliage Field|Streaming")
+	float LoadDistance = 12000.f; //Keep it at or past the largest layer cull distance
+
+	UPROPERTY(EditAnywhere, Category = "Foliage Field|Streaming")
+	float PrefetchSeconds = 2.f; //How far ahead along the velocity cells are requested, for landing ships
+
+	UPROPERTY(EditAnywhere, Category = "Foliage Field|Streaming", meta = (ClampMin = "1"))
+	int32 MaxCellsInFlight = 8; //Tracing or scattering
+
+	//Emptied components kept for the next cell instead of being destroyed, each keeps its mesh
+	UPROPERTY(Transient)
+	TArray<UHierarchicalInstancedStaticMeshComponent*> FreeComponents;
+
+	struct FCell
+	{
+		TSharedPtr<FFoliageCellData> Data;
+		UE::Tasks::FTask Task;
+		TArray<UHierarchicalInstancedStaticMeshComponent*> Components;
+		uint32 Serial = 0; //Tells its traces from those of an earlier cell at the same coordinate
+		int32 PendingTraces = 0;
+		int32 NextBucket = 0;
+		double Priority = 0.0; //Distance to the nearest pawn when requested
+		bool bLaunched = false;
+		bool bApplied = false;
+	};
+
+	TMap<FIntPoint, FCell> Cells;
+	TArray<TPair<FIntPoint, double>> WantedCells; //Not loaded yet with their priority, nearest first
+
+	//Loaded meshes by bucket, with the layer each came from
+	UPROPERTY(Transient)
+	TArray<UStaticMesh*> BucketMeshes;
+
+	TArray<int32> BucketLayers;
+	FFoliageFieldParams Params;
+	TSharedPtr<FStreamableHandle> MeshesHandle;
+	uint32 NextSerial = 1;
+	bool bMeshesLoaded = false;
+};
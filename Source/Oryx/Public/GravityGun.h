@@ -2,11 +2,60 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Engine/NetSerialization.h"
+#include "Misc/NetworkGuid.h"
 #include "GravityGun.generated.h"
 
 class UStaticMeshComponent;
 class UPhysicsHandleComponent;
 class UCameraComponent;
+class FBitWriter;
+
+//Replicated target of the held prop, quantized to keep each update small
+USTRUCT()
+struct FGravityGunHeldState
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    UPrimitiveComponent* Component = nullptr;
+
+    UPROPERTY()
+    FVector_NetQuantize10 TargetLocation = FVector::ZeroVector; //0.1cm precision
+
+    UPROPERTY()
+    FRotator TargetRotation = FRotator::ZeroRotator; //Sent as 16 bits per axis
+
+    bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+
+    //Writes what NetSerialize would send, for bandwidth stats outside of replication
+    void SerializeForStats(FBitWriter& Writer, FNetworkGUID ComponentGUID) const;
+};
+
+template<>
+struct TStructOpsTypeTraits<FGravityGunHeldState> : public TStructOpsTypeTraitsBase2<FGravityGunHeldState>
+{
+    enum { WithNetSerializer = true };
+};
+
+//Last prop fired by the server, so other machines can apply the same launch
+USTRUCT()
+struct FGravityGunFireState
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    UPrimitiveComponent* Component = nullptr;
+
+    UPROPERTY()
+    FVector_NetQuantize10 LaunchLocation = FVector::ZeroVector;
+
+    UPROPERTY()
+    FVector_NetQuantizeNormal Direction = FVector::ForwardVector;
+
+    UPROPERTY()
+    uint8 FireCount = 0; //Bumped every shot so repeated fires of the same prop still replicate
+};
 
 UCLASS()
 class ORYX_API AGravityGun : public AActor
@@ -16,6 +65,9 @@ class ORYX_API AGravityGun : public AActor
 public:
     AGravityGun();
 
+    virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+    virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
 protected:
     virtual void BeginPlay() override;
     virtual void Tick(float DeltaTime) override;
@@ -61,6 +113,58 @@ protected:
     float FireForce = 2000.f; //Impulse force when firing objects
 #pragma endregion
 
+#pragma region Networking
+    UPROPERTY(EditAnywhere, Category = "Gun|Network")
+    float HeldNetUpdateFrequency = 30.f; //Replication rate while a prop is held
+
+    UPROPERTY(EditAnywhere, Category = "Gun|Network")
+    float IdleNetUpdateFrequency = 2.f; //Replication rate while the gun is empty
+
+    UPROPERTY(EditAnywhere, Category = "Gun|Network")
+    float FiredTrackTime = 1.f; //Seconds to stay at the held rate after firing
+
+    UPROPERTY(EditAnywhere, Category = "Gun|Network")
+    float HoldTargetSendRate = 30.f; //Client -> server hold target updates per second
+
+    UPROPERTY(EditAnywhere, Category = "Gun|Network")
+    float MaxHoldTargetError = 150.f; //Extra distance the server tolerates on client hold targets
+
+    //Server view of the held prop, replicated to everyone but the owner (who predicts it)
+    UPROPERTY(ReplicatedUsing = OnRep_HeldState)
+    FGravityGunHeldState HeldState;
+
+    UPROPERTY(ReplicatedUsing = OnRep_FireState)
+    FGravityGunFireState FireState;
+
+    UFUNCTION()
+    void OnRep_HeldState();
+
+    UFUNCTION()
+    void OnRep_FireState();
+
+    UFUNCTION(Server, Reliable)
+    void ServerGrab(UPrimitiveComponent* Component);
+
+    UFUNCTION(Server, Reliable)
+    void ServerRelease();
+
+    UFUNCTION(Server, Reliable)
+    void ServerFire(UPrimitiveComponent* Component, FVector_NetQuantizeNormal Direction);
+
+    UFUNCTION(Server, Unreliable)
+    void ServerUpdateHoldTarget(FVector_NetQuantize10 Location, FRotator Rotation);
+
+    UFUNCTION(Client, Reliable)
+    void ClientRejectGrab(); //Server refused the predicted grab, undo it
+
+    float TimeSinceHoldTargetSent = 0.f;
+    float TimeSinceFire = 0.f;
+
+    //Held state as last measured for the bandwidth stats
+    TArray<uint8> LastHeldStateBits;
+    int64 LastHeldStateNumBits = -1;
+#pragma endregion
+
     float CurrentSpinSpeed = 0.f;
     bool bSpinning = false;
 
@@ -69,8 +173,21 @@ protected:
     bool bSnapping = false;
     float SnapSpeed = 10.f; //Speed of interpolation when snapping
 
+    UCameraComponent* GetOwnerCamera() const;
+    bool IsLocallyControlled() const; //True on the machine whose player owns this gun
+    UPrimitiveComponent* TraceForGrabbable() const;
+    bool CanServerGrab(const UPrimitiveComponent* Component) const;
+
+    void GrabComponent(UPrimitiveComponent* Component); //Attach physics handle (local, predicted on clients)
+    void ReleaseComponent(); //Detach physics handle (local)
+    void LaunchComponent(UPrimitiveComponent* Component, const FVector& Direction);
+    void RecordFire(UPrimitiveComponent* Component, const FVector& Direction); //Server: publish shot to other machines
+
+    void UpdateNetRate(float DeltaTime);
+    void UpdateNetStats(float DeltaTime);
+
 public:
-    //Manual rotation flags 
+    //Manual rotation flags
     bool bRotateYawRight = false;
     bool bRotateYawLeft = false;
     bool bRotatePitchUp = false;
@@ -89,4 +206,12 @@ public:
     void SnapRotationForward(); //snap to Forward-facing rotation
 
     void FireObject(); //shoot object forward
+
+    //Segment the grab trace covers this frame, false without an owner camera
+    bool GetGrabTrace(FVector& OutStart, FVector& OutEnd) const;
+
+    UPrimitiveComponent* GetHeldComponent() const { return HeldComponent; }
+
+    //Server or standalone: drops what is held and holds Component instead, nullptr only drops (loading saved games)
+    void SetHeldComponent(UPrimitiveComponent* Component);
 };
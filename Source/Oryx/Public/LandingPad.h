@@ -22,6 +22,7 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void Tick(float DeltaTime);
 
 	UFUNCTION()
@@ -40,12 +41,14 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Landing Pad")
 	USphereComponent* LandingTrigger;
 
+	//Every ship inside the trigger, a busy pad can have several waiting around it
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
-	ASpaceshipPawn* OverlappingShip;
+	TArray<ASpaceshipPawn*> OverlappingShips;
 
+	//Ships inside the trigger and high enough to start landing
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
-	bool bCanLand = false;
+	TArray<ASpaceshipPawn*> ShipsCanLand;
 
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
-	bool bIsInsideTrigger = false;
+	//Point inside the trigger and above the pad where an arriving ship can start its landing
+	FVector GetApproachPoint() const;
 };
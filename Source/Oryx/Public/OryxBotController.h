@@ -0,0 +1,43 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Controller.h"
+#include "OryxInputAction.h"
+#include "OryxBotController.generated.h"
+
+//One timed line of a bot script: "<seconds> <Action> [x [y [z]]]"
+struct FOryxBotCommand
+{
+	float Time = 0.f;
+	EOryxInputAction Action = EOryxInputAction::None;
+	FInputActionValue Value;
+};
+
+//Parsed bot script, shared by every bot running it
+struct ORYX_API FOryxBotScript
+{
+	TArray<FOryxBotCommand> Commands;
+	float Duration = 0.f; //Loop length, one second past the last command
+
+	static TSharedPtr<const FOryxBotScript> LoadFromFile(const FString& Path);
+};
+
+//Headless controller that possesses an Oryx pawn and plays a looping input script into it
+UCLASS()
+class ORYX_API AOryxBotController : public AController
+{
+	GENERATED_BODY()
+
+public:
+	AOryxBotController();
+
+	void SetScript(TSharedPtr<const FOryxBotScript> InScript, float StartOffset);
+
+protected:
+	virtual void Tick(float DeltaTime) override;
+
+	TSharedPtr<const FOryxBotScript> Script;
+
+	float ScriptTime = 0.f;
+	int32 NextCommand = 0;
+};
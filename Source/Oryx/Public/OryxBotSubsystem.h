@@ -0,0 +1,67 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "OryxBotSubsystem.generated.h"
+
+class AOryxBotController;
+struct FOryxBotScript;
+
+//Spawns scripted bots for load testing and reports server tick time as the bot count grows.
+//Start a server with "-OryxBots=64 [-OryxBotScript=Bots/ShipPatrol.txt] [-OryxBotPawn=OnFoot]"
+//or use the Oryx.Bots.Spawn / Oryx.Bots.Clear console commands. Reports also go to Saved/Profiling/OryxBots.csv,
+//which shipping servers write without logging.
+UCLASS(Config = Game)
+class ORYX_API UOryxBotSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//Spawns Count bots, each possessing a new ship (or on-foot pawn) and looping ScriptPath
+	void SpawnBots(int32 Count, const FString& ScriptPath, bool bOnFoot);
+	void ClearBots();
+
+	int32 GetNumBots() const { return Bots.Num(); }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	UPROPERTY(Config)
+	TSoftClassPtr<APawn> ShipPawnClass;
+
+	UPROPERTY(Config)
+	TSoftClassPtr<APawn> OnFootPawnClass;
+
+	UPROPERTY(Config)
+	FString DefaultShipScript; //Relative to the project content directory
+
+	UPROPERTY(Config)
+	FString DefaultOnFootScript;
+
+	UPROPERTY(Config)
+	float SpawnSpacing = 1500.f; //Distance between bots on the spawn grid
+
+	UPROPERTY(Config)
+	int32 SpawnGridWidth = 16; //Bots per row, fixed so later batches continue the grid instead of overlapping it
+
+	UPROPERTY(Config)
+	float ReportInterval = 5.f; //Seconds between tick time reports
+
+	UPROPERTY()
+	TArray<AOryxBotController*> Bots;
+
+	int32 NextSpawnSlot = 0; //Grid slot of the next bot, kept across batches until the bots are cleared
+
+	//Tick time accumulated since the last report
+	int32 ReportFrames = 0;
+	double ReportFrameTime = 0.0;
+	double ReportGameThreadTime = 0.0;
+	double ReportMaxFrameTime = 0.0;
+	double ReportTimer = 0.0;
+	bool bReportHeaderWritten = false; //Report file is started over once per run
+};
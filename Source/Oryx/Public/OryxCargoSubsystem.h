@@ -0,0 +1,33 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "OryxCargoSubsystem.generated.h"
+
+class UShipCargoHoldComponent;
+struct FOryxEvent;
+
+//Routes props released or fired by a gravity gun to the cargo hold they landed nearest to, through one event listener
+//for the whole world instead of one per ship. The listener is only attached while a hold is registered, so a world
+//without holds keeps event pushes down to a branch. Authority only, holds register themselves.
+UCLASS()
+class ORYX_API UOryxCargoSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	void RegisterHold(UShipCargoHoldComponent* Hold);
+	void UnregisterHold(UShipCargoHoldComponent* Hold);
+
+	int32 GetNumHolds() const { return Holds.Num(); }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void OnEvents(TConstArrayView<FOryxEvent> Events);
+
+	TArray<TWeakObjectPtr<UShipCargoHoldComponent>> Holds;
+	FDelegateHandle EventsHandle;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "OryxContentBudgetCommandlet.generated.h"
+
+class FJsonObject;
+class UStaticMesh;
+class UTexture;
+class UNiagaraSystem;
+class UBlueprint;
+
+//Checks maps and blueprints against per-category content budgets. Everything a map or blueprint hard references is
+//measured (World Partition maps include their external actors): static mesh triangles and collision, texture memory,
+//Niagara emitter counts and particle caps, blueprint component counts, plus each map's total texture memory.
+//Writes a JSON report and returns non-zero if anything is over budget, so CI can fail on it.
+//  UnrealEditor-Cmd Oryx.uproject -run=OryxContentBudget [-Roots=/Game/Maps,/Game/Blueprints] [-Report=Path.json] -unattended -nullrhi
+UCLASS(Config = Game)
+class ORYX_API UOryxContentBudgetCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UOryxContentBudgetCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+	UPROPERTY(Config)
+	int32 MaxMeshTriangles = 100000; //LOD0 of meshes without Nanite
+
+	UPROPERTY(Config)
+	int32 MaxNaniteTriangles = 2000000;
+
+	UPROPERTY(Config)
+	int32 MaxCollisionElements = 16; //Simple shapes and convex hulls
+
+	UPROPERTY(Config)
+	int32 MaxConvexVertices = 1024; //Summed over every hull
+
+	UPROPERTY(Config)
+	bool bAllowComplexAsSimple = false; //Per-triangle collision for physics queries
+
+	UPROPERTY(Config)
+	float MaxTextureMB = 8.f; //All mips, for the platform the commandlet runs on
+
+	UPROPERTY(Config)
+	int32 MaxTextureSize = 2048; //Largest imported dimension
+
+	UPROPERTY(Config)
+	int32 MaxNiagaraEmitters = 8;
+
+	UPROPERTY(Config)
+	int32 MaxParticlesPerEmitter = 2000;
+
+	UPROPERTY(Config)
+	bool bRequireParticleCaps = true; //Emitters left on automatic allocation have no declared cap
+
+	UPROPERTY(Config)
+	int32 MaxBlueprintComponents = 40;
+
+	UPROPERTY(Config)
+	float MaxMapTextureMB = 1024.f;
+
+#if WITH_EDITOR
+	//Each fills Metrics and returns the budget violations, empty when within budget
+	TArray<FString> CheckStaticMesh(UStaticMesh* Mesh, FJsonObject& Metrics) const;
+	TArray<FString> CheckTexture(UTexture* Texture, FJsonObject& Metrics, float& OutMB) const;
+	TArray<FString> CheckNiagaraSystem(UNiagaraSystem* System, FJsonObject& Metrics) const;
+	TArray<FString> CheckBlueprint(UBlueprint* Blueprint, FJsonObject& Metrics) const;
+
+	//Hard package dependencies under /Game, recursively, including Package itself
+	void GatherDependencies(FName Package, TSet<FName>& InOutPackages) const;
+#endif
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Containers/Queue.h"
+#include "UObject/ObjectKey.h"
+#include <atomic>
+#include "OryxEventSubsystem.generated.h"
+
+enum class EOryxEventType : uint8
+{
+	LandingStage, //Subject ship, Value the new ELandingStage, None after Landed is a takeoff
+	PadEntered, //Subject ship now above Other pad and able to land, Value 1 if the pad is free for it
+	PadExited, //Subject ship dropped below Other pad
+	PadDenied, //Subject ship asked to land on Other pad but it's reserved
+	Grab, //Subject gravity gun, Other the component
+	Release,
+	Fire,
+	Board, //Subject ship, Other the pawn that boarded it
+	Exit, //Subject ship, Other the pawn that left it
+	Stow, //Subject ship, Other the prop taken into its cargo hold (gone by dispatch), Value the items now held
+	Eject, //Subject ship, Other the prop put back out, Value the items left
+	Fracture //Subject the prop's actor, Other the prop broken into pieces (gone by dispatch), Value the pieces
+};
+
+//One gameplay state change. Plain data, so pushing one is a copy into the queue and nothing is formatted
+struct FOryxEvent
+{
+	double Time = 0.0; //FPlatformTime::Seconds
+	uint32 Frame = 0;
+	EOryxEventType Type = EOryxEventType::LandingStage;
+	uint8 Value = 0;
+	FObjectKey Subject;
+	FObjectKey Other;
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnOryxEvents, TConstArrayView<FOryxEvent> /*Events*/);
+
+//Typed gameplay event stream. Producers on any thread push into a lock-free multi producer queue, once a frame the
+//game thread drains it and hands the whole batch to every listener. With no listeners Push returns before touching
+//the queue, so events cost a branch. Built-in listeners: on-screen prompts (Oryx.Events.Screen) and log (Oryx.Events.Log).
+//Console: Oryx.Events.Bench [Count]
+UCLASS()
+class ORYX_API UOryxEventSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//Safe from any thread while the world is alive
+	static void Push(const UObject* WorldContext, EOryxEventType Type, const UObject* Subject, const UObject* Other = nullptr, uint8 Value = 0);
+	void Push(const FOryxEvent& Event);
+
+	bool HasListeners() const { return NumListeners.load(std::memory_order_relaxed) > 0; }
+
+	//Game thread only, Listener gets every event pushed since the last batch
+	FDelegateHandle AddListener(FOnOryxEvents::FDelegate&& Listener);
+	void RemoveListener(FDelegateHandle Handle);
+
+	//Drains the queue and dispatches now instead of waiting for Tick
+	void Flush();
+
+	//Pushes Count events from every worker with a counting listener attached and logs the throughput
+	void RunBenchmark(int32 Count);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	//Adds or removes the built-in listeners to match their console variables
+	void SyncBuiltInListeners();
+
+	void ShowOnScreen(TConstArrayView<FOryxEvent> Events) const;
+	void LogEvents(TConstArrayView<FOryxEvent> Events) const;
+
+	TQueue<FOryxEvent, EQueueMode::Mpsc> Queue;
+	FOnOryxEvents OnEvents;
+	std::atomic<int32> NumListeners{ 0 };
+	TArray<FOryxEvent> Batch;
+
+	FDelegateHandle ScreenHandle;
+	FDelegateHandle LogHandle;
+};
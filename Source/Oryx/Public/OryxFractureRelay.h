@@ -0,0 +1,20 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "OryxFractureSubsystem.h"
+#include "OryxFractureRelay.generated.h"
+
+//Carries fracture breaks from the authority to clients. Spawned by the authority's UOryxFractureSubsystem in networked
+//games, always relevant and without replicated movement, it only ever sends breaks
+UCLASS(NotPlaceable, Transient)
+class ORYX_API AOryxFractureRelay : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AOryxFractureRelay();
+
+	UFUNCTION(NetMulticast, Reliable)
+	void MulticastBreak(const FOryxFractureBreak& Break);
+};
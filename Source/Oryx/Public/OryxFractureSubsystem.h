@@ -0,0 +1,196 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "OryxFractureSubsystem.generated.h"
+
+class AActor;
+class AOryxFractureRelay;
+class UInstancedStaticMeshComponent;
+class UPrimitiveComponent;
+class UStaticMesh;
+class UStaticMeshComponent;
+struct FHitResult;
+struct FOryxEvent;
+struct FStreamableHandle;
+
+//A prop mesh and the pieces it breaks into. Pieces are the leaf fragments of the prop's geometry collection, exported
+//with the Fracture mode's To Mesh tool keeping the collection's pivot, so each one sits in place at the prop's transform
+USTRUCT()
+struct FOryxFractureSet
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Config)
+	TSoftObjectPtr<UStaticMesh> Mesh;
+
+	UPROPERTY(Config)
+	TArray<TSoftObjectPtr<UStaticMesh>> Pieces;
+
+	UPROPERTY(Config)
+	TArray<FTransform> PieceTransforms; //In the prop, by piece. Only for pieces not sharing its pivot, identity when missing
+};
+
+//One break as the authority decided it, sent to clients so they spawn their own pieces from the same state
+USTRUCT()
+struct FOryxFractureBreak
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UStaticMeshComponent* Prop = nullptr; //Gone on a client the retirement reached first, the rest still places the pieces
+
+	UPROPERTY()
+	UStaticMesh* Mesh = nullptr;
+
+	UPROPERTY()
+	FTransform Transform;
+
+	UPROPERTY()
+	FVector_NetQuantize10 Velocity;
+
+	UPROPERTY()
+	FVector_NetQuantize100 AngularVelocity; //rad/s
+
+	UPROPERTY()
+	float Mass = 0.f;
+
+	UPROPERTY()
+	bool bGravity = true;
+};
+
+//Bodies, folded instances and loaded meshes of one fracture set
+USTRUCT()
+struct FOryxFracturePool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<UStaticMesh*> Pieces;
+
+	UPROPERTY()
+	TArray<UInstancedStaticMeshComponent*> Folded; //One per piece, made on first fold
+
+	UPROPERTY()
+	TArray<UStaticMeshComponent*> Free;
+
+	UPROPERTY()
+	TArray<UStaticMeshComponent*> Folding; //Frozen in place until their instances have been drawn
+
+	TArray<FTransform> PieceTransforms;
+	TArray<float> MassShares; //Of the prop's mass, by piece bounds volume
+	TArray<int32> NextFolded; //Oldest instance of each piece, overwritten once MaxFoldedPerPiece are kept
+	int32 NumActive = 0;
+};
+
+//Props a gravity gun fires break apart when they hit something fast enough. Fired props with a fracture set are
+//watched for a few seconds, a hit above FractureSpeed swaps the prop for its pieces, moving as the prop was. Pieces
+//come from a pool per set capped at MaxBodiesPerSet, and all simulating pieces together stay under MaxBodies:
+//the oldest breaks are folded early to make room. Once every piece of a break has been still for RestSeconds they
+//fold into per-piece instanced meshes without collision, and the bodies go back to the pool.
+//Only the authority watches shots and decides what breaks. It retires the prop, which replicates, and sends the break
+//through an AOryxFractureRelay so every client spawns the same pieces locally, like promoted debris. A dedicated
+//server spawns none. Console: Oryx.Fracture.PhysicsTier, Oryx.Fracture.Spawn [Count]
+UCLASS(Config = Game)
+class ORYX_API UOryxFractureSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//Authority only. Swaps Prop for its pieces moving at Velocity and sends the break to clients. False when it has no
+	//loaded set or the physics tier can't fit its pieces
+	bool Fracture(UStaticMeshComponent* Prop, const FVector& Velocity);
+
+	//A break the authority decided on, received by a client
+	void ApplyBreak(const FOryxFractureBreak& Break);
+
+	//Acquires Count pool props with the loaded sets' meshes in front of the first local player, to try breaking them
+	void SpawnProps(int32 Count);
+
+	int32 GetNumBodies() const { return NumBodies; }
+
+	//Pieces and folded instances belong to this actor, nothing else should take them
+	bool IsRubble(const AActor* Actor) const { return Actor && Actor == Rubble; }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void OnSetsLoaded();
+	void OnEvents(TConstArrayView<FOryxEvent> Events);
+	void StopWatching(int32 Index);
+	void Fold(int32 Index);
+	void AddFolded(FOryxFracturePool& Pool, int32 Piece, const FTransform& Transform);
+	bool SpawnPieces(const FOryxFractureBreak& Break);
+	UStaticMeshComponent* AcquireBody(FOryxFracturePool& Pool);
+	int32 GetBodyBudget() const;
+
+	UFUNCTION()
+	void OnPropHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
+
+	UPROPERTY(Config)
+	TArray<FOryxFractureSet> Sets;
+
+	UPROPERTY(Config)
+	float FractureSpeed = 1500.f; //cm/s the prop was moving at the frame before the hit
+
+	UPROPERTY(Config)
+	float WatchSeconds = 4.f; //After a shot
+
+	UPROPERTY(Config)
+	float SpreadSpeed = 150.f; //cm/s added to each piece away from the prop's center
+
+	UPROPERTY(Config)
+	int32 MaxBodiesPerSet = 48; //Hard cap of each set's pool
+
+	UPROPERTY(Config)
+	int32 MaxBodies = 192; //All simulating pieces together, scaled down by Oryx.Fracture.PhysicsTier
+
+	UPROPERTY(Config)
+	float RestSpeed = 5.f; //cm/s, slower pieces count as still
+
+	UPROPERTY(Config)
+	float RestSeconds = 3.f;
+
+	UPROPERTY(Config)
+	int32 MaxFoldedPerPiece = 256;
+
+	//Keyed by the intact prop mesh
+	UPROPERTY(Transient)
+	TMap<UStaticMesh*, FOryxFracturePool> Pools;
+
+	//Owns the pieces' bodies and instanced meshes
+	UPROPERTY(Transient)
+	AActor* Rubble = nullptr;
+
+	//Authority of a networked game only
+	UPROPERTY(Transient)
+	AOryxFractureRelay* Relay = nullptr;
+
+	struct FWatchedProp
+	{
+		TWeakObjectPtr<UStaticMeshComponent> Prop;
+		double Until = 0.0;
+		FVector Velocity = FVector::ZeroVector;
+		bool bNotifiedHits = false; //The prop's own setting, put back when watching stops
+	};
+
+	//One broken prop. Bodies are owned by Rubble, in the order of the set's pieces
+	struct FBreak
+	{
+		UStaticMesh* Mesh = nullptr;
+		TArray<UStaticMeshComponent*, TInlineAllocator<16>> Bodies;
+		double StillSince = 0.0;
+	};
+
+	TArray<FWatchedProp> Watched;
+	TArray<TPair<TWeakObjectPtr<UStaticMeshComponent>, FVector>> PendingBreaks; //Hits wait for the tick, out of physics callbacks
+	TArray<FBreak> Breaks; //Oldest first
+	int32 NumBodies = 0;
+	TSharedPtr<FStreamableHandle> SetsHandle;
+	FDelegateHandle EventsHandle;
+};
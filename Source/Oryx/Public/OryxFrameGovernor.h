@@ -0,0 +1,103 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include <atomic>
+#include "OryxFrameGovernor.generated.h"
+
+//Solver advance time, written by the physics thread and collected once per game frame
+struct FOryxPhysicsTiming
+{
+	std::atomic<uint64> StepStartCycles{ 0 };
+	std::atomic<uint64> AccumulatedCycles{ 0 };
+};
+
+//At governor Level and above, console variable CVar is set to Value
+USTRUCT()
+struct FOryxGovernorStep
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Config)
+	FString CVar;
+
+	UPROPERTY(Config)
+	int32 Level = 1;
+
+	UPROPERTY(Config)
+	float Value = 0.f;
+};
+
+//Trades gameplay simulation detail for frame time. Game thread world tick time and Chaos solver time are smoothed and
+//compared to TargetFrameMs and PhysicsBudgetMs. Staying over either for DegradeSeconds raises the level one step,
+//staying well under both for RestoreSeconds lowers it again, and the gap between the two thresholds keeps it
+//from flapping. Each level applies the Steps at or below it (pilot budget, debris physics tier, thruster FX LOD,
+//gravity gun hold rate...), the level 0 values are whatever the console variables held at begin play.
+//Oryx.Governor.SyntheticGameMs and Oryx.Governor.SyntheticPhysicsMs inject load so it can be exercised headless.
+UCLASS(Config = Game)
+class ORYX_API UOryxFrameGovernor : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	int32 GetLevel() const { return Level; }
+	int32 GetMaxLevel() const { return MaxLevel; }
+
+	//Applies the steps for NewLevel and logs every console variable it changes
+	void SetLevel(int32 NewLevel, const TCHAR* Reason);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void OnWorldTickStart(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+	void OnWorldPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+
+	UPROPERTY(Config)
+	float TargetFrameMs = 16.6f; //Game thread world tick
+
+	UPROPERTY(Config)
+	float PhysicsBudgetMs = 6.f;
+
+	UPROPERTY(Config)
+	float DegradeMargin = 0.05f; //Over target by this fraction counts as over budget
+
+	UPROPERTY(Config)
+	float RestoreMargin = 0.25f; //Under target by this fraction counts as having room
+
+	UPROPERTY(Config)
+	float DegradeSeconds = 0.5f;
+
+	UPROPERTY(Config)
+	float RestoreSeconds = 3.f;
+
+	UPROPERTY(Config)
+	float SmoothingSeconds = 0.25f;
+
+	UPROPERTY(Config)
+	TArray<FOryxGovernorStep> Steps;
+
+	//Level 0 value of every console variable a step touches
+	TMap<FString, FString> DefaultValues;
+
+	int32 Level = 0;
+	int32 MaxLevel = 0;
+
+	double TickStartTime = 0.0;
+	float GameMs = 0.f;
+	float PhysicsMs = 0.f; //Solver advance on the physics thread, not the wall time of the physics tick groups
+	float SmoothedGameMs = 0.f;
+	float SmoothedPhysicsMs = 0.f;
+	float OverSeconds = 0.f;
+	float UnderSeconds = 0.f;
+
+	FDelegateHandle TickStartHandle;
+	FDelegateHandle PostActorTickHandle;
+	FDelegateHandle SolverPreAdvanceHandle;
+	FDelegateHandle SolverPostAdvanceHandle;
+	TSharedPtr<FOryxPhysicsTiming, ESPMode::ThreadSafe> PhysicsTiming;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "InputActionValue.h"
+#include "OryxInputAction.generated.h"
+
+class APawn;
+
+//Every gameplay input the Oryx pawns react to, so scripts and tools can drive them without Enhanced Input
+UENUM(BlueprintType)
+enum class EOryxInputAction : uint8 //uint8 so recorded streams stay compact
+{
+	None,
+
+	//Ship
+	ForwardThrust,
+	LeftThrust,
+	RightThrust,
+	AllThrusters,
+	Brake,
+	Land,
+	Steer,              // 2D steering offset in [-1,1], stands in for the mouse
+
+	//On foot
+	MoveForward,
+	MoveBackward,
+	MoveLeft,
+	MoveRight,
+	Look,
+	Jump,
+	BoardShip,
+
+	//Gravity gun
+	GravityGrab,
+	RotateRight,
+	RotateLeft,
+	RotateForward,
+	RotateBackward,
+	SnapHorizontal,
+	SnapVertical,
+	SnapForward,
+	Spin,
+	Fire
+};
+
+namespace OryxInput
+{
+	//Routes an input to whichever Oryx pawn is given, through the same callbacks Enhanced Input uses
+	ORYX_API void Dispatch(APawn* Pawn, EOryxInputAction Action, const FInputActionValue& Value);
+
+	//Hands an input to the world's recorder, does nothing unless a recording is running
+	ORYX_API void Record(const APawn* Source, EOryxInputAction Action, const FInputActionValue& Value);
+
+	//True while a recording is being replayed into Source's world, live device input should be ignored
+	ORYX_API bool IsPlayingBack(const AActor* Source);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "OryxInputAction.h"
+#include "OryxInputRecorder.generated.h"
+
+class APawn;
+
+//One recorded input, Frame counts fixed steps since recording started
+struct FOryxRecordedInput
+{
+	uint32 Frame = 0;
+	EOryxInputAction Action = EOryxInputAction::None;
+	FInputActionValue Value;
+};
+
+//Records every input reaching the local player's Oryx pawn into a compact binary file and replays it
+//through fixed-step simulation, comparing per-frame state checksums to detect divergence.
+//Console: Oryx.Input.Record <Name>, Oryx.Input.Stop, Oryx.Input.Play <Name>
+//Command line: -OryxRecord=<Name> or -OryxReplay=<Name> [-OryxReplayExit]
+UCLASS()
+class ORYX_API UOryxInputRecorder : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void StartRecording(const FString& Name);
+	void StartPlayback(const FString& Name);
+	void Stop();
+
+	bool IsRecording() const { return bRecording; }
+	bool IsPlaying() const { return bPlaying; }
+
+	//Called from the pawn input callbacks, ignores anything but the local player's pawn
+	void RecordInput(const APawn* Source, EOryxInputAction Action, const FInputActionValue& Value);
+
+	static FString GetRecordingPath(const FString& Name);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	APawn* GetPlayerPawn() const;
+	uint32 ComputeStateChecksum() const; //CRC of quantized ship and on-foot pawn state
+	void EnableFixedStep();
+	void RestoreTimeStep();
+
+	bool SaveRecording(const FString& Path) const;
+	bool LoadRecording(const FString& Path);
+	void FinishPlayback();
+
+	//Live device input would mix with the recording, the played pawn's Enhanced Input bindings are off meanwhile
+	void BlockLiveInput();
+	void RestoreLiveInput();
+
+	float FixedDeltaTime = 1.f / 60.f;
+	bool bPrevUseFixedTimeStep = false;
+	double PrevFixedDeltaTime = 0.0;
+
+	bool bRecording = false;
+	bool bPlaying = false;
+	bool bExitWhenDone = false;
+
+	FString ActiveName;
+	uint32 CurrentFrame = 0;
+	int32 NextInput = 0;
+	int32 FirstDivergentFrame = INDEX_NONE;
+
+	TArray<FOryxRecordedInput> Inputs;
+	TArray<uint32> Checksums;          //Recorded run
+	TArray<uint32> PlaybackChecksums;  //This run, written next to the recording when playback ends
+	TArray<TWeakObjectPtr<APawn>> InputBlockedPawns;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/UObjectArray.h"
+#include <atomic>
+
+class UWorld;
+
+//Boot and map-load profiling, started from the module so boot loads are seen. With -OryxLoadProfile every package is
+//recorded in the order it is created (imports included, whichever thread loads them) along with whether the game
+//thread was blocked on a load at the time: inside LoadMap, or a synchronous LoadPackage until the next frame starts.
+//A blocking package's time runs until the next package is created in the same blocking stretch, close to the time
+//spent on that package alone. It writes to Saved/Profiling/OryxLoad (or -OryxLoadProfileDir=):
+//  Packages.csv        order, time, blocking ms and map of every package
+//  GameOpenOrder.log   cooked file open order, for Build/<Platform>/FileOpenOrder
+//  Preload.ini         per-map lists of blocking packages for UOryxPreloadSubsystem
+//-OryxLoadProfile=Seconds writes them that long after the first playable frame (5 by default).
+//-OryxFirstFrame only reports time-to-first-playable-frame: process start until a frame ends with a loaded map and a
+//local player pawn. It is logged and appended to FirstFrame.csv. -OryxLoadProfileExit quits once the run is reported.
+//Console: Oryx.LoadProfile.Dump
+class ORYX_API FOryxLoadProfiler : public FUObjectArray::FUObjectCreateListener
+{
+public:
+	static void StartFromCommandLine();
+	static void Shutdown();
+	static FOryxLoadProfiler* Get();
+
+	virtual ~FOryxLoadProfiler() override;
+
+	virtual void NotifyUObjectCreated(const UObjectBase* Object, int32 Index) override;
+	virtual void OnUObjectArrayShutdown() override;
+
+	bool Dump();
+
+private:
+	FOryxLoadProfiler(bool bInRecord, float InSettleSeconds, bool bInExit);
+
+	void OpenWindow(bool bMapLoad);
+	void CloseWindow();
+
+	void OnPreLoadMap(const FString& MapName);
+	void OnPostLoadMap(UWorld* World);
+	void OnSyncLoadPackage(const FString& PackageName);
+	void OnBeginFrame();
+	void OnEndFrame();
+
+	const UWorld* FindPlayableWorld() const;
+	void ReportFirstFrame(const UWorld* World, double Seconds) const;
+
+	struct FPackageRecord
+	{
+		FName Name;
+		double Time = 0.0;
+		int32 Window = INDEX_NONE; //Blocking stretch it was created in, none when the game thread kept running
+		int32 Segment = INDEX_NONE; //Map load it came after, none during boot
+	};
+
+	//A stretch of time the game thread waited on loading
+	struct FWindow
+	{
+		double Start = 0.0;
+		double End = 0.0;
+		bool bMapLoad = false;
+	};
+
+	const bool bRecord;
+	const float SettleSeconds;
+	const bool bExit;
+	bool bListening = false;
+
+	mutable FCriticalSection RecordsLock;
+	TArray<FPackageRecord> Records;
+	TArray<FWindow> Windows;
+	TArray<FName> SegmentMaps;
+
+	std::atomic<int32> CurrentWindow{ INDEX_NONE };
+	std::atomic<int32> CurrentSegment{ INDEX_NONE };
+
+	double FirstFrameTime = 0.0; //Platform seconds, 0 until the first playable frame
+	bool bDumped = false;
+	FString OutputDir;
+	FDelegateHandle PreLoadMapHandle;
+	FDelegateHandle PostLoadMapHandle;
+	FDelegateHandle SyncLoadHandle;
+	FDelegateHandle BeginFrameHandle;
+	FDelegateHandle EndFrameHandle;
+};
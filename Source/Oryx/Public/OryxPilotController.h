@@ -0,0 +1,81 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Controller.h"
+#include "OryxInputAction.h"
+#include "OryxPilotController.generated.h"
+
+class ALandingPad;
+class ASpaceshipPawn;
+enum class EShipNavResult : uint8;
+
+//NPC pilot that flies an ASpaceshipPawn through the same inputs a player uses (thrust, brake, steer, land).
+//It doesn't tick: UOryxPilotScheduler calls Think() under a frame budget, and between thinks the ship
+//keeps flying on whatever inputs were last pressed.
+UCLASS(Config = Game)
+class ORYX_API AOryxPilotController : public AController
+{
+	GENERATED_BODY()
+
+public:
+	AOryxPilotController();
+
+	//Loops through Route, each leg routed around terrain by the ship nav octree. With bLandAfterEachLap the
+	//pilot asks traffic control for a pad at the end of every lap and lands there before flying on.
+	void SetRoute(const TArray<FVector>& InRoute);
+
+	//Re-plans and updates the ship's inputs, called by the scheduler about every ThinkFrames frames
+	void Think(int32 ThinkFrames = 1);
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void OnPossess(APawn* InPawn) override;
+	virtual void ApplyWorldOffset(const FVector& InOffset, bool bWorldShift) override;
+
+	void RequestLegPath();
+	void OnPadAssigned(ALandingPad* Pad);
+	void OnLegPathFound(EShipNavResult Result, const TArray<FVector>& Path, uint32 RequestId);
+
+	//Where the current leg ends, the assigned pad if there is one
+	FVector GetGoal() const;
+
+	//Presses or releases an action only when its state changes
+	void SetPressed(EOryxInputAction Action, bool bPressed, bool& bCurrent);
+
+	UPROPERTY(Config)
+	float CruiseSpeed = 2000.f;
+
+	UPROPERTY(Config)
+	float ArrivalRadius = 1500.f; //Route point reached
+
+	UPROPERTY(Config)
+	float WaypointRadius = 800.f; //Nav path waypoint reached
+
+	UPROPERTY(Config)
+	float ThrustConeAngle = 25.f; //Only thrust when the nose is within this many degrees of the heading
+
+	UPROPERTY(Config)
+	bool bLandAfterEachLap = true;
+
+	UPROPERTY(Config)
+	float LandedWaitTime = 20.f; //Seconds spent on a pad before taking off again
+
+	UPROPERTY()
+	ASpaceshipPawn* Ship = nullptr;
+
+	UPROPERTY()
+	ALandingPad* AssignedPad = nullptr;
+
+	double LandedTime = -1.0;
+
+	TArray<FVector> Route;
+	int32 RouteIndex = 0;
+
+	TArray<FVector> LegPath;
+	int32 LegPathIndex = 0;
+	uint32 LegPathRequest = 0;
+
+	bool bThrusting = false;
+	bool bBraking = false;
+};
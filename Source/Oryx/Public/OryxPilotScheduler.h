@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "OryxPilotScheduler.generated.h"
+
+class AOryxPilotController;
+
+//Shares a per-frame millisecond budget (Oryx.Pilots.BudgetMs) between every NPC pilot. Pilots near a player
+//want to think every frame, distant ones only every FarThinkFrames. Each frame the most overdue pilots think
+//first until the budget runs out, anyone skipped is more overdue next frame so nobody starves.
+//Console: Oryx.Pilots.Spawn <Count> [PatrolRadius], Oryx.Pilots.Clear
+UCLASS(Config = Game)
+class ORYX_API UOryxPilotScheduler : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterPilot(AOryxPilotController* Pilot);
+	void UnregisterPilot(AOryxPilotController* Pilot);
+
+	//Spawns ships flown by pilots patrolling random points around the first player start
+	void SpawnPilots(int32 Count, float PatrolRadius);
+	void ClearPilots();
+
+	int32 GetNumPilots() const { return Pilots.Num(); }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	//Frames a pilot may go between thinks at Distance from the closest player
+	float GetThinkInterval(float Distance) const;
+
+	UPROPERTY(Config)
+	TSoftClassPtr<APawn> PilotShipClass;
+
+	UPROPERTY(Config)
+	float NearDistance = 10000.f; //Inside this pilots think every frame
+
+	UPROPERTY(Config)
+	float FarDistance = 50000.f; //Beyond this pilots think every FarThinkFrames
+
+	UPROPERTY(Config)
+	int32 FarThinkFrames = 8;
+
+	struct FPilotEntry
+	{
+		TWeakObjectPtr<AOryxPilotController> Pilot;
+		uint64 LastThinkFrame = 0;
+	};
+
+	TArray<FPilotEntry> Pilots;
+
+	//Pilots spawned by SpawnPilots, so Clear can also remove their ships
+	UPROPERTY()
+	TArray<AOryxPilotController*> SpawnedPilots;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "UObject/UObjectGlobals.h"
+#include "OryxPreloadSubsystem.generated.h"
+
+class UPackage;
+
+//Packages a map blocked on while loading, in the order it needed them
+USTRUCT()
+struct FOryxMapPreload
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Config)
+	FName Map; //Long package name, /Game/Maps/NewMap
+
+	UPROPERTY(Config)
+	TArray<FName> Packages;
+};
+
+//Load-time preload lists. When a map with a list starts loading, or earlier if PreloadMap is called ahead of travel,
+//every package on it is requested asynchronously in one batch, so the loader reads them in parallel instead of
+//discovering them one blocking load at a time. Everything in the loaded packages is held until the map has loaded, the
+//map keeps what it uses from there. Lists are written by FOryxLoadProfiler (Preload.ini) and merged into DefaultGame.ini.
+//Console: Oryx.Preload 0 turns it off to compare against
+UCLASS(Config = Game)
+class ORYX_API UOryxPreloadSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	//Starts loading Map's list, loading the map later won't request it again. False when Map has no list
+	UFUNCTION(BlueprintCallable, Category = "Loading")
+	bool PreloadMap(const FString& Map);
+
+	//Long package name of a map URL, short name, object path or PIE world name
+	static FName GetMapPackageName(const FString& Map);
+
+protected:
+	void OnPreLoadMap(const FString& MapName);
+	void OnPostLoadMap(UWorld* World);
+	void OnPackageLoaded(const FName& PackageName, UPackage* Package, EAsyncLoadingResult::Type Result, int32 Batch);
+
+	//Holds Package's objects, a referenced package alone doesn't keep them from the collection LoadMap runs
+	void Hold(UPackage* Package);
+
+	UPROPERTY(Config)
+	TArray<FOryxMapPreload> MapPreloads;
+
+	UPROPERTY(Transient)
+	TArray<UObject*> Held;
+
+	FName PreloadingMap;
+	int32 CurrentBatch = 0; //Callbacks of a batch that was replaced are ignored
+	int32 NumRequested = 0;
+	int32 NumPending = 0;
+	double PreloadStartTime = 0.0;
+	FDelegateHandle PreLoadMapHandle;
+	FDelegateHandle PostLoadMapHandle;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "OryxPropPool.generated.h"
+
+class AStaticMeshActor;
+class UStaticMesh;
+class UPrimitiveComponent;
+
+//Hidden, collisionless static mesh actors kept for reuse, so props that come and go (cargo ejected from ships...)
+//don't spawn and destroy an actor each time. Authority only, pooled props replicate in networked games.
+UCLASS(Config = Game)
+class ORYX_API UOryxPropPool : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//A visible, simulating prop showing Mesh at Transform. Material overrides are cleared, mass is the caller's to set
+	AStaticMeshActor* Acquire(UStaticMesh* Mesh, const FTransform& Transform);
+
+	//Hides Prop and keeps it for the next Acquire, destroys it once MaxFree are kept
+	void Release(AStaticMeshActor* Prop);
+
+	//Takes a prop out of the world: released to its world's pool when it is the root of a static mesh actor spawned at
+	//runtime, otherwise the whole actor is destroyed if the prop is its root, or only the prop. Props the map placed
+	//are never pooled, a reused actor would carry their identity (saves match them by path) to an unrelated prop
+	static void Retire(UPrimitiveComponent* Prop);
+
+	int32 GetNumFree() const { return Free.Num(); }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	UPROPERTY(Config)
+	int32 MaxFree = 256;
+
+	UPROPERTY(Transient)
+	TArray<AStaticMeshActor*> Free;
+};
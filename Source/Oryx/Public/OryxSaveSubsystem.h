@@ -0,0 +1,93 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tasks/Task.h"
+#include "OryxSaveSubsystem.generated.h"
+
+class UPrimitiveComponent;
+class ULevel;
+struct FOryxSnapshotBuffers;
+
+//Fast world snapshots: ships (transform, velocity, landing stage, pad and cargo hold), on-foot pawns, what each gravity
+//gun holds, every physics prop moved from where the map placed it and the placed props taken out of the world. Records are fixed size and written flat behind a
+//versioned header, so loading maps the file and reads them in place. A full snapshot is followed by delta saves
+//that only hold props changed since it, loading applies the full snapshot and then its delta.
+//Everything is matched by a hash of its path in the map, nothing is spawned: saved actors the map doesn't have are
+//skipped, props left out of the snapshot are put back where the map placed them. Cargo is saved by asset path and
+//ejected from the pool as usual after loading.
+//Capture runs on the game thread, building and writing the file on a worker. Writes queue behind each other, saving
+//never waits on one. Only the server or a standalone game saves and loads.
+//Console: Oryx.Save [Slot] [delta], Oryx.Load [Slot], Oryx.Save.Bench [Props]
+UCLASS(Config = Game)
+class ORYX_API UOryxSaveSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//Delta saves need a full snapshot of the same slot to apply to, without one a full snapshot is written instead
+	bool Save(const FString& Slot, bool bDelta);
+	bool Load(const FString& Slot);
+
+	static FString GetSnapshotPath(const FString& Slot, bool bDelta);
+
+	//Spawns NumProps moved physics props, times capturing a full snapshot of them and removes them again
+	void RunBench(int32 NumProps);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void OnLevelAdded(ULevel* Level, UWorld* InWorld);
+	void GatherProps(const ULevel* Level);
+
+	//Game thread part of a save, delta against Base
+	void Capture(bool bDelta, FOryxSnapshotBuffers& Buffers) const;
+
+	UPROPERTY(Config)
+	float AutosaveInterval = 60.f; //Seconds, 0 turns autosave off
+
+	UPROPERTY(Config)
+	int32 DeltasPerFull = 4; //Autosaves between full snapshots
+
+	UPROPERTY(Config)
+	FString AutosaveSlot = TEXT("Autosave");
+
+	UPROPERTY(Config)
+	float MoveTolerance = 1.f; //cm, closer than this to where it was counts as not moved
+
+	UPROPERTY(Config)
+	float RotateTolerance = 0.5f; //Degrees
+
+	//A simulating component of a placed actor and where the map put it, relative to the original world origin
+	struct FProp
+	{
+		TWeakObjectPtr<UPrimitiveComponent> Component;
+		TWeakObjectPtr<const ULevel> Level; //Still in the world after the component is gone means the prop was retired
+		uint64 Id = 0;
+		FVector Location = FVector::ZeroVector;
+		FQuat Rotation = FQuat::Identity;
+	};
+
+	TArray<FProp> Props;
+
+	//Stowed or broken: the component is gone while its level is still in the world
+	static bool IsRetired(const FProp& Prop);
+
+	//Props in the last full snapshot, deltas are taken against these
+	FString BaseSlot;
+	uint64 BaseId = 0;
+	TMap<uint64, int32> BasePropIndex;
+	TSharedPtr<FOryxSnapshotBuffers> Base;
+
+	UE::Tasks::FTask WriteTask;
+	float TimeSinceAutosave = 0.f;
+	int32 AutosavesSinceFull = 0;
+	bool bSupported = false;
+
+	FDelegateHandle LevelAddedHandle;
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "OryxShipAssetSubsystem.generated.h"
+
+class ASpaceshipPawn;
+struct FStreamableHandle;
+
+//Shared asset bundles per ship class: the first ship of a class requests its bundle, later ships of that class
+//start with the assets already resident. The bundles live as long as the game instance and are released with it.
+UCLASS()
+class ORYX_API UOryxShipAssetSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	//Requests ShipClass's bundle once and keeps it resident, nullptr when the class references nothing to load
+	TSharedPtr<FStreamableHandle> PreloadShipAssets(TSubclassOf<ASpaceshipPawn> ShipClass);
+
+protected:
+	TMap<TWeakObjectPtr<UClass>, TSharedPtr<FStreamableHandle>> ShipBundles;
+};
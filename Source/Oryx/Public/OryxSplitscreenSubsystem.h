@@ -0,0 +1,75 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "OryxSplitscreenSubsystem.generated.h"
+
+class AActor;
+class APlayerController;
+class UPrimitiveComponent;
+struct FTraceDatum;
+struct FTraceHandle;
+
+//Local multiplayer mode, on while more than one local player shares the screen (Oryx.Splitscreen.Mode). Every
+//local player's view point is gathered once per frame.
+//Ground traces of every walking pawn go out together as one async batch, answered by next frame, instead of one
+//blocking trace per pawn. Thruster FX are capped per viewport: each view shows FX of its closest ships within
+//FXCullDistance (Oryx.Splitscreen.FXShipsPerView), other views hide those through their player's hidden components,
+//and ships no view picked pause their FX altogether. With one player nothing changes.
+//Console: Oryx.Splitscreen.Players <Count>
+UCLASS(Config = Game)
+class ORYX_API UOryxSplitscreenSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	bool IsActive() const { return bActive; }
+	int32 GetNumViews() const { return Views.Num(); }
+
+	//Queues Pawn's ground trace for this frame's batch. False while the mode is off or the pawn has no answer yet,
+	//the pawn traces itself then. Otherwise bOutGrounded is last frame's answer
+	bool QueryGround(const AActor* Pawn, const FVector& Start, const FVector& End, bool& bOutGrounded);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void GatherViews();
+	void IssueGroundTraces();
+	void OnGroundTrace(const FTraceHandle& Handle, FTraceDatum& Datum, uint64 Batch);
+	void UpdateThrusterFX();
+	void UnhideThrusterFX();
+	void ClearThrusterFX();
+
+	//Distance from Location to the closest local view point, at most FXCullDistance
+	float GetViewDistance(const FVector& Location) const;
+
+	UPROPERTY(Config)
+	float FXCullDistance = 40000.f; //Ships further than this from every view show no thruster FX
+
+	struct FView
+	{
+		TWeakObjectPtr<APlayerController> Player;
+		FVector Location = FVector::ZeroVector;
+	};
+
+	struct FGroundRequest
+	{
+		TWeakObjectPtr<const AActor> Pawn;
+		FVector Start = FVector::ZeroVector;
+		FVector End = FVector::ZeroVector;
+	};
+
+	TArray<FView> Views;
+	TArray<FGroundRequest> GroundRequests; //Queued by pawns this frame
+	TArray<TWeakObjectPtr<const AActor>> GroundInFlight; //Pawns of the batch out on the trace threads, by UserData
+	TMap<TWeakObjectPtr<const AActor>, bool> GroundResults; //Answers to last frame's batch
+	uint64 GroundBatch = 0;
+
+	//Thruster FX this subsystem hid per player, taken out of their hidden components again next frame
+	TMap<TWeakObjectPtr<APlayerController>, TArray<TWeakObjectPtr<UPrimitiveComponent>>> HiddenFX;
+	bool bActive = false;
+};
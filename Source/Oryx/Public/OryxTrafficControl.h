@@ -0,0 +1,113 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "OryxTrafficControl.generated.h"
+
+class ALandingPad;
+class ASpaceshipPawn;
+
+DECLARE_DELEGATE_OneParam(FOnLandingPadAssigned, ALandingPad* /*Pad*/);
+
+//Minimum cost assignment of rows to columns (Hungarian algorithm, O(n^2 m)), resumable one row at a time
+//so a large batch can be spread over several frames
+struct ORYX_API FOryxAssignmentSolver
+{
+	//Costs is Rows x Cols, row major, Rows <= Cols
+	void Start(TArray<float>&& InCosts, int32 InRows, int32 InCols);
+
+	//Adds rows until done or past Deadline (FPlatformTime::Seconds), returns true once every row is assigned
+	bool Step(double Deadline);
+
+	bool IsRunning() const { return NextRow <= Rows && Rows > 0; }
+
+	//Column assigned to each row, valid once Step has returned true
+	void GetAssignment(TArray<int32>& OutColumnForRow) const;
+
+private:
+	TArray<float> Costs;
+	int32 Rows = 0;
+	int32 Cols = 0;
+	int32 NextRow = 1;
+
+	//1-based potentials and matching as in the classic formulation, index 0 is a sentinel
+	TArray<double> U;
+	TArray<double> V;
+	TArray<int32> RowForCol;
+	TArray<int32> Way;
+};
+
+//Landing traffic control: pads are reserved for one ship at a time, ships that want to land queue up and
+//are matched to free pads in batches by FOryxAssignmentSolver, cheapest total flight distance with a bonus
+//for ships that have waited longest. The solve is time sliced under Oryx.Traffic.BudgetMs.
+UCLASS(Config = Game)
+class ORYX_API UOryxTrafficControl : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterPad(ALandingPad* Pad);
+	void UnregisterPad(ALandingPad* Pad);
+
+	//Queues Ship for the next free pad, OnAssigned fires once a pad has been reserved for it
+	void RequestLanding(ASpaceshipPawn* Ship, FOnLandingPadAssigned OnAssigned);
+	void CancelRequest(const ASpaceshipPawn* Ship);
+
+	//Reserves Pad straight away for a ship already over it, fails if another ship holds it
+	bool TryReservePad(ALandingPad* Pad, ASpaceshipPawn* Ship);
+
+	//Frees whatever Ship holds, on takeoff or when the ship goes away
+	void ReleasePad(const ASpaceshipPawn* Ship);
+
+	bool IsPadAvailableFor(const ALandingPad* Pad, const ASpaceshipPawn* Ship) const;
+	int32 GetNumWaiting() const { return Waiting.Num(); }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void StartBatch();
+	void ApplyBatch();
+
+	UPROPERTY(Config)
+	int32 MaxBatchSize = 64; //Ships per assignment batch
+
+	UPROPERTY(Config)
+	float AssignmentInterval = 0.5f; //Seconds between batches, lets requests pile up into one solve
+
+	UPROPERTY(Config)
+	float ReservationTimeout = 120.f; //Seconds a ship may hold a pad before it's taken back
+
+	UPROPERTY(Config)
+	float WaitCostPerSecond = 500.f; //Distance a ship is allowed to fly further per second already waited
+
+	struct FPadState
+	{
+		TWeakObjectPtr<ALandingPad> Pad;
+		TWeakObjectPtr<ASpaceshipPawn> ReservedBy;
+		double ReservedTime = 0.0;
+	};
+
+	struct FLandingRequest
+	{
+		TWeakObjectPtr<ASpaceshipPawn> Ship;
+		FOnLandingPadAssigned OnAssigned;
+		double RequestTime = 0.0;
+	};
+
+	FPadState* FindPadState(const ALandingPad* Pad);
+	const FPadState* FindPadState(const ALandingPad* Pad) const;
+
+	TArray<FPadState> Pads;
+	TArray<FLandingRequest> Waiting;
+
+	//Batch being solved, ships are rows unless there are fewer pads than ships
+	FOryxAssignmentSolver Solver;
+	TArray<TWeakObjectPtr<ASpaceshipPawn>> BatchShips;
+	TArray<TWeakObjectPtr<ALandingPad>> BatchPads;
+	bool bBatchShipsAreRows = true;
+	double NextBatchTime = 0.0;
+};
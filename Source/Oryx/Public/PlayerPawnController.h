@@ -3,7 +3,9 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Pawn.h"
 #include "InputActionValue.h"
+#include "Engine/NetSerialization.h"
 #include "SpaceshipPawn.h"
+#include "OryxInputAction.h"
 #include "PlayerPawnController.generated.h"
 
 class UCapsuleComponent;
@@ -13,6 +15,7 @@ class UInputMappingContext;
 class UInputAction;
 class AGravityGun;
 class ASpaceshipPawn;
+struct FStreamableHandle;
 
 UCLASS()
 class ORYX_API APlayerPawnController : public APawn
@@ -22,7 +25,18 @@ class ORYX_API APlayerPawnController : public APawn
 public:
     APlayerPawnController();
 
+    virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+    //Feeds a scripted input through the same callbacks as Enhanced Input
+    void DispatchInput(EOryxInputAction Action, const FInputActionValue& Value);
+
+    //Movement state beyond the capsule's transform and velocity, for saved games
+    float GetCameraPitch() const { return CameraPitch; }
+    FVector2D GetHorizontalVelocity() const { return CurrentHorizontalVelocity; }
+    void RestoreMovement(float InCameraPitch, const FVector2D& InHorizontalVelocity);
+
 protected:
+    virtual void NotifyControllerChanged() override;
     virtual void PossessedBy(AController* NewController) override;
     virtual void Tick(float DeltaTime) override;
     virtual void SetupPlayerInputComponent(UInputComponent* PlayerInputComponent) override;
@@ -60,10 +74,15 @@ protected:
 
 #pragma region Gravity Gun
     // Gravity Gun
+    //Soft so the gun blueprint streams in after possession instead of loading with the map
     UPROPERTY(EditAnywhere, Category = "GravityGun")
-    TSubclassOf<AGravityGun> GravityGunClass;
+    TSoftClassPtr<AGravityGun> GravityGunClass;
 
-    UPROPERTY()
+    TSharedPtr<FStreamableHandle> GravityGunClassHandle;
+
+    void SpawnGravityGun();
+
+    UPROPERTY(Replicated) //Spawned on the server, clients need it to forward input
     AGravityGun* GravityGun;
 
     UPROPERTY(EditAnywhere, Category = "GravityGunInputs")
@@ -114,6 +133,16 @@ protected:
 
     float CameraPitch = 0.f;
 
+    UPROPERTY(EditAnywhere, Category = "Movement|Network")
+    float MovementSendRate = 30.f; //Client -> server location and view updates per second
+
+    float TimeSinceMovementSent = 0.f;
+
+    //Owning client's location, yaw, camera pitch and velocity. The pawn isn't simulated on the server for remote
+    //players, the gravity gun's server checks read this copy
+    UFUNCTION(Server, Unreliable)
+    void ServerUpdateMovement(FVector_NetQuantize10 Location, float Yaw, float Pitch, FVector_NetQuantize10 Velocity);
+
 #pragma region Player Functions
     void Look(const FInputActionValue& Value);
     void Jump(const FInputActionValue& Value);
@@ -128,6 +157,9 @@ protected:
     void LeftReleased(const FInputActionValue&);
 
     void CheckGrounded();
+
+    //Logs a press/release for input recording (see UOryxInputRecorder)
+    void RecordDigital(EOryxInputAction Action, bool bPressed);
 #pragma endregion
 
 #pragma region Gravity Gun Functions
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Tasks/Task.h"
+#include <atomic>
+#include "RockField.generated.h"
+
+class UBoxComponent;
+class UHierarchicalInstancedStaticMeshComponent;
+class UStaticMesh;
+struct FStreamableHandle;
+
+USTRUCT()
+struct FRockFieldMesh
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = "Rock Field")
+	TSoftObjectPtr<UStaticMesh> Mesh;
+
+	UPROPERTY(EditAnywhere, Category = "Rock Field", meta = (ClampMin = "0"))
+	float Weight = 1.f; //Relative chance of a rock using this mesh
+};
+
+//Everything a worker needs to generate a chunk, copied off the actor so no UObject is touched off the game thread
+struct FRockFieldParams
+{
+	int32 Seed = 0;
+	float ChunkSize = 25000.f;
+	FBox Bounds = FBox(ForceInit);
+	int32 RocksPerChunk = 300;
+	float MinScale = 0.5f;
+	float MaxScale = 12.f;
+	float ScaleExponent = 3.f;
+	float SolidMinScale = 2.f;
+	float NoiseScale = 0.00002f;
+	TArray<float> CumulativeWeights;
+};
+
+//Instances of one chunk per mesh relative to the field's Bounds.Min, filled on a worker. Not world space so a
+//chunk finished across an origin rebase still lands in the right place.
+struct FRockChunkData
+{
+	TArray<TArray<FTransform>> SolidInstances; //Collide using the mesh's simple collision
+	TArray<TArray<FTransform>> DustInstances; //Too small to matter, render only
+	std::atomic<bool> bCancelled{ false };
+};
+
+//Seeded procedural rock field filling its box. The box is cut into chunks that are generated on worker threads
+//and streamed in around every local player pawn, looking ahead along its velocity so a fast ship finds chunks
+//already built. Finished chunks are handed to pooled HISM components under Oryx.Rocks.BudgetMs per frame.
+UCLASS()
+class ORYX_API ARockField : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ARockField();
+
+	virtual void Tick(float DeltaTime) override;
+	virtual void ApplyWorldOffset(const FVector& InOffset, bool bWorldShift) override;
+
+	//Same params and coordinate always give the same rocks
+	static void GenerateChunk(const FRockFieldParams& Params, const FIntVector& Coord, FRockChunkData& Out);
+
+	int32 GetNumLoadedChunks() const { return Chunks.Num(); }
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	void OnMeshesLoaded();
+	void UpdateWantedChunks();
+	void LaunchChunkTasks();
+	void ApplyChunks();
+	void UnloadChunk(const FIntVector& Coord);
+
+	UHierarchicalInstancedStaticMeshComponent* AcquireComponent(UStaticMesh* Mesh, bool bSolid);
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Rock Field")
+	UBoxComponent* FieldBounds;
+
+	UPROPERTY(EditAnywhere, Category = "Rock Field")
+	TArray<FRockFieldMesh> Meshes;
+
+	UPROPERTY(EditAnywhere, Category = "Rock Field")
+	int32 Seed = 1337;
+
+	UPROPERTY(EditAnywhere, Category = "Rock Field", meta = (ClampMin = "1000"))
+	float ChunkSize = 25000.f;
+
+	UPROPERTY(EditAnywhere, Category = "Rock Field", meta = (ClampMin = "0"))
+	int32 RocksPerChunk = 300; //Before clustering noise thins them out
+
+	UPROPERTY(EditAnywhere, Category = "Rock Field")
+	float MinScale = 0.5f;
+
+	UPROPERTY(EditAnywhere, Category = "Rock Field")
+	float MaxScale = 12.f;
+
+	UPROPERTY(EditAnywhere, Category = "Rock Field", meta = (ClampMin = "1"))
+	float ScaleExponent = 3.f; //Higher means more small rocks
+
+	UPROPERTY(EditAnywhere, Category = "Rock Field")
+	float SolidMinScale = 2.f; //Rocks smaller than this get no collision
+
+	UPROPERTY(EditAnywhere, Category = "Rock Field")
+	float NoiseScale = 0.00002f; //Size of the clusters, smaller is bigger
+
+	UPROPERTY(EditAnywhere, Category = "Rock Field|Streaming")
+	float LoadDistance = 60000.f; //Also where rocks are culled, so nothing unloaded is ever drawn
+
+	UPROPERTY(EditAnywhere, Category = "Rock Field|Streaming")
+	float PrefetchSeconds = 4.f; //How far ahead along the velocity chunks are requested
+
+	UPROPERTY(EditAnywhere, Category = "Rock Field|Streaming", meta = (ClampMin = "1"))
+	int32 MaxTasksInFlight = 8;
+
+	//Emptied components kept for the next chunk instead of being destroyed, each keeps its mesh
+	UPROPERTY(Transient)
+	TArray<UHierarchicalInstancedStaticMeshComponent*> FreeComponents;
+
+	struct FChunk
+	{
+		TSharedPtr<FRockChunkData> Data;
+		UE::Tasks::FTask Task;
+		TArray<UHierarchicalInstancedStaticMeshComponent*> Components;
+		int32 NextBucket = 0; //Mesh bucket to apply next, solids first then dust
+		double Priority = 0.0; //Distance to the nearest pawn when requested
+		bool bApplied = false;
+	};
+
+	TMap<FIntVector, FChunk> Chunks;
+	TArray<TPair<FIntVector, double>> WantedChunks; //Not loaded yet with their priority, nearest first
+
+	//Meshes that actually loaded, indices match Params.CumulativeWeights
+	UPROPERTY(Transient)
+	TArray<UStaticMesh*> LoadedMeshes;
+
+	FRockFieldParams Params;
+	TSharedPtr<FStreamableHandle> MeshesHandle;
+	bool bMeshesLoaded = false;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "ShipArchetype.generated.h"
+
+//Shared, read-only tuning for a class of ship. Every ASpaceshipPawn of that class points at the same
+//asset, so retuning a fleet is one asset edit and ships don't carry their own copies of these values.
+UCLASS(BlueprintType, Const)
+class ORYX_API UShipArchetype : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	virtual void PostInitProperties() override;
+	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+#pragma region Rotation
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Rotation")
+	float MaxMouseRadius = 200.f; //Screen pixels of mouse travel for full steering
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Rotation")
+	float RotationInterpSpeed = 2.0f;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Rotation")
+	float MaxSteerAngle = 45.f; //Pitch/yaw/roll target at full mouse offset (degrees)
+#pragma endregion
+
+#pragma region Forces
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Forces")
+	float ForwardThrusterForce = 5000.f;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Forces")
+	float SideThrusterForce = 5000.f;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Forces")
+	float TakeoffImpulse = 25000.f; //Upward impulse to break free from a pad
+#pragma endregion
+
+#pragma region Landing
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Landing")
+	float LandingMoveSpeed = 500.f;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Landing")
+	float LandingRotateSpeed = 0.5f;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Landing")
+	float LandingDescendSpeed = 200.f;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Landing")
+	float ApproachHeight = 1000.f; //Height above the pad the approach flies to
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Landing")
+	float BrakeDistance = 1000.f; //Distance to the approach point where braking starts
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Landing")
+	float AlignDistance = 300.f; //Distance to the approach point where yaw alignment starts
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Landing", meta = (ClampMin = "0", ClampMax = "1"))
+	float BrakeSpeedScale = 0.4f; //Fraction of LandingMoveSpeed while braking
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Landing", meta = (ClampMin = "0", ClampMax = "1"))
+	float AlignDriftSpeedScale = 0.2f; //Fraction of LandingMoveSpeed drifting over the pad while aligning
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Landing")
+	float FacePadTolerance = 2.5f; //Degrees on each axis before moving towards the pad
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Landing")
+	float RotationTolerance = 1.f; //Degrees on each axis before descending
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Landing")
+	float TouchdownHeight = 300.f; //Height above the pad origin where the ship counts as landed
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Landing")
+	float WaypointAcceptRadius = 400.f; //How close to a nav path waypoint before heading for the next
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Landing")
+	float ExitDistance = 500.f; //How far to the side the on-foot pawn is spawned
+#pragma endregion
+
+#pragma region Derived
+	//Precomputed from the values above whenever they load or change
+	float InvMaxMouseRadius = 0.f;
+	float BrakeSpeed = 0.f;
+	float AlignDriftSpeed = 0.f;
+
+	//Recomputes the Derived values, for archetypes filled in from code
+	void UpdateDerivedValues();
+#pragma endregion
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShipAvoidanceSubsystem.generated.h"
+
+//Everything the solver reads, one entry per agent so a batch can come from live ships or a benchmark
+struct FShipAvoidanceBatch
+{
+	TArray<FVector> Positions;
+	TArray<FVector3f> Velocities;
+	TArray<FVector3f> PreferredVelocities;
+	TArray<float> Radii;
+	TArray<float> MaxSpeeds;
+	TArray<bool> Reciprocal; //Avoids in turn, agents facing one that doesn't take the whole correction
+
+	int32 Num() const { return Positions.Num(); }
+	void Reset();
+	void Add(const FVector& Position, const FVector3f& Velocity, const FVector3f& Preferred, float Radius, float MaxSpeed, bool bReciprocal = true);
+};
+
+struct FShipAvoidanceSettings
+{
+	float NeighbourDistance = 5000.f;
+	int32 MaxNeighbours = 10;
+	float TimeHorizon = 3.f;   //Seconds ahead agents guarantee to stay clear of each other
+	float TimeStep = 1.f / 60.f;
+};
+
+//Reciprocal collision avoidance (3D ORCA) for ships. Anything that steers a ship registers it once, then
+//calls SetDesiredVelocity whenever it steers (every frame, or every few frames with the interval passed along) and
+//moves with GetAvoidanceVelocity. Registered ships that aren't steered (the player's) still count as obstacles at
+//their current velocity. All agents are solved in one batched pass after the pilot scheduler and the actors tick,
+//neighbours come from a spatial hash, results are used the next frame.
+UCLASS(Config = Game)
+class ORYX_API UShipAvoidanceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	int32 RegisterAgent(const AActor* Owner, float Radius);
+	void UnregisterAgent(int32 Handle);
+
+	//Where the agent wants to go, MaxSpeed caps what the solver may return. It stays steered towards it for
+	//SteerFrames frames, callers that steer less often than every frame pass their interval
+	void SetDesiredVelocity(int32 Handle, const FVector& Velocity, float MaxSpeed, int32 SteerFrames = 1);
+
+	//Last velocity solved while steered, or the desired velocity until the agent has been solved once
+	FVector GetAvoidanceVelocity(int32 Handle) const;
+
+	int32 GetNumAgents() const { return NumAgents; }
+
+	//Solves Batch into OutVelocities across all workers
+	static void Solve(const FShipAvoidanceBatch& Batch, const FShipAvoidanceSettings& Settings, TArray<FVector3f>& OutVelocities);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	UPROPERTY(Config)
+	float NeighbourDistance = 5000.f;
+
+	UPROPERTY(Config)
+	int32 MaxNeighbours = 10;
+
+	UPROPERTY(Config)
+	float TimeHorizon = 3.f;
+
+	//Per handle, free handles have no owner
+	struct FAgent
+	{
+		TWeakObjectPtr<const AActor> Owner;
+		float Radius = 0.f;
+		FVector3f Desired = FVector3f::ZeroVector;
+		float MaxSpeed = 0.f;
+		uint64 DesiredFrame = 0; //GFrameCounter when last steered, stale agents just hold their velocity
+		int32 SteerFrames = 1;
+		FVector3f Result = FVector3f::ZeroVector; //Only written by steered solves
+		bool bSolved = false;
+	};
+
+	TArray<FAgent> Agents;
+	TArray<int32> FreeHandles;
+	int32 NumAgents = 0;
+
+	//Reused every frame
+	FShipAvoidanceBatch Batch;
+	TArray<int32> BatchHandles;
+	TArray<FVector3f> BatchResults;
+};
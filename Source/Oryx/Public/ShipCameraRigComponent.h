@@ -0,0 +1,60 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "ShipCameraRigComponent.generated.h"
+
+class ASpaceshipPawn;
+class UCameraComponent;
+
+//Chase camera for the ship the local player flies. Ticks in TG_PostPhysics, after the physics results for the frame
+//are on the ship's body and before the player camera manager reads the view, so the view never shows last frame's
+//pose. The camera aims LeadTime ahead along the velocity and its offset from the ship follows a critically damped
+//spring, so steady flight has no lag at any speed and only changes in velocity or heading move the ship on screen.
+//On every other ship it stays asleep: no camera, no tick.
+UCLASS(ClassGroup = (Oryx), meta = (BlueprintSpawnableComponent), Config = Game)
+class ORYX_API UShipCameraRigComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UShipCameraRigComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	//Wakes the rig when the ship becomes locally player controlled and puts it to sleep when it stops
+	void RefreshLocalControl();
+
+protected:
+	virtual void BeginPlay() override;
+
+	//Takes over a camera the blueprint already has, keeping its placement as Offset, or makes one
+	void AcquireCamera();
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Camera")
+	FVector Offset = FVector(-1200.f, 0.f, 350.f); //Ship space, used when the ship has no camera of its own
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Camera")
+	float LeadTime = 0.15f; //Seconds along the velocity the camera aims at
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Camera")
+	float MaxLead = 3000.f;
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Camera")
+	float LocationSmoothTime = 0.2f; //Roughly how long the offset takes to settle after a change
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Camera")
+	float RotationSmoothTime = 0.1f;
+
+	UPROPERTY()
+	ASpaceshipPawn* Ship = nullptr;
+
+	UPROPERTY(Transient)
+	UCameraComponent* Camera = nullptr;
+
+	//Spring state, relative to the ship so origin rebases and teleports of the whole ship don't disturb it
+	FVector CurrentOffset = FVector::ZeroVector;
+	FVector OffsetRate = FVector::ZeroVector;
+	FQuat SmoothedRotation = FQuat::Identity;
+	bool bSnap = true;
+};
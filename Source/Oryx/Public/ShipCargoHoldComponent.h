@@ -0,0 +1,115 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/SceneComponent.h"
+#include "ShipCargoHoldComponent.generated.h"
+
+class UStaticMesh;
+class UStaticMeshComponent;
+class UMaterialInterface;
+
+//A stowed prop, everything needed to put it back into the world
+USTRUCT()
+struct FShipCargoItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UStaticMesh* Mesh = nullptr;
+
+	UPROPERTY()
+	TArray<UMaterialInterface*> Materials; //Overrides only, usually empty
+
+	UPROPERTY()
+	FVector3f Scale = FVector3f::OneVector;
+
+	UPROPERTY()
+	float MassKg = 0.f;
+
+	UPROPERTY()
+	TArray<float> CustomData; //Custom primitive data
+};
+
+//Cargo hold of a ship. Props a gravity gun releases or fires near the ship are watched for a few seconds (routed here
+//by UOryxCargoSubsystem when this is the closest hold), and
+//any that reach the intake sphere are stowed: the record keeps mesh, mass, scale and custom data, the prop's actor
+//goes back to UOryxPropPool (or is destroyed) so a full hold is one actor and no bodies. Ejecting takes props from
+//the pool again, one per EjectInterval so they don't spawn inside each other. Cargo mass is added to the ship's.
+//Authority only. Console: Oryx.Cargo.Eject [Count]
+UCLASS(ClassGroup = (Oryx), meta = (BlueprintSpawnableComponent), Config = Game)
+class ORYX_API UShipCargoHoldComponent : public USceneComponent
+{
+	GENERATED_BODY()
+
+public:
+	UShipCargoHoldComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	//Queues Count props to eject, every prop in the hold for 0
+	UFUNCTION(BlueprintCallable, Category = "Cargo")
+	void Eject(int32 Count = 1);
+
+	//Starts watching a released or fired prop for WatchSeconds
+	void Watch(UStaticMeshComponent* Component);
+
+	float GetWatchRadius() const { return WatchRadius; }
+	int32 GetNumItems() const { return Items.Num(); }
+	const TArray<FShipCargoItem>& GetItems() const { return Items; }
+	float GetCargoMassKg() const { return CargoMassKg; }
+
+	//Replaces what the hold carries, for loading a save. Queued ejects are dropped
+	void RestoreItems(TArray<FShipCargoItem> InItems);
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	bool CanStow(const UStaticMeshComponent* Component) const;
+	void Stow(UStaticMeshComponent* Component);
+	void EjectNext();
+	void UpdateShipMass();
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Cargo")
+	float IntakeRadius = 600.f; //Around this component, a prop touching it is stowed
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Cargo")
+	float WatchRadius = 5000.f; //Props released or fired this close are watched
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Cargo")
+	float WatchSeconds = 3.f;
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Cargo")
+	int32 MaxItems = 500;
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Cargo")
+	FVector EjectDirection = FVector(-1.f, 0.f, 0.f); //Ship space
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Cargo")
+	float EjectDistance = 800.f; //From this component to the ejected prop's bounds
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Cargo")
+	float EjectSpeed = 600.f; //On top of the ship's velocity
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Cargo")
+	float EjectInterval = 0.1f;
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Cargo")
+	bool bCargoAddsMass = true;
+
+	UPROPERTY()
+	TArray<FShipCargoItem> Items;
+
+	struct FWatchedProp
+	{
+		TWeakObjectPtr<UStaticMeshComponent> Component;
+		double Until = 0.0;
+	};
+
+	TArray<FWatchedProp> Watched;
+	int32 PendingEjects = 0;
+	float EjectCooldown = 0.f;
+	float EmptyMassKg = 0.f;
+	float CargoMassKg = 0.f;
+	bool bRegistered = false;
+};
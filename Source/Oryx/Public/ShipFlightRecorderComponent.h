@@ -0,0 +1,67 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include <atomic>
+#include "ShipFlightRecorderComponent.generated.h"
+
+class ASpaceshipPawn;
+
+//One post-physics snapshot of a ship, plain data so writes are a straight copy
+struct FShipFlightSample
+{
+	double Time = 0.0;
+	uint32 Frame = 0;
+	uint8 LandingStage = 0;
+	uint8 ActiveThrusters = 0; //EShipThrusterFlags
+	FVector Location = FVector::ZeroVector; //Relative to the original world origin
+	FQuat4f Rotation = FQuat4f::Identity;
+	FVector3f LinearVelocity = FVector3f::ZeroVector;
+	FVector3f AngularVelocity = FVector3f::ZeroVector; //deg/s
+	FVector3f AppliedForce = FVector3f::ZeroVector;
+};
+
+//Always-on flight recorder: keeps the last Capacity samples of a ship in a fixed ring buffer.
+//Single writer (the ship's post-physics tick), readers copy without locking and drop any sample
+//overwritten while they copied. Dump with "Oryx.FlightRecorder.Dump [csv|bin]", crashes dump automatically.
+UCLASS(ClassGroup = (Oryx), meta = (BlueprintSpawnableComponent))
+class ORYX_API UShipFlightRecorderComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UShipFlightRecorderComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	//Copies the buffered samples oldest first, safe from any thread
+	void CopySamples(TArray<FShipFlightSample>& OutSamples) const;
+
+	bool DumpCsv(const FString& Path) const;
+	bool DumpColumnar(const FString& Path) const;
+
+	//Columnar dump to Saved/FlightRecorder/<Ship>_Crash.oryxflight from the system error handler, without locking
+	//or allocating
+	void DumpOnCrash();
+
+	//Writes every live recorder to Saved/FlightRecorder, returns the number of files written
+	static int32 DumpAll(bool bCsv);
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Flight Recorder")
+	int32 Capacity = 2048; //~34 seconds at 60 fps
+
+	UPROPERTY()
+	ASpaceshipPawn* Ship = nullptr;
+
+	TArray<FShipFlightSample> Samples;
+	std::atomic<uint64> WriteIndex{ 0 }; //Total samples ever written, slot = index % Capacity
+
+	//Preallocated for DumpOnCrash
+	TArray<FShipFlightSample> CrashSamples;
+	TArray<uint8> CrashBuffer;
+	FString CrashPath;
+};
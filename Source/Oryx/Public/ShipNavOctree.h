@@ -0,0 +1,110 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+//One cube of the octree. Free leaves are the graph the path search runs on
+struct FShipNavNode
+{
+	FVector3f Center = FVector3f::ZeroVector;
+	float HalfSize = 0.f;
+	int32 FirstChild = INDEX_NONE; //8 consecutive children, INDEX_NONE for leaves
+	bool bBlocked = false;         //Leaves only: overlaps geometry at the finest resolution
+	int32 FirstNeighbour = 0;      //Range in Neighbours of face adjacent free leaves
+	int32 NumNeighbours = 0;
+
+	bool IsLeaf() const { return FirstChild == INDEX_NONE; }
+	FBox GetBox() const { return FBox(FVector(Center - FVector3f(HalfSize)), FVector(Center + FVector3f(HalfSize))); }
+};
+
+enum class EShipNavResult : uint8
+{
+	Success,
+	Partial,  //Ran out of budget, path ends at the node closest to the goal
+	Failed    //No octree, or start/goal outside navigable space
+};
+
+//Copy of the level's static collision as plain shapes, gathered on the game thread so the octree build can test
+//it from workers without touching the physics scene. Boxes are oriented, capsules and convex hulls are stored as
+//the oriented boxes around them, so tests err on the blocked side. Bucketed into a uniform grid for lookups.
+class ORYX_API FShipNavGeometry
+{
+public:
+	void AddBox(const FVector& Center, const FQuat& Rotation, const FVector& HalfExtent);
+	void AddSphere(const FVector& Center, float Radius);
+
+	//Call once every shape is in, Inflate grows every shape (the agent radius)
+	void Finalize(float InCellSize, float InInflate);
+
+	//True when the cube overlaps any shape grown by Inflate, safe from any thread after Finalize
+	bool Overlaps(const FVector& Center, float HalfSize) const;
+
+	int32 GetNumShapes() const { return Shapes.Num(); }
+
+private:
+	struct FShape
+	{
+		FVector Center = FVector::ZeroVector;
+		FVector Axes[3] = { FVector::XAxisVector, FVector::YAxisVector, FVector::ZAxisVector };
+		FVector HalfExtent = FVector::ZeroVector; //Radius in X for spheres
+		FBox Bounds = FBox(ForceInit);            //Grown by Inflate
+		bool bSphere = false;
+	};
+
+	bool Overlaps(const FShape& Shape, const FVector& Center, float HalfSize) const;
+	FIntVector GetCell(const FVector& Location) const;
+
+	TArray<FShape> Shapes;
+	TMap<FIntVector, TArray<int32>> Cells;
+	TArray<int32> LargeShapes; //Spanning too many cells to bucket, tested by every lookup
+	float CellSize = 1.f;
+	float Inflate = 0.f;
+};
+
+//Sparse voxel octree over level collision. Open space collapses into large free leaves and only cells touching
+//geometry are subdivided down to LeafSize, so big empty maps stay small. Immutable once built, so any number
+//of threads can search it at once.
+class ORYX_API FShipNavOctree
+{
+public:
+	//True when a cube overlaps geometry, called from worker threads during Build
+	using FBlockedTest = TFunction<bool(const FVector& Center, float HalfSize)>;
+
+	//Returns false if bCancel was raised before the build finished
+	bool Build(const FBox& Bounds, float InLeafSize, const FBlockedTest& IsBlocked, const std::atomic<bool>& bCancel);
+
+	bool IsValid() const { return Nodes.Num() > 0; }
+	int32 GetNumNodes() const { return Nodes.Num(); }
+	int32 GetNumFreeLeaves() const { return NumFreeLeaves; }
+	const FShipNavNode& GetNode(int32 Index) const { return Nodes[Index]; }
+
+	//Leaf containing Location, INDEX_NONE outside the octree
+	int32 FindLeaf(const FVector& Location) const;
+
+	//Containing leaf if free, otherwise the closest free leaf within SearchRadius
+	int32 FindNearestFreeLeaf(const FVector& Location, float SearchRadius) const;
+
+	//Free leaves overlapping Box
+	void QueryFreeLeaves(const FBox& Box, TArray<int32>& OutLeaves) const;
+
+	//Walks the segment leaf by leaf, skipping across large free leaves in one step
+	bool IsSegmentFree(const FVector& A, const FVector& B) const;
+
+	//Theta*: A* over free leaves that also tries the grandparent with a line of sight check, giving any-angle
+	//paths without a smoothing pass. MaxExpansions caps the work, OutPath includes Start and End.
+	EShipNavResult FindPath(const FVector& Start, const FVector& End, int32 MaxExpansions, TArray<FVector>& OutPath) const;
+
+	void Serialize(FArchive& Ar);
+
+	float LeafSize = 0.f;
+
+private:
+	//Classifies the node at Index and recursively splits it while it overlaps geometry
+	void BuildNode(TArray<FShipNavNode>& OutNodes, int32 Index, const FVector& Center, float HalfSize, const FBlockedTest& IsBlocked, const std::atomic<bool>& bCancel) const;
+	void BuildNeighbours();
+	void QueryFreeLeaves(int32 NodeIndex, const FBox& Box, TArray<int32>& OutLeaves) const;
+
+	TArray<FShipNavNode> Nodes; //Nodes[0] is the root
+	TArray<int32> Neighbours;
+	int32 NumFreeLeaves = 0;
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShipNavOctree.h"
+#include "Tasks/Task.h"
+#include <atomic>
+#include "ShipNavSubsystem.generated.h"
+
+DECLARE_DELEGATE_TwoParams(FOnShipNavPathFound, EShipNavResult /*Result*/, const TArray<FVector>& /*Path*/);
+
+//Builds a sparse voxel octree from a copy of the level's static collision on worker threads, caches it per map in
+//Saved/ShipNav and answers budgeted Theta* path queries for ships off the game thread. The octree is kept relative
+//to the world's original origin, so it and the cache survive origin rebasing, and query endpoints and paths are
+//converted at the edges.
+//Console: Oryx.Nav.Rebuild, Oryx.Nav.Bench <Count>
+UCLASS(Config = Game)
+class ORYX_API UShipNavSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//Queues a path query, OnFound fires on the game thread once the octree is ready and the search has run
+	void RequestPath(const FVector& Start, const FVector& End, FOnShipNavPathFound OnFound);
+
+	//Builds in the background, bUseCache skips the build when the cached octree still matches the level
+	void Rebuild(bool bUseCache);
+
+	//Runs Count searches between random free points across all workers and logs the throughput
+	void RunBenchmark(int32 Count) const;
+
+	bool IsReady() const { return Octree.IsValid(); }
+	TSharedPtr<const FShipNavOctree> GetOctree() const { return Octree; }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	//Bounds and an order independent hash of every static WorldStatic collider, changes when the level does.
+	//OutGeometry, if given, also receives their collision shapes in the octree's frame
+	uint32 GatherStaticGeometry(FBox& OutBounds, FShipNavGeometry* OutGeometry) const;
+
+	FString GetCachePath() const;
+	bool LoadCache(const FString& Path, uint32 Fingerprint);
+	static bool SaveCache(const FString& Path, uint32 Fingerprint, float RequestedLeafSize, float BuiltAgentRadius, FShipNavOctree& Built);
+
+	void CancelBuild();
+	void DispatchQueries();
+
+	//Added to a world location to get the octree's frame
+	FVector GetOriginOffset() const;
+
+	UPROPERTY(Config)
+	float LeafSize = 400.f; //Finest voxel edge length
+
+	UPROPERTY(Config)
+	float AgentRadius = 300.f; //Geometry is inflated by this so paths keep a ship's width clear
+
+	UPROPERTY(Config)
+	float BoundsPadding = 5000.f; //Flyable space beyond the outermost collider
+
+	UPROPERTY(Config)
+	int32 MaxExpansionsPerQuery = 2048; //Search budget, queries that run out return a partial path
+
+	UPROPERTY(Config)
+	int32 MaxQueriesInFlight = 256;
+
+	//Endpoints and Path in the octree's frame until delivery
+	struct FQuery
+	{
+		FVector Start;
+		FVector End;
+		FOnShipNavPathFound OnFound;
+		EShipNavResult Result = EShipNavResult::Failed;
+		TArray<FVector> Path;
+		UE::Tasks::FTask Task;
+	};
+
+	TSharedPtr<const FShipNavOctree> Octree;
+
+	//Pending build, published to Octree from Tick once it completes
+	TSharedPtr<FShipNavOctree> BuildingOctree;
+	UE::Tasks::FTask BuildTask;
+	std::atomic<bool> bCancelBuild{ false };
+	std::atomic<bool> bBuildSucceeded{ false };
+	double BuildStartTime = 0.0;
+
+	TArray<TSharedPtr<FQuery>> PendingQueries;
+	TArray<TSharedPtr<FQuery>> RunningQueries;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "WorldPartition/WorldPartitionStreamingSource.h"
+#include "ShipStreamingSourceComponent.generated.h"
+
+class ASpaceshipPawn;
+
+//World Partition streaming source that looks ahead of a fast ship. The player controller only streams around where
+//the ship is, so this adds sources where it will be after each LookAheadTimes entry along its velocity, plus the
+//landing pad it's heading for. Further look-ahead gets lower priority and is dropped first while async loading
+//is saturated. Time the ship spends with its own cells not yet activated is reported as streaming stall.
+UCLASS(ClassGroup = (Oryx), meta = (BlueprintSpawnableComponent), Config = Game)
+class ORYX_API UShipStreamingSourceComponent : public UActorComponent, public IWorldPartitionStreamingSourceProvider
+{
+	GENERATED_BODY()
+
+public:
+	UShipStreamingSourceComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	//IWorldPartitionStreamingSourceProvider
+	virtual bool GetStreamingSources(TArray<FWorldPartitionStreamingSource>& OutStreamingSources) const override;
+	virtual const UObject* GetStreamingSourceOwner() const override { return this; }
+
+	float GetStallSeconds() const { return StallSeconds; }
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	//Only ships a player flies stream, on their own machine and on the server
+	bool ShouldStream() const;
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Streaming")
+	TArray<float> LookAheadTimes = { 1.5f, 3.f, 6.f }; //Seconds, nearest first, each later one a priority lower
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Streaming")
+	float MinLookAheadSpeed = 500.f; //Slower than this the player controller's own source is enough
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Streaming")
+	int32 SaturatedAsyncPackages = 64; //Async loads in flight that count as I/O saturated
+
+	UPROPERTY()
+	ASpaceshipPawn* Ship = nullptr;
+
+	TArray<FName> LookAheadNames;
+	FName LandingName;
+
+	//Look-ahead sources in use, cut back while saturated and restored once loading drains to half
+	int32 NumLookAheads = 0;
+	bool bRegistered = false;
+	float StallSeconds = 0.f;
+};
@@ -5,6 +5,7 @@
 #include "InputActionValue.h"
 #include "NiagaraSystem.h"
 #include "NiagaraComponent.h"
+#include "OryxInputAction.h"
 #include "SpaceshipPawn.generated.h"
 
 //Forward class declarations tell the compiler that the class exists and will be defined elsewhere
@@ -15,6 +16,13 @@ class UInputAction;
 class UInputMappingContext;
 class UNiagaraComponent;
 class ALandingPad;
+class UShipFlightRecorderComponent;
+class UShipStreamingSourceComponent;
+class UShipCameraRigComponent;
+class UShipCargoHoldComponent;
+class UShipArchetype;
+enum class EShipNavResult : uint8;
+struct FStreamableHandle;
 #pragma endregion
 
 UENUM(BlueprintType)
@@ -29,6 +37,18 @@ enum class ELandingStage : uint8 //uint8 to use 1 byte in memory
 	Landed
 };
 
+//Thrusters that applied force this frame, one bit each
+enum class EShipThrusterFlags : uint8
+{
+	None = 0,
+	Main = 1 << 0,
+	Left = 1 << 1,
+	Right = 1 << 2,
+	BrakeLeft = 1 << 3,
+	BrakeRight = 1 << 4
+};
+ENUM_CLASS_FLAGS(EShipThrusterFlags);
+
 UCLASS()
 class ORYX_API ASpaceshipPawn : public APawn
 {
@@ -37,10 +57,16 @@ class ORYX_API ASpaceshipPawn : public APawn
 public:
 	ASpaceshipPawn();
 
+	virtual void PostLoad() override;
+	virtual void PostInitializeComponents() override;
+
 protected:
 	//Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void Tick(float DeltaTime) override;
+	virtual void ApplyWorldOffset(const FVector& InOffset, bool bWorldShift) override;
+	virtual void NotifyControllerChanged() override;
 	virtual void SetupPlayerInputComponent(UInputComponent* PlayerInputComponent) override;
 
 #pragma region Functions
@@ -53,15 +79,30 @@ protected:
 	//Applied currently active thrusts
 	void ApplyThrusters(float DeltaTime);
 
+	//Pauses and hides this ship's thruster FX when Oryx.Ship.ThrusterFXLod or the split-screen FX cap leaves it out
+	void UpdateThrusterFXLod();
+	bool bThrusterFXShown = true;
+	bool bThrusterFXSignificant = true;
+
 	//Begins the landing process
 	void StartLanding(ALandingPad* LandingPad);
 
 	//Function handles the actual landing functionality
 	void LandingSequence(float DeltaTime);
 
+	//Approach path around terrain from the ship nav octree, RequestId drops answers for an earlier landing
+	void OnLandingPathFound(EShipNavResult Result, const TArray<FVector>& Path, uint32 RequestId);
+
+	//Current approach waypoint, FinalTarget once the path is used up (or there is none)
+	FVector GetLandingWaypoint(const FVector& ShipLocation, const FVector& FinalTarget);
+
 	void LockShipOnPad(bool bLock);
 	void StartTakeoff();
 	void OnExitShip();
+
+	//Streams this ship's FX and exit pawn class in the background, FX are assigned once loaded
+	void RequestShipAssets();
+	void ApplyThrusterEffects();
 #pragma endregion
 
 #pragma region Input Action Callbacks
@@ -94,6 +135,18 @@ protected:
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Ship|Thrusters")
 	USceneComponent* ReverseRightThruster;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Ship")
+	UShipFlightRecorderComponent* FlightRecorder;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Ship")
+	UShipStreamingSourceComponent* StreamingSource;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Ship")
+	UShipCameraRigComponent* CameraRig;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Ship")
+	UShipCargoHoldComponent* CargoHold;
 #pragma endregion
 
 #pragma region Input Actions
@@ -122,20 +175,28 @@ protected:
 	UInputAction* IA_Land;
 #pragma endregion
 
-#pragma region Rotation Settings and Thruster forces
-	//Rotation Settings
-	UPROPERTY(EditAnywhere, Category = "Ship|Rotation")
-	float MaxMouseRadius = 200.f;
-
-	UPROPERTY(EditAnywhere, Category = "Ship|Rotation")
-	float RotationInterpSpeed = 2.0f;
-
-	//Force Values
-	UPROPERTY(EditAnywhere, Category = "Ship|Forces")
-	float ForwardThrusterForce = 5000.f;
-
-	UPROPERTY(EditAnywhere, Category = "Ship|Forces")
-	float SideThrusterForce = 5000.f;
+#pragma region Tuning
+	//Shared tuning for this class of ship, falls back to the UShipArchetype defaults when unset
+	UPROPERTY(EditAnywhere, Category = "Ship")
+	const UShipArchetype* Archetype = nullptr;
+
+#if WITH_EDITORONLY_DATA
+	//Per-pawn tuning from before UShipArchetype, still in older Blueprints. PostLoad moves overrides into an archetype
+	UPROPERTY()
+	float MaxMouseRadius_DEPRECATED = 200.f;
+	UPROPERTY()
+	float RotationInterpSpeed_DEPRECATED = 2.0f;
+	UPROPERTY()
+	float ForwardThrusterForce_DEPRECATED = 5000.f;
+	UPROPERTY()
+	float SideThrusterForce_DEPRECATED = 5000.f;
+	UPROPERTY()
+	float LandingMoveSpeed_DEPRECATED = 500.f;
+	UPROPERTY()
+	float LandingRotateSpeed_DEPRECATED = 0.5f;
+	UPROPERTY()
+	float LandingDescendSpeed_DEPRECATED = 200.f;
+#endif
 #pragma endregion
 
 #pragma region Thruster particle effects
@@ -154,20 +215,21 @@ protected:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Ship|Effects")
 	UNiagaraComponent* RightBrakeThrusterFX;
 
+	//Soft so the map doesn't wait on FX, streamed in by RequestShipAssets()
 	UPROPERTY(EditAnywhere, Category = "Ship|Effects")
-	UNiagaraSystem* MainThrusterEffect;
+	TSoftObjectPtr<UNiagaraSystem> MainThrusterEffect;
 
 	UPROPERTY(EditAnywhere, Category = "Ship|Effects")
-	UNiagaraSystem* LeftThrusterEffect;
+	TSoftObjectPtr<UNiagaraSystem> LeftThrusterEffect;
 
 	UPROPERTY(EditAnywhere, Category = "Ship|Effects")
-	UNiagaraSystem* RightThrusterEffect;
+	TSoftObjectPtr<UNiagaraSystem> RightThrusterEffect;
 
 	UPROPERTY(EditAnywhere, Category = "Ship|Effects")
-	UNiagaraSystem* LeftBrakeThrusterEffect;
+	TSoftObjectPtr<UNiagaraSystem> LeftBrakeThrusterEffect;
 
 	UPROPERTY(EditAnywhere, Category = "Ship|Effects")
-	UNiagaraSystem* RightBrakeThrusterEffect;
+	TSoftObjectPtr<UNiagaraSystem> RightBrakeThrusterEffect;
 #pragma endregion
 
 #pragma region Variables
@@ -180,28 +242,59 @@ protected:
 	bool bAllThrusters = false;
 	bool bBrake = false;
 	bool bIsLanding = false;
+
+	//What ApplyThrusters did this frame, read by the flight recorder
+	EShipThrusterFlags ActiveThrusters = EShipThrusterFlags::None;
+	FVector LastAppliedForce = FVector::ZeroVector;
+
+	TSharedPtr<FStreamableHandle> ShipAssetsHandle;
+
+	int32 AvoidanceHandle = INDEX_NONE;
 #pragma endregion
 
 #pragma region Landing
 	ALandingPad* TargetLandingPad = nullptr;
 
-	UPROPERTY(EditAnywhere, Category = "Landing")
-	float LandingMoveSpeed = 500.f;
-	UPROPERTY(EditAnywhere, Category = "Landing")
-	float LandingRotateSpeed = 0.5f;
-	UPROPERTY(EditAnywhere, Category = "Landing")
-	float LandingDescendSpeed = 200.f;
+	TArray<FVector> LandingPath;
+	int32 LandingPathIndex = 0;
+	uint32 LandingPathRequest = 0;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Landing")
 	ELandingStage LandingStage = ELandingStage::None;
 
+	//Every stage change goes through here so it reaches the event stream
+	void SetLandingStage(ELandingStage NewStage);
+
 public:
 	ALandingPad* OverlappingLandingPad = nullptr;
 #pragma endregion
 
 	UPROPERTY(EditAnywhere, Category = "Ship")
-	TSubclassOf<APawn> PlayerPawnClass;
+	TSoftClassPtr<APawn> PlayerPawnClass;
 
 	UFUNCTION()
 	void TryBoard(APlayerPawnController* PlayerPawn);
+
+	//Puts the ship straight into Stage for Pad, reserving it, for loading saved games. No pad means not landing
+	void RestoreLanding(ELandingStage Stage, ALandingPad* Pad);
+
+	//Feeds a scripted input through the same callbacks as Enhanced Input
+	void DispatchInput(EOryxInputAction Action, const FInputActionValue& Value);
+
+	//Assets every ship of ShipClass needs, preloaded once per class by UOryxShipAssetSubsystem
+	static void GetShipBundle(TSubclassOf<ASpaceshipPawn> ShipClass, TArray<FSoftObjectPath>& OutPaths);
+
+	ELandingStage GetLandingStage() const { return LandingStage; }
+	ALandingPad* GetTargetLandingPad() const { return TargetLandingPad; }
+	EShipThrusterFlags GetActiveThrusters() const { return ActiveThrusters; }
+	FVector GetLastAppliedForce() const { return LastAppliedForce; }
+	const UShipArchetype& GetArchetype() const;
+
+	//Registers DesiredVelocity with traffic avoidance and returns the velocity to actually fly at. SteerFrames is
+	//how many frames until the caller steers again
+	FVector SteerAroundTraffic(const FVector& DesiredVelocity, int32 SteerFrames = 1);
+
+	//Thruster FX, for UOryxSplitscreenSubsystem to hide per viewport and pause where no viewport shows them
+	void GetThrusterFX(TArray<UPrimitiveComponent*, TInlineAllocator<5>>& OutEffects) const;
+	void SetThrusterFXSignificant(bool bSignificant) { bThrusterFXSignificant = bSignificant; }
 };